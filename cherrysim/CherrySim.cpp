@@ -44,6 +44,8 @@
 #include <functional>
 #include <json.hpp>
 #include <fstream>
+#include <type_traits>
+#include <unordered_map>
 
 extern "C"{
 #include <dbscan.h>
@@ -94,8 +96,8 @@ using json = nlohmann::json;
 // These values may not change while simulating a node.
 //#########################################################################################
 
-CherrySim* cherrySimInstance = nullptr; // Use this to access the simulator from C functions
-NRF_UART_Type* simUartPtr = nullptr;
+SIM_THREAD_LOCAL CherrySim* cherrySimInstance = nullptr; // Use this to access the simulator from C functions, set by setNode for the calling thread
+SIM_THREAD_LOCAL NRF_UART_Type* simUartPtr = nullptr;
 bool meshGwCommunication = false;
 
 //This is normally populated by the linker script when compiling FruityMesh,
@@ -109,12 +111,16 @@ ConnTypeResolver connTypeResolvers[] = {
 // These functions can start / stop / reset the simulator
 //#########################################################################################
 
+//The header is followed by the written pages of each node. For each node there is a u32 with the number
+//of pages, followed by the pages, each one prefixed with its page number as u32. Pages that are not in
+//the file are erased.
 struct FlashFileHeader
 {
 	u32 version;
 	u32 sizeOfHeader;
 	u32 flashSize;
 	u32 amountOfNodes;
+	u32 pageSize;
 };
 
 bool CherrySim::shouldSimIvTrigger(u32 ivMs)
@@ -135,12 +141,23 @@ void CherrySim::StoreFlashToFile()
 	ffh.sizeOfHeader = sizeof(ffh);
 	ffh.flashSize = SIM_MAX_FLASH_SIZE;
 	ffh.amountOfNodes = getTotalNodes();
+	ffh.pageSize = SimFlash::PAGE_SIZE;
 
 	file.write((const char*)&ffh, sizeof(ffh));
 
 	for (u32 i = 0; i < getTotalNodes(); i++)
 	{
-		file.write((const char*)this->nodes[i].flash, SIM_MAX_FLASH_SIZE);
+		const SimFlash& flash = this->nodes[i].flash;
+		const u32 numPages = flash.GetNumWrittenPages();
+		file.write((const char*)&numPages, sizeof(numPages));
+
+		for (u32 page = 0; page < SimFlash::SIZE / SimFlash::PAGE_SIZE; page++)
+		{
+			if (flash.IsPageErased(page)) continue;
+
+			file.write((const char*)&page, sizeof(page));
+			file.write((const char*)flash.data() + page * SimFlash::PAGE_SIZE, SimFlash::PAGE_SIZE);
+		}
 	}
 }
 
@@ -148,7 +165,7 @@ void CherrySim::LoadFlashFromFile()
 {
 	if (simConfig.storeFlashToFile == "") return;
 
-	std::ifstream infile(simConfig.storeFlashToFile);
+	std::ifstream infile(simConfig.storeFlashToFile, std::ios::binary);
 
 	//If file does not exist we just return
 	if (!infile.good())
@@ -159,19 +176,53 @@ void CherrySim::LoadFlashFromFile()
 	infile.seekg(0, std::ios::end);
 	size_t length = infile.tellg();
 	infile.seekg(0, std::ios::beg);
-	char* buffer = new char[length];
-	infile.read(buffer, length);
+	std::vector<char> buffer(length);
+	infile.read(buffer.data(), length);
 
 	FlashFileHeader ffh;
 	CheckedMemset(&ffh, 0, sizeof(ffh));
-	ffh = *(FlashFileHeader*)(buffer);
+	if (length >= sizeof(ffh)) CheckedMemcpy(&ffh, buffer.data(), sizeof(ffh));
 
-	if (
-		   ffh.sizeOfHeader  != sizeof(ffh)
+	//Checks if the given amount of bytes can still be read, otherwise the file is corrupt
+	size_t readPosition = sizeof(ffh);
+	auto canRead = [&](size_t size) { return readPosition + size <= length; };
+
+	bool corrupt = 
+		   length            <  sizeof(ffh)
+		|| ffh.sizeOfHeader  != sizeof(ffh)
 		|| ffh.flashSize     != SIM_MAX_FLASH_SIZE
 		|| ffh.amountOfNodes != getTotalNodes()
-		|| length            != sizeof(ffh) + SIM_MAX_FLASH_SIZE * getTotalNodes()
-		)
+		|| ffh.pageSize      != SimFlash::PAGE_SIZE;
+
+	//The file is checked completely before anything is loaded
+	struct StoredPage
+	{
+		u32 nodeIndex;
+		u32 page;
+		size_t position;
+	};
+	std::vector<StoredPage> storedPages;
+	for (u32 i = 0; i < getTotalNodes() && !corrupt; i++)
+	{
+		u32 numPages = 0;
+		if (!canRead(sizeof(numPages))) { corrupt = true; break; }
+		CheckedMemcpy(&numPages, buffer.data() + readPosition, sizeof(numPages));
+		readPosition += sizeof(numPages);
+
+		for (u32 p = 0; p < numPages; p++)
+		{
+			u32 page = 0;
+			if (!canRead(sizeof(page) + SimFlash::PAGE_SIZE)) { corrupt = true; break; }
+			CheckedMemcpy(&page, buffer.data() + readPosition, sizeof(page));
+			readPosition += sizeof(page);
+			if (page >= SimFlash::SIZE / SimFlash::PAGE_SIZE) { corrupt = true; break; }
+
+			storedPages.push_back({ i, page, readPosition });
+			readPosition += SimFlash::PAGE_SIZE;
+		}
+	}
+
+	if (corrupt || readPosition != length)
 	{
 		//Probably the correct action if this happens is to just remove the flash safe file (see simConfig.storeFlashToFile)
 		//This is NOT automatically performed here as it would be rather rude to just remove it in case the user accidentally
@@ -180,12 +231,10 @@ void CherrySim::LoadFlashFromFile()
 		return;
 	}
 
-	for (u32 i = 0; i < getTotalNodes(); i++)
+	for (const StoredPage& storedPage : storedPages)
 	{
-		CheckedMemcpy(this->nodes[i].flash, buffer + SIM_MAX_FLASH_SIZE * i + sizeof(ffh), SIM_MAX_FLASH_SIZE);
+		CheckedMemcpy(this->nodes[storedPage.nodeIndex].flash.data() + storedPage.page * SimFlash::PAGE_SIZE, buffer.data() + storedPage.position, SimFlash::PAGE_SIZE);
 	}
-
-	delete[] buffer;
 }
 
 #define AddSimulatedFeatureSet(featureset) \
@@ -255,10 +304,19 @@ CherrySim::CherrySim(const SimConfiguration &simConfig)
 		// that we don't accidentally run the same stuff all the time.
 		SIMEXCEPTION(IllegalStateException);
 #endif
-		const std::string replayFileContents = LoadFileContents(simConfig.replayPath.c_str());
-		CheckVersionFromReplayRecord(replayFileContents);
-		replayRecordEntries = ExtractReplayRecord(replayFileContents);
-		this->simConfig = ExtractSimConfigurationFromReplayRecord(replayFileContents);
+		if (ReplayTraceReader::IsTrace(simConfig.replayPath.c_str()))
+		{
+			LoadReplayTrace();
+		}
+		else
+		{
+			const std::string replayFileContents = LoadFileContents(simConfig.replayPath.c_str());
+			CheckVersionFromReplayRecord(replayFileContents);
+			replayRecordEntries = ExtractReplayRecord(replayFileContents);
+			this->simConfig = ExtractSimConfigurationFromReplayRecord(replayFileContents);
+		}
+		//The replay must not overwrite the trace that it is read from
+		this->simConfig.replayTracePath = "";
 	}
 	//Set a reference that can be used from fruitymesh if necessary
 	cherrySimInstance = this;
@@ -313,6 +371,13 @@ void CherrySim::Init()
 
 		std::string versionString = "[!]VERSION START:[!]" + std::to_string(FM_VERSION) + "[!]VERSION END[!]";
 		TerminalPrintHandler(versionString.c_str());
+
+		if (simConfig.replayTracePath != "")
+		{
+			replayTraceWriter = std::make_unique<ReplayTraceWriter>(simConfig.replayTracePath.c_str());
+			replayTraceWriter->WriteConfiguration(configJson.dump());
+			replayTraceWriter->WriteVersion(FM_VERSION);
+		}
 	}
 
 	//Generate a psuedo random number generator with a uniform distribution
@@ -352,7 +417,7 @@ void CherrySim::Init()
 		LoadPresetNodePositions();
 	}
 
-	server = new FruitySimServer();
+	server = new FruitySimServer(this);
 }
 
 //This will load the site data from a json and will read the device json to import all devices
@@ -602,6 +667,88 @@ void CherrySim::CheckVersionFromReplayRecord(const std::string &fileContents)
 	}
 }
 
+static ReplayRecordEntry ToReplayRecordEntry(const ReplayTraceRecord& record)
+{
+	ReplayRecordEntry entry;
+	entry.index = record.index;
+	entry.time = record.timeMs;
+	entry.command.assign(record.data, record.dataLength);
+	return entry;
+}
+
+//Reads the configuration and the version of a trace up to the first command, the other commands are read while they are replayed
+void CherrySim::LoadReplayTrace()
+{
+	replayTraceReader = std::make_unique<ReplayTraceReader>(simConfig.replayPath.c_str());
+	bool versionFound = false;
+	ReplayTraceRecord record;
+	while (replayRecordEntries.empty() && replayTraceReader->Next(record))
+	{
+		if (record.type == ReplayTraceRecordType::CONFIGURATION)
+		{
+			simConfig = nlohmann::json::parse(record.data, record.data + record.dataLength);
+		}
+		else if (record.type == ReplayTraceRecordType::VERSION)
+		{
+			u32 versionFromFile = 0;
+			if (record.dataLength == sizeof(versionFromFile)) memcpy(&versionFromFile, record.data, sizeof(versionFromFile));
+			if (versionFromFile != FM_VERSION)
+			{
+				//The version from the replay file does not match the version from the current repository state.
+				SIMEXCEPTION(IllegalArgumentException);
+			}
+			versionFound = true;
+		}
+		else if (record.type == ReplayTraceRecordType::COMMAND)
+		{
+			replayRecordEntries.push(ToReplayRecordEntry(record));
+		}
+	}
+	if (!versionFound)
+	{
+		//The configuration and the version are written before the first command
+		SIMEXCEPTION(IllegalArgumentException);
+	}
+}
+
+const ReplayRecordEntry* CherrySim::PeekReplayRecordEntry()
+{
+	ReplayTraceRecord record;
+	while (replayRecordEntries.empty() && replayTraceReader != nullptr && replayTraceReader->Next(record))
+	{
+		//Commands are written in the order of the simulation time, so they can be replayed as they are read
+		if (record.type == ReplayTraceRecordType::COMMAND) replayRecordEntries.push(ToReplayRecordEntry(record));
+	}
+	return replayRecordEntries.empty() ? nullptr : &replayRecordEntries.front();
+}
+
+void CherrySim::ConvertReplayToTrace(const char* replayPath, const char* tracePath)
+{
+	const std::string replayFileContents = LoadFileContents(replayPath);
+	const std::string versionString = ExtractReplayToken(replayFileContents, "[!]VERSION START:[!]", "[!]VERSION END[!]");
+	const nlohmann::json configJson = ExtractSimConfigurationFromReplayRecord(replayFileContents);
+	std::queue<ReplayRecordEntry> entries = ExtractReplayRecord(replayFileContents);
+
+	ReplayTraceWriter writer(tracePath);
+	writer.WriteConfiguration(configJson.dump());
+	writer.WriteVersion(Utility::StringToU32(versionString.c_str()));
+	while (!entries.empty())
+	{
+		writer.WriteCommand(entries.front().index, entries.front().time, entries.front().command);
+		entries.pop();
+	}
+}
+
+void CherrySim::TraceReplayCommand(const std::string& command)
+{
+	if (replayTraceWriter != nullptr) replayTraceWriter->WriteCommand(currentNode->index, simState.simTimeMs, command);
+}
+
+void CherrySim::TraceReplayEvent(const char* event)
+{
+	if (replayTraceWriter != nullptr) replayTraceWriter->WriteEvent(currentNode->index, simState.simTimeMs, event);
+}
+
 void CherrySim::LoadPresetNodePositions()
 {
 	if (simConfig.preDefinedPositions.size() != 0)
@@ -645,6 +792,9 @@ void CherrySim::SimulateStepForAllNodes()
 	//Check if the webserver has some open requests to process
 	server->ProcessServerRequests();
 
+	//Ticks in which no node has anything to do are skipped before the next tick is simulated
+	if (simConfig.skipIdleTicks) SkipIdleTicks();
+
 	int64_t sumOfAllSimulatedFrames = 0;
 	for (u32 i = 0; i < getTotalNodes(); i++) {
 		setNode(i);
@@ -652,68 +802,273 @@ void CherrySim::SimulateStepForAllNodes()
 	}
 	const int64_t avgSimulatedFrames = sumOfAllSimulatedFrames / getTotalNodes();
 
-	while (replayRecordEntries.size() > 0 && replayRecordEntries.front().time <= simState.simTimeMs)
+	const ReplayRecordEntry* replayRecordEntry;
+	while ((replayRecordEntry = PeekReplayRecordEntry()) != nullptr && replayRecordEntry->time <= simState.simTimeMs)
 	{
-		setNode(replayRecordEntries.front().index);
+		setNode(replayRecordEntry->index);
 		GS->terminal.PutIntoTerminalCommandQueue(replayRecordEntries.front().command, false);
 		replayRecordEntries.pop();
 	}
 
+	if (simConfig.useSpatialBroadcastGrid) UpdateBroadcastGrid();
+	UpdatePathLossCache();
+
 	//printf("-- %u --" EOL, simState.simTimeMs);
-	for (u32 i = 0; i < getTotalNodes(); i++) {
-		setNode(i);
-		bool simulateNode = true;
+	if (simConfig.parallelStepThreads != 0)
+	{
+		SimulateStepForAllNodesInParallel(avgSimulatedFrames);
+	}
+	else
+	{
+		for (u32 i = 0; i < getTotalNodes(); i++) {
+			setNode(i);
+			bool simulateNode = true;
+			if (simConfig.simulateJittering)
+			{
+				const int64_t frameOffset = currentNode->simulatedFrames - avgSimulatedFrames;
+				// Sigmoid function, flipped on the Y-Axis.
+				const double probability = 1.0 / (1 + std::exp((double)(frameOffset) * 0.1));
+				const double randVal = simState.rnd.nextDouble();
+				if (randVal > probability)
+				{
+					simulateNode = false;
+				}
+			}
+			if (simulateNode)
+			{
+				SimulateStepForCurrentNode();
+			}
+
+			globalBreakCounter++;
+		}
+	}
+
+	AdvanceSimTime();
+}
+
+//Finishes a step after all nodes were simulated
+void CherrySim::AdvanceSimTime()
+{
+	//Run a check on the current clustering state
+	if (simConfig.enableClusteringValidityCheck)
+	{
+		CheckClusteringIncrementally();
+
+		//The full recomputation is too slow for every step and only cross checks the incremental check
+		if (simConfig.clusteringCrossCheckIntervalMs != 0 && simState.simTimeMs - lastClusteringCrossCheckMs >= simConfig.clusteringCrossCheckIntervalMs)
+		{
+			lastClusteringCrossCheckMs = simState.simTimeMs;
+			CheckMeshingConsistency();
+
+			//Clusters that were not touched for a long time are checked again as well, e.g. to find a corrupted cluster size
+			for (u32 i = 0; i < getTotalNodes(); i++) nodes[i].clusterCheckPending = true;
+		}
+	}
+	else
+	{
+		//Connections are not tracked while the check is disabled, so everything is checked again once it is enabled
+		clusterCheckNodeSets.Reset(0);
+		clusterCheckNodeSetsDirty = true;
+	}
+
+	simState.simTimeMs += simConfig.simTickDurationMs;
+	//Initialize RNG with new seed in order to be able to jump to a frame and resimulate it
+	simState.rnd = MersenneTwister(simState.simTimeMs + simConfig.seed);
+
+	//Back up the flash every flashToFileWriteInterval's step.
+	flashToFileWriteCycle++;
+	if (flashToFileWriteCycle % flashToFileWriteInterval == 0) StoreFlashToFile();
+}
+
+void CherrySim::SimulateStepForCurrentNode()
+{
+	StackBaseSetter sbs;
+
+	currentNode->simulatedFrames++;
+	QueueInterrupts();
+	simulateTimer();
+	simulateTimeouts();
+	//While nodes are stepped in parallel, broadcasts are simulated in a separate phase
+	if (!parallelStepActive) simulateBroadcast();
+	SimulateConnections();
+	SimulateServiceDiscovery();
+	SimulateUartInterrupts();
+#ifndef GITHUB_RELEASE
+	SimulateClcData();
+#endif //GITHUB_RELEASE
+	try {
+		FruityHal::EventLooper();
+		simulateFlashCommit();
+		simulateBatteryUsage();
+		simulateWatchDog();
+	}
+	catch (const NodeSystemResetException& e) {
+		//Node broke out of its current simulation and rebootet
+		//In a parallel step, the reset and the event happen in ApplyStepMailboxes
+		if (!parallelStepActive)
+		{
+			TraceReplayEvent("NODE_RESET");
+			if (simEventListener) simEventListener->CherrySimEventHandler("NODE_RESET");
+		}
+	}
+}
+
+//Steps all nodes using the workerPool. Nodes are simulated in two phases: First, every node runs its
+//firmware, then all nodes broadcast based on the advertising and scanning state from the first phase.
+//All effects that a node has on other nodes are collected in its outbox and are applied in the order of
+//the node indices afterwards. Together with a random number generator and global ids per node, the result
+//of a step does not depend on the number of threads or on which thread simulated which node.
+void CherrySim::SimulateStepForAllNodesInParallel(int64_t avgSimulatedFrames)
+{
+	const u32 totalNodes = getTotalNodes();
+	if (workerPool == nullptr || workerPool->GetNumThreads() != simConfig.parallelStepThreads)
+	{
+		workerPool.reset();
+		workerPool = std::make_unique<SimWorkerPool>(simConfig.parallelStepThreads);
+	}
+
+	simulateNodeInStep.assign(totalNodes, 1);
+	for (u32 i = 0; i < totalNodes; i++) {
+		nodeEntry* node = &nodes[i];
 		if (simConfig.simulateJittering)
 		{
-			const int64_t frameOffset = currentNode->simulatedFrames - avgSimulatedFrames;
+			const int64_t frameOffset = node->simulatedFrames - avgSimulatedFrames;
 			// Sigmoid function, flipped on the Y-Axis.
 			const double probability = 1.0 / (1 + std::exp((double)(frameOffset) * 0.1));
 			const double randVal = simState.rnd.nextDouble();
 			if (randVal > probability)
 			{
-				simulateNode = false;
+				simulateNodeInStep[i] = 0;
 			}
 		}
-		if (simulateNode)
-		{
-			StackBaseSetter sbs;
+		node->rnd = MersenneTwister((simState.simTimeMs + simConfig.seed) ^ (i * 2654435761u));
+		node->stepEventIdsDrawn = 0;
+		node->stepPacketIdsDrawn = 0;
+		node->outbox.clear();
+		node->resetPending = false;
+		node->stepException = nullptr;
+	}
 
-			currentNode->simulatedFrames++;
-			QueueInterrupts();
-			simulateTimer();
-			simulateTimeouts();
+	parallelStepActive = true;
+	workerPool->Run(totalNodes, [this](u32 i) {
+		if (!simulateNodeInStep[i]) return;
+		setNode(i);
+		try {
+			SimulateStepForCurrentNode();
+		}
+		catch (...) {
+			currentNode->stepException = std::current_exception();
+		}
+	});
+	workerPool->Run(totalNodes, [this](u32 i) {
+		if (!simulateNodeInStep[i] || nodes[i].resetPending || nodes[i].stepException) return;
+		setNode(i);
+		try {
+			StackBaseSetter sbs;
 			simulateBroadcast();
-			SimulateConnections();
-			SimulateServiceDiscovery();
-			SimulateUartInterrupts();
-#ifndef GITHUB_RELEASE
-			SimulateClcData();
-#endif //GITHUB_RELEASE
-			try {
-				FruityHal::EventLooper();
-				simulateFlashCommit();
-				simulateBatteryUsage();
-				simulateWatchDog();
+		}
+		catch (...) {
+			currentNode->stepException = std::current_exception();
+		}
+	});
+	parallelStepActive = false;
+
+	//The global ids that the nodes drew during the step are skipped by the counters
+	u32 maxStepEventIdsDrawn = 0;
+	u32 maxStepPacketIdsDrawn = 0;
+	for (u32 i = 0; i < totalNodes; i++) {
+		maxStepEventIdsDrawn = std::max(maxStepEventIdsDrawn, nodes[i].stepEventIdsDrawn);
+		maxStepPacketIdsDrawn = std::max(maxStepPacketIdsDrawn, nodes[i].stepPacketIdsDrawn);
+	}
+	simState.globalEventIdCounter += maxStepEventIdsDrawn * totalNodes;
+	simState.globalPacketIdCounter += maxStepPacketIdsDrawn * totalNodes;
+
+	//Exceptions are rethrown in the order of the node indices so that the same one is reported for every run
+	for (u32 i = 0; i < totalNodes; i++) {
+		if (nodes[i].stepException)
+		{
+			setNode(i);
+			std::rethrow_exception(nodes[i].stepException);
+		}
+	}
+
+	ApplyStepMailboxes();
+
+	setNode(totalNodes - 1);
+	globalBreakCounter += totalNodes;
+}
+
+void CherrySim::ApplyStepMailboxes()
+{
+	for (u32 i = 0; i < getTotalNodes(); i++) {
+		for (StepMailboxEntry& entry : nodes[i].outbox) {
+			if (entry.action)
+			{
+				if (currentNode != &nodes[i]) setNode(i);
+				entry.action();
 			}
-			catch (const NodeSystemResetException& e) {
-				//Node broke out of its current simulation and rebootet
-				if (simEventListener) simEventListener->CherrySimEventHandler("NODE_RESET");
+			//Events that belong to a connection are dropped if the connection was closed during the step
+			else if (entry.connectionHandle < 0 || findConnectionByHandle(entry.receiver, entry.connectionHandle) != nullptr)
+			{
+				entry.receiver->eventQueue.push_back(entry.event);
 			}
 		}
+		nodes[i].outbox.clear();
+	}
 
-		globalBreakCounter++;
+	for (u32 i = 0; i < getTotalNodes(); i++) {
+		if (nodes[i].resetPending)
+		{
+			nodes[i].resetPending = false;
+			setNode(i);
+			resetCurrentNode(nodes[i].pendingRebootReason, false);
+			TraceReplayEvent("NODE_RESET");
+			if (simEventListener) simEventListener->CherrySimEventHandler("NODE_RESET");
+		}
 	}
+}
 
-	//Run a check on the current clustering state
-	if(simConfig.enableClusteringValidityCheck) CheckMeshingConsistency();
+void CherrySim::PostEvent(nodeEntry* receiver, const simBleEvent& event, int connectionHandle)
+{
+	if (!parallelStepActive || receiver == currentNode)
+	{
+		receiver->eventQueue.push_back(event);
+		return;
+	}
 
-	simState.simTimeMs += simConfig.simTickDurationMs;
-	//Initialize RNG with new seed in order to be able to jump to a frame and resimulate it
-	simState.rnd = MersenneTwister(simState.simTimeMs + simConfig.seed);
+	StepMailboxEntry entry;
+	entry.receiver = receiver;
+	entry.event = event;
+	entry.connectionHandle = connectionHandle;
+	currentNode->outbox.push_back(std::move(entry));
+}
 
-	//Back up the flash every flashToFileWriteInterval's step.
-	flashToFileWriteCycle++;
-	if (flashToFileWriteCycle % flashToFileWriteInterval == 0) StoreFlashToFile();
+void CherrySim::RunOnStepBarrier(std::function<void()> action)
+{
+	if (!parallelStepActive)
+	{
+		action();
+		return;
+	}
+
+	StepMailboxEntry entry;
+	entry.action = std::move(action);
+	currentNode->outbox.push_back(std::move(entry));
+}
+
+//While nodes are stepped in parallel, every node draws from its own sequence of ids: the n-th id that the
+//node with index i draws in a step is the counter value at the beginning of the step + n * totalNodes + i.
+//Ids therefore stay unique and ascending per node and do not depend on the order in which threads run.
+u32 CherrySim::DrawGlobalEventId()
+{
+	if (!parallelStepActive) return simState.globalEventIdCounter++;
+	return simState.globalEventIdCounter + currentNode->stepEventIdsDrawn++ * getTotalNodes() + currentNode->index;
+}
+
+u32 CherrySim::DrawGlobalPacketId()
+{
+	if (!parallelStepActive) return simState.globalPacketIdCounter++;
+	return simState.globalPacketIdCounter + currentNode->stepPacketIdsDrawn++ * getTotalNodes() + currentNode->index;
 }
 
 void CherrySim::quitSimulation()
@@ -724,18 +1079,18 @@ void CherrySim::quitSimulation()
 u32 CherrySim::getTotalNodes(bool countAgain) const
 {
 	u32 counter = 0;
-	if (cherrySimInstance->totalNodes == 0 || countAgain) {
+	if (totalNodes == 0 || countAgain) {
 		for (auto it = simConfig.nodeConfigName.begin(); it != simConfig.nodeConfigName.end(); it++) {
 			counter += it->second;
 		}
-		cherrySimInstance->totalNodes = counter;
+		totalNodes = counter;
 	}
-	if (cherrySimInstance->totalNodes == 0)
+	if (totalNodes == 0)
 	{
 		// Could not find any node!
 		SIMEXCEPTION(IllegalStateException);
 	}
-	return cherrySimInstance->totalNodes;
+	return totalNodes;
 
 }
 
@@ -743,7 +1098,7 @@ u32 CherrySim::getTotalNodes(bool countAgain) const
 u32 CherrySim::getAssetNodes(bool countAgain) const
 {
 	u32 counter = 0;
-	if (cherrySimInstance->assetNodes == 0 || countAgain) {
+	if (assetNodes == 0 || countAgain) {
 		for (u32 i = 0; i < getTotalNodes(); i++)
 		{
 			NodeIndexSetter setter(i);
@@ -753,9 +1108,9 @@ u32 CherrySim::getAssetNodes(bool countAgain) const
 				counter++;
 			}
 		}
-		cherrySimInstance->assetNodes = counter;
+		assetNodes = counter;
 	}
-	return cherrySimInstance->assetNodes;
+	return assetNodes;
 }
 
 //################################## Terminal #############################################
@@ -777,6 +1132,13 @@ std::vector<std::string> tokenize(const std::string& message)
 //Terminal functions to control the simulator (CherrySim registers its TerminalCommandHandler with FruityMesh)
 TerminalCommandHandlerReturnType CherrySim::TerminalCommandHandler(const std::string& message)
 {
+	//Simulator commands may modify any node, so they have to wait until no node is stepped anymore
+	if (parallelStepActive)
+	{
+		RunOnStepBarrier([this, message]() { TerminalCommandHandler(message); });
+		return TerminalCommandHandlerReturnType::SUCCESS;
+	}
+
 	auto commandArgs = tokenize(message);
 	if (commandArgs.size() >= 2 && commandArgs[0] == "sim")
 	{
@@ -1046,6 +1408,12 @@ void CherrySim::RegisterTerminalPrintListener(TerminalPrintListener* callback)
 //Called for all terminal output from all nodes
 void CherrySim::TerminalPrintHandler(const char* message)
 {
+	if (parallelStepActive)
+	{
+		const std::string messageCopy = message;
+		RunOnStepBarrier([this, messageCopy]() { TerminalPrintHandler(messageCopy.c_str()); });
+		return;
+	}
 	if (simConfig.useLogAccumulator)
 	{
 		logAccumulator += std::string(message);
@@ -1075,6 +1443,8 @@ void CherrySim::setNode(u32 i)
 	}
 
 	//printf("**SIM**: Setting node %u\n", i+1);
+	//Several simulators can run on different threads, the thread that simulates a node uses the simulator of that node
+	cherrySimInstance = this;
 	currentNode = &nodes[i];
 
 	simGlobalStatePtr = &(nodes[i].gs);
@@ -1082,7 +1452,7 @@ void CherrySim::setNode(u32 i)
 	simFicrPtr = &(nodes[i].ficr);
 	simUicrPtr = &(nodes[i].uicr);
 	simGpioPtr = &(nodes[i].gpio);
-	simFlashPtr = nodes[i].flash;
+	simFlashPtr = nodes[i].flash.data();
 	simUartPtr = &(nodes[i].state.uartType);
 
 	__application_start_address = (uint32_t)simFlashPtr + FruityHal::GetSoftDeviceSize();
@@ -1212,8 +1582,7 @@ void CherrySim::initNode(u32 i)
 	nodes[i].index = i;
 	nodes[i].id = i + 1;
 
-	//Initialize flash memory
-	CheckedMemset(nodes[i].flash, 0xFF, sizeof(nodes[i].flash));
+	//The flash memory of the new nodeEntry is already erased
 	//TODO: We could load a softdevice and app image into flash, would that help for something?
 
 	//Generate device address based on the id
@@ -1241,8 +1610,8 @@ void CherrySim::SetFeaturesets()
 	std::vector<FeatureNameOrderPair> definedFeaturesets;
 	for (auto it = simConfig.nodeConfigName.begin(); it != simConfig.nodeConfigName.end(); it++)
 	{
-		auto entry = cherrySimInstance->featuresetPointers.find(it->first);
-		if (entry == cherrySimInstance->featuresetPointers.end())
+		auto entry = featuresetPointers.find(it->first);
+		if (entry == featuresetPointers.end())
 		{
 			SIMEXCEPTION(IllegalStateException); //Featureset is not defined yet
 		}
@@ -1374,18 +1743,24 @@ void CherrySim::bootCurrentNode()
 	currentNode->state.~SoftdeviceState();
 	new (&currentNode->state) SoftdeviceState();
 
-	//Allocate halMemory
+	//Allocate halMemory once, it is cleared on every boot
 	const u32 halMemorySize = FruityHal::GetHalMemorySize() / sizeof(u32) + 1;
-	u32* halMemory = new u32[halMemorySize];
-	CheckedMemset(halMemory, 0, halMemorySize * sizeof(u32));
-	GS->halMemory = halMemory;
+	if (currentNode->halMemory == nullptr) {
+		currentNode->halMemory = new u32[halMemorySize];
+	}
+	CheckedMemset(currentNode->halMemory, 0, halMemorySize * sizeof(u32));
+	GS->halMemory = currentNode->halMemory;
 
 	//############## Boot the node using the FruityMesh boot routine
 	BootFruityMesh();
 
-	//Create memory for modules
+	//Create memory for modules, it is only allocated again if the modules need a different size
 	const u32 moduleMemoryBlockSize = INITIALIZE_MODULES(false);
-	currentNode->moduleMemoryBlock = (u8*)new u32[moduleMemoryBlockSize / sizeof(u32) + 1];
+	if (currentNode->moduleMemoryBlock == nullptr || currentNode->moduleMemoryBlockSize != moduleMemoryBlockSize) {
+		delete[] currentNode->moduleMemoryBlock;
+		currentNode->moduleMemoryBlock = (u8*)new u32[moduleMemoryBlockSize / sizeof(u32) + 1];
+		currentNode->moduleMemoryBlockSize = moduleMemoryBlockSize;
+	}
 	GS->moduleAllocator.setMemory(currentNode->moduleMemoryBlock, moduleMemoryBlockSize);
 	//Boot the modules
 	BootModules();
@@ -1399,14 +1774,23 @@ void CherrySim::bootCurrentNode()
 }
 
 void CherrySim::resetCurrentNode(RebootReason rebootReason, bool throwException) {
+	//Resetting disconnects other nodes, so during a parallel step this is postponed until all nodes were stepped
+	if (parallelStepActive)
+	{
+		currentNode->resetPending = true;
+		currentNode->pendingRebootReason = rebootReason;
+		if (throwException)
+		{
+			throw NodeSystemResetException();
+		}
+		return;
+	}
+
 	if (simConfig.verbose) printf("Node %d resetted\n", currentNode->id);
 
-	//Save the node index because it will be gone after node shutdown
+	//Save the node index, the memory of the node is not freed as it is reused by the next boot
 	u32 index = currentNode->index;
 
-	//Clean up node
-	shutdownCurrentNode();
-
 	//Disconnect all simulator connections to this node
 	for (int i = 0; i < currentNode->state.configuredTotalConnectionCount; i++) {
 		SoftdeviceConnection* connection = &nodes[index].state.connections[i];
@@ -1430,10 +1814,11 @@ void CherrySim::resetCurrentNode(RebootReason rebootReason, bool throwException)
 
 void CherrySim::shutdownCurrentNode() {
 	delete[] currentNode->moduleMemoryBlock;
-	//Cast is needed because the following passage from the C++ Standard:
-	//"This implies that an object cannot be deleted using a pointer of type void* because there are no objects of type void"
-	u32* halMemory = (u32*)GS->halMemory;
-	delete[] halMemory;
+	currentNode->moduleMemoryBlock = nullptr;
+	currentNode->moduleMemoryBlockSize = 0;
+	delete[] currentNode->halMemory;
+	currentNode->halMemory = nullptr;
+	GS->halMemory = nullptr;
 }
 
 //################################## Flash Simulation #####################################
@@ -1454,10 +1839,10 @@ void CherrySim::simulateFlashCommit() {
 //This will loop until all flash operations (also those that are queued in response to a successfuly operation) are executed
 void CherrySim::sim_commit_flash_operations()
 {
-	if (cherrySimInstance->simConfig.simulateAsyncFlash) {
-		while (cherrySimInstance->currentNode->state.numWaitingFlashOperations > 0) {
+	if (simConfig.simulateAsyncFlash) {
+		while (currentNode->state.numWaitingFlashOperations > 0) {
 			DispatchSystemEvents(FruityHal::SystemEvents::FLASH_OPERATION_SUCCESS);
-			cherrySimInstance->currentNode->state.numWaitingFlashOperations--;
+			currentNode->state.numWaitingFlashOperations--;
 		}
 	}
 }
@@ -1466,11 +1851,11 @@ void CherrySim::sim_commit_flash_operations()
 void CherrySim::sim_commit_some_flash_operations(const uint8_t* failData, uint16_t numMaxEvents)
 {
 	u32 i = 0;
-	if (cherrySimInstance->simConfig.simulateAsyncFlash) {
-		while (cherrySimInstance->currentNode->state.numWaitingFlashOperations > 0 && i < numMaxEvents) {
+	if (simConfig.simulateAsyncFlash) {
+		while (currentNode->state.numWaitingFlashOperations > 0 && i < numMaxEvents) {
 			if (failData[i] == 0) DispatchSystemEvents(FruityHal::SystemEvents::FLASH_OPERATION_SUCCESS);
 			else DispatchSystemEvents(FruityHal::SystemEvents::FLASH_OPERATION_ERROR);
-			cherrySimInstance->currentNode->state.numWaitingFlashOperations--;
+			currentNode->state.numWaitingFlashOperations--;
 			i++;
 		}
 	}
@@ -1488,55 +1873,152 @@ void CherrySim::simulateBroadcast() {
 	if (currentNode->state.advertisingActive) {
 		if (shouldSimIvTrigger(currentNode->state.advertisingIntervalMs)) {
 			//Distribute the event to all nodes in range
-			for (u32 i = 0; i < getTotalNodes(); i++) {
-				if (i != currentNode->index) {
-
-					//If the other node is scanning
-					if (nodes[i].state.scanningActive) {
-						//If the random value hits the probability, the event is sent
-						double probability = calculateReceptionProbability(currentNode, &nodes[i]);
-						if (PSRNG() < probability) {
-							simBleEvent s;
-							s.globalId = simState.globalEventIdCounter++;
-							s.bleEvent.header.evt_id = BLE_GAP_EVT_ADV_REPORT;
-							s.bleEvent.header.evt_len = s.globalId;
-							s.bleEvent.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
-
-							CheckedMemcpy(&s.bleEvent.evt.gap_evt.params.adv_report.data, &currentNode->state.advertisingData, currentNode->state.advertisingDataLength);
-							s.bleEvent.evt.gap_evt.params.adv_report.dlen = currentNode->state.advertisingDataLength;
-							CheckedMemset(&s.bleEvent.evt.gap_evt.params.adv_report.peer_addr, 0, sizeof(s.bleEvent.evt.gap_evt.params.adv_report.peer_addr));
-							s.bleEvent.evt.gap_evt.params.adv_report.peer_addr.addr_type = (u8)currentNode->address.addr_type;
-							static_assert(sizeof(s.bleEvent.evt.gap_evt.params.adv_report.peer_addr.addr) == sizeof(currentNode->address.addr), "See next line.");
-							CheckedMemcpy(&s.bleEvent.evt.gap_evt.params.adv_report.peer_addr.addr, &currentNode->address.addr, sizeof(currentNode->address.addr));
-							//TODO: bleEvent.evt.gap_evt.params.adv_report.peer_addr = ...;
-							s.bleEvent.evt.gap_evt.params.adv_report.rssi = (i8)GetReceptionRssi(currentNode, &nodes[i]);
-							s.bleEvent.evt.gap_evt.params.adv_report.scan_rsp = 0;
-							s.bleEvent.evt.gap_evt.params.adv_report.type = (u8)currentNode->state.advertisingType;
-
-							nodes[i].eventQueue.push_back(s);
-						}
+			if (simConfig.useSpatialBroadcastGrid) {
+				//Reused buffer for the nodes that are in range, one per thread as nodes might broadcast in parallel
+				static thread_local std::vector<u32> broadcastGridNodes;
+				broadcastGrid.GetNodesAround(currentNode->index, broadcastGridNodes);
+				for (u32 i : broadcastGridNodes) {
+					if (!SimulateBroadcastToNode(&nodes[i])) return;
+				}
+			}
+			else {
+				for (u32 i = 0; i < getTotalNodes(); i++) {
+					if (i != currentNode->index) {
+						if (!SimulateBroadcastToNode(&nodes[i])) return;
 					}
-					//If the other node is connecting
-					else if (nodes[i].state.connectingActive && currentNode->state.advertisingType == FruityHal::BleGapAdvType::ADV_IND) {
-						//If the other node matches our partnerId we are connecting to
-						if (memcmp(&nodes[i].state.connectingPartnerAddr, &currentNode->address, sizeof(FruityHal::BleGapAddr)) == 0) {
-							//If the random value hits the probability, the event is sent
-							double probability = calculateReceptionProbability(currentNode, &nodes[i]);
-							if (PSRNG() < probability) {
-
-								ConnectMasterToSlave(&nodes[i], currentNode);
-
-								//Disable advertising for the own node, because this will be stopped after a connection is made
-								//Then, Immediately return to not broadcast more packets
-								currentNode->state.advertisingActive = false;
-								return;
-							}
+				}
+			}
+		}
+	}
+}
+
+//Delivers the current advertising packet of the currentNode to the given node
+//Returns false if a connection was made and no further packets should be broadcasted
+bool CherrySim::SimulateBroadcastToNode(nodeEntry* receiver) {
+	//If the other node is scanning
+	if (receiver->state.scanningActive) {
+		//If the random value hits the probability, the event is sent
+		double probability = calculateReceptionProbability(currentNode, receiver);
+		if (PSRNG() < probability) {
+			simBleEvent s;
+			s.globalId = DrawGlobalEventId();
+			s.bleEvent.header.evt_id = BLE_GAP_EVT_ADV_REPORT;
+			s.bleEvent.header.evt_len = s.globalId;
+			s.bleEvent.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
+
+			CheckedMemcpy(&s.bleEvent.evt.gap_evt.params.adv_report.data, &currentNode->state.advertisingData, currentNode->state.advertisingDataLength);
+			s.bleEvent.evt.gap_evt.params.adv_report.dlen = currentNode->state.advertisingDataLength;
+			CheckedMemset(&s.bleEvent.evt.gap_evt.params.adv_report.peer_addr, 0, sizeof(s.bleEvent.evt.gap_evt.params.adv_report.peer_addr));
+			s.bleEvent.evt.gap_evt.params.adv_report.peer_addr.addr_type = (u8)currentNode->address.addr_type;
+			static_assert(sizeof(s.bleEvent.evt.gap_evt.params.adv_report.peer_addr.addr) == sizeof(currentNode->address.addr), "See next line.");
+			CheckedMemcpy(&s.bleEvent.evt.gap_evt.params.adv_report.peer_addr.addr, &currentNode->address.addr, sizeof(currentNode->address.addr));
+			//TODO: bleEvent.evt.gap_evt.params.adv_report.peer_addr = ...;
+			s.bleEvent.evt.gap_evt.params.adv_report.rssi = (i8)GetReceptionRssi(currentNode, receiver);
+			s.bleEvent.evt.gap_evt.params.adv_report.scan_rsp = 0;
+			s.bleEvent.evt.gap_evt.params.adv_report.type = (u8)currentNode->state.advertisingType;
+
+			PostEvent(receiver, s);
+		}
+	}
+	//If the other node is connecting
+	else if (receiver->state.connectingActive && currentNode->state.advertisingType == FruityHal::BleGapAdvType::ADV_IND) {
+		//If the other node matches our partnerId we are connecting to
+		if (memcmp(&receiver->state.connectingPartnerAddr, &currentNode->address, sizeof(FruityHal::BleGapAddr)) == 0) {
+			//If the random value hits the probability, the event is sent
+			double probability = calculateReceptionProbability(currentNode, receiver);
+			if (PSRNG() < probability) {
+
+				if (parallelStepActive) {
+					nodeEntry* slave = currentNode;
+					RunOnStepBarrier([this, receiver, slave]() {
+						if (receiver->state.connectingActive && memcmp(&receiver->state.connectingPartnerAddr, &slave->address, sizeof(FruityHal::BleGapAddr)) == 0) {
+							ConnectMasterToSlave(receiver, slave);
 						}
-					}
+						else {
+							slave->state.advertisingActive = true;
+						}
+					});
+				}
+				else {
+					ConnectMasterToSlave(receiver, currentNode);
 				}
+
+				//Disable advertising for the own node, because this will be stopped after a connection is made
+				//Then, Immediately return to not broadcast more packets
+				currentNode->state.advertisingActive = false;
+				return false;
 			}
 		}
 	}
+	return true;
+}
+
+//Calculates the distance after which no node can receive any advertising packet from any other node anymore
+float CherrySim::GetMaxReceptionRangeInMeters()
+{
+	i32 maxTxSum = INT32_MIN;
+	for (u32 i = 0; i < getTotalNodes(); i++) {
+		maxTxSum = std::max(maxTxSum, (i32)nodes[i].gs.boardconf.configuration.calibratedTX + Conf::defaultDBmTX);
+	}
+
+	//With rssi noise, a packet might still be received a few dBm below the cutoff
+	//The standard deviation of the noise is below 2 dBm at the cutoff, so we allow for 4 times that
+	const float noiseMargin = simConfig.rssiNoise ? 8.0f : 0.0f;
+
+	return (float)pow(10, (maxTxSum - MIN_RECEPTION_RSSI + noiseMargin) / (10 * N));
+}
+
+//Brings the broadcast grid up to date with the current node positions and transmission powers
+void CherrySim::UpdateBroadcastGrid()
+{
+	const float range = GetMaxReceptionRangeInMeters();
+	if (range != broadcastGrid.GetCellSize()) {
+		broadcastGrid.Reset(getTotalNodes(), range);
+	}
+
+	//Positions might have been written directly to the nodeEntry (e.g. by json import or tests)
+	for (u32 i = 0; i < getTotalNodes(); i++) {
+		UpdateBroadcastGridNode(i);
+	}
+}
+
+//Recalculates the path loss for all nodes whose position or impossibleConnections changed since the last step
+void CherrySim::UpdatePathLossCache()
+{
+	const u32 totalNodes = getTotalNodes();
+	const float range = GetMaxReceptionRangeInMeters();
+	const std::array<float, 4> parameters = { (float)simConfig.mapWidthInMeters, (float)simConfig.mapHeightInMeters, (float)simConfig.mapElevationInMeters, range };
+	if (pathLossCache.GetNumNodes() != totalNodes || parameters != pathLossCacheParameters) {
+		pathLossCache.Reset(totalNodes);
+		pathLossCacheParameters = parameters;
+	}
+
+	//Positions might have been written directly to the nodeEntry (e.g. by json import or tests)
+	for (u32 i = 0; i < totalNodes; i++) {
+		pathLossCache.UpdateNode(i, nodes[i].x, nodes[i].y, nodes[i].z, nodes[i].impossibleConnection);
+	}
+
+	for (u32 dirtyIndex : pathLossCache.GetDirtyNodes()) {
+		const nodeEntry* dirtyNode = &nodes[dirtyIndex];
+		pathLossCache.RemoveNode(dirtyIndex);
+		for (u32 i = 0; i < totalNodes; i++) {
+			if (i == dirtyIndex) continue;
+			//The sparse cache only keeps nodes in reception range, all others are calculated on demand
+			if (!pathLossCache.IsDense() && GetDistanceBetween(dirtyNode, &nodes[i]) > range) continue;
+			pathLossCache.Set(dirtyIndex, i, CalculatePathLoss(dirtyNode, &nodes[i]));
+		}
+	}
+	pathLossCache.ClearDirty();
+}
+
+void CherrySim::UpdateBroadcastGridNode(u32 nodeIndex)
+{
+	const nodeEntry* node = &nodes[nodeIndex];
+	broadcastGrid.UpdateNode(
+		nodeIndex,
+		node->x * simConfig.mapWidthInMeters,
+		node->y * simConfig.mapHeightInMeters,
+		node->z * simConfig.mapElevationInMeters);
 }
 
 ble_gap_addr_t CherrySim::Convert(const FruityHal::BleGapAddr* address)
@@ -1621,7 +2103,7 @@ void CherrySim::ConnectMasterToSlave(nodeEntry* master, nodeEntry* slave)
 
 	//Generate an event for the current node
 	simBleEvent s2;
-	s2.globalId = simState.globalEventIdCounter++;
+	s2.globalId = DrawGlobalEventId();
 	s2.bleEvent.header.evt_id = BLE_GAP_EVT_CONNECTED;
 	s2.bleEvent.header.evt_len = s2.globalId;
 	s2.bleEvent.evt.gap_evt.conn_handle = simState.globalConnHandleCounter;
@@ -1675,7 +2157,7 @@ void CherrySim::ConnectMasterToSlave(nodeEntry* master, nodeEntry* slave)
 
 	//Generate an event for the remote node
 	simBleEvent s;
-	s.globalId = simState.globalEventIdCounter++;
+	s.globalId = DrawGlobalEventId();
 	s.bleEvent.header.evt_id = BLE_GAP_EVT_CONNECTED;
 	s.bleEvent.header.evt_len = s.globalId;
 	s.bleEvent.evt.gap_evt.conn_handle = simState.globalConnHandleCounter;
@@ -1689,6 +2171,11 @@ void CherrySim::ConnectMasterToSlave(nodeEntry* master, nodeEntry* slave)
 
 	//Disable connecting for the other node because we just got the remote SoftDevice a connection
 	master->state.connectingActive = false;
+
+	//Both nodes are now part of the same set for the incremental clustering check
+	if (!clusterCheckNodeSetsDirty) clusterCheckNodeSets.Union(master->index, slave->index);
+	master->clusterCheckPending = true;
+	slave->clusterCheckPending = true;
 }
 
 u32 CherrySim::DisconnectSimulatorConnection(SoftdeviceConnection* connection, u32 hciReason, u32 hciReasonPartner) {
@@ -1721,17 +2208,15 @@ u32 CherrySim::DisconnectSimulatorConnection(SoftdeviceConnection* connection, u
 		SIMEXCEPTIONFORCE(IllegalStateException);
 	}
 
-	//Clear the transmitbuffers for both nodes
+	//Clear the transmitbuffers for our node, the partners buffers are cleared below
 	CheckedMemset(connection->reliableBuffers, 0x00, sizeof(connection->reliableBuffers));
 	CheckedMemset(connection->unreliableBuffers, 0x00, sizeof(connection->unreliableBuffers));
-	CheckedMemset(partnerConnection->reliableBuffers, 0x00, sizeof(connection->reliableBuffers));
-	CheckedMemset(partnerConnection->unreliableBuffers, 0x00, sizeof(connection->unreliableBuffers));
 
 	//#### Our own node
 	connection->connectionActive = false;
 
 	simBleEvent s1;
-	s1.globalId = simState.globalEventIdCounter++;
+	s1.globalId = DrawGlobalEventId();
 	s1.bleEvent.header.evt_id = BLE_GAP_EVT_DISCONNECTED;
 	s1.bleEvent.header.evt_len = s1.globalId;
 	s1.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
@@ -1739,17 +2224,41 @@ u32 CherrySim::DisconnectSimulatorConnection(SoftdeviceConnection* connection, u
 	connection->owningNode->eventQueue.push_back(s1);
 
 	//#### Remote node
+	if (parallelStepActive) {
+		const u16 connectionHandle = connection->connectionHandle;
+		RunOnStepBarrier([this, partnerNode, partnerConnection, connectionHandle, hciReasonPartner]() {
+			//The partner might have closed its side during the same step
+			if (partnerConnection->connectionActive && partnerConnection->connectionHandle == connectionHandle) {
+				DisconnectPartnerConnection(partnerNode, partnerConnection, hciReasonPartner);
+			}
+		});
+	}
+	else {
+		DisconnectPartnerConnection(partnerNode, partnerConnection, hciReasonPartner);
+	}
+
+	return NRF_SUCCESS;
+}
+
+void CherrySim::DisconnectPartnerConnection(nodeEntry* partnerNode, SoftdeviceConnection* partnerConnection, u32 hciReasonPartner)
+{
+	CheckedMemset(partnerConnection->reliableBuffers, 0x00, sizeof(partnerConnection->reliableBuffers));
+	CheckedMemset(partnerConnection->unreliableBuffers, 0x00, sizeof(partnerConnection->unreliableBuffers));
+
 	partnerConnection->connectionActive = false;
 
+	//The sets of the incremental clustering check can not be split, so they are rebuilt after the step
+	clusterCheckNodeSetsDirty = true;
+	partnerNode->clusterCheckPending = true;
+	partnerConnection->partner->clusterCheckPending = true;
+
 	simBleEvent s2;
-	s2.globalId = simState.globalEventIdCounter++;
+	s2.globalId = DrawGlobalEventId();
 	s2.bleEvent.header.evt_id = BLE_GAP_EVT_DISCONNECTED;
 	s2.bleEvent.header.evt_len = s2.globalId;
 	s2.bleEvent.evt.gap_evt.conn_handle = partnerConnection->connectionHandle;
 	s2.bleEvent.evt.gap_evt.params.disconnected.reason = hciReasonPartner;
 	partnerNode->eventQueue.push_back(s2);
-
-	return NRF_SUCCESS;
 }
 
 void CherrySim::simulateTimeouts() {
@@ -1757,7 +2266,7 @@ void CherrySim::simulateTimeouts() {
 		currentNode->state.connectingActive = false;
 
 		simBleEvent s;
-		s.globalId = simState.globalEventIdCounter++;
+		s.globalId = DrawGlobalEventId();
 		s.bleEvent.header.evt_id = BLE_GAP_EVT_TIMEOUT;
 		s.bleEvent.header.evt_len = s.globalId;
 		s.bleEvent.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
@@ -1770,7 +2279,7 @@ void CherrySim::simulateTimeouts() {
 void CherrySim::SimulateUartInterrupts()
 {
 	const SoftdeviceState &state = currentNode->state;
-	while (state.uartReadIndex != state.uartBufferLength && cherrySimInstance->currentNode->state.currentlyEnabledUartInterrupts != 0) {
+	while (state.uartReadIndex != state.uartBufferLength && currentNode->state.currentlyEnabledUartInterrupts != 0) {
 		UART0_IRQHandler();
 	}
 }
@@ -1818,7 +2327,7 @@ void CherrySim::SendUnreliableTxCompleteEvent(nodeEntry* node, int connHandle, u
 {
 	if (packetCount > 0) {
 		simBleEvent s2;
-		s2.globalId = simState.globalEventIdCounter++;
+		s2.globalId = DrawGlobalEventId();
 		s2.bleEvent.header.evt_id = BLE_GATTC_EVT_WRITE_CMD_TX_COMPLETE;
 		s2.bleEvent.header.evt_len = s2.globalId;
 		s2.bleEvent.evt.gattc_evt.conn_handle = connHandle;
@@ -1914,7 +2423,7 @@ void CherrySim::SimulateConnections() {
 						//Generate the event that the write was successful immediately
 						//TODO: Could be postponed a bit to better match the real world
 						simBleEvent s2;
-						s2.globalId = simState.globalEventIdCounter++;
+						s2.globalId = DrawGlobalEventId();
 						s2.bleEvent.header.evt_id = BLE_GATTC_EVT_WRITE_RSP;
 						s2.bleEvent.header.evt_len = s2.globalId;
 						s2.bleEvent.evt.gattc_evt.conn_handle = connection->connectionHandle;
@@ -1948,7 +2457,7 @@ void CherrySim::SimulateConnections() {
 				nodeEntry* slave = i == 0 ? currentNode : connection->partner;
 
 				simBleEvent s;
-				s.globalId = simState.globalEventIdCounter++;
+				s.globalId = DrawGlobalEventId();
 				s.bleEvent.header.evt_id = BLE_GAP_EVT_RSSI_CHANGED;
 				s.bleEvent.header.evt_len = s.globalId;
 				s.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
@@ -1959,7 +2468,14 @@ void CherrySim::SimulateConnections() {
 		}
 	}
 
-	//Simulate Connection Loss every second
+	SimulateConnectionLoss();
+}
+
+//Simulate Connection Loss every second
+//Returns true if a connection was lost
+bool CherrySim::SimulateConnectionLoss()
+{
+	bool connectionLost = false;
 	if (simConfig.connectionTimeoutProbabilityPerSec != 0) {
 		for (int i = 0; i < currentNode->state.configuredTotalConnectionCount; i++) {
 			if (currentNode->state.connections[i].connectionActive) {
@@ -1967,10 +2483,12 @@ void CherrySim::SimulateConnections() {
 					SIMSTATCOUNT("simulatedTimeouts");
 					printf("Simulated Connection Loss for node %d to partner %d (handle %d)" EOL, currentNode->id, currentNode->state.connections[i].partner->id, currentNode->state.connections[i].connectionHandle);
 					DisconnectSimulatorConnection(&currentNode->state.connections[i], BLE_HCI_CONNECTION_TIMEOUT, BLE_HCI_CONNECTION_TIMEOUT);
+					connectionLost = true;
 				}
 			}
 		}
 	}
+	return connectionLost;
 }
 
 //This function generates a WRITE event and a TX for two nodes that want to send data
@@ -1997,7 +2515,7 @@ void CherrySim::GenerateWrite(SoftDeviceBufferedPacket* bufferedPacket) {
 
 	//Generate WRITE event at our partners side
 	simBleEvent s;
-	s.globalId = simState.globalEventIdCounter++;
+	s.globalId = DrawGlobalEventId();
 	s.bleEvent.header.evt_id = BLE_GATTS_EVT_WRITE;
 	s.bleEvent.header.evt_len = s.globalId;
 
@@ -2031,7 +2549,7 @@ void CherrySim::GenerateWrite(SoftDeviceBufferedPacket* bufferedPacket) {
 	s.bleEvent.evt.gatts_evt.params.write.offset = 0;
 	s.bleEvent.evt.gatts_evt.params.write.op = p_write_params.write_op;
 
-	receiver->eventQueue.push_back(s);
+	PostEvent(receiver, s, conn_handle);
 }
 
 void CherrySim::GenerateNotification(SoftDeviceBufferedPacket* bufferedPacket) {
@@ -2057,7 +2575,7 @@ void CherrySim::GenerateNotification(SoftDeviceBufferedPacket* bufferedPacket) {
 
 	//Generate HVX event at our partners side
 	simBleEvent s;
-	s.globalId = simState.globalEventIdCounter++;
+	s.globalId = DrawGlobalEventId();
 	s.bleEvent.header.evt_id = BLE_GATTC_EVT_HVX;
 	s.bleEvent.header.evt_len = s.globalId;
 	s.bleEvent.evt.gattc_evt.conn_handle = conn_handle;
@@ -2070,7 +2588,7 @@ void CherrySim::GenerateNotification(SoftDeviceBufferedPacket* bufferedPacket) {
 	s.bleEvent.evt.gattc_evt.params.hvx.len = (u16)(u32)hvx_params.p_len;
 	s.bleEvent.evt.gattc_evt.params.hvx.type = hvx_params.type;
 
-	receiver->eventQueue.push_back(s);
+	PostEvent(receiver, s, conn_handle);
 }
 
 void CherrySim::StartServiceDiscovery(u16 connHandle, const ble_uuid_t &p_uuid, int discoveryTimeMs)
@@ -2279,11 +2797,128 @@ void CherrySim::simulateWatchDog()
 #endif
 }
 
+//################################## Idle Tick Skipping ###################################
+// Ticks in which no node has anything to do but advancing its clock are skipped cheaply
+//#########################################################################################
+
+static bool IsIntervalDue(u32 timeMs, u32 ivMs)
+{
+	return ivMs != 0 && (timeMs % ivMs) == 0;
+}
+
+//Returns how many of the next ticks (at most maxTicks) the currentNode would only advance its clock in.
+//This must mirror SimulateStepForCurrentNode, each check is conservative and stops the skipping at
+//the first tick in which something could happen. The app timer triggers at the same times as without
+//skipping so that the firmware observes the same appTimerDs and SHOULD_IV_TRIGGER results.
+u32 CherrySim::GetNumIdleTicksOfCurrentNode(u32 maxTicks, bool broadcastsAreReceived)
+{
+	const nodeEntry* node = currentNode;
+	const SoftdeviceState& state = node->state;
+
+	//Everything that already waits for the node is handled in the next tick
+	if (node->eventQueue.size() > 0
+		|| node->interruptQueue.size() > 0
+		|| (node->lastMovementSimTimeMs != 0 && node->lastMovementSimTimeMs + 2000 > simState.simTimeMs)
+		|| state.numWaitingFlashOperations > 0
+		|| state.uartReadIndex != state.uartBufferLength
+		|| state.discoveryDoneTime != 0
+		|| node->gs.passsedTimeSinceLastTimerHandlerDs != 0
+		|| node->gs.button1HoldTimeDs != 0
+		|| currentNode->gs.terminal.HasQueuedTerminalCommands())
+	{
+		return 0;
+	}
+
+	const u32 appTimerIntervalMs = 100L * MAIN_TIMER_TICK * 10 / ticksPerSecond;
+
+	for (u32 tick = 1; tick <= maxTicks; tick++) {
+		//The time of the node and of the simulation during the step that simulates this tick
+		const u32 timeMs = state.timeMs + tick * simConfig.simTickDurationMs;
+		const u32 simTimeMs = simState.simTimeMs + (tick - 1) * simConfig.simTickDurationMs;
+
+		if (IsIntervalDue(timeMs, appTimerIntervalMs)) return tick - 1;
+		if (state.advertisingActive && broadcastsAreReceived && IsIntervalDue(timeMs, state.advertisingIntervalMs)) return tick - 1;
+		if (state.connectingActive && state.connectingTimeoutTimestampMs <= (i32)simTimeMs) return tick - 1;
+#ifndef GITHUB_RELEASE
+		if (IsIntervalDue(timeMs, 30000)) return tick - 1;
+#endif //GITHUB_RELEASE
+#ifdef FM_WATCHDOG_TIMEOUT
+		if (simConfig.simulateWatchdog && timeMs - node->lastWatchdogFeedTime > node->watchdogTimeout) return tick - 1;
+#endif
+
+		for (int i = 0; i < state.configuredTotalConnectionCount; i++) {
+			const SoftdeviceConnection* connection = &state.connections[i];
+			if (!connection->connectionActive) continue;
+
+			u16 connectionIntervalMs = connection->connectionInterval;
+			if (connectionIntervalMs == (int)7.5f) connectionIntervalMs = 10;
+
+			if (IsIntervalDue(timeMs, connectionIntervalMs) && getNextPacketToWrite(const_cast<SoftdeviceConnection*>(connection)) != nullptr) return tick - 1;
+			if (connection->rssiMeasurementActive && IsIntervalDue(timeMs, 5000)) return tick - 1;
+		}
+	}
+
+	return maxTicks;
+}
+
+//Advances the simulation until the next tick in which any node has something to do
+void CherrySim::SkipIdleTicks()
+{
+	//These modes rely on every tick being simulated
+	if (simConfig.simulateJittering || simConfig.realTime || meshGwCommunication) return;
+
+	//Advertising packets only have an effect if any node receives them
+	bool broadcastsAreReceived = false;
+	for (u32 i = 0; i < getTotalNodes(); i++) {
+		if (nodes[i].state.scanningActive || nodes[i].state.connectingActive) {
+			broadcastsAreReceived = true;
+			break;
+		}
+	}
+
+	u32 idleTicks = maxIdleTicksPerStep;
+	if (const ReplayRecordEntry* replayRecordEntry = PeekReplayRecordEntry()) {
+		const u32 replayTimeMs = replayRecordEntry->time;
+		if (replayTimeMs <= simState.simTimeMs) return;
+		idleTicks = std::min(idleTicks, (replayTimeMs - simState.simTimeMs + simConfig.simTickDurationMs - 1) / simConfig.simTickDurationMs);
+	}
+
+	for (u32 i = 0; i < getTotalNodes() && idleTicks > 0; i++) {
+		setNode(i);
+		idleTicks = GetNumIdleTicksOfCurrentNode(idleTicks, broadcastsAreReceived);
+	}
+
+	for (u32 i = 0; i < idleTicks; i++) {
+		//A lost connection queues events, so the following ticks are not idle anymore
+		if (SimulateIdleTickForAllNodes()) break;
+	}
+}
+
+//Does everything that a step does for a tick in which no node has anything to do
+//Returns true if a connection was lost during the tick
+bool CherrySim::SimulateIdleTickForAllNodes()
+{
+	bool connectionLost = false;
+	for (u32 i = 0; i < getTotalNodes(); i++) {
+		setNode(i);
+		currentNode->simulatedFrames++;
+		currentNode->state.timeMs += simConfig.simTickDurationMs;
+		simulateBatteryUsage();
+		if (!blockConnections && SimulateConnectionLoss()) connectionLost = true;
+
+		globalBreakCounter++;
+	}
+
+	AdvanceSimTime();
+
+	return connectionLost;
+}
+
 struct InterruptGuard
 {
 	//Protects us against interrupting inside an interrupt using RAII.
 
-	static inline bool currentlyInAnInterrupt = false;
+	static inline thread_local bool currentlyInAnInterrupt = false;
 
 	InterruptGuard() {
 		currentlyInAnInterrupt = true;
@@ -2298,7 +2933,7 @@ void CherrySim::SimulateInterrupts()
 {
 	if (currentNode->interruptQueue.size() > 0 && InterruptGuard::currentlyInAnInterrupt == false)
 	{
-		const double randVal = simState.rnd.nextDouble();
+		const double randVal = GetRnd().nextDouble();
 		if (randVal <= simConfig.interruptProbability)
 		{
 			InterruptGuard guard;
@@ -2306,7 +2941,7 @@ void CherrySim::SimulateInterrupts()
 			u32 pin = currentNode->interruptQueue.front();
 			currentNode->interruptQueue.pop();
 
-			if (cherrySimInstance->currentNode->gpioInitializedPins.find(pin) != cherrySimInstance->currentNode->gpioInitializedPins.end()) {
+			if (currentNode->gpioInitializedPins.find(pin) != currentNode->gpioInitializedPins.end()) {
 				InterruptSettings &settings = currentNode->gpioInitializedPins[pin];
 				if (settings.isEnabled)
 				{
@@ -2318,11 +2953,443 @@ void CherrySim::SimulateInterrupts()
 	}
 }
 
+//################################## Snapshots ############################################
+// Stores and restores the complete state of the simulator and all nodes
+//#########################################################################################
+
+constexpr u32 SNAPSHOT_MAGIC = 0x4E535343; //"CSSN"
+constexpr u32 SNAPSHOT_VERSION = 2;
+constexpr u32 SNAPSHOT_END_OF_PAGES = 0xFFFFFFFF;
+
+class SnapshotWriter
+{
+private:
+	std::vector<u8>& buffer;
+
+public:
+	explicit SnapshotWriter(std::vector<u8>& buffer) : buffer(buffer) {}
+
+	void WriteBytes(const void* data, size_t length)
+	{
+		const u8* bytes = (const u8*)data;
+		buffer.insert(buffer.end(), bytes, bytes + length);
+	}
+
+	template<typename T>
+	void Write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be written directly");
+		WriteBytes(&value, sizeof(T));
+	}
+
+	void WriteString(const std::string& value)
+	{
+		Write((u32)value.size());
+		WriteBytes(value.data(), value.size());
+	}
+};
+
+class SnapshotReader
+{
+private:
+	const std::vector<u8>& buffer;
+	size_t position = 0;
+
+public:
+	explicit SnapshotReader(const std::vector<u8>& buffer) : buffer(buffer) {}
+
+	//Returns false and leaves data untouched if the snapshot is too short
+	bool ReadBytes(void* data, size_t length)
+	{
+		if (length > buffer.size() - position) return false;
+		CheckedMemcpy((u8*)data, buffer.data() + position, length);
+		position += length;
+		return true;
+	}
+
+	template<typename T>
+	bool Read(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be read directly");
+		return ReadBytes(&value, sizeof(T));
+	}
+
+	bool ReadString(std::string& value)
+	{
+		u32 length = 0;
+		if (!Read(length) || length > buffer.size() - position) return false;
+		value.assign((const char*)buffer.data() + position, length);
+		position += length;
+		return true;
+	}
+
+	bool IsAtEnd() const
+	{
+		return position == buffer.size();
+	}
+};
+
+//Returns the range of a member within the GlobalState
+template<typename T>
+static std::pair<size_t, size_t> GetGlobalStateMemberRange(const GlobalState& gs, const T& member)
+{
+	return { (size_t)((const u8*)&member - (const u8*)&gs), sizeof(T) };
+}
+
+void CherrySim::WriteGlobalStateSnapshot(SnapshotWriter& writer, const GlobalState& gs)
+{
+	//The bytes of the members that own memory are written as well, but are skipped when reading
+	writer.WriteBytes(&gs, sizeof(GlobalState));
+
+	writer.WriteString(gs.logger.currentString);
+	std::queue<TerminalCommandQueueEntry> terminalCommandQueue = gs.terminal.terminalCommandQueue;
+	writer.Write((u32)terminalCommandQueue.size());
+	for (; !terminalCommandQueue.empty(); terminalCommandQueue.pop())
+	{
+		writer.WriteString(terminalCommandQueue.front().terminalCommand);
+		writer.Write(terminalCommandQueue.front().skipCrcCheck);
+	}
+}
+
+bool CherrySim::ReadGlobalStateSnapshot(SnapshotReader& reader, GlobalState& gs)
+{
+	std::vector<u8> rawState(sizeof(GlobalState));
+	std::string currentString;
+	std::queue<TerminalCommandQueueEntry> terminalCommandQueue;
+	u32 count = 0;
+	if (!reader.ReadBytes(rawState.data(), rawState.size()) || !reader.ReadString(currentString) || !reader.Read(count)) return false;
+	for (u32 i = 0; i < count; i++)
+	{
+		TerminalCommandQueueEntry entry;
+		if (!reader.ReadString(entry.terminalCommand) || !reader.Read(entry.skipCrcCheck)) return false;
+		terminalCommandQueue.push(std::move(entry));
+	}
+
+	//Copying the bytes of a std::string or std::queue would leak their memory and later free the memory of the snapshot's
+	//simulator, so only the bytes around them are copied. All members that own memory must be listed here.
+	std::array<std::pair<size_t, size_t>, 2> skippedRanges = { {
+		GetGlobalStateMemberRange(gs, gs.logger.currentString),
+		GetGlobalStateMemberRange(gs, gs.terminal.terminalCommandQueue),
+	} };
+	std::sort(skippedRanges.begin(), skippedRanges.end());
+	size_t offset = 0;
+	for (const std::pair<size_t, size_t>& range : skippedRanges)
+	{
+		CheckedMemcpy((u8*)&gs + offset, rawState.data() + offset, range.first - offset);
+		offset = range.first + range.second;
+	}
+	CheckedMemcpy((u8*)&gs + offset, rawState.data() + offset, sizeof(GlobalState) - offset);
+
+	gs.logger.currentString = std::move(currentString);
+	gs.terminal.terminalCommandQueue = std::move(terminalCommandQueue);
+
+	return true;
+}
+
+void CherrySim::WriteNodeSnapshot(SnapshotWriter& writer, const nodeEntry& node)
+{
+	writer.Write(node.id);
+	writer.Write(node.x);
+	writer.Write(node.y);
+	writer.Write(node.z);
+	writer.WriteString(node.nodeConfiguration);
+	writer.Write(node.address);
+
+	//The firmware state is copied as is, including its pointers and virtual tables, which is why
+	//the snapshot can only be restored into the same memory
+	WriteGlobalStateSnapshot(writer, node.gs);
+#ifndef GITHUB_RELEASE
+	writer.WriteBytes(&node.clcMock, sizeof(ClcMock));
+#endif //GITHUB_RELEASE
+	//The modules only hold fixed size members, their virtual tables stay valid as the same modules are at the same place
+	writer.Write((uint64_t)(uintptr_t)node.moduleMemoryBlock);
+	writer.Write(node.moduleMemoryBlockSize);
+	writer.WriteBytes(node.moduleMemoryBlock, node.moduleMemoryBlockSize);
+	writer.Write((uint64_t)(uintptr_t)node.halMemory);
+	if (node.halMemory != nullptr) writer.WriteBytes(node.halMemory, FruityHal::GetHalMemorySize());
+
+	writer.Write(node.ficr);
+	writer.Write(node.uicr);
+	writer.Write(node.gpio);
+
+	//Only pages that were written to are stored
+	for (u32 page = 0; page < SimFlash::SIZE / SimFlash::PAGE_SIZE; page++)
+	{
+		if (node.flash.IsPageErased(page)) continue;
+		writer.Write(page);
+		writer.WriteBytes(node.flash.data() + page * SimFlash::PAGE_SIZE, SimFlash::PAGE_SIZE);
+	}
+	writer.Write(SNAPSHOT_END_OF_PAGES);
+
+	writer.Write(node.state);
+	writer.Write((u32)node.eventQueue.size());
+	for (const simBleEvent& event : node.eventQueue) writer.Write(event);
+	writer.Write(node.currentEvent);
+	writer.Write(node.ledOn);
+	writer.Write(node.nanoAmperePerMsTotal);
+
+	writer.Write(node.restartCounter);
+	writer.Write(node.simulatedFrames);
+	writer.Write(node.watchdogTimeout);
+	writer.Write(node.lastWatchdogFeedTime);
+	writer.Write(node.rebootReason);
+
+	writer.Write((u32)node.impossibleConnection.size());
+	for (int impossibleConnection : node.impossibleConnection) writer.Write(impossibleConnection);
+	writer.Write((u32)node.gpioInitializedPins.size());
+	for (const auto& pin : node.gpioInitializedPins)
+	{
+		writer.Write(pin.first);
+		writer.Write(pin.second);
+	}
+	std::queue<u32> interruptQueue = node.interruptQueue;
+	writer.Write((u32)interruptQueue.size());
+	for (; !interruptQueue.empty(); interruptQueue.pop()) writer.Write(interruptQueue.front());
+
+	writer.Write(node.bmgWasInit);
+	writer.Write(node.twiWasInit);
+	writer.Write(node.Tlv49dA1b6WasInit);
+	writer.Write(node.spiWasInit);
+	writer.Write(node.lis2dh12WasInit);
+	writer.Write(node.bme280WasInit);
+	writer.Write(node.lastMovementSimTimeMs);
+	writer.Write(node.fakeDfuVersion);
+	writer.Write(node.fakeDfuVersionArmed);
+
+	writer.Write(node.bleStackType);
+	writer.Write(node.bleStackMaxTotalConnections);
+	writer.Write(node.bleStackMaxPeripheralConnections);
+	writer.Write(node.bleStackMaxCentralConnections);
+
+	writer.Write(node.sentPackets);
+	writer.Write(node.routedPackets);
+	writer.Write(node.rnd);
+}
+
+bool CherrySim::ReadNodeSnapshot(SnapshotReader& reader, nodeEntry& node)
+{
+	bool ok = reader.Read(node.id)
+		&& reader.Read(node.x)
+		&& reader.Read(node.y)
+		&& reader.Read(node.z)
+		&& reader.ReadString(node.nodeConfiguration)
+		&& reader.Read(node.address);
+	if (!ok) return false;
+
+	//The memory blocks of the firmware must still be at the same place, otherwise its pointers would be wrong
+	uint64_t moduleMemoryBlock = 0;
+	u32 moduleMemoryBlockSize = 0;
+	uint64_t halMemory = 0;
+	ok = ReadGlobalStateSnapshot(reader, node.gs)
+#ifndef GITHUB_RELEASE
+		&& reader.ReadBytes(&node.clcMock, sizeof(ClcMock))
+#endif //GITHUB_RELEASE
+		&& reader.Read(moduleMemoryBlock)
+		&& reader.Read(moduleMemoryBlockSize)
+		&& moduleMemoryBlock == (uint64_t)(uintptr_t)node.moduleMemoryBlock
+		&& moduleMemoryBlockSize == node.moduleMemoryBlockSize
+		&& reader.ReadBytes(node.moduleMemoryBlock, moduleMemoryBlockSize)
+		&& reader.Read(halMemory)
+		&& halMemory == (uint64_t)(uintptr_t)node.halMemory
+		&& (node.halMemory == nullptr || reader.ReadBytes(node.halMemory, FruityHal::GetHalMemorySize()));
+	if (!ok) return false;
+
+	ok = reader.Read(node.ficr)
+		&& reader.Read(node.uicr)
+		&& reader.Read(node.gpio);
+	if (!ok) return false;
+
+	node.flash.EraseAll();
+	u32 page = 0;
+	while (true)
+	{
+		if (!reader.Read(page)) return false;
+		if (page == SNAPSHOT_END_OF_PAGES) break;
+		if (page >= SimFlash::SIZE / SimFlash::PAGE_SIZE) return false;
+		if (!reader.ReadBytes(node.flash.data() + page * SimFlash::PAGE_SIZE, SimFlash::PAGE_SIZE)) return false;
+	}
+
+	u32 count = 0;
+	if (!reader.Read(node.state) || !reader.Read(count)) return false;
+	node.eventQueue.clear();
+	for (u32 i = 0; i < count; i++)
+	{
+		simBleEvent event;
+		if (!reader.Read(event)) return false;
+		node.eventQueue.push_back(event);
+	}
+	ok = reader.Read(node.currentEvent)
+		&& reader.Read(node.ledOn)
+		&& reader.Read(node.nanoAmperePerMsTotal)
+		&& reader.Read(node.restartCounter)
+		&& reader.Read(node.simulatedFrames)
+		&& reader.Read(node.watchdogTimeout)
+		&& reader.Read(node.lastWatchdogFeedTime)
+		&& reader.Read(node.rebootReason);
+	if (!ok) return false;
+
+	if (!reader.Read(count)) return false;
+	node.impossibleConnection.clear();
+	for (u32 i = 0; i < count; i++)
+	{
+		int impossibleConnection = 0;
+		if (!reader.Read(impossibleConnection)) return false;
+		node.impossibleConnection.push_back(impossibleConnection);
+	}
+	if (!reader.Read(count)) return false;
+	node.gpioInitializedPins.clear();
+	for (u32 i = 0; i < count; i++)
+	{
+		u32 pin = 0;
+		InterruptSettings settings;
+		if (!reader.Read(pin) || !reader.Read(settings)) return false;
+		node.gpioInitializedPins[pin] = settings;
+	}
+	if (!reader.Read(count)) return false;
+	node.interruptQueue = {};
+	for (u32 i = 0; i < count; i++)
+	{
+		u32 pin = 0;
+		if (!reader.Read(pin)) return false;
+		node.interruptQueue.push(pin);
+	}
+
+	ok = reader.Read(node.bmgWasInit)
+		&& reader.Read(node.twiWasInit)
+		&& reader.Read(node.Tlv49dA1b6WasInit)
+		&& reader.Read(node.spiWasInit)
+		&& reader.Read(node.lis2dh12WasInit)
+		&& reader.Read(node.bme280WasInit)
+		&& reader.Read(node.lastMovementSimTimeMs)
+		&& reader.Read(node.fakeDfuVersion)
+		&& reader.Read(node.fakeDfuVersionArmed)
+		&& reader.Read(node.bleStackType)
+		&& reader.Read(node.bleStackMaxTotalConnections)
+		&& reader.Read(node.bleStackMaxPeripheralConnections)
+		&& reader.Read(node.bleStackMaxCentralConnections)
+		&& reader.Read(node.sentPackets)
+		&& reader.Read(node.routedPackets)
+		&& reader.Read(node.rnd);
+	if (!ok) return false;
+
+	//Only used during a parallel step
+	node.outbox.clear();
+	node.resetPending = false;
+	node.pendingRebootReason = RebootReason::UNKNOWN;
+	node.stepException = nullptr;
+
+	return true;
+}
+
+std::vector<u8> CherrySim::CreateSnapshot() const
+{
+	if (parallelStepActive) SIMEXCEPTION(IllegalStateException);
+
+	std::vector<u8> snapshot;
+	SnapshotWriter writer(snapshot);
+
+	writer.Write(SNAPSHOT_MAGIC);
+	writer.Write(SNAPSHOT_VERSION);
+	writer.Write((u32)FM_VERSION);
+	writer.Write((u32)sizeof(nodeEntry));
+	writer.Write((u32)sizeof(GlobalState));
+	writer.Write(getTotalNodes());
+	writer.Write((uint64_t)(uintptr_t)nodes);
+
+	writer.Write(simState.simTimeMs);
+	writer.Write(simState.rnd);
+	writer.Write(simState.globalConnHandleCounter);
+	writer.Write(simState.globalEventIdCounter);
+	writer.Write(simState.globalPacketIdCounter);
+	writer.Write(globalBreakCounter);
+	writer.Write(blockConnections);
+	writer.Write(flashToFileWriteCycle);
+	writer.WriteString(logAccumulator);
+
+	for (u32 i = 0; i < getTotalNodes(); i++)
+	{
+		WriteNodeSnapshot(writer, nodes[i]);
+	}
+
+	return snapshot;
+}
+
+bool CherrySim::RestoreSnapshot(const std::vector<u8>& snapshot)
+{
+	if (parallelStepActive) SIMEXCEPTION(IllegalStateException);
+
+	SnapshotReader reader(snapshot);
+
+	u32 magic = 0;
+	u32 version = 0;
+	u32 fmVersion = 0;
+	u32 nodeEntrySize = 0;
+	u32 globalStateSize = 0;
+	u32 numNodes = 0;
+	uint64_t nodesAddress = 0;
+	const bool headerOk = reader.Read(magic)
+		&& reader.Read(version)
+		&& reader.Read(fmVersion)
+		&& reader.Read(nodeEntrySize)
+		&& reader.Read(globalStateSize)
+		&& reader.Read(numNodes)
+		&& reader.Read(nodesAddress);
+	if (
+		!headerOk
+		|| magic != SNAPSHOT_MAGIC
+		|| version != SNAPSHOT_VERSION
+		|| fmVersion != FM_VERSION
+		|| nodeEntrySize != sizeof(nodeEntry)
+		|| globalStateSize != sizeof(GlobalState)
+		|| numNodes != getTotalNodes()
+		|| nodesAddress != (uint64_t)(uintptr_t)nodes
+	) {
+		//The snapshot was created by a different build or a different simulator
+		SIMEXCEPTION(CorruptOrOutdatedSavefile);
+		return false;
+	}
+
+	bool ok = reader.Read(simState.simTimeMs)
+		&& reader.Read(simState.rnd)
+		&& reader.Read(simState.globalConnHandleCounter)
+		&& reader.Read(simState.globalEventIdCounter)
+		&& reader.Read(simState.globalPacketIdCounter)
+		&& reader.Read(globalBreakCounter)
+		&& reader.Read(blockConnections)
+		&& reader.Read(flashToFileWriteCycle)
+		&& reader.ReadString(logAccumulator);
+
+	for (u32 i = 0; i < getTotalNodes() && ok; i++)
+	{
+		ok = ReadNodeSnapshot(reader, nodes[i]);
+	}
+
+	if (!ok || !reader.IsAtEnd())
+	{
+		//A partially restored simulation can not be continued
+		SIMEXCEPTION(CorruptOrOutdatedSavefile);
+		return false;
+	}
+
+	setNode(0);
+
+	//The state of the incremental clustering check is not part of the snapshot, mismatches that were
+	//found before belong to a different simulation
+	clusterCheckNodeSets.Reset(0);
+	clusterCheckNodeSetsDirty = true;
+	clusteringMismatchCount = 0;
+	lastClusteringCrossCheckMs = simState.simTimeMs;
+
+	return true;
+}
+
 //################################## Validity Checks ######################################
 // This section contains methods that check the meshing for validity
 //#########################################################################################
 
-//This method can be used to check the clustering for potential errors after each simulation step
+//This method can be used to check the clustering for potential errors. As it recomputes the clustering of the whole
+//mesh, it is only run every clusteringCrossCheckIntervalMs to cross check CheckClusteringIncrementally, set the
+//interval to the simTickDurationMs to run it after each simulation step.
 //Once a clustering error occurs, simply enable checking through the simConfig. Whenever a potential
 //clustering issue occurs, it will print a warning and break in the debugger. It might however generate
 //false positives. A tip for using this: Enable it and let it run through a simulation without node terminal output.
@@ -2392,7 +3459,7 @@ void CherrySim::CheckMeshingConsistency()
 			MeshConnection* conn = conns.handles[k].GetConnection();
 
 			if (conn->handshakeDone()) {
-				PacketQueue* queue = &(conn->packetSendQueueHighPrio);
+				PooledPacketQueue* queue = &(conn->packetSendQueueHighPrio);
 				for (u32 m = 0; m < queue->_numElements; m++) {
 					SizedData data = queue->PeekNext(m);
 					if (data.length >= SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + SIZEOF_CONN_PACKET_CLUSTER_INFO_UPDATE) {
@@ -2608,6 +3675,220 @@ ClusterSize CherrySim::DetermineClusterSizeAndPropagateClusterUpdates(nodeEntry*
 	return size;
 }
 
+bool CherrySim::IsClusterSizeChange(const u8* data, u32 length)
+{
+	if (length < SIZEOF_CONN_PACKET_CLUSTER_INFO_UPDATE) return false;
+
+	const connPacketClusterInfoUpdate* packet = (const connPacketClusterInfoUpdate*)data;
+	return packet->header.messageType == MessageType::CLUSTER_INFO_UPDATE && packet->payload.clusterSizeChange != 0;
+}
+
+bool CherrySim::IsClusterSizeChange(const SoftDeviceBufferedPacket& packet)
+{
+	if (packet.sender == nullptr) return false;
+
+	// This is a workaround for hvxParams keeping only pointer to len.
+	const u32 length = packet.isHvx ? (u16)(u32)packet.params.hvxParams.p_len : packet.params.writeParams.len;
+	return IsClusterSizeChange(packet.data, length);
+}
+
+bool CherrySim::IsClusterSizeChange(const simBleEvent& event)
+{
+	if (event.bleEvent.header.evt_id == BLE_GATTS_EVT_WRITE) {
+		const ble_gatts_evt_write_t& write = event.bleEvent.evt.gatts_evt.params.write;
+		return IsClusterSizeChange(write.data, write.len);
+	}
+	else if (event.bleEvent.header.evt_id == BLE_GATTC_EVT_HVX) {
+		const ble_gattc_evt_hvx_t& hvx = event.bleEvent.evt.gattc_evt.params.hvx;
+		return IsClusterSizeChange(hvx.data, hvx.len);
+	}
+	return false;
+}
+
+void CherrySim::ClusterSizeChangeQueued(const SoftDeviceBufferedPacket& packet)
+{
+	//Only touches the current node so that it can be called while nodes are stepped in parallel
+	if (IsClusterSizeChange(packet)) {
+		currentNode->clusterSizeChangesQueued++;
+		currentNode->clusterCheckPending = true;
+	}
+}
+
+void CherrySim::ClusterSizeChangeDelivered(const simBleEvent& event)
+{
+	if (IsClusterSizeChange(event)) {
+		currentNode->clusterSizeChangesDelivered++;
+		currentNode->clusterCheckPending = true;
+	}
+}
+
+//Merges the nodes of all simulator connections into sets and counts the cluster size changes that are
+//still in flight. Packets that were lost together with a connection are no longer counted afterwards.
+void CherrySim::RebuildClusterCheckNodeSets()
+{
+	const u32 totalNodes = getTotalNodes();
+	clusterCheckNodeSets.Reset(totalNodes);
+
+	for (u32 i = 0; i < totalNodes; i++)
+	{
+		nodeEntry* node = &nodes[i];
+		node->clusterSizeChangesQueued = 0;
+		node->clusterSizeChangesDelivered = 0;
+
+		for (u32 k = 0; k < node->state.configuredTotalConnectionCount; k++)
+		{
+			const SoftdeviceConnection& sc = node->state.connections[k];
+			if (!sc.connectionActive) continue;
+
+			clusterCheckNodeSets.Union(i, sc.partner->index);
+
+			for (u32 m = 0; m < SIM_NUM_RELIABLE_BUFFERS; m++) {
+				if (IsClusterSizeChange(sc.reliableBuffers[m])) node->clusterSizeChangesQueued++;
+			}
+			for (u32 m = 0; m < SIM_NUM_UNRELIABLE_BUFFERS; m++) {
+				if (IsClusterSizeChange(sc.unreliableBuffers[m])) node->clusterSizeChangesQueued++;
+			}
+		}
+
+		//Changes in the eventQueue are counted as if the receiver had queued them, which gives the same sum for the set
+		for (const simBleEvent& event : node->eventQueue) {
+			if (IsClusterSizeChange(event)) node->clusterSizeChangesQueued++;
+		}
+	}
+
+	clusterCheckNodeSetsDirty = false;
+}
+
+//A node is settled once the firmware knows all of its connections, all mesh connections are handshaked and
+//no cluster size change is waiting to be sent. Must be called with the node set as the currentNode.
+bool CherrySim::IsClusteringOfNodeSettled(nodeEntry* node)
+{
+	for (u32 k = 0; k < node->state.configuredTotalConnectionCount; k++)
+	{
+		const SoftdeviceConnection& sc = node->state.connections[k];
+		if (!sc.connectionActive) continue;
+
+		const BaseConnection* bc = node->gs.cm.GetRawConnectionFromHandle(sc.connectionHandle);
+		if (bc == nullptr || bc->connectionType == ConnectionType::RESOLVER) return false;
+		if (bc->connectionType == ConnectionType::FRUITYMESH && !bc->handshakeDone()) return false;
+	}
+
+	MeshConnections conns = node->gs.cm.GetMeshConnections(ConnectionDirection::INVALID);
+	for (u32 k = 0; k < conns.count; k++)
+	{
+		MeshConnection* conn = conns.handles[k].GetConnection();
+
+		//Without a simulator connection, the disconnect event is still waiting in the eventQueue
+		if (!conn->handshakeDone() || findConnectionByHandle(node, conn->connectionHandle) == nullptr) return false;
+		if (conn->currentClusterInfoUpdatePacket.payload.clusterSizeChange != 0) return false;
+
+		PooledPacketQueue* queue = &(conn->packetSendQueueHighPrio);
+		for (u32 m = 0; m < queue->_numElements; m++) {
+			SizedData data = queue->PeekNext(m);
+			if (data.length > SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED
+				&& IsClusterSizeChange(data.data + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, data.length - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+//Checks the clustering after each step without recomputing it for the whole mesh. Only the sets of nodes
+//that were touched by a connection change or a cluster size change are checked, and only once no more cluster
+//size changes are in flight in the set. Then, each node must know the exact size of the cluster it is part of.
+//In contrast to CheckMeshingConsistency, updates are not predicted while they travel through the mesh.
+void CherrySim::CheckClusteringIncrementally()
+{
+	const u32 totalNodes = getTotalNodes();
+	if (clusterCheckNodeSets.GetNumElements() != totalNodes)
+	{
+		//Nothing is known about the clustering yet, so all nodes are checked once
+		for (u32 i = 0; i < totalNodes; i++) nodes[i].clusterCheckPending = true;
+		clusterCheckNodeSetsDirty = true;
+	}
+	if (clusterCheckNodeSetsDirty) RebuildClusterCheckNodeSets();
+
+	std::unordered_map<u32, i32> changesInFlight;
+	for (u32 i = 0; i < totalNodes; i++) {
+		if (nodes[i].clusterCheckPending) changesInFlight[clusterCheckNodeSets.Find(i)] = 0;
+	}
+	if (changesInFlight.empty()) return;
+
+	std::unordered_map<u32, std::vector<nodeEntry*>> setsToCheck;
+	for (u32 i = 0; i < totalNodes; i++) {
+		auto entry = changesInFlight.find(clusterCheckNodeSets.Find(i));
+		if (entry == changesInFlight.end()) continue;
+
+		entry->second += (i32)nodes[i].clusterSizeChangesQueued - (i32)nodes[i].clusterSizeChangesDelivered;
+		setsToCheck[entry->first].push_back(&nodes[i]);
+	}
+
+	const u32 previousNodeIndex = currentNode != nullptr ? currentNode->index : 0;
+	const u32 numNoneAssetNodes = totalNodes - getAssetNodes();
+	std::vector<u8> visited(totalNodes, 0);
+	std::vector<nodeEntry*> cluster;
+
+	for (auto& set : setsToCheck)
+	{
+		//The set is checked again after the next step
+		if (changesInFlight[set.first] != 0) continue;
+
+		bool settled = true;
+		for (nodeEntry* node : set.second) {
+			if (node->index >= numNoneAssetNodes) continue;
+			setNode(node->index);
+			if (!IsClusteringOfNodeSettled(node)) {
+				settled = false;
+				break;
+			}
+		}
+		if (!settled) continue;
+
+		//A set can contain several clusters as only handshaked mesh connections join nodes into a cluster
+		for (nodeEntry* start : set.second)
+		{
+			if (start->index >= numNoneAssetNodes || visited[start->index]) continue;
+
+			cluster.clear();
+			cluster.push_back(start);
+			visited[start->index] = 1;
+			for (size_t c = 0; c < cluster.size(); c++)
+			{
+				nodeEntry* node = cluster[c];
+				setNode(node->index);
+				MeshConnections conns = node->gs.cm.GetMeshConnections(ConnectionDirection::INVALID);
+				for (u32 k = 0; k < conns.count; k++)
+				{
+					const SoftdeviceConnection* sc = findConnectionByHandle(node, conns.handles[k].GetConnection()->connectionHandle);
+					nodeEntry* partner = sc->partner;
+					if (visited[partner->index]) continue;
+
+					const BaseConnection* partnerConnection = partner->gs.cm.GetRawConnectionFromHandle(sc->connectionHandle);
+					if (partnerConnection == nullptr || partnerConnection->connectionType != ConnectionType::FRUITYMESH) continue;
+
+					visited[partner->index] = 1;
+					cluster.push_back(partner);
+				}
+			}
+
+			for (nodeEntry* node : cluster)
+			{
+				if (node->gs.node.clusterSize != (ClusterSize)cluster.size()) {
+					printf("NODE %d has a cluster size of %d but is part of a settled cluster of %u nodes" EOL, node->id, node->gs.node.clusterSize, (u32)cluster.size());
+					printf("-------- CLUSTERING MISMATCH -----------" EOL);
+					clusteringMismatchCount++;
+				}
+			}
+		}
+
+		for (nodeEntry* node : set.second) node->clusterCheckPending = false;
+	}
+
+	if (currentNode == nullptr || currentNode->index != previousNodeIndex) setNode(previousNodeIndex);
+}
+
 //################################## Configuration Management #############################
 // 
 //#########################################################################################
@@ -2775,22 +4056,50 @@ float CherrySim::GetReceptionRssi(const nodeEntry* sender, const nodeEntry* rece
 	return GetReceptionRssi(sender, receiver, sender->gs.boardconf.configuration.calibratedTX, Conf::defaultDBmTX);
 }
 
-float CherrySim::GetReceptionRssi(const nodeEntry* sender, const nodeEntry* receiver, int8_t senderDbmTx, int8_t senderCalibratedTx) {
+//Returns the path loss in dB between two nodes, which only depends on their distance
+float CherrySim::CalculatePathLoss(const nodeEntry* nodeA, const nodeEntry* nodeB) {
 	// If either the sender or the receiver has the other marked as as a impossibleConnection, the rssi is set to a unconnectable level.
-	if (   std::find(sender  ->impossibleConnection.begin(), sender  ->impossibleConnection.end(), receiver->index) != sender  ->impossibleConnection.end()
-		|| std::find(receiver->impossibleConnection.begin(), receiver->impossibleConnection.end(), sender  ->index) != receiver->impossibleConnection.end())
+	if (   std::find(nodeA->impossibleConnection.begin(), nodeA->impossibleConnection.end(), nodeB->index) != nodeA->impossibleConnection.end()
+		|| std::find(nodeB->impossibleConnection.begin(), nodeB->impossibleConnection.end(), nodeA->index) != nodeB->impossibleConnection.end())
+	{
+		return PathLossCache::IMPOSSIBLE;
+	}
+	float dist = GetDistanceBetween(nodeA, nodeB);
+	return log10(dist) * 10 * N;
+}
+
+//Returns the rssi without the random noise, it does not change the random state of the simulation
+float CherrySim::GetReceptionRssiNoNoise(const nodeEntry* sender, const nodeEntry* receiver) {
+	float pathLoss;
+	if (!pathLossCache.Get(sender->index, receiver->index, pathLoss))
+	{
+		pathLoss = CalculatePathLoss(sender, receiver);
+	}
+	if (pathLoss == PathLossCache::IMPOSSIBLE)
+	{
+		return -10000;
+	}
+	return (sender->gs.boardconf.configuration.calibratedTX + Conf::defaultDBmTX) - pathLoss;
+}
+
+float CherrySim::GetReceptionRssi(const nodeEntry* sender, const nodeEntry* receiver, int8_t senderDbmTx, int8_t senderCalibratedTx) {
+	float pathLoss;
+	if (!pathLossCache.Get(sender->index, receiver->index, pathLoss))
+	{
+		pathLoss = CalculatePathLoss(sender, receiver);
+	}
+	if (pathLoss == PathLossCache::IMPOSSIBLE)
 	{
 		return -10000;
 	}
-	float dist = GetDistanceBetween(sender, receiver);
 	if (!simConfig.rssiNoise)
 	{
-		return (senderDbmTx + senderCalibratedTx) - log10(dist) * 10 * N;
+		return (senderDbmTx + senderCalibratedTx) - pathLoss;
 	}
 	/*The rssi noise is modeled based on the paper http://www1.cs.columbia.edu/~andreaf/downloads/01331706.pdf */
-	float rssi = (senderDbmTx + senderCalibratedTx) - log10(dist) * 10 * N;
+	float rssi = (senderDbmTx + senderCalibratedTx) - pathLoss;
 	float rssiNoiseStd = (float)(0.0497 * rssi + 6.3438);
-	float randomNoise = (float)cherrySimInstance->simState.rnd.nextNormal(0.0, rssiNoiseStd);
+	float randomNoise = (float)GetRnd().nextNormal(0.0, rssiNoiseStd);
 	return rssi + randomNoise;
 }
 
@@ -2801,7 +4110,7 @@ double CherrySim::calculateReceptionProbability(const nodeEntry* sendingNode, co
 	if (rssi > -60) return 0.9;
 	else if (rssi > -80) return 0.8;
 	else if (rssi > -85) return 0.5;
-	else if (rssi > -90) return 0.3;
+	else if (rssi > MIN_RECEPTION_RSSI) return 0.3;
 	else return 0;
 }
 
@@ -2861,6 +4170,8 @@ bool CherrySim::SetPosition(u32 nodeIndex, float x, float y, float z)
 		nodes[nodeIndex].x = x;
 		nodes[nodeIndex].y = y;
 		nodes[nodeIndex].z = z;
+		if (simConfig.useSpatialBroadcastGrid && broadcastGrid.GetCellSize() > 0) UpdateBroadcastGridNode(nodeIndex);
+		pathLossCache.MarkDirty(nodeIndex);
 		return true;
 	}
 	return false;
@@ -2873,6 +4184,8 @@ bool CherrySim::AddPosition(u32 nodeIndex, float x, float y, float z)
 		nodes[nodeIndex].x += x;
 		nodes[nodeIndex].y += y;
 		nodes[nodeIndex].z += z;
+		if (simConfig.useSpatialBroadcastGrid && broadcastGrid.GetCellSize() > 0) UpdateBroadcastGridNode(nodeIndex);
+		pathLossCache.MarkDirty(nodeIndex);
 		return true;
 	}
 
@@ -2919,6 +4232,14 @@ void CherrySim::AddMessageToStats(PacketStat* statArray, u8* message, u16 messag
 
 	PacketStat packet;
 
+	//Count each of the messages that were packed into a single write
+	if (splitHeader->splitMessageType == MessageType::AGGREGATED_WRITE_CMD) {
+		for (u16 i = SIZEOF_CONN_PACKET_AGGREGATION_HEADER; i + 1 < messageLength; i += 1 + message[i]) {
+			AddMessageToStats(statArray, message + i + 1, message[i]);
+		}
+		return;
+	}
+
 	//Check if it is the first part of a split message or not
 	if (splitHeader->splitMessageType == MessageType::SPLIT_WRITE_CMD && splitHeader->splitCounter == 0) {
 		packet.isSplit = true;
@@ -44,7 +44,14 @@ into all files in order to rewrite macros and other calls.
 #include <Terminal.h>
 #include <LedWrapper.h>
 #include <CherrySimTypes.h>
+#include <SpatialGrid.h>
+#include <SimWorkerPool.h>
+#include <PathLossCache.h>
+#include <ReplayTrace.h>
+#include <UnionFind.h>
 #include <map>
+#include <memory>
+#include <array>
 #include <chrono>
 #include <string>
 
@@ -61,6 +68,8 @@ struct ReplayRecordEntry
 };
 
 
+class SnapshotWriter;
+class SnapshotReader;
 
 class CherrySim
 {
@@ -73,9 +82,10 @@ public:
 	volatile bool receivedDataFromMeshGw = false;
 	SimConfiguration simConfig; //The current configuration for the simulator
 	SimulatorState simState; //The current state of the simulator
-	nodeEntry* currentNode = nullptr; //A pointer to the current node under simulation
+	static inline thread_local nodeEntry* currentNode = nullptr; //A pointer to the current node under simulation, thread local so that nodes can be stepped in parallel
 	nodeEntry* nodes = nullptr; //A pointer that points to the memory that holds the complete state of all nodes
 	std::string logAccumulator;
+	u32 clusteringMismatchCount = 0; //Counts the potential clustering mismatches found by the incremental validity check
 
 	CherrySimEventListener* simEventListener = nullptr;
 
@@ -96,24 +106,48 @@ public:
 
 	std::map<std::string, FeaturesetPointers> featuresetPointers;
 
-	std::queue<ReplayRecordEntry> replayRecordEntries;
-
+	std::queue<ReplayRecordEntry> replayRecordEntries; //Read ahead from the replayTraceReader one at a time if the replay is a trace
+	std::unique_ptr<ReplayTraceReader> replayTraceReader;
+	std::unique_ptr<ReplayTraceWriter> replayTraceWriter; //Only used if simConfig.logReplayCommands and simConfig.replayTracePath are set
 
 	static std::string LoadFileContents(const char* path);
 	static std::string ExtractReplayToken(const std::string &fileContents, const std::string &startToken, const std::string &endToken);
 	static std::queue<ReplayRecordEntry> ExtractReplayRecord(const std::string &fileContents);
 	static SimConfiguration ExtractSimConfigurationFromReplayRecord(const std::string &fileContents);
 	static void CheckVersionFromReplayRecord(const std::string &fileContents);
+	static void ConvertReplayToTrace(const char* replayPath, const char* tracePath); //Converts a logged text replay to the binary trace format
 
 private:
-	u32 totalNodes = 0;
-	u32 assetNodes = 0;
+	mutable u32 totalNodes = 0; //Counted on first use
+	mutable u32 assetNodes = 0;
 	constexpr static float N = 2.5; //Our calibration value for distance calculation
+	constexpr static float MIN_RECEPTION_RSSI = -90; //Packets with an rssi at or below this value are never received
 	TerminalPrintListener* terminalPrintListener = nullptr;
 	FruitySimServer* server = nullptr;
 
 	std::chrono::time_point<std::chrono::steady_clock> lastTick;
 
+	SpatialGrid broadcastGrid; //Only used if simConfig.useSpatialBroadcastGrid is set
+
+	PathLossCache pathLossCache;
+	std::array<float, 4> pathLossCacheParameters = {}; //Map dimensions and reception range the cache was built for
+
+	std::unique_ptr<SimWorkerPool> workerPool; //Only used if simConfig.parallelStepThreads is not 0
+	bool parallelStepActive = false; //True while the nodes are stepped by the workerPool
+	std::vector<u8> simulateNodeInStep; //Decided upfront for each node as the decision uses simState.rnd
+
+	UnionFind clusterCheckNodeSets; //Nodes that are linked by a simulator connection, only used if simConfig.enableClusteringValidityCheck is set
+	bool clusterCheckNodeSetsDirty = true; //Set once a connection was removed, as the sets can only be merged
+	u32 lastClusteringCrossCheckMs = 0;
+
+	static constexpr u32 maxIdleTicksPerStep = 100; //Only used if simConfig.skipIdleTicks is set, limits how far a single step may advance the simulation
+
+	float GetMaxReceptionRangeInMeters();
+	void UpdateBroadcastGrid();
+	void UpdateBroadcastGridNode(u32 nodeIndex);
+	void UpdatePathLossCache();
+	float CalculatePathLoss(const nodeEntry* nodeA, const nodeEntry* nodeB);
+
 	bool shouldSimIvTrigger(u32 ivMs);
 
 	void StoreFlashToFile();
@@ -121,6 +155,25 @@ private:
 	void PrepareSimulatedFeatureSets();
 	void QueueInterrupts();
 
+	void SimulateStepForCurrentNode();
+	void SimulateStepForAllNodesInParallel(int64_t avgSimulatedFrames);
+	void ApplyStepMailboxes();
+	void AdvanceSimTime();
+
+	void LoadReplayTrace();
+	const ReplayRecordEntry* PeekReplayRecordEntry(); //Returns the next command of the replay, nullptr once the replay is done
+	void TraceReplayEvent(const char* event);
+
+	void SkipIdleTicks();
+	u32 GetNumIdleTicksOfCurrentNode(u32 maxTicks, bool broadcastsAreReceived);
+	bool SimulateIdleTickForAllNodes();
+
+	static void WriteNodeSnapshot(SnapshotWriter& writer, const nodeEntry& node);
+	static bool ReadNodeSnapshot(SnapshotReader& reader, nodeEntry& node);
+	//The firmware state is stored as is, except for the members that own memory, which are stored by value
+	static void WriteGlobalStateSnapshot(SnapshotWriter& writer, const GlobalState& gs);
+	static bool ReadGlobalStateSnapshot(SnapshotReader& reader, GlobalState& gs);
+
 public:
 	//#### Simulation Control
 	explicit CherrySim(const SimConfiguration &simConfig);
@@ -134,12 +187,28 @@ public:
 	void SimulateStepForAllNodes(); //Simulates on timestep for all nodes
 	void quitSimulation();
 
+	//#### Parallel Stepping
+	//While nodes are stepped in parallel, they must not modify other nodes or the simulator directly
+	MersenneTwister& GetRnd() { return parallelStepActive ? currentNode->rnd : simState.rnd; }
+	bool IsParallelStepActive() const { return parallelStepActive; }
+	void PostEvent(nodeEntry* receiver, const simBleEvent& event, int connectionHandle = -1); //Puts the event into the eventQueue of the receiver
+	void RunOnStepBarrier(std::function<void()> action); //Runs the action once no other node is stepped anymore
+	u32 DrawGlobalEventId();
+	u32 DrawGlobalPacketId();
+
+	//#### Snapshots
+	//A snapshot holds the complete state of the simulator and all nodes. As the firmware state contains pointers,
+	//a snapshot can only be restored into the simulator that created it, e.g. to start several tests from the same state.
+	std::vector<u8> CreateSnapshot() const;
+	bool RestoreSnapshot(const std::vector<u8>& snapshot);
+
 	//#### Terminal
 	#ifdef TERMINAL_ENABLED
 	TerminalCommandHandlerReturnType TerminalCommandHandler(const std::string& message);
 	#endif // Inherited via TerminalCommandListener
 	void RegisterTerminalPrintListener(TerminalPrintListener* callback); // Register a class that will be notified when sth. is printed to the Terminal
 	void TerminalPrintHandler(const char* message); //Called for all simulator output
+	void TraceReplayCommand(const std::string& command); //Streams a command that the current node executes to the replay trace
 
 	//#### Node Lifecycle
 	void setNode(u32 i);
@@ -178,10 +247,12 @@ public:
 
 	//GAP Simulation
 	void simulateBroadcast();
+	bool SimulateBroadcastToNode(nodeEntry* receiver);
 	static ble_gap_addr_t Convert(const FruityHal::BleGapAddr* address);
 	static FruityHal::BleGapAddr Convert(const ble_gap_addr_t* p_addr);
 	void ConnectMasterToSlave(nodeEntry * master, nodeEntry* slave);
 	u32 DisconnectSimulatorConnection(SoftdeviceConnection * connection, u32 hciReason, u32 hciReasonPartner);
+	void DisconnectPartnerConnection(nodeEntry* partnerNode, SoftdeviceConnection* partnerConnection, u32 hciReasonPartner);
 	void simulateTimeouts();
 
 	//UART Simulation
@@ -189,6 +260,7 @@ public:
 
 	//GATT Simulation
 	void SimulateConnections();
+	bool SimulateConnectionLoss();
 	void SendUnreliableTxCompleteEvent(nodeEntry* node, int connHandle, u8 packetCount);
 	void GenerateWrite(SoftDeviceBufferedPacket* bufferedPacket);
 	void GenerateNotification(SoftDeviceBufferedPacket* bufferedPacket);
@@ -217,6 +289,14 @@ public:
 	//Validity Checking
 	void CheckMeshingConsistency();
 	ClusterSize DetermineClusterSizeAndPropagateClusterUpdates(nodeEntry* node, nodeEntry* startNode);
+	void CheckClusteringIncrementally();
+	void RebuildClusterCheckNodeSets();
+	bool IsClusteringOfNodeSettled(nodeEntry* node);
+	static bool IsClusterSizeChange(const u8* data, u32 length);
+	static bool IsClusterSizeChange(const SoftDeviceBufferedPacket& packet);
+	static bool IsClusterSizeChange(const simBleEvent& event);
+	void ClusterSizeChangeQueued(const SoftDeviceBufferedPacket& packet); //Called for each packet that the current node puts into its SoftDevice buffers
+	void ClusterSizeChangeDelivered(const simBleEvent& event); //Called for each event that the current node takes from its eventQueue
 
 	//Configuration
 	void SetCustomAdvertisingModuleConfig();
@@ -238,6 +318,7 @@ public:
 	float GetDistanceBetween(const nodeEntry * nodeA, const nodeEntry * nodeB);
 	float GetReceptionRssi(const nodeEntry * sender, const nodeEntry * receiver);
 	float GetReceptionRssi(const nodeEntry* sender, const nodeEntry* receiver, int8_t senderDbmTx, int8_t senderCalibratedTx);
+	float GetReceptionRssiNoNoise(const nodeEntry* sender, const nodeEntry* receiver);
 	double calculateReceptionProbability(const nodeEntry* sendingNode, const nodeEntry* receivingNode);
 
 	SoftdeviceConnection* findConnectionByHandle(nodeEntry* node, int connectionHandle);
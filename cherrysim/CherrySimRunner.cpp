@@ -82,6 +82,13 @@ int main(int argc, char** argv) {
 		{
 			shortLived = true;
 		}
+		else if (s == "ConvertReplay" && i + 2 < argc)
+		{
+			//Converts a logged text replay to the binary trace format that can be used as replayPath as well
+			CherrySim::ConvertReplayToTrace(argv[i + 1], argv[i + 2]);
+			printf("Converted replay %s to trace %s" EOL, argv[i + 1], argv[i + 2]);
+			return 0;
+		}
 		else
 		{
 			if (i != 0) std::cerr << "WARNING: unknown parameter " << s << "\n";
@@ -107,6 +114,7 @@ int main(int argc, char** argv) {
 	//You may use the following line to enable the replay feature. As this change
 	//should not get commited anyway, you may use absolut paths.
 	//simConfig.replayPath = "C:/Path/to/some/log/file/MyLog.log";
+	//A binary trace that was written with simConfig.replayTracePath or converted with the ConvertReplay parameter can be used the same way.
 
 	CherrySimRunner* runner = new CherrySimRunner(runnerConfig, simConfig, meshGwCommunication);
 	printf("Launching Runner..." EOL);
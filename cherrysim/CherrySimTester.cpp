@@ -34,12 +34,16 @@
 #include "CherrySim.h"
 #include "Node.h"
 #include <regex>
+#include <algorithm>
 #include <string>
 #include <cstdarg>
 #include <chrono>
 #include <iostream>
+#include <thread>
+#include <atomic>
 #include "FruityHal.h"
 #include "Utility.h"
+#include "json.hpp"
  
 /***
 This class is a wrapper around the simulator and provides methods for injecting data into the simulator
@@ -141,6 +145,7 @@ int main(int argc, char **argv) {
 	else {
 		exitCode = RUN_ALL_TESTS();
 	}
+	CherrySimTester::ClearClusteredSnapshots();
 	auto endTime = std::chrono::high_resolution_clock::now();
 	auto diff = endTime - startTime;
 	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(diff).count();
@@ -212,6 +217,9 @@ SimConfiguration CherrySimTester::CreateDefaultSimConfiguration()
 	return simConfig;
 }
 
+std::unordered_map<std::string, CherrySimTester::ClusteredSimulator> CherrySimTester::clusteredSimulators;
+std::mutex CherrySimTester::clusteredSimulatorsMutex;
+
 CherrySimTester::CherrySimTester(CherrySimTesterConfig testerConfig, SimConfiguration simConfig)
 	  : config(testerConfig),
 	  simConfig(simConfig) 
@@ -227,6 +235,7 @@ CherrySimTester::CherrySimTester(CherrySimTester && other)
 	: sim                        (std::move(other.sim)),
 	awaitedTerminalOutputs       (std::move(other.awaitedTerminalOutputs)),
 	useRegex                     (std::move(other.useRegex)),
+	awaitedMessageMatcher        (std::move(other.awaitedMessageMatcher)),
 	awaitedMessagePointer        (std::move(other.awaitedMessagePointer)),
 	awaitedMessagesFound         (std::move(other.awaitedMessagesFound)),
 	awaitedBleEventNodeId        (std::move(other.awaitedBleEventNodeId)),
@@ -238,14 +247,29 @@ CherrySimTester::CherrySimTester(CherrySimTester && other)
 	awaitedMessageResult         (std::move(other.awaitedMessageResult)),
 	config                       (std::move(other.config)),
 	simConfig                    (std::move(other.simConfig)),
-	started                      (std::move(other.started))
+	started                      (std::move(other.started)),
+	clusteredSimulator           (std::move(other.clusteredSimulator))
 {
 	other.sim = nullptr;
+	other.clusteredSimulator = nullptr;
 }
 
 CherrySimTester::~CherrySimTester()
 {
-	delete sim;
+	if (clusteredSimulator != nullptr)
+	{
+		//The simulator is kept for the next tester that restores its snapshot
+		sim->SetCherrySimEventListener(nullptr);
+		sim->RegisterTerminalPrintListener(nullptr);
+		if (cherrySimInstance == sim) cherrySimInstance = nullptr;
+		std::unique_lock<std::mutex> lock(clusteredSimulatorsMutex);
+		clusteredSimulator->inUse = false;
+		clusteredSimulator = nullptr;
+	}
+	else
+	{
+		delete sim;
+	}
 	sim = nullptr;
 }
 
@@ -284,6 +308,143 @@ void CherrySimTester::SimulateUntilClusteringDone(int timeoutMs)
 	}
 }
 
+void CherrySimTester::SimulateUntilClusteringDoneWithSnapshot(int timeoutMs)
+{
+	if (!started || clusteredSimulator != nullptr || sim->simState.simTimeMs != 0)
+	{
+		//The clustered state would not include what was simulated so far
+		SIMEXCEPTION(IllegalStateException);
+	}
+
+	const std::string key = GetClusteredSimulatorKey();
+	std::unique_lock<std::mutex> lock(clusteredSimulatorsMutex);
+	auto entry = clusteredSimulators.find(key);
+	if (entry != clusteredSimulators.end() && !entry->second.inUse)
+	{
+		//Continue on the kept simulator instead of our freshly booted one
+		clusteredSimulator = &entry->second;
+		clusteredSimulator->inUse = true;
+		lock.unlock();
+		delete sim;
+		sim = clusteredSimulator->sim.get();
+		cherrySimInstance = sim;
+		sim->SetCherrySimEventListener(this);
+		sim->RegisterTerminalPrintListener(this);
+		sim->simConfig = clusteredSimulator->simConfig;
+		sim->RestoreSnapshot(clusteredSimulator->snapshot);
+		return;
+	}
+
+	lock.unlock();
+
+	SimulateUntilClusteringDone(timeoutMs);
+
+	std::vector<u8> snapshot = sim->CreateSnapshot();
+	lock.lock();
+	if (clusteredSimulators.find(key) == clusteredSimulators.end())
+	{
+		ClusteredSimulator& newEntry = clusteredSimulators[key];
+		newEntry.snapshot = std::move(snapshot);
+		newEntry.simConfig = sim->simConfig;
+		newEntry.sim.reset(sim);
+		newEntry.inUse = true;
+		clusteredSimulator = &newEntry;
+	}
+}
+
+std::string CherrySimTester::GetClusteredSimulatorKey() const
+{
+	std::string key = nlohmann::json(simConfig).dump();
+
+	//The booted state of each node is summarized with a checksum. Two freshly booted simulators only differ in their
+	//memory addresses, so only the parts of the state are used that do not contain pointers.
+	for (u32 i = 0; i < sim->getTotalNodes(); i++)
+	{
+		const nodeEntry& node = sim->nodes[i];
+		u32 crc = Utility::CalculateCrc32((const u8*)&node.x, sizeof(node.x));
+		crc = Utility::CalculateCrc32((const u8*)&node.y, sizeof(node.y), crc);
+		crc = Utility::CalculateCrc32((const u8*)&node.z, sizeof(node.z), crc);
+		for (int impossibleConnection : node.impossibleConnection)
+		{
+			crc = Utility::CalculateCrc32((const u8*)&impossibleConnection, sizeof(impossibleConnection), crc);
+		}
+
+		crc = Utility::CalculateCrc32((const u8*)&node.gs.config, sizeof(node.gs.config), crc);
+		for (u32 m = 0; m < node.gs.amountOfModules; m++)
+		{
+			const Module* module = node.gs.activeModules[m];
+			crc = Utility::CalculateCrc32((const u8*)&module->moduleId, sizeof(module->moduleId), crc);
+			crc = Utility::CalculateCrc32((const u8*)module->configurationPointer, module->configurationLength, crc);
+		}
+
+		for (u32 page = 0; page < SimFlash::SIZE / SimFlash::PAGE_SIZE; page++)
+		{
+			if (node.flash.IsPageErased(page)) continue;
+			crc = Utility::CalculateCrc32((const u8*)&page, sizeof(page), crc);
+			crc = Utility::CalculateCrc32(node.flash.data() + page * SimFlash::PAGE_SIZE, SimFlash::PAGE_SIZE, crc);
+		}
+
+		//Commands that are still queued are executed while the mesh clusters
+		std::queue<TerminalCommandQueueEntry> terminalCommandQueue = node.gs.terminal.terminalCommandQueue;
+		for (; !terminalCommandQueue.empty(); terminalCommandQueue.pop())
+		{
+			const std::string& command = terminalCommandQueue.front().terminalCommand;
+			crc = Utility::CalculateCrc32((const u8*)command.c_str(), (u32)command.size() + 1, crc);
+		}
+
+		key += "|" + node.nodeConfiguration + ":" + std::to_string(crc);
+	}
+
+	return key;
+}
+
+void CherrySimTester::ClearClusteredSnapshots()
+{
+	//Must only be called once no tester uses a kept simulator anymore
+	std::unique_lock<std::mutex> lock(clusteredSimulatorsMutex);
+	for (auto& entry : clusteredSimulators)
+	{
+		if (entry.second.inUse) SIMEXCEPTION(IllegalStateException);
+	}
+	clusteredSimulators.clear();
+}
+
+void CherrySimTester::RunScenariosInParallel(u32 count, const std::function<void(u32)>& scenario)
+{
+	std::vector<std::exception_ptr> exceptions(count);
+	std::atomic<u32> nextScenario{ 0 };
+	auto runScenarios = [&]() {
+		while (true)
+		{
+			const u32 index = nextScenario.fetch_add(1);
+			if (index >= count) return;
+			try {
+				scenario(index);
+			}
+			catch (...) {
+				exceptions[index] = std::current_exception();
+			}
+		}
+	};
+
+	//The calling thread only waits so that every scenario starts without any disabled exceptions
+	const u32 numThreads = std::min(count, std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads;
+	for (u32 i = 0; i < numThreads; i++)
+	{
+		threads.emplace_back(runScenarios);
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	for (const std::exception_ptr& exception : exceptions)
+	{
+		if (exception) std::rethrow_exception(exception);
+	}
+}
+
 void CherrySimTester::SimulateUntilClusteringDoneWithDifferentNetworkIds(int timeoutMs)
 {
 	if (timeoutMs == 0) SIMEXCEPTION(ZeroTimeoutNotSupportedException);
@@ -301,10 +462,9 @@ void CherrySimTester::SimulateUntilClusteringDoneWithDifferentNetworkIds(int tim
 
 void CherrySimTester::SimulateBroadcastMessage(double x, double y, ble_gap_evt_adv_report_t& advReport, bool ignoreDropProb)
 {
-	printf("Simulating broadcast message" EOL);
+	if (config.verbose) printf("Simulating broadcast message" EOL);
 
-	sim->currentNode->x = (float)x;
-	sim->currentNode->y = (float)y;
+	sim->SetPosition(sim->currentNode->index, (float)x, (float)y, sim->currentNode->z);
 	u32 numNoneAssetNodes = sim->getTotalNodes() - sim->getAssetNodes();
 	for (u32 i = 0; i < numNoneAssetNodes; i++) {
 		//If the other node is scanning
@@ -313,7 +473,7 @@ void CherrySimTester::SimulateBroadcastMessage(double x, double y, ble_gap_evt_a
 			double probability = sim->calculateReceptionProbability(sim->currentNode, &(sim->nodes[i]));
 			if (PSRNG() < probability || ignoreDropProb) {
 				simBleEvent s;
-				s.globalId = sim->simState.globalEventIdCounter++;
+				s.globalId = sim->DrawGlobalEventId();
 				s.bleEvent.header.evt_id = BLE_GAP_EVT_ADV_REPORT;
 				s.bleEvent.header.evt_len = s.globalId;
 				s.bleEvent.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
@@ -381,6 +541,7 @@ void CherrySimTester::SimulateUntilMessagesReceived(int timeoutMs, std::vector<S
 	if (timeoutMs == 0) SIMEXCEPTION(ZeroTimeoutNotSupportedException);
 	useRegex = false;
 	awaitedTerminalOutputs = &messages;
+	awaitedMessageMatcher.Prepare(messages, useRegex);
 
 	_SimulateUntilMessageReceived(timeoutMs);
 }
@@ -403,6 +564,7 @@ void CherrySimTester::SimulateUntilRegexMessagesReceived(int timeoutMs, std::vec
 	if (timeoutMs == 0) SIMEXCEPTION(ZeroTimeoutNotSupportedException);
 	useRegex = true;
 	awaitedTerminalOutputs = &messages;
+	awaitedMessageMatcher.Prepare(messages, useRegex);
 
 	_SimulateUntilMessageReceived(timeoutMs);
 }
@@ -541,21 +703,11 @@ void CherrySimTester::TerminalPrintHandler(nodeEntry* currentNode, const char* m
 
 	if (awaitedMessageResult[awaitedMessagePointer - 1] == '\n') {
 		awaitedMessageResult[awaitedMessagePointer - 1] = '\0';
-		std::vector<SimulationMessage>& awaited = *this->awaitedTerminalOutputs;
-		for (unsigned int i = 0; i < awaited.size(); i++) {
-			if (!awaited[i].isFound()) {
-				if (sim->currentNode->id == awaited[i].getNodeId())
-				{
-					if (awaited[i].checkAndSet(awaitedMessageResult.data(), useRegex))
-					{
-						break; //A received message should validate only one awaited message.
-					}
-				}
-			}
-		}
-		
-		awaitedMessagesFound = std::all_of(awaited.begin(), awaited.end(), [](const SimulationMessage& sm) {return sm.isFound(); });
-		
+
+		//A received message validates only one awaited message.
+		awaitedMessageMatcher.CheckLine(sim->currentNode->id, awaitedMessageResult.data());
+		awaitedMessagesFound = awaitedMessageMatcher.AllMessagesFound();
+
 		awaitedMessagePointer = 0;
 	}
 }
@@ -655,3 +807,140 @@ bool SimulationMessage::matchesRegex(const std::string & message)
 	std::regex reg(messagePart);
 	return std::regex_search(message, reg);
 }
+
+void SimulationMessageMatcher::Prepare(std::vector<SimulationMessage>& messages, bool useRegex)
+{
+	this->messages = &messages;
+	this->useRegex = useRegex;
+	buckets.clear();
+	numMessagesNotFound = 0;
+
+	for (u32 i = 0; i < messages.size(); i++)
+	{
+		//Messages that were already found can never be set again
+		if (messages[i].isFound()) continue;
+		numMessagesNotFound++;
+
+		NodeBucket& bucket = buckets[messages[i].getNodeId()];
+		bucket.messageIndices.push_back(i);
+		if (useRegex) bucket.regexes.emplace_back(messages[i].messagePart);
+	}
+
+	for (auto& entry : buckets)
+	{
+		NodeBucket& bucket = entry.second;
+		bucket.matched.resize(bucket.messageIndices.size());
+		if (!useRegex) BuildAutomaton(bucket, messages);
+	}
+}
+
+u32 SimulationMessageMatcher::GetTransition(const NodeBucket& bucket, u32 state, char c)
+{
+	for (const auto& transition : bucket.states[state].transitions)
+	{
+		if (transition.first == c) return transition.second;
+	}
+	return 0;
+}
+
+void SimulationMessageMatcher::BuildAutomaton(NodeBucket& bucket, const std::vector<SimulationMessage>& messages)
+{
+	//Builds a trie of all messageParts where state 0 is the root
+	bucket.states.clear();
+	bucket.states.emplace_back();
+	for (u32 i = 0; i < bucket.messageIndices.size(); i++)
+	{
+		u32 state = 0;
+		for (char c : messages[bucket.messageIndices[i]].messagePart)
+		{
+			u32 next = GetTransition(bucket, state, c);
+			if (next == 0)
+			{
+				next = (u32)bucket.states.size();
+				bucket.states.emplace_back();
+				bucket.states[state].transitions.push_back({ c, next });
+			}
+			state = next;
+		}
+		bucket.states[state].matches.push_back(i);
+	}
+
+	//Sets the failure transitions in breadth first order, so that the failure state of a state is always
+	//finished before. Each state then also matches everything that its failure state matches.
+	std::vector<u32> queue;
+	for (const auto& transition : bucket.states[0].transitions) queue.push_back(transition.second);
+	for (u32 i = 0; i < queue.size(); i++)
+	{
+		const u32 state = queue[i];
+		for (const auto& transition : bucket.states[state].transitions)
+		{
+			u32 failure = bucket.states[state].failure;
+			while (failure != 0 && GetTransition(bucket, failure, transition.first) == 0)
+			{
+				failure = bucket.states[failure].failure;
+			}
+			failure = GetTransition(bucket, failure, transition.first);
+
+			AutomatonState& next = bucket.states[transition.second];
+			next.failure = failure;
+			next.matches.insert(next.matches.end(), bucket.states[failure].matches.begin(), bucket.states[failure].matches.end());
+			queue.push_back(transition.second);
+		}
+	}
+}
+
+void SimulationMessageMatcher::CheckLine(NodeId nodeId, const char* line)
+{
+	auto entry = buckets.find(nodeId);
+	if (entry == buckets.end()) return;
+	NodeBucket& bucket = entry->second;
+	std::vector<SimulationMessage>& awaited = *messages;
+
+	if (useRegex)
+	{
+		for (u32 i = 0; i < bucket.messageIndices.size(); i++)
+		{
+			SimulationMessage& message = awaited[bucket.messageIndices[i]];
+			if (!message.isFound() && std::regex_search(line, bucket.regexes[i]))
+			{
+				message.makeFound(line);
+				numMessagesNotFound--;
+				return;
+			}
+		}
+		return;
+	}
+
+	//Empty messageParts end in the root and match every line
+	std::fill(bucket.matched.begin(), bucket.matched.end(), false);
+	for (u32 index : bucket.states[0].matches) bucket.matched[index] = true;
+
+	u32 state = 0;
+	for (const char* c = line; *c != '\0'; c++)
+	{
+		u32 next = GetTransition(bucket, state, *c);
+		while (next == 0 && state != 0)
+		{
+			state = bucket.states[state].failure;
+			next = GetTransition(bucket, state, *c);
+		}
+		state = next;
+		for (u32 index : bucket.states[state].matches) bucket.matched[index] = true;
+	}
+
+	for (u32 i = 0; i < bucket.messageIndices.size(); i++)
+	{
+		SimulationMessage& message = awaited[bucket.messageIndices[i]];
+		if (bucket.matched[i] && !message.isFound())
+		{
+			message.makeFound(line);
+			numMessagesNotFound--;
+			return;
+		}
+	}
+}
+
+bool SimulationMessageMatcher::AllMessagesFound() const
+{
+	return numMessagesNotFound == 0;
+}
@@ -30,6 +30,11 @@
 #pragma once
 
 #include <CherrySim.h>
+#include <regex>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <functional>
 
 constexpr int MAX_TERMINAL_OUTPUT = 1024;
 
@@ -51,6 +56,8 @@ private:
 	void makeFound(const std::string &messageComplete);
 	bool matchesRegex(const std::string &message);
 
+	friend class SimulationMessageMatcher;
+
 public:
 	SimulationMessage(NodeId nodeId, const std::string& messagePart);
 	bool checkAndSet(const std::string &message, bool useRegex);
@@ -59,6 +66,46 @@ public:
 	NodeId getNodeId() const;
 };
 
+/*
+The SimulationMessageMatcher is prepared once a simulation starts to wait for a list of messages. The messages
+are bucketed by their node so that a terminal line is only checked against the messages of the node that printed it.
+Literal messages of a node are searched in a single pass over the line with an Aho-Corasick automaton, regex messages
+are compiled once instead of for every line. The first message of the list that is not found yet and matches the line
+is set to found, just as if checkAndSet was called on all messages of the node in order.
+*/
+class SimulationMessageMatcher
+{
+private:
+	struct AutomatonState
+	{
+		std::vector<std::pair<char, u32>> transitions;
+		u32 failure = 0;
+		std::vector<u32> matches; //Indices in the messageIndices of the bucket whose messagePart ends in this state
+	};
+
+	struct NodeBucket
+	{
+		std::vector<u32> messageIndices; //Indices in the awaited messages, in their original order
+		std::vector<AutomatonState> states;
+		std::vector<std::regex> regexes;
+		std::vector<bool> matched;
+	};
+
+	std::vector<SimulationMessage>* messages = nullptr;
+	bool useRegex = false;
+	std::unordered_map<NodeId, NodeBucket> buckets;
+	u32 numMessagesNotFound = 0;
+
+	static u32 GetTransition(const NodeBucket& bucket, u32 state, char c);
+	static void BuildAutomaton(NodeBucket& bucket, const std::vector<SimulationMessage>& messages);
+
+public:
+	void Prepare(std::vector<SimulationMessage>& messages, bool useRegex);
+	//Checks a complete terminal line of a node and sets the first matching message to found
+	void CheckLine(NodeId nodeId, const char* line);
+	bool AllMessagesFound() const;
+};
+
 class CherrySimTester : public TerminalPrintListener, public CherrySimEventListener
 {
 public:
@@ -67,6 +114,7 @@ public:
 	//Used for awaiting specific terminal messages
 	std::vector<SimulationMessage>* awaitedTerminalOutputs = nullptr;
 	bool useRegex = false;
+	SimulationMessageMatcher awaitedMessageMatcher;
 	u16 awaitedMessagePointer = 0;
 	bool awaitedMessagesFound = false;
 
@@ -86,6 +134,21 @@ private:
 	void _SimulateUntilMessageReceived(int timeoutMs);
 	bool started = false;
 
+	//A simulator that was kept after it clustered so that later testers can continue from its snapshot
+	struct ClusteredSimulator
+	{
+		std::unique_ptr<CherrySim> sim;
+		std::vector<u8> snapshot;
+		SimConfiguration simConfig; //Not part of the snapshot, but may be changed by the tests that use the simulator
+		bool inUse = false;
+	};
+	static std::unordered_map<std::string, ClusteredSimulator> clusteredSimulators; //Keyed by GetClusteredSimulatorKey
+	static std::mutex clusteredSimulatorsMutex; //Testers may run in parallel, see RunScenariosInParallel
+	ClusteredSimulator* clusteredSimulator = nullptr; //Set if sim is owned by clusteredSimulators
+	//Identifies the booted state from which the mesh is clustered, which is the SimConfiguration together with
+	//what a test might have changed after Start, e.g. featuresets, module configurations or terminal commands
+	std::string GetClusteredSimulatorKey() const;
+
 public:
 	CherrySimTester(CherrySimTesterConfig testerConfig, SimConfiguration simConfig);
 	
@@ -105,6 +168,17 @@ public:
 
 	//### Simulation methods
 	void SimulateUntilClusteringDone(int timeoutMs);
+	//Must be called directly after Start. The first tester with a SimConfiguration clusters the mesh and keeps its
+	//simulator with a snapshot of the clustered state. Later testers with the same SimConfiguration continue
+	//on that simulator from the snapshot instead of simulating the clustering again.
+	void SimulateUntilClusteringDoneWithSnapshot(int timeoutMs);
+	//Deletes all simulators that were kept for their clustered snapshots
+	static void ClearClusteredSnapshots();
+
+	//Calls scenario once for every index in [0, count), distributed over one thread per core. Every scenario must
+	//create its own CherrySimTester and should not use parallelStepThreads, as all cores are already busy.
+	//Exceptions are rethrown in the order of the scenario indices once all scenarios have finished.
+	static void RunScenariosInParallel(u32 count, const std::function<void(u32)>& scenario);
 	void SimulateUntilClusteringDoneWithDifferentNetworkIds(int timeoutMs);
 
 	void SimulateUntilClusteringDoneWithExpectedNumberOfClusters(int timeoutMs, u32 clusters);
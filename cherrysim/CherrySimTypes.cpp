@@ -55,6 +55,7 @@ void to_json(nlohmann::json& j, const SimConfiguration & config)
 		{ "devicesJsonPath"                   , config.devicesJsonPath                   },
 		{ "replayPath"                        , config.replayPath                        },
 		{ "logReplayCommands"                 , config.logReplayCommands                 },
+		{ "replayTracePath"                   , config.replayTracePath                   },
 		{ "useLogAccumulator"                 , config.useLogAccumulator                 },
 		{ "defaultNetworkId"                  , config.defaultNetworkId                  },
 		{ "preDefinedPositions"               , config.preDefinedPositions               },
@@ -63,9 +64,13 @@ void to_json(nlohmann::json& j, const SimConfiguration & config)
 		{ "simulateJittering"                 , config.simulateJittering                 },
 		{ "verbose"                           , config.verbose                           },
 		{ "enableClusteringValidityCheck"     , config.enableClusteringValidityCheck     },
+		{ "clusteringCrossCheckIntervalMs"    , config.clusteringCrossCheckIntervalMs    },
 		{ "enableSimStatistics"               , config.enableSimStatistics               },
 		{ "storeFlashToFile"                  , config.storeFlashToFile                  },
 		{ "verboseCommands"                   , config.verboseCommands                   },
+		{ "useSpatialBroadcastGrid"           , config.useSpatialBroadcastGrid           },
+		{ "parallelStepThreads"               , config.parallelStepThreads               },
+		{ "skipIdleTicks"                     , config.skipIdleTicks                     },
 		{ "defaultBleStackType"               , config.defaultBleStackType               },
 	};
 }
@@ -96,6 +101,7 @@ void from_json(const nlohmann::json & j, SimConfiguration & config)
 		else if(it.key() == "devicesJsonPath"                   ) config.devicesJsonPath                   = *it;
 		else if(it.key() == "replayPath"                        ) config.replayPath                        = *it;
 		else if(it.key() == "logReplayCommands"                 ) config.logReplayCommands                 = *it;
+		else if(it.key() == "replayTracePath"                   ) config.replayTracePath                   = *it;
 		else if(it.key() == "useLogAccumulator"                 ) config.useLogAccumulator                 = *it;
 		else if(it.key() == "defaultNetworkId"                  ) config.defaultNetworkId                  = *it;
 		else if(it.key() == "preDefinedPositions"               ) j.at("preDefinedPositions").get_to(config.preDefinedPositions);
@@ -104,9 +110,13 @@ void from_json(const nlohmann::json & j, SimConfiguration & config)
 		else if(it.key() == "simulateJittering"                 ) config.simulateJittering                 = *it;
 		else if(it.key() == "verbose"                           ) config.verbose                           = *it;
 		else if(it.key() == "enableClusteringValidityCheck"     ) config.enableClusteringValidityCheck     = *it;
+		else if(it.key() == "clusteringCrossCheckIntervalMs"    ) config.clusteringCrossCheckIntervalMs    = *it;
 		else if(it.key() == "enableSimStatistics"               ) config.enableSimStatistics               = *it;
 		else if(it.key() == "storeFlashToFile"                  ) config.storeFlashToFile                  = *it;
 		else if(it.key() == "verboseCommands"                   ) config.verboseCommands                   = *it;
+		else if(it.key() == "useSpatialBroadcastGrid"           ) config.useSpatialBroadcastGrid           = *it;
+		else if(it.key() == "parallelStepThreads"               ) config.parallelStepThreads               = *it;
+		else if(it.key() == "skipIdleTicks"                     ) config.skipIdleTicks                     = *it;
 		else if(it.key() == "defaultBleStackType"               ) config.defaultBleStackType               = *it;
 		else SIMEXCEPTION(UnknownJsonEntryException);
 	}
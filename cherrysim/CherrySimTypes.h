@@ -34,7 +34,10 @@
 #include <map>
 #include <array>
 #include <string>
+#include <exception>
+#include <functional>
 #include "MersenneTwister.h"
+#include "SimFlash.h"
 #include "json.hpp"
 #ifndef GITHUB_RELEASE
 #include "ClcMock.h"
@@ -46,9 +49,9 @@ extern "C" {
 
 #include <FruityHal.h>
 
-//Making the instance available to softdevice calls and others
+//Making the instance available to softdevice calls and others, every thread has its own current simulator
 class CherrySim;
-extern CherrySim* cherrySimInstance;
+extern SIM_THREAD_LOCAL CherrySim* cherrySimInstance;
 
 constexpr int SIM_EVT_QUEUE_SIZE = 50;
 constexpr int SIM_MAX_CONNECTION_NUM = 10; //Maximum total num of connections supported by the simulator
@@ -61,8 +64,8 @@ constexpr int SIM_NUM_CHARS    = 5;
 
 constexpr int PACKET_STAT_SIZE = 10*1024;
 
-#define PSRNG() (cherrySimInstance->simState.rnd.nextDouble())
-#define PSRNGINT(min, max) ((u32)cherrySimInstance->simState.rnd.nextU32(min, max)) //Generates random int from min (inclusive) up to max (inclusive)
+#define PSRNG() (cherrySimInstance->GetRnd().nextDouble())
+#define PSRNGINT(min, max) ((u32)cherrySimInstance->GetRnd().nextU32(min, max)) //Generates random int from min (inclusive) up to max (inclusive)
 
 //A BLE Event that is sent by the Simulator is wrapped
 struct simBleEvent {
@@ -202,6 +205,16 @@ struct SoftdeviceState {
 
 };
 
+//An effect that a node has on another node or on the simulator itself. While nodes are stepped in parallel,
+//these are collected in the outbox of the node and applied after all nodes were stepped.
+struct StepMailboxEntry
+{
+	nodeEntry* receiver = nullptr; //If set, the event is put into the eventQueue of the receiver, otherwise the action is executed
+	simBleEvent event;
+	int connectionHandle = -1; //If set, the event is dropped if the receiver does not have this connection anymore
+	std::function<void()> action; //Executed with the sending node set as the current node
+};
+
 struct InterruptSettings
 {
 	bool isEnabled                       = false;
@@ -223,13 +236,16 @@ struct nodeEntry {
 	NRF_FICR_Type ficr;
 	NRF_UICR_Type uicr;
 	NRF_GPIO_Type gpio;
-	u8 flash[SIM_MAX_FLASH_SIZE];
+	SimFlash flash;
 	SoftdeviceState state;
 	std::deque<simBleEvent> eventQueue;
 	simBleEvent currentEvent; //The event currently being processed, as a simBleEvent, this can have some additional data attached to it useful for debugging
 	bool ledOn;
 	u32 nanoAmperePerMsTotal;
+	//The memory of the modules and the hal is kept across reboots so that a snapshot of the node stays valid
 	u8 *moduleMemoryBlock = nullptr;
+	u32 moduleMemoryBlockSize = 0;
+	u32 *halMemory = nullptr;
 
 	uint32_t restartCounter = 0; //Counts how many times the node was restarted
 	int64_t simulatedFrames = 0;
@@ -264,6 +280,20 @@ struct nodeEntry {
 	PacketStat sentPackets[PACKET_STAT_SIZE];
 	PacketStat routedPackets[PACKET_STAT_SIZE];
 
+	//Parallel stepping, only used if SimConfiguration::parallelStepThreads is not 0
+	MersenneTwister rnd; //Reseeded every step from the seed, the time and the node index
+	u32 stepEventIdsDrawn = 0; //Global ids that this node drew during the current step, see CherrySim::DrawGlobalEventId
+	u32 stepPacketIdsDrawn = 0;
+	std::vector<StepMailboxEntry> outbox;
+	bool resetPending = false; //The node requested a reset that is executed once all nodes were stepped
+	RebootReason pendingRebootReason = RebootReason::UNKNOWN;
+	std::exception_ptr stepException;
+
+	//Incremental clustering validity check, only used if SimConfiguration::enableClusteringValidityCheck is set
+	u32 clusterSizeChangesQueued = 0; //Packets with a cluster size change that this node put into its SoftDevice buffers
+	u32 clusterSizeChangesDelivered = 0; //Packets with a cluster size change that this node took from its eventQueue
+	bool clusterCheckPending = false; //The cluster of this node must be checked once no more changes are in flight
+
 };
 
 
@@ -271,8 +301,8 @@ struct SimulatorState {
 	u32 simTimeMs = 0;
 	MersenneTwister rnd;
 	u16 globalConnHandleCounter = 0;
-	u32 globalEventIdCounter = 0;
-	u32 globalPacketIdCounter = 0;
+	u32 globalEventIdCounter = 0; //Only drawn from through CherrySim::DrawGlobalEventId
+	u32 globalPacketIdCounter = 0; //Only drawn from through CherrySim::DrawGlobalPacketId
 };
 
 struct SimConfiguration {
@@ -310,6 +340,7 @@ struct SimConfiguration {
 	std::string devicesJsonPath                    = "";
 	std::string replayPath                         = ""; //If set, a replay is loaded from this path.
 	bool        logReplayCommands                  = false; //If set, lines are logged out that can be used as input for the replay feature.
+	std::string replayTracePath                    = ""; //If set together with logReplayCommands, the replay is also written to this path in the binary trace format.
 	bool        useLogAccumulator                  = false; //If set, all logs are written to CherrySim::logAccumulator
 	u32         defaultNetworkId                   = 0;
 	std::vector<std::pair<double, double>> preDefinedPositions;
@@ -319,11 +350,18 @@ struct SimConfiguration {
 	bool        verbose                            = false;
 
 	bool        enableClusteringValidityCheck      = false; //Enable automatic checking of the clustering after each step
+	uint32_t    clusteringCrossCheckIntervalMs     = 10 * 1000; //Interval of the full recomputation that cross checks the incremental clustering check, 0 to disable
 	bool        enableSimStatistics                = false;
 	std::string storeFlashToFile                   = "";
 
 	bool        verboseCommands                    = false;
 
+	bool        useSpatialBroadcastGrid            = false; //Only visits nodes in reception range when broadcasting. Much faster for big maps, but the PSRNG sequence differs from a run without it.
+
+	uint32_t    parallelStepThreads                = 0; //0 steps all nodes one after another. Otherwise the nodes are stepped in two phases by this many threads. The result does not depend on the amount of threads (1 included), but differs from a sequential run.
+
+	bool        skipIdleTicks                      = false; //Ticks in which no node has anything to do only advance the clocks, so that a step may simulate multiple ticks. Timers trigger at the same times, but the PSRNG sequence differs from a run without it.
+
 
 	//BLE Stack capabilities
 	BleStackType defaultBleStackType          = BleStackType::INVALID;
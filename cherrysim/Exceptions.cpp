@@ -29,9 +29,33 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "Exceptions.h"
 #include <map>
+#include <atomic>
 
-static std::map<std::type_index, int> ignoredExceptions;
-static int disableDebugBreakOnExceptionCounter = 0;
+struct Exceptions::ExceptionState
+{
+	std::map<std::type_index, int> ignoredExceptions;
+};
+
+static thread_local Exceptions::ExceptionState ownExceptionState;
+static thread_local Exceptions::ExceptionState* sharedExceptionState = nullptr;
+//Debug breaks are disabled for the whole process, e.g. when running on the pipeline
+static std::atomic<int> disableDebugBreakOnExceptionCounter{ 0 };
+
+Exceptions::ExceptionState* Exceptions::getExceptionState()
+{
+	return sharedExceptionState != nullptr ? sharedExceptionState : &ownExceptionState;
+}
+
+Exceptions::ExceptionStateSharer::ExceptionStateSharer(ExceptionState* state)
+	: previousState(sharedExceptionState)
+{
+	sharedExceptionState = state;
+}
+
+Exceptions::ExceptionStateSharer::~ExceptionStateSharer()
+{
+	sharedExceptionState = previousState;
+}
 
 bool Exceptions::getDebugBreakOnException()
 {
@@ -40,6 +64,7 @@ bool Exceptions::getDebugBreakOnException()
 
 void Exceptions::disableExceptionByIndex(std::type_index index)
 {
+	std::map<std::type_index, int>& ignoredExceptions = getExceptionState()->ignoredExceptions;
 	if (ignoredExceptions.find(index) == ignoredExceptions.end()) {
 		ignoredExceptions.insert({ index, 1 });
 	}
@@ -50,6 +75,7 @@ void Exceptions::disableExceptionByIndex(std::type_index index)
 
 void Exceptions::enableExceptionByIndex(std::type_index index)
 {
+	std::map<std::type_index, int>& ignoredExceptions = getExceptionState()->ignoredExceptions;
 	if (ignoredExceptions.find(index) == ignoredExceptions.end()) {
 		SIMEXCEPTION(MemoryCorruptionException);
 	}
@@ -64,11 +90,13 @@ void Exceptions::enableExceptionByIndex(std::type_index index)
 
 bool Exceptions::isExceptionEnabledByIndex(std::type_index index)
 {
-	if (ignoredExceptions.find(index) == ignoredExceptions.end()) {
+	const std::map<std::type_index, int>& ignoredExceptions = getExceptionState()->ignoredExceptions;
+	auto entry = ignoredExceptions.find(index);
+	if (entry == ignoredExceptions.end()) {
 		return true;
 	}
 	else {
-		return ignoredExceptions[index] <= 0;
+		return entry->second <= 0;
 	}
 }
 
@@ -79,8 +107,7 @@ Exceptions::DisableDebugBreakOnException::DisableDebugBreakOnException()
 
 Exceptions::DisableDebugBreakOnException::~DisableDebugBreakOnException() noexcept(false)
 {
-	disableDebugBreakOnExceptionCounter--;
-	if (disableDebugBreakOnExceptionCounter < 0)
+	if (--disableDebugBreakOnExceptionCounter < 0)
 	{
 		SIMEXCEPTION(MemoryCorruptionException);
 	}
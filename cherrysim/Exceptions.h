@@ -113,6 +113,22 @@ CREATEEXCEPTION(ErrorLoggedException);
 
 namespace Exceptions {
 
+	//Disabled exceptions are tracked per thread so that simulations on different threads do not influence each other
+	struct ExceptionState;
+	ExceptionState* getExceptionState();
+
+	//While it exists, the current thread uses the disabled exceptions of another thread. Used by threads that
+	//work on behalf of another thread, e.g. the SimWorkerPool. The state must not be modified while shared.
+	class ExceptionStateSharer {
+	private:
+		ExceptionState* previousState;
+	public:
+		explicit ExceptionStateSharer(ExceptionState* state);
+		~ExceptionStateSharer();
+		ExceptionStateSharer(const ExceptionStateSharer&) = delete;
+		ExceptionStateSharer& operator=(const ExceptionStateSharer&) = delete;
+	};
+
 	void disableExceptionByIndex(std::type_index index);
 	void enableExceptionByIndex(std::type_index index);
 	bool isExceptionEnabledByIndex(std::type_index index);
@@ -33,11 +33,13 @@
 
 #include <memory>
 #include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <limits>
 #include <iostream>
 #if defined(SIM_SERVER_PRESENT)
 #include <evhttp.h>
 #endif // SIM_SERVER_PRESENT
-#include <thread>
 #include <json.hpp>
 #include <stdio.h>
 
@@ -60,7 +62,9 @@
 This provides a basic webserver that serves the fruitymap and information about the mesh.
 The only thing necessary to view the simulation is a browser, that's it :-)
 
-FIXME: Objects are currently not destroyed properly, so the application will crash when closing
+The requests are answered on a separate thread. While the map is polling, the simulation thread
+takes a snapshot of every node from time to time and stamps the nodes that changed with a new
+version. The map then only asks for the devices that changed since the version it already has.
 */
 
 using json = nlohmann::json;
@@ -70,8 +74,6 @@ using json = nlohmann::json;
 WSADATA wsaData;
 static bool WSAStartupWasCalled = false;
 #endif //_WIN32
-event_base* eventBase = nullptr;
-std::unique_ptr<evhttp, decltype(&evhttp_free)>* server = nullptr;
 
 
 //HACK! WSAStartup has a memory leak when called several times, even then WSACleanup is called the same
@@ -91,7 +93,13 @@ static WSACleanuper wsaCleanuper;
 
 #endif // SIM_SERVER_PRESENT
 
-FruitySimServer::FruitySimServer()
+static int64_t GetSteadyTimeMs()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+FruitySimServer::FruitySimServer(CherrySim* sim)
+	: sim(sim), lastDevicesRequestMs(std::numeric_limits<int64_t>::min() / 2)
 {
 	StartServer();
 }
@@ -110,8 +118,9 @@ int FruitySimServer::StartServer()
 		WSAStartupWasCalled = true;
 	}
 #endif // _WIN32
-	
-	eventBase = event_init();
+
+	//Every server has its own event base as it is only used from its own thread
+	eventBase = event_base_new();
 
 	if (!eventBase)
 	{
@@ -121,184 +130,314 @@ int FruitySimServer::StartServer()
 
 	char const SrvAddress[] = "0.0.0.0";
 	std::uint16_t SrvPort = 5555;
-	server = new std::unique_ptr<evhttp, decltype(&evhttp_free)>(evhttp_start(SrvAddress, SrvPort), &evhttp_free);
-	if (!server)
+	httpServer = evhttp_new(eventBase);
+	if (!httpServer || evhttp_bind_socket(httpServer, SrvAddress, SrvPort) != 0)
 	{
-		std::cerr << "Failed to init http server." << std::endl;
+		//Happens e.g. if another simulator already serves the map
+		if (httpServer) evhttp_free(httpServer);
+		httpServer = nullptr;
+		event_base_free(eventBase);
+		eventBase = nullptr;
 		return -1;
 	}
 
-	void(*OnReq)(evhttp_request *req, void *) = [](evhttp_request *req, void *)
+	void(*OnReq)(evhttp_request *req, void *) = [](evhttp_request *req, void * server)
+	{
+		((FruitySimServer*)server)->HandleRequest(req);
+	};
+
+	evhttp_set_gencb(httpServer, OnReq, this);
+
+	serverThread = std::thread(&FruitySimServer::ServerThreadMain, this);
+#endif // SIM_SERVER_PRESENT
+	return 0;
+}
+
+FruitySimServer::~FruitySimServer()
+{
+#if defined(SIM_SERVER_PRESENT)
+	if (serverThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(serverThreadMutex);
+			shuttingDown = true;
+		}
+		serverThreadWakeup.notify_all();
+		serverThread.join();
+	}
+	if (httpServer != nullptr) evhttp_free(httpServer);
+	httpServer = nullptr;
+	if (eventBase != nullptr) event_base_free(eventBase);
+	eventBase = nullptr;
+#endif // SIM_SERVER_PRESENT
+}
+
+void FruitySimServer::ServerThreadMain()
+{
+#if defined(SIM_SERVER_PRESENT)
+	std::unique_lock<std::mutex> lock(serverThreadMutex);
+	while (!shuttingDown)
+	{
+		lock.unlock();
+		event_base_loop(eventBase, EVLOOP_NONBLOCK);
+		lock.lock();
+		serverThreadWakeup.wait_for(lock, std::chrono::milliseconds(10), [this] { return shuttingDown; });
+	}
+#endif // SIM_SERVER_PRESENT
+}
+
+void FruitySimServer::HandleRequest(evhttp_request* req)
+{
+#if defined(SIM_SERVER_PRESENT)
+	FILE* file = nullptr;
+
+	auto *OutBuf = evhttp_request_get_output_buffer(req);
+	if (!OutBuf)
+		return;
+
+	if (strstr(req->uri, "/devices") != nullptr)
 	{
-		FILE* file = nullptr;
-	
-		auto *OutBuf = evhttp_request_get_output_buffer(req);
-		if (!OutBuf)
-			return;
+		lastDevicesRequestMs = GetSteadyTimeMs();
 
-		if (strstr(req->uri, "/devices") != nullptr)
+		u32 since = 0;
+		const char* query = evhttp_uri_get_query(evhttp_request_get_evhttp_uri(req));
+		evkeyvalq params;
+		if (query != nullptr && evhttp_parse_query_str(query, &params) == 0)
 		{
-			std::string devices = GenerateDevicesJson();
-	
-			evbuffer_add_printf(OutBuf, "%s", devices.c_str());
-			evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "application/json");
+			const char* sinceParam = evhttp_find_header(&params, "since");
+			if (sinceParam != nullptr) since = (u32)strtoul(sinceParam, nullptr, 10);
+			evhttp_clear_headers(&params);
 		}
-		else if (strstr(req->uri, "/site") != nullptr)
+
+		std::string devices = GenerateDevicesJson(since);
+
+		evbuffer_add(OutBuf, devices.c_str(), devices.size());
+		evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "application/json");
+	}
+	else if (strstr(req->uri, "/site") != nullptr)
+	{
+		std::string site = GenerateSiteJson();
+		evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "application/json");
+
+		evbuffer_add_printf(OutBuf, "%s", site.c_str());
+	}
+	else {
+		//Serve static files, no directories supported, only some mimetypes work, hacky approach
+		std::string fileName = CherrySimUtils::getNormalizedPath() + "/";
+
+		if (strstr(req->uri, ".png") != nullptr)
 		{
-			std::string site = GenerateSiteJson();
-			evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "application/json");
-	
-			evbuffer_add_printf(OutBuf, "%s", site.c_str());
+			fileName += std::string("web/img/") + std::string(req->uri + 9);
+		}
+		else if (strcmp(req->uri, "/") == 0) {
+			fileName += std::string("web/index.html");
+		}
+		else if (strcmp(req->uri, "/simulator/floorplan") == 0) {
+			fileName += std::string("web/img/floorplan.png");
+		}
+		else if (strcmp(req->uri, "/simulator/wallplan") == 0) {
+			fileName += std::string("web/img/floorplan.png");
 		}
 		else {
-			//Serve static files, no directories supported, only some mimetypes work, hacky approach
-			std::string fileName = CherrySimUtils::getNormalizedPath() + "/";
+			fileName += std::string("web/") + std::string(req->uri + 1);
+		}
+		if ((file = fopen(fileName.c_str(), "r")) != nullptr) {
+			struct stat buf;
+			fstat(fileno(file), &buf);
+			off_t size = buf.st_size;
 
-			if (strstr(req->uri, ".png") != nullptr)
-			{
-				fileName += std::string("web/img/") + std::string(req->uri + 9);
-			}
-			else if (strcmp(req->uri, "/") == 0) {
-				fileName += std::string("web/index.html");
+			if (strstr(fileName.c_str(), ".html") != nullptr) {
+				evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "text/html");
 			}
-			else if (strcmp(req->uri, "/simulator/floorplan") == 0) {
-				fileName += std::string("web/img/floorplan.png");
+			else if (strstr(fileName.c_str(), ".js") != nullptr) {
+				evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "application/javascript");
 			}
-			else if (strcmp(req->uri, "/simulator/wallplan") == 0) {
-				fileName += std::string("web/img/floorplan.png");
-			}
-			else {
-				fileName += std::string("web/") + std::string(req->uri + 1);
-			}
-			if ((file = fopen(fileName.c_str(), "r")) != nullptr) {
-				struct stat buf;
-				fstat(fileno(file), &buf);
-				off_t size = buf.st_size;
-	
-				if (strstr(fileName.c_str(), ".html") != nullptr) {
-					evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "text/html");
-				}
-				else if (strstr(fileName.c_str(), ".js") != nullptr) {
-					evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "application/javascript");
-				}
-				else if (strstr(fileName.c_str(), ".png") != nullptr) {
-					evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "image/png");
-				}
-	
-				//Add the file (will close the file once done)
-				evbuffer_add_file(OutBuf, fileno(file), 0, size);
+			else if (strstr(fileName.c_str(), ".png") != nullptr) {
+				evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "image/png");
 			}
+
+			//Add the file (will close the file once done)
+			evbuffer_add_file(OutBuf, fileno(file), 0, size);
 		}
-	
-		evhttp_send_reply(req, HTTP_OK, "OK", OutBuf);
-	};
-	
-	evhttp_set_gencb(server->get(), OnReq, nullptr);
+	}
+
+	evhttp_send_reply(req, HTTP_OK, "OK", OutBuf);
 #endif // SIM_SERVER_PRESENT
-	return 0;
 }
 
-FruitySimServer::~FruitySimServer()
+void FruitySimServer::ProcessServerRequests()
 {
 #if defined(SIM_SERVER_PRESENT)
-	if (server != nullptr) delete server;
-	server = nullptr;
-	event_base_free(eventBase);
+	if (httpServer == nullptr) return;
+
+	//Nobody looks at the map, so the simulation does not have to collect anything
+	const int64_t nowMs = GetSteadyTimeMs();
+	if (nowMs - lastDevicesRequestMs > MAP_OPEN_TIMEOUT_MS) return;
+	if (nowMs - lastDeviceStateUpdateMs < DEVICE_STATE_UPDATE_INTERVAL_MS) return;
+	lastDeviceStateUpdateMs = nowMs;
+
+	UpdateDeviceStates();
 #endif // SIM_SERVER_PRESENT
 }
 
-void FruitySimServer::ProcessServerRequests()
+void FruitySimServer::UpdateDeviceStates()
 {
-#if defined(SIM_SERVER_PRESENT)
-	event_base_loop(eventBase, EVLOOP_NONBLOCK);
-#endif // SIM_SERVER_PRESENT
+	collectedDeviceStates.resize(sim->getTotalNodes());
+	for (u32 i = 0; i < collectedDeviceStates.size(); i++)
+	{
+		NodeIndexSetter nodeIndexSetter(i);
+		CollectDeviceState(i, collectedDeviceStates[i]);
+	}
+
+	std::lock_guard<std::mutex> lock(deviceStatesMutex);
+	if (deviceStates.size() != collectedDeviceStates.size())
+	{
+		//Everything is new, a delta could not tell the map which devices were removed, so
+		//devices that are requested with an older version get the full list
+		deviceStates = collectedDeviceStates;
+		deviceStateVersions.assign(deviceStates.size(), devicesVersion + 1);
+		devicesVersion++;
+		deviceSetVersion = devicesVersion;
+		return;
+	}
+
+	bool changed = false;
+	for (u32 i = 0; i < deviceStates.size(); i++)
+	{
+		if (memcmp(&deviceStates[i], &collectedDeviceStates[i], sizeof(MapDeviceState)) != 0)
+		{
+			deviceStates[i] = collectedDeviceStates[i];
+			deviceStateVersions[i] = devicesVersion + 1;
+			changed = true;
+		}
+	}
+	if (changed) devicesVersion++;
+}
+
+void FruitySimServer::CollectDeviceState(u32 index, MapDeviceState& state)
+{
+	//The state is compared bytewise, so the padding must not contain garbage
+	memset(&state, 0, sizeof(state));
+
+	nodeEntry* node = &sim->nodes[index];
+
+	//Get the only handshaked inConnection
+	//TODO: The inConnection is only used to draw the direction arrow in the fruitymap, but currently
+	//the json only supports communicating 1 inConnection, this should be changed at some point so that
+	//Each connection can report its direction and masterBit
+	auto inConnections = node->gs.cm.GetMeshConnections(ConnectionDirection::DIRECTION_IN);
+	MeshConnection* inConnection = nullptr;
+	for (int k = 0; k < inConnections.count; k++) {
+		if (inConnections.handles[k] && inConnections.handles[k].IsHandshakeDone()) {
+			inConnection = inConnections.handles[k].GetConnection();
+		}
+	}
+
+	state.index = node->index;
+	strncpy(state.serialNumber, node->gs.config.GetSerialNumber(), NODE_SERIAL_NUMBER_MAX_CHAR_LENGTH);
+	state.nodeId = node->gs.node.configuration.nodeId;
+	state.clusterId = node->gs.node.clusterId;
+	state.clusterSize = node->gs.node.clusterSize;
+	state.ledOn = node->ledOn;
+
+	//Find out who has the master bit of the inConnection
+	if (inConnection != nullptr) {
+		state.inConnectionHasMasterBit = inConnection->connectionMasterBit == 1;
+		state.inConnectionPartner = inConnection->partnerId;
+
+		//FIXME: This mixes fruitymesh and simulator connections, but should only use simulator data
+		SoftdeviceConnection* foundSoftdeviceConnection = sim->findConnectionByHandle(node, inConnection->connectionHandle);
+		//We must check if the simulator connection still exists as it might have been cleaned up already
+		if (foundSoftdeviceConnection != nullptr) {
+			nodeEntry* partnerNode = foundSoftdeviceConnection->partner;
+			MeshConnections conn = partnerNode->gs.cm.GetMeshConnections(ConnectionDirection::DIRECTION_OUT);
+			for (int k = 0; k < conn.count; k++) {
+				if (conn.handles[k] && conn.handles[k].GetConnectionHandle() == inConnection->connectionHandle) {
+					state.inConnectionPartnerHasMasterBit = conn.handles[k].GetConnection()->connectionMasterBit;
+				}
+			}
+			//The noise would make every node look changed and would consume random numbers of the simulation
+			state.inConnectionRssi = (i32)sim->GetReceptionRssiNoNoise(node, partnerNode);
+		}
+	}
+
+	state.connectionLossCounter = node->gs.node.connectionLossCounter;
+	state.freeIn = node->gs.cm.freeMeshInConnections;
+	state.freeOut = node->gs.cm.freeMeshOutConnections;
+
+	state.advertisingActive = node->state.advertisingActive;
+	if (node->state.advertisingActive) {
+		state.advertisingDataLength = node->state.advertisingDataLength;
+		CheckedMemcpy(state.advertisingData, node->state.advertisingData, node->state.advertisingDataLength);
+	}
+
+	for (int j = 0; j < node->state.configuredTotalConnectionCount; j++) {
+		if (node->state.connections[j].connectionActive) {
+			MapDeviceState::Connection& connection = state.connections[state.numConnections];
+			connection.handle = node->state.connections[j].connectionHandle;
+			connection.target = node->state.connections[j].partner->gs.node.configuration.nodeId;
+			state.numConnections++;
+		}
+	}
+
+	state.x = node->x;
+	state.y = node->y;
 }
 
-#if defined(SIM_SERVER_PRESENT)
 std::string FruitySimServer::GenerateSiteJson()
 {
 	json site;
 
-	site["heightInMeter"] = cherrySimInstance->simConfig.mapHeightInMeters;
-	site["lengthInMeter"] = cherrySimInstance->simConfig.mapWidthInMeters;
+	site["heightInMeter"] = sim->simConfig.mapHeightInMeters;
+	site["lengthInMeter"] = sim->simConfig.mapWidthInMeters;
 	site["name"] = "SimulatorSite";
 	site["pixelPerMeter"] = 5;
 
 	return site.dump(4);
 }
-#endif // SIM_SERVER_PRESENT
 
-#if defined(SIM_SERVER_PRESENT)
-std::string FruitySimServer::GenerateDevicesJson()
+std::string FruitySimServer::GenerateDevicesJson(u32 since)
 {
+	//Only the changed states are copied while the simulation is blocked, the json is built afterwards
+	std::vector<MapDeviceState> changedStates;
+	u32 version = 0;
+	bool full = false;
+	{
+		std::lock_guard<std::mutex> lock(deviceStatesMutex);
+		version = devicesVersion;
+		//A version from the future belongs to a previous simulation, so the map has to start over
+		full = since == 0 || since > devicesVersion || since < deviceSetVersion;
+		for (u32 i = 0; i < deviceStates.size(); i++)
+		{
+			if (full || deviceStateVersions[i] > since) changedStates.push_back(deviceStates[i]);
+		}
+	}
+
 	json devices;
 	devices["status"] = "success";
-	for (unsigned int i = 0; i < cherrySimInstance->getTotalNodes(); i++) {
-		NodeIndexSetter nodeIndexSetter(i);
-		nodeEntry* node = &cherrySimInstance->nodes[i];
+	devices["version"] = version;
+	devices["full"] = full;
+	devices["result"] = json::array();
+	for (const MapDeviceState& state : changedStates) {
 		json device;
 
-		//Get the only handshaked inConnection
-		//TODO: The inConnection is only used to draw the direction arrow in the fruitymap, but currently
-		//the json only supports communicating 1 inConnection, this should be changed at some point so that
-		//Each connection can report its direction and masterBit
-		auto inConnections = node->gs.cm.GetMeshConnections(ConnectionDirection::DIRECTION_IN);
-		MeshConnection* inConnection = nullptr;
-		for (int k = 0; k < inConnections.count; k++) {
-			if (inConnections.handles[k] && inConnections.handles[k].IsHandshakeDone()) {
-				inConnection = inConnections.handles[k].GetConnection();
-			}
-		}
-
 		//UUID is generated based on the node index
 		char uuid[50];
-		sprintf(uuid, "00000000-1111-2222-3333-00000000%04u", node->index);
+		sprintf(uuid, "00000000-1111-2222-3333-00000000%04u", state.index);
 
 		device["uuid"] = uuid;
-		device["deviceId"] = node->gs.config.GetSerialNumber();
+		device["deviceId"] = state.serialNumber;
 		device["platform"] = "BLENODE";
-		device["ledOn"] = node->ledOn;
-		device["inConnectionHasMasterBit"] = false;
-		device["inConnectionPartnerHasMasterBit"] = false;
-
-		//Find out who has the master bit of the inConnection
-		if(inConnection != nullptr) device["inConnectionHasMasterBit"] = inConnection->connectionMasterBit == 1;
-
-		bool partnerHasMB = false;
-
-		if (inConnection != nullptr) {
-			SoftdeviceConnection* foundSoftdeviceConnection = cherrySimInstance->findConnectionByHandle(node, inConnection->connectionHandle);
-			//We must check if the simulator connection still exists as it might have been cleaned up already
-			if (foundSoftdeviceConnection != nullptr) {
-				nodeEntry* partnerNode = foundSoftdeviceConnection->partner;
-				MeshConnections conn = partnerNode->gs.cm.GetMeshConnections(ConnectionDirection::DIRECTION_OUT);
-				for (int k = 0; k < conn.count; k++) {
-					if (conn.handles[k] && conn.handles[k].GetConnectionHandle() == inConnection->connectionHandle) {
-						partnerHasMB = conn.handles[k].GetConnection()->connectionMasterBit;
-					}
-				}
-			}
-		}
-
-		device["inConnectionPartnerHasMasterBit"] = partnerHasMB;
-
-		device["connectionLossCounter"] = node->gs.node.connectionLossCounter;
-		device["inConnectionPartner"] = inConnection == nullptr ? 0 : inConnection->partnerId;
-
-
-		//FIXME: This mixes fruitymesh and simulator connections, but should only use simulator data
-		if (inConnection != nullptr) {
-			SoftdeviceConnection* sdInConn = cherrySimInstance->findConnectionByHandle(node, inConnection->connectionHandle);
-			if (sdInConn != nullptr) device["inConnectionRssi"] = (int)cherrySimInstance->GetReceptionRssi(node, sdInConn->partner);
-		}
-		else {
-			device["inConnectionRssi"] = 0;
-		}
-
+		device["ledOn"] = state.ledOn;
+		device["inConnectionHasMasterBit"] = state.inConnectionHasMasterBit;
+		device["inConnectionPartnerHasMasterBit"] = state.inConnectionPartnerHasMasterBit;
+		device["connectionLossCounter"] = state.connectionLossCounter;
+		device["inConnectionPartner"] = state.inConnectionPartner;
+		device["inConnectionRssi"] = state.inConnectionRssi;
 
 		char advData[200];
-		if (node->state.advertisingActive) {
-			Logger::convertBufferToHexString(node->state.advertisingData, node->state.advertisingDataLength, advData, sizeof(advData));
+		if (state.advertisingActive) {
+			Logger::convertBufferToHexString(state.advertisingData, state.advertisingDataLength, advData, sizeof(advData));
 		}
 		else {
 			sprintf(advData, "Not advertising");
@@ -306,34 +445,31 @@ std::string FruitySimServer::GenerateDevicesJson()
 
 		device["details"] = {
 			{"platform", "BLENODE"},
-			{"clusterId", node->gs.node.clusterId},
-			{"clusterSize", node->gs.node.clusterSize},
-			{"nodeId", node->gs.node.configuration.nodeId},
-			{"serialNumber", node->gs.config.GetSerialNumber()},
+			{"clusterId", state.clusterId},
+			{"clusterSize", state.clusterSize},
+			{"nodeId", state.nodeId},
+			{"serialNumber", state.serialNumber},
 			{"connections", json::array()},
 			{"nonConnections", json::array()},
 			{"lastSentAdvertisingMessage", advData},
-			{"freeIn", node->gs.cm.freeMeshInConnections},
-			{"freeOut", node->gs.cm.freeMeshOutConnections}
+			{"freeIn", state.freeIn},
+			{"freeOut", state.freeOut}
 		};
-		for (int j = 0; j < node->state.configuredTotalConnectionCount; j++) {
-			if (node->state.connections[j].connectionActive) {
-				json connection;
-				connection["handle"] = node->state.connections[j].connectionHandle;
-				connection["rssi"] = 7;
-				connection["target"] = node->state.connections[j].partner->gs.node.configuration.nodeId;
-
-				device["details"]["connections"].push_back(connection);
-			}
+		for (u32 j = 0; j < state.numConnections; j++) {
+			json connection;
+			connection["handle"] = state.connections[j].handle;
+			connection["rssi"] = 7;
+			connection["target"] = state.connections[j].target;
+
+			device["details"]["connections"].push_back(connection);
 		}
 		device["properties"] = {
 			{"onMap", "true"},
-			{"x", node->x},
-			{"y", node->y}
+			{"x", state.x},
+			{"y", state.y}
 		};
 		devices["result"].push_back(device);
 	}
 
 	return devices.dump(4);
 }
-#endif // SIM_SERVER_PRESENT
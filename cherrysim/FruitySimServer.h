@@ -30,20 +30,96 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <CherrySimTypes.h>
+
+class CherrySim;
+struct event_base;
+struct evhttp;
+struct evhttp_request;
+
+//The state of a node as it is shown on the map. It is trivially copyable so that changes can be found with memcmp.
+struct MapDeviceState
+{
+	struct Connection
+	{
+		int handle;
+		NodeId target;
+	};
+
+	u32 index;
+	char serialNumber[NODE_SERIAL_NUMBER_MAX_CHAR_LENGTH + 1];
+	NodeId nodeId;
+	ClusterId clusterId;
+	ClusterSize clusterSize;
+	bool ledOn;
+	bool inConnectionHasMasterBit;
+	bool inConnectionPartnerHasMasterBit;
+	NodeId inConnectionPartner;
+	i32 inConnectionRssi;
+	u16 connectionLossCounter;
+	u8 freeIn;
+	u8 freeOut;
+	bool advertisingActive;
+	u8 advertisingDataLength;
+	u8 advertisingData[40];
+	u8 numConnections;
+	Connection connections[SIM_MAX_CONNECTION_NUM];
+	float x;
+	float y;
+};
 
 class FruitySimServer
 {
 public:
-	FruitySimServer();
+	explicit FruitySimServer(CherrySim* sim);
 	~FruitySimServer();
 
-	//Call periodically so that the server can process requests
+	//Call periodically from the simulation thread, collects the changes of the nodes while the map is open
 	void ProcessServerRequests();
 
+	//Returns the devices that changed after the given version, all devices if since is 0
+	//or if the set of devices changed after the given version
+	std::string GenerateDevicesJson(u32 since);
+
 private:
+	static constexpr int64_t MAP_OPEN_TIMEOUT_MS = 5000; //The map counts as open this long after its last request
+	static constexpr int64_t DEVICE_STATE_UPDATE_INTERVAL_MS = 100;
+
+	CherrySim* sim;
+	event_base* eventBase = nullptr;
+	evhttp* httpServer = nullptr;
+
+	//The requests are processed on the server thread, so that serializing the json does not stall the simulation
+	std::thread serverThread;
+	std::mutex serverThreadMutex;
+	std::condition_variable serverThreadWakeup;
+	bool shuttingDown = false;
+
+	std::vector<MapDeviceState> collectedDeviceStates; //Only used by the simulation thread
+
+	std::atomic<int64_t> lastDevicesRequestMs;
+	int64_t lastDeviceStateUpdateMs = 0;
+
 	int StartServer();
+	void ServerThreadMain();
+	void HandleRequest(evhttp_request* req);
 
-	static std::string GenerateDevicesJson();
-	static std::string GenerateSiteJson();
-};
+	void CollectDeviceState(u32 index, MapDeviceState& state);
+	std::string GenerateSiteJson();
+
+TESTER_PUBLIC:
+	//The change log: every device state is stamped with the version in which it changed last
+	std::mutex deviceStatesMutex;
+	std::vector<MapDeviceState> deviceStates;
+	std::vector<u32> deviceStateVersions;
+	u32 devicesVersion = 0;
+	u32 deviceSetVersion = 0; //The version in which devices were added or removed, older versions need the full list
 
+	//Takes a snapshot of all nodes and stamps the changed ones with a new version
+	void UpdateDeviceStates();
+};
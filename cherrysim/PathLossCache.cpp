@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+
+#include "PathLossCache.h"
+#include <algorithm>
+
+void PathLossCache::SetNeighbour(std::vector<Neighbour>& list, u32 index, float pathLoss)
+{
+	auto it = std::lower_bound(list.begin(), list.end(), index, [](const Neighbour& n, u32 i) { return n.index < i; });
+	if (it != list.end() && it->index == index)
+	{
+		it->pathLoss = pathLoss;
+	}
+	else
+	{
+		list.insert(it, Neighbour{ index, pathLoss });
+	}
+}
+
+void PathLossCache::RemoveNeighbour(std::vector<Neighbour>& list, u32 index)
+{
+	auto it = std::lower_bound(list.begin(), list.end(), index, [](const Neighbour& n, u32 i) { return n.index < i; });
+	if (it != list.end() && it->index == index) list.erase(it);
+}
+
+void PathLossCache::Reset(u32 numNodes)
+{
+	this->numNodes = numNodes;
+	matrix.clear();
+	neighbours.clear();
+	if (IsDense())
+	{
+		matrix.assign((size_t)numNodes * numNodes, 0);
+	}
+	else
+	{
+		neighbours.resize(numNodes);
+	}
+	snapshots.assign(numNodes, NodeSnapshot());
+	dirtyNodes.clear();
+	isDirty.assign(numNodes, 0);
+	for (u32 i = 0; i < numNodes; i++)
+	{
+		MarkDirty(i);
+	}
+}
+
+u32 PathLossCache::GetNumNodes() const
+{
+	return numNodes;
+}
+
+bool PathLossCache::IsDense() const
+{
+	return numNodes <= MAX_DENSE_NODES;
+}
+
+void PathLossCache::UpdateNode(u32 nodeIndex, float x, float y, float z, const std::vector<int>& impossibleConnection)
+{
+	NodeSnapshot& snapshot = snapshots[nodeIndex];
+	if (snapshot.x != x || snapshot.y != y || snapshot.z != z || snapshot.impossibleConnection != impossibleConnection)
+	{
+		snapshot.x = x;
+		snapshot.y = y;
+		snapshot.z = z;
+		snapshot.impossibleConnection = impossibleConnection;
+		MarkDirty(nodeIndex);
+	}
+}
+
+void PathLossCache::MarkDirty(u32 nodeIndex)
+{
+	if (nodeIndex >= numNodes || isDirty[nodeIndex]) return;
+	isDirty[nodeIndex] = 1;
+	dirtyNodes.push_back(nodeIndex);
+}
+
+bool PathLossCache::IsDirty(u32 nodeIndex) const
+{
+	return nodeIndex >= numNodes || isDirty[nodeIndex];
+}
+
+const std::vector<u32>& PathLossCache::GetDirtyNodes() const
+{
+	return dirtyNodes;
+}
+
+void PathLossCache::RemoveNode(u32 nodeIndex)
+{
+	if (IsDense()) return;
+	for (const Neighbour& n : neighbours[nodeIndex])
+	{
+		RemoveNeighbour(neighbours[n.index], nodeIndex);
+	}
+	neighbours[nodeIndex].clear();
+}
+
+void PathLossCache::Set(u32 nodeA, u32 nodeB, float pathLoss)
+{
+	if (IsDense())
+	{
+		matrix[(size_t)nodeA * numNodes + nodeB] = pathLoss;
+		matrix[(size_t)nodeB * numNodes + nodeA] = pathLoss;
+	}
+	else
+	{
+		SetNeighbour(neighbours[nodeA], nodeB, pathLoss);
+		SetNeighbour(neighbours[nodeB], nodeA, pathLoss);
+	}
+}
+
+void PathLossCache::ClearDirty()
+{
+	for (u32 nodeIndex : dirtyNodes)
+	{
+		isDirty[nodeIndex] = 0;
+	}
+	dirtyNodes.clear();
+}
+
+bool PathLossCache::Get(u32 nodeA, u32 nodeB, float& pathLossOut) const
+{
+	if (IsDirty(nodeA) || IsDirty(nodeB)) return false;
+
+	if (IsDense())
+	{
+		pathLossOut = matrix[(size_t)nodeA * numNodes + nodeB];
+		return true;
+	}
+
+	const std::vector<Neighbour>& list = neighbours[nodeA];
+	auto it = std::lower_bound(list.begin(), list.end(), nodeB, [](const Neighbour& n, u32 i) { return n.index < i; });
+	if (it == list.end() || it->index != nodeB) return false;
+	pathLossOut = it->pathLoss;
+	return true;
+}
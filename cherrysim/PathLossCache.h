@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+#pragma once
+
+#include <types.h>
+#include <vector>
+#include <limits>
+
+/*
+Caches the path loss in dB between all pairs of nodes so that the logarithm of the distance does not have
+to be calculated for every packet. Small simulations use a dense matrix, bigger ones only keep the pairs
+that are within reception range, other pairs have to be calculated by the caller. The cache keeps a copy of
+everything that the path loss depends on and marks a node as dirty once it changes. The entries of dirty
+nodes are not returned until the caller has recalculated them.
+*/
+class PathLossCache
+{
+public:
+	static constexpr u32 MAX_DENSE_NODES = 2048; //A dense matrix for this many nodes needs 16MB
+	static constexpr float IMPOSSIBLE = std::numeric_limits<float>::infinity(); //Path loss for pairs that must never receive each other
+
+private:
+	struct NodeSnapshot
+	{
+		float x = 0;
+		float y = 0;
+		float z = 0;
+		std::vector<int> impossibleConnection;
+	};
+
+	struct Neighbour
+	{
+		u32 index;
+		float pathLoss;
+	};
+
+	u32 numNodes = 0;
+	std::vector<float> matrix; //Dense, numNodes * numNodes
+	std::vector<std::vector<Neighbour>> neighbours; //Sparse, sorted by index
+	std::vector<NodeSnapshot> snapshots;
+	std::vector<u32> dirtyNodes;
+	std::vector<u8> isDirty;
+
+	static void SetNeighbour(std::vector<Neighbour>& list, u32 index, float pathLoss);
+	static void RemoveNeighbour(std::vector<Neighbour>& list, u32 index);
+
+public:
+	//Removes all entries and marks all nodes as dirty
+	void Reset(u32 numNodes);
+	u32 GetNumNodes() const;
+	bool IsDense() const;
+
+	//Compares the given state of the node with the cached one and marks the node as dirty if it changed
+	void UpdateNode(u32 nodeIndex, float x, float y, float z, const std::vector<int>& impossibleConnection);
+	void MarkDirty(u32 nodeIndex);
+	bool IsDirty(u32 nodeIndex) const;
+	const std::vector<u32>& GetDirtyNodes() const;
+
+	//Removes all sparse entries of the node, must be called before the pairs of a dirty node are set again
+	void RemoveNode(u32 nodeIndex);
+	void Set(u32 nodeA, u32 nodeB, float pathLoss);
+	void ClearDirty();
+
+	//Returns false if the pair is not cached or one of the nodes is dirty
+	bool Get(u32 nodeA, u32 nodeB, float& pathLossOut) const;
+};
@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "ReplayTrace.h"
+#include "Exceptions.h"
+#include <cstring>
+#include <fstream>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+constexpr u32 HEADER_SIZE = sizeof(u32) + sizeof(u16);
+constexpr u32 RECORD_HEADER_SIZE = sizeof(u32) + sizeof(u8);
+constexpr u32 NODE_AND_TIME_SIZE = 2 * sizeof(u32);
+
+ReplayTraceWriter::ReplayTraceWriter(const char* path)
+{
+	file = fopen(path, "wb");
+	if (file == nullptr)
+	{
+		SIMEXCEPTION(FileException);
+		return;
+	}
+	fwrite(&MAGIC, sizeof(MAGIC), 1, file);
+	fwrite(&FORMAT_VERSION, sizeof(FORMAT_VERSION), 1, file);
+}
+
+ReplayTraceWriter::~ReplayTraceWriter()
+{
+	if (file != nullptr) fclose(file);
+}
+
+void ReplayTraceWriter::WriteRecord(ReplayTraceRecordType type, const u32* nodeAndTime, const void* data, u32 dataLength)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (file == nullptr) return;
+
+	const u32 length = (nodeAndTime != nullptr ? NODE_AND_TIME_SIZE : 0) + dataLength;
+	fwrite(&length, sizeof(length), 1, file);
+	fwrite(&type, sizeof(type), 1, file);
+	if (nodeAndTime != nullptr) fwrite(nodeAndTime, NODE_AND_TIME_SIZE, 1, file);
+	if (dataLength > 0) fwrite(data, dataLength, 1, file);
+
+	//Records are rare compared to the log, flushing keeps the trace complete if the simulator crashes
+	fflush(file);
+}
+
+void ReplayTraceWriter::WriteConfiguration(const std::string& configurationJson)
+{
+	WriteRecord(ReplayTraceRecordType::CONFIGURATION, nullptr, configurationJson.data(), (u32)configurationJson.size());
+}
+
+void ReplayTraceWriter::WriteVersion(u32 version)
+{
+	WriteRecord(ReplayTraceRecordType::VERSION, nullptr, &version, sizeof(version));
+}
+
+void ReplayTraceWriter::WriteCommand(u32 index, u32 timeMs, const std::string& command)
+{
+	const u32 nodeAndTime[2] = { index, timeMs };
+	WriteRecord(ReplayTraceRecordType::COMMAND, nodeAndTime, command.data(), (u32)command.size());
+}
+
+void ReplayTraceWriter::WriteEvent(u32 index, u32 timeMs, const char* event)
+{
+	const u32 nodeAndTime[2] = { index, timeMs };
+	WriteRecord(ReplayTraceRecordType::EVENT, nodeAndTime, event, (u32)strlen(event));
+}
+
+ReplayTraceReader::ReplayTraceReader(const char* path)
+{
+#ifdef __linux__
+	const int fd = open(path, O_RDONLY);
+	struct stat fileStat;
+	if (fd >= 0 && fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+	{
+		void* mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED)
+		{
+			madvise(mapping, fileStat.st_size, MADV_SEQUENTIAL);
+			data = (const u8*)mapping;
+			size = fileStat.st_size;
+			isMapped = true;
+		}
+	}
+	if (fd >= 0) close(fd);
+#endif
+	if (!isMapped)
+	{
+		std::ifstream input(path, std::ios::binary | std::ios::ate);
+		if (!input)
+		{
+			SIMEXCEPTION(FileException);
+			return;
+		}
+		contents.resize((size_t)input.tellg());
+		input.seekg(0);
+		input.read((char*)contents.data(), contents.size());
+		data = contents.data();
+		size = contents.size();
+	}
+
+	u32 magic = 0;
+	u16 formatVersion = 0;
+	if (size >= HEADER_SIZE)
+	{
+		memcpy(&magic, data, sizeof(magic));
+		memcpy(&formatVersion, data + sizeof(magic), sizeof(formatVersion));
+	}
+	if (magic != ReplayTraceWriter::MAGIC || formatVersion != ReplayTraceWriter::FORMAT_VERSION)
+	{
+		//Not a trace or written by an incompatible simulator
+		SIMEXCEPTION(CorruptOrOutdatedSavefile);
+		position = size;
+		return;
+	}
+	position = HEADER_SIZE;
+}
+
+ReplayTraceReader::~ReplayTraceReader()
+{
+#ifdef __linux__
+	if (isMapped) munmap((void*)data, size);
+#endif
+}
+
+bool ReplayTraceReader::IsTrace(const char* path)
+{
+	std::ifstream input(path, std::ios::binary);
+	u32 magic = 0;
+	return input.read((char*)&magic, sizeof(magic)) && magic == ReplayTraceWriter::MAGIC;
+}
+
+bool ReplayTraceReader::Next(ReplayTraceRecord& out)
+{
+	if (size - position < RECORD_HEADER_SIZE) return false;
+
+	u32 length = 0;
+	memcpy(&length, data + position, sizeof(length));
+	if (size - position - RECORD_HEADER_SIZE < length) return false;
+
+	const u8* payload = data + position + RECORD_HEADER_SIZE;
+	out = ReplayTraceRecord();
+	out.type = (ReplayTraceRecordType)data[position + sizeof(length)];
+	if (out.type == ReplayTraceRecordType::COMMAND || out.type == ReplayTraceRecordType::EVENT)
+	{
+		if (length < NODE_AND_TIME_SIZE) return false;
+		memcpy(&out.index, payload, sizeof(out.index));
+		memcpy(&out.timeMs, payload + sizeof(out.index), sizeof(out.timeMs));
+		payload += NODE_AND_TIME_SIZE;
+		length -= NODE_AND_TIME_SIZE;
+	}
+	out.data = (const char*)payload;
+	out.dataLength = length;
+
+	position = (size_t)(payload - data) + length;
+	return true;
+}
@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <types.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdio>
+
+/*
+A compact binary trace of a simulation that can be replayed. It is the binary counterpart to the replay lines
+that are logged with SimConfiguration::logReplayCommands. The trace starts with a header and records are only
+ever appended to it. Every record is prefixed with its length, so a reader skips records that it does not know
+and a trace that was cut off, e.g. because the simulator crashed, can still be read up to its last complete record.
+
+Header: u32 magic, u16 format version
+Record: u32 length of the payload, u8 type, payload
+    CONFIGURATION: The SimConfiguration as json
+    VERSION:       u32 FM_VERSION
+    COMMAND:       u32 node index, u32 simulation time in ms, terminal command
+    EVENT:         u32 node index, u32 simulation time in ms, event name
+*/
+enum class ReplayTraceRecordType : u8
+{
+	CONFIGURATION = 0,
+	VERSION = 1,
+	COMMAND = 2,
+	EVENT = 3,
+};
+
+struct ReplayTraceRecord
+{
+	ReplayTraceRecordType type = ReplayTraceRecordType::CONFIGURATION;
+	u32 index = 0; //Only set for commands and events
+	u32 timeMs = 0; //Only set for commands and events
+	const char* data = nullptr; //Points into the trace and is not null terminated
+	u32 dataLength = 0;
+};
+
+class ReplayTraceWriter
+{
+private:
+	FILE* file = nullptr;
+	std::mutex mutex; //Nodes that are stepped in parallel may write at the same time
+
+	void WriteRecord(ReplayTraceRecordType type, const u32* nodeAndTime, const void* data, u32 dataLength);
+
+public:
+	static constexpr u32 MAGIC = 0x54524D46; //"FMRT"
+	static constexpr u16 FORMAT_VERSION = 1;
+
+	explicit ReplayTraceWriter(const char* path);
+	~ReplayTraceWriter();
+	ReplayTraceWriter(const ReplayTraceWriter&) = delete;
+	ReplayTraceWriter& operator=(const ReplayTraceWriter&) = delete;
+
+	void WriteConfiguration(const std::string& configurationJson);
+	void WriteVersion(u32 version);
+	void WriteCommand(u32 index, u32 timeMs, const std::string& command);
+	void WriteEvent(u32 index, u32 timeMs, const char* event);
+};
+
+//Reads a trace front to back. Where the platform supports it, the trace is memory mapped so that it is paged in
+//while it is replayed instead of being loaded at once, otherwise it is loaded completely.
+class ReplayTraceReader
+{
+private:
+	const u8* data = nullptr;
+	size_t size = 0;
+	size_t position = 0;
+	bool isMapped = false;
+	std::vector<u8> contents; //Only used if the trace could not be mapped
+
+public:
+	explicit ReplayTraceReader(const char* path);
+	~ReplayTraceReader();
+	ReplayTraceReader(const ReplayTraceReader&) = delete;
+	ReplayTraceReader& operator=(const ReplayTraceReader&) = delete;
+
+	//Checks if the file at the path starts with the header of a trace
+	static bool IsTrace(const char* path);
+
+	//Returns false once the end of the trace or an incomplete record is reached
+	bool Next(ReplayTraceRecord& out);
+};
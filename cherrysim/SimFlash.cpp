@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+
+#include "SimFlash.h"
+#include <cstring>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static_assert(SimFlash::SIZE % SimFlash::PAGE_SIZE == 0, "Flash must consist of whole pages");
+
+#ifdef __linux__
+//Returns a file that contains an erased flash, it is shared by all nodes and never written
+static int GetErasedImage()
+{
+	static const int fd = []() {
+		int fd = memfd_create("SimFlashErasedImage", 0);
+		if (fd < 0) return -1;
+
+		u8 erasedPage[SimFlash::PAGE_SIZE];
+		memset(erasedPage, 0xFF, sizeof(erasedPage));
+		for (u32 i = 0; i < SimFlash::SIZE / SimFlash::PAGE_SIZE; i++)
+		{
+			if (write(fd, erasedPage, sizeof(erasedPage)) != (ssize_t)sizeof(erasedPage))
+			{
+				close(fd);
+				return -1;
+			}
+		}
+		return fd;
+	}();
+	return fd;
+}
+#endif
+
+SimFlash::SimFlash()
+{
+#ifdef __linux__
+	const int fd = GetErasedImage();
+	if (fd >= 0)
+	{
+		void* mapping = mmap(nullptr, SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED)
+		{
+			memory = (u8*)mapping;
+			isMapped = true;
+			return;
+		}
+	}
+#endif
+	memory = new u8[SIZE];
+	memset(memory, 0xFF, SIZE);
+}
+
+SimFlash::~SimFlash()
+{
+#ifdef __linux__
+	if (isMapped)
+	{
+		munmap(memory, SIZE);
+		return;
+	}
+#endif
+	delete[] memory;
+}
+
+bool SimFlash::Remap(u32 offset, u32 length)
+{
+#ifdef __linux__
+	const long osPageSize = sysconf(_SC_PAGESIZE);
+	if (!isMapped || osPageSize <= 0 || offset % osPageSize != 0 || length % osPageSize != 0) return false;
+
+	//Mapping over the old pages discards the private copies of the node
+	void* mapping = mmap(memory + offset, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, GetErasedImage(), offset);
+	return mapping != MAP_FAILED;
+#else
+	return false;
+#endif
+}
+
+void SimFlash::Erase(u32 offset, u32 length)
+{
+	if (offset >= SIZE) return;
+	if (length > SIZE - offset) length = SIZE - offset;
+
+	if (!Remap(offset, length)) memset(memory + offset, 0xFF, length);
+}
+
+void SimFlash::EraseAll()
+{
+	Erase(0, SIZE);
+}
+
+bool SimFlash::IsPageErased(u32 page) const
+{
+	const u32* words = (const u32*)(memory + page * PAGE_SIZE);
+	for (u32 i = 0; i < PAGE_SIZE / sizeof(u32); i++)
+	{
+		if (words[i] != 0xFFFFFFFF) return false;
+	}
+	return true;
+}
+
+u32 SimFlash::GetNumWrittenPages() const
+{
+	u32 count = 0;
+	for (u32 page = 0; page < SIZE / PAGE_SIZE; page++)
+	{
+		if (!IsPageErased(page)) count++;
+	}
+	return count;
+}
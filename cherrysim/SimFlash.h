@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+#pragma once
+
+#include <types.h>
+
+/*
+The flash memory of a simulated node. The memory is contiguous so that the firmware can access it through
+simFlashPtr like the real flash. Where the platform supports it, all nodes map the same erased image
+copy-on-write, so that only pages that a node wrote to use memory. Erasing gives the memory of the pages
+back. On other platforms the flash is allocated on the heap.
+*/
+class SimFlash
+{
+public:
+	static constexpr u32 SIZE = SIM_MAX_FLASH_SIZE;
+	static constexpr u32 PAGE_SIZE = 4096; //Granularity of the flash file, must match the page size of the simulated chip
+
+private:
+	u8* memory = nullptr;
+	bool isMapped = false;
+
+	//Erases the range by mapping the erased image again, returns false if the range can not be remapped
+	bool Remap(u32 offset, u32 length);
+
+public:
+	SimFlash();
+	~SimFlash();
+	SimFlash(const SimFlash&) = delete;
+	SimFlash& operator=(const SimFlash&) = delete;
+
+	u8* data() { return memory; }
+	const u8* data() const { return memory; }
+	u8& operator[](u32 index) { return memory[index]; }
+
+	//Sets the range to 0xFF
+	void Erase(u32 offset, u32 length);
+	void EraseAll();
+	//Checks the content of the page, a page that was written with 0xFF only counts as erased as well
+	bool IsPageErased(u32 page) const;
+	u32 GetNumWrittenPages() const;
+};
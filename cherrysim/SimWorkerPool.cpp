@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SimWorkerPool.h"
+
+SimWorkerPool::SimWorkerPool(u32 numThreads)
+{
+	for (u32 i = 1; i < numThreads; i++)
+	{
+		threads.emplace_back(&SimWorkerPool::WorkerMain, this);
+	}
+}
+
+SimWorkerPool::~SimWorkerPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		shuttingDown = true;
+	}
+	workAvailable.notify_all();
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+u32 SimWorkerPool::GetNumThreads() const
+{
+	return (u32)threads.size() + 1;
+}
+
+void SimWorkerPool::ExecuteJobs()
+{
+	while (true)
+	{
+		const u32 index = nextJob.fetch_add(1);
+		if (index >= jobCount) return;
+		(*job)(index);
+	}
+}
+
+void SimWorkerPool::WorkerMain()
+{
+	u32 seenGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workAvailable.wait(lock, [&] { return shuttingDown || generation != seenGeneration; });
+			if (shuttingDown) return;
+			seenGeneration = generation;
+		}
+
+		{
+			Exceptions::ExceptionStateSharer sharer(callerExceptionState);
+			ExecuteJobs();
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			busyThreads--;
+		}
+		workDone.notify_one();
+	}
+}
+
+void SimWorkerPool::Run(u32 count, const std::function<void(u32)>& job)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		this->job = &job;
+		callerExceptionState = Exceptions::getExceptionState();
+		jobCount = count;
+		nextJob = 0;
+		busyThreads = (u32)threads.size();
+		generation++;
+	}
+	workAvailable.notify_all();
+
+	ExecuteJobs();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	workDone.wait(lock, [&] { return busyThreads == 0; });
+	this->job = nullptr;
+	callerExceptionState = nullptr;
+}
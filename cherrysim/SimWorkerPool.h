@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <types.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include "Exceptions.h"
+
+/*
+A small pool of persistent worker threads that is used to step the simulated nodes in parallel.
+The calling thread takes part in the work as well, so a pool for n threads only starts n - 1
+additional threads. Jobs are handed out dynamically, the caller is responsible for making the
+result independent of which thread executed which job.
+*/
+class SimWorkerPool
+{
+private:
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::condition_variable workDone;
+
+	const std::function<void(u32)>* job = nullptr;
+	Exceptions::ExceptionState* callerExceptionState = nullptr; //Jobs ignore the same exceptions as the thread that called Run
+	u32 jobCount = 0;
+	u32 generation = 0; //Incremented for every call to Run, wakes up the workers
+	u32 busyThreads = 0;
+	bool shuttingDown = false;
+	std::atomic<u32> nextJob{ 0 };
+
+	void WorkerMain();
+	void ExecuteJobs();
+
+public:
+	explicit SimWorkerPool(u32 numThreads);
+	~SimWorkerPool();
+	SimWorkerPool(const SimWorkerPool&) = delete;
+	SimWorkerPool& operator=(const SimWorkerPool&) = delete;
+
+	u32 GetNumThreads() const;
+
+	//Calls job once for every index in [0, count) and returns after all calls have returned.
+	//The job must not throw.
+	void Run(u32 count, const std::function<void(u32)>& job);
+};
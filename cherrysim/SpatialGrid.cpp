@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+
+i32 SpatialGrid::ToCellCoordinate(float meters) const
+{
+	return (i32)std::floor(meters / cellSizeInMeters);
+}
+
+SpatialGrid::CellKey SpatialGrid::ToCellKey(i32 cellX, i32 cellY, i32 cellZ)
+{
+	//21 bits per axis are plenty, even positions far outside of the map stay unique
+	constexpr uint64_t mask = (1ULL << 21) - 1;
+	return (((uint64_t)cellX & mask) << 42) | (((uint64_t)cellY & mask) << 21) | ((uint64_t)cellZ & mask);
+}
+
+SpatialGrid::CellKey SpatialGrid::ToCellKey(float x, float y, float z) const
+{
+	return ToCellKey(ToCellCoordinate(x), ToCellCoordinate(y), ToCellCoordinate(z));
+}
+
+void SpatialGrid::Reset(u32 numNodes, float cellSizeInMeters)
+{
+	this->cellSizeInMeters = cellSizeInMeters;
+	cells.clear();
+	nodeCells.assign(numNodes, INVALID_CELL);
+}
+
+float SpatialGrid::GetCellSize() const
+{
+	return cellSizeInMeters;
+}
+
+void SpatialGrid::UpdateNode(u32 nodeIndex, float x, float y, float z)
+{
+	const CellKey newCell = ToCellKey(x, y, z);
+	const CellKey oldCell = nodeCells[nodeIndex];
+	if (newCell == oldCell) return;
+
+	if (oldCell != INVALID_CELL)
+	{
+		std::vector<u32>& oldNodes = cells[oldCell];
+		oldNodes.erase(std::find(oldNodes.begin(), oldNodes.end(), nodeIndex));
+		if (oldNodes.empty()) cells.erase(oldCell);
+	}
+
+	cells[newCell].push_back(nodeIndex);
+	nodeCells[nodeIndex] = newCell;
+}
+
+void SpatialGrid::GetNodesAround(u32 nodeIndex, std::vector<u32>& nodesOut) const
+{
+	nodesOut.clear();
+
+	const CellKey ownCell = nodeCells[nodeIndex];
+	if (ownCell == INVALID_CELL) return;
+
+	//Sign extend the 21 bit coordinates of our own cell again
+	constexpr uint64_t mask = (1ULL << 21) - 1;
+	const i32 cellX = (i32)((u32)((ownCell >> 42) & mask) << 11) >> 11;
+	const i32 cellY = (i32)((u32)((ownCell >> 21) & mask) << 11) >> 11;
+	const i32 cellZ = (i32)((u32)( ownCell        & mask) << 11) >> 11;
+
+	for (i32 dx = -1; dx <= 1; dx++)
+	{
+		for (i32 dy = -1; dy <= 1; dy++)
+		{
+			for (i32 dz = -1; dz <= 1; dz++)
+			{
+				auto it = cells.find(ToCellKey(cellX + dx, cellY + dy, cellZ + dz));
+				if (it == cells.end()) continue;
+				for (u32 otherIndex : it->second)
+				{
+					if (otherIndex != nodeIndex) nodesOut.push_back(otherIndex);
+				}
+			}
+		}
+	}
+
+	std::sort(nodesOut.begin(), nodesOut.end());
+}
@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <types.h>
+#include <vector>
+#include <unordered_map>
+
+/*
+A uniform grid that buckets nodes by their position in meters. The cell size is chosen to be
+the maximum distance at which any two nodes could still receive each other, so that all
+possible receivers of a node are located in the 27 cells surrounding it. This allows the
+simulator to skip the reception calculation for nodes that are out of range anyway.
+*/
+class SpatialGrid
+{
+private:
+	typedef uint64_t CellKey;
+	static constexpr CellKey INVALID_CELL = UINT64_MAX;
+
+	float cellSizeInMeters = 0;
+	std::unordered_map<CellKey, std::vector<u32>> cells;
+	std::vector<CellKey> nodeCells; //The cell in which each node index is currently placed
+
+	i32 ToCellCoordinate(float meters) const;
+	static CellKey ToCellKey(i32 cellX, i32 cellY, i32 cellZ);
+	CellKey ToCellKey(float x, float y, float z) const;
+
+public:
+	//Removes all nodes and prepares the grid for the given amount of nodes
+	void Reset(u32 numNodes, float cellSizeInMeters);
+	float GetCellSize() const;
+
+	//Places the node into the cell of the given position (in meters) or moves it if necessary
+	void UpdateNode(u32 nodeIndex, float x, float y, float z);
+
+	//Fills nodesOut with all node indices, except the given one, that are placed in the
+	//cells surrounding the given node. The result is sorted by node index so that the
+	//order in which nodes are visited matches the order of a linear scan.
+	void GetNodesAround(u32 nodeIndex, std::vector<u32>& nodesOut) const;
+};
@@ -33,8 +33,8 @@
 #include "Exceptions.h"
 #include <cstdio> //for std::size_t
 
-std::vector<const void*> StackWatcher::stackBase;
-u32 StackWatcher::disableValue = 0;
+thread_local std::vector<const void*> StackWatcher::stackBase;
+thread_local u32 StackWatcher::disableValue = 0;
 
 void StackWatcher::check()
 {
@@ -38,6 +38,7 @@
 #include <json.hpp>
 #include <Logger.h>
 #include <fstream>
+#include <mutex>
 
 extern "C" {
 #include <app_timer.h>
@@ -55,20 +56,24 @@ All calls work in conjunction with helper methods and simulation routines define
 using json = nlohmann::json;
 
 //These variables are normally defined by the linker sections, so we need to define them here
-uint32_t __application_start_address;
-uint32_t __application_end_address;
-uint32_t __application_ram_start_address;
-uint32_t __start_conn_type_resolvers;
-uint32_t __stop_conn_type_resolvers;
+//As all nodes share one process, they are thread local just like the other pointers to the current node
+SIM_THREAD_LOCAL uint32_t __application_start_address;
+SIM_THREAD_LOCAL uint32_t __application_end_address;
+SIM_THREAD_LOCAL uint32_t __application_ram_start_address;
+SIM_THREAD_LOCAL uint32_t __start_conn_type_resolvers;
+SIM_THREAD_LOCAL uint32_t __stop_conn_type_resolvers;
 
 //Pointer to FruityMesh state
-GlobalState* simGlobalStatePtr;
+SIM_THREAD_LOCAL GlobalState* simGlobalStatePtr;
 
 //nRF hardware abstraction
-NRF_FICR_Type* simFicrPtr;
-NRF_UICR_Type* simUicrPtr;
-NRF_GPIO_Type* simGpioPtr;
-uint8_t* simFlashPtr;
+SIM_THREAD_LOCAL NRF_FICR_Type* simFicrPtr;
+SIM_THREAD_LOCAL NRF_UICR_Type* simUicrPtr;
+SIM_THREAD_LOCAL NRF_GPIO_Type* simGpioPtr;
+SIM_THREAD_LOCAL uint8_t* simFlashPtr;
+
+//Guards the AES implementation used by sd_ecb_block_encrypt
+static std::mutex aesMutex;
 
 
 //########################################### SoftDevice Call Redirection #####################################################
@@ -304,10 +309,10 @@ extern "C"
 			//Was not initialized!
 			SIMEXCEPTION(IllegalStateException);
 		}
-		gyro->x = (uint16_t)cherrySimInstance->simState.rnd.nextU32();
-		gyro->y = (uint16_t)cherrySimInstance->simState.rnd.nextU32();
-		gyro->z = (uint16_t)cherrySimInstance->simState.rnd.nextU32();
-		gyro->sensortime = cherrySimInstance->simState.rnd.nextU32();
+		gyro->x = (uint16_t)cherrySimInstance->GetRnd().nextU32();
+		gyro->y = (uint16_t)cherrySimInstance->GetRnd().nextU32();
+		gyro->z = (uint16_t)cherrySimInstance->GetRnd().nextU32();
+		gyro->sensortime = cherrySimInstance->GetRnd().nextU32();
 		return BMG250_OK;
 	}
 
@@ -385,10 +390,10 @@ extern "C"
 			//Was not initialized!
 			SIMEXCEPTION(IllegalStateException);
 		}
-		out->x = (uint16_t)cherrySimInstance->simState.rnd.nextU32();
-		out->y = (uint16_t)cherrySimInstance->simState.rnd.nextU32();
-		out->z = (uint16_t)cherrySimInstance->simState.rnd.nextU32();
-		out->temp = (uint16_t)cherrySimInstance->simState.rnd.nextU32();
+		out->x = (uint16_t)cherrySimInstance->GetRnd().nextU32();
+		out->y = (uint16_t)cherrySimInstance->GetRnd().nextU32();
+		out->z = (uint16_t)cherrySimInstance->GetRnd().nextU32();
+		out->temp = (uint16_t)cherrySimInstance->GetRnd().nextU32();
 		return 0;
 	}
 
@@ -634,9 +639,9 @@ extern "C"
 			return (int32_t)ErrorType::NULL_ERROR;
 		}
 		axis3bit16_t* buffer = (axis3bit16_t*)buff;
-		buffer->i16bit[0] = (i16)cherrySimInstance->simState.rnd.nextU32();
-		buffer->i16bit[1] = (i16)cherrySimInstance->simState.rnd.nextU32();
-		buffer->i16bit[2] = (i16)cherrySimInstance->simState.rnd.nextU32();
+		buffer->i16bit[0] = (i16)cherrySimInstance->GetRnd().nextU32();
+		buffer->i16bit[1] = (i16)cherrySimInstance->GetRnd().nextU32();
+		buffer->i16bit[2] = (i16)cherrySimInstance->GetRnd().nextU32();
 
 		return (int32_t)ErrorType::SUCCESS;
 
@@ -785,7 +790,7 @@ extern "C"
 			SIMEXCEPTION(IllegalStateException);
 		}
 
-		return cherrySimInstance->simState.rnd.nextU32();
+		return cherrySimInstance->GetRnd().nextU32();
 	}
 	uint32_t bme280_get_temperature()
 	{
@@ -796,7 +801,7 @@ extern "C"
 			SIMEXCEPTION(IllegalStateException);
 		}
 
-		return cherrySimInstance->simState.rnd.nextU32();
+		return cherrySimInstance->GetRnd().nextU32();
 	}
 	uint32_t bme280_get_humidity()
 	{
@@ -807,7 +812,7 @@ extern "C"
 			SIMEXCEPTION(IllegalStateException);
 		}
 
-		return cherrySimInstance->simState.rnd.nextU32();
+		return cherrySimInstance->GetRnd().nextU32();
 	}
 
 	uint32_t sd_ble_gap_connect(const ble_gap_addr_t* p_peer_addr, const ble_gap_scan_params_t* p_scan_params, const ble_gap_conn_params_t* p_conn_params, uint32_t)
@@ -899,7 +904,7 @@ extern "C"
 
 		//Send an event to the connection partner to request the key information
 		simBleEvent s1;
-		s1.globalId = cherrySimInstance->simState.globalEventIdCounter++;
+		s1.globalId = cherrySimInstance->DrawGlobalEventId();
 		s1.bleEvent.header.evt_id = BLE_GAP_EVT_SEC_INFO_REQUEST;
 		s1.bleEvent.header.evt_len = s1.globalId;
 		s1.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
@@ -909,10 +914,16 @@ extern "C"
 		s1.bleEvent.evt.gap_evt.params.sec_info_request.enc_info = 0; //TODO: incomplete information
 		s1.bleEvent.evt.gap_evt.params.sec_info_request.id_info = 0; //TODO: incomplete information
 		s1.bleEvent.evt.gap_evt.params.sec_info_request.sign_info = 0; //TODO: incomplete information
-		connection->partner->eventQueue.push_back(s1);
+		cherrySimInstance->PostEvent(connection->partner, s1, connection->connectionHandle);
 
 		//Save the key that should be used for encrypting the connection
-		CheckedMemcpy(cherrySimInstance->currentNode->state.currentLtkForEstablishingSecurity, p_enc_info->ltk, 16);
+		//The partner reads the key from our state, so it is only changed once no node is stepped
+		nodeEntry* node = cherrySimInstance->currentNode;
+		std::array<u8, 16> ltk;
+		CheckedMemcpy(ltk.data(), p_enc_info->ltk, 16);
+		cherrySimInstance->RunOnStepBarrier([node, ltk]() {
+			CheckedMemcpy(node->state.currentLtkForEstablishingSecurity, ltk.data(), 16);
+		});
 
 		return NRF_SUCCESS;
 	}
@@ -934,7 +945,7 @@ extern "C"
 			//Set our own conneciton to encrypted
 			connection->connectionEncrypted = true;
 			simBleEvent s1;
-			s1.globalId = cherrySimInstance->simState.globalEventIdCounter++;
+			s1.globalId = cherrySimInstance->DrawGlobalEventId();
 			s1.bleEvent.header.evt_id = BLE_GAP_EVT_CONN_SEC_UPDATE;
 			s1.bleEvent.header.evt_len = s1.globalId;
 			s1.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
@@ -944,16 +955,22 @@ extern "C"
 			cherrySimInstance->currentNode->eventQueue.push_back(s1);
 
 			//Set our own partners connection to encrypted
-			connection->partnerConnection->connectionEncrypted = true;
+			SoftdeviceConnection* partnerConnection = connection->partnerConnection;
+			const u16 connectionHandle = connection->connectionHandle;
+			cherrySimInstance->RunOnStepBarrier([partnerConnection, connectionHandle]() {
+				if (partnerConnection->connectionActive && partnerConnection->connectionHandle == connectionHandle) {
+					partnerConnection->connectionEncrypted = true;
+				}
+			});
 			simBleEvent s2;
-			s2.globalId = cherrySimInstance->simState.globalEventIdCounter++;
+			s2.globalId = cherrySimInstance->DrawGlobalEventId();
 			s2.bleEvent.header.evt_id = BLE_GAP_EVT_CONN_SEC_UPDATE;
 			s2.bleEvent.header.evt_len = s2.globalId;
 			s2.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
 			s2.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.encr_key_size = 16;
 			s2.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.sm = 1;
 			s2.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.lv = 3;
-			connection->partner->eventQueue.push_back(s2);
+			cherrySimInstance->PostEvent(connection->partner, s2, connection->connectionHandle);
 		}
 		//Keys do not match, generate a failure
 		else {
@@ -1227,7 +1244,7 @@ extern "C"
 		}
 
 		//We save a global id for each packet that is sent, so that we can debug where a packet was generated
-		buffer->globalPacketId = cherrySimInstance->simState.globalPacketIdCounter++;
+		buffer->globalPacketId = cherrySimInstance->DrawGlobalPacketId();
 		buffer->sender = cherrySimInstance->currentNode;
 		buffer->receiver = partnerNode;
 		buffer->connHandle = conn_handle;
@@ -1236,6 +1253,8 @@ extern "C"
 		buffer->params.writeParams = *p_write_params;
 		buffer->params.writeParams.p_value = buffer->data; //Reassign data pointer to our buffer
 		buffer->isHvx = false;
+
+		cherrySimInstance->ClusterSizeChangeQueued(*buffer);
 		
 		//Record statistics for every packet queued in the SoftDevice
 		cherrySimInstance->AddMessageToStats(cherrySimInstance->currentNode->routedPackets, buffer->data, buffer->params.writeParams.len);
@@ -1255,11 +1274,8 @@ extern "C"
 
 		logt("RS", "Erasing Page %u", page_number);
 
-		u32* p = (u32*)(FLASH_REGION_START_ADDRESS + (u32)page_number * FruityHal::GetCodePageSize());
-
-		for (u32 i = 0; i < FruityHal::GetCodePageSize() / 4; i++) {
-			p[i] = 0xFFFFFFFF;
-		}
+		//Erasing releases the memory of the page
+		cherrySimInstance->currentNode->flash.Erase((u32)page_number * FruityHal::GetCodePageSize(), FruityHal::GetCodePageSize());
 
 
 		if (cherrySimInstance->simConfig.simulateAsyncFlash) {
@@ -1380,9 +1396,14 @@ extern "C"
 
 			simBleEvent bleEvent = cherrySimInstance->currentNode->eventQueue.front();
 			cherrySimInstance->currentNode->eventQueue.pop_front();
+			cherrySimInstance->ClusterSizeChangeDelivered(bleEvent);
 
 			if (cherrySimInstance->simEventListener != nullptr) {
-				cherrySimInstance->simEventListener->CherrySimBleEventHandler(cherrySimInstance->currentNode, &bleEvent, FruityHal::GetEventBufferSize());
+				nodeEntry* node = cherrySimInstance->currentNode;
+				const u16 eventSize = FruityHal::GetEventBufferSize();
+				cherrySimInstance->RunOnStepBarrier([node, bleEvent, eventSize]() mutable {
+					cherrySimInstance->simEventListener->CherrySimBleEventHandler(node, &bleEvent, eventSize);
+				});
 			}
 
 			//We copy the current event so that we can access it during debugging if we want to get more information
@@ -1573,7 +1594,7 @@ extern "C"
 			return NRF_ERROR_RESOURCES;
 		}
 
-		buffer->globalPacketId = cherrySimInstance->simState.globalPacketIdCounter++;
+		buffer->globalPacketId = cherrySimInstance->DrawGlobalPacketId();
 		buffer->sender = cherrySimInstance->currentNode;
 		buffer->receiver = partnerNode;
 		buffer->connHandle = conn_handle;
@@ -1588,6 +1609,8 @@ extern "C"
 		buffer->params.hvxParams.p_data = buffer->data; //Reassign data pointer to our buffer
 		buffer->isHvx = true;
 
+		cherrySimInstance->ClusterSizeChangeQueued(*buffer);
+
 		//printf("Q@NODE %u WRITES NOTIFICATION messageType %02X" EOL, cherrySimInstance->currentNode->id, buffer->data[0]);
 
 		return 0;
@@ -1595,6 +1618,8 @@ extern "C"
 
 	uint32_t sd_ecb_block_encrypt(nrf_ecb_hal_data_t * p_ecb_data) {
 		START_OF_FUNCTION();
+		//The AES implementation keeps its state in static variables
+		std::lock_guard<std::mutex> guard(aesMutex);
 		AES_ECB_encrypt(p_ecb_data->cleartext, p_ecb_data->key, p_ecb_data->ciphertext, 16);
 
 		return 0;
@@ -1621,9 +1646,13 @@ const char *__asan_default_options() {
 // These calls can be made within FruityMesh using the macros (e.g. SIMSTATCOUNT)
 //#########################################################################################
 
+//Statistics can be collected by nodes that are simulated in parallel
+std::mutex simStatMutex;
+
 std::map<std::string, int> simStatCounts;
 void sim_collect_statistic_count(const char* key)
 {
+	std::lock_guard<std::mutex> guard(simStatMutex);
 	if (simStatCounts.find(key) != simStatCounts.end())
 	{
 		simStatCounts[key] = simStatCounts[key] + 1;
@@ -1637,6 +1666,7 @@ std::map<std::string, int> simStatAvgCounts;
 std::map<std::string, int> simStatAvgTotal;
 void sim_collect_statistic_avg(const char* key, int value)
 {
+	std::lock_guard<std::mutex> guard(simStatMutex);
 	if (simStatAvgCounts.find(key) != simStatAvgCounts.end())
 	{
 		simStatAvgCounts[key] = simStatAvgCounts[key] + 1;
@@ -1672,6 +1702,18 @@ uint32_t sim_get_stack_type()
 	return (uint32_t) cherrySimInstance->currentNode->bleStackType;
 }
 
+void sim_ecb_expand_key(const uint8_t* key, uint8_t* roundKeys)
+{
+	std::lock_guard<std::mutex> guard(aesMutex);
+	AES_ECB_expand_key(key, roundKeys);
+}
+
+void sim_ecb_encrypt_blocks(const uint8_t* roundKeys, const uint8_t* cleartext, uint8_t* ciphertext, uint32_t numBlocks)
+{
+	std::lock_guard<std::mutex> guard(aesMutex);
+	AES_ECB_encrypt_expanded(cleartext, roundKeys, ciphertext, numBlocks);
+}
+
 
 bool isEmpty(const u8* data, u32 length)
 {
@@ -105,12 +105,22 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+//The pointers that redirect FruityMesh to the node under simulation are thread local
+//so that several nodes can be simulated in parallel (see SimConfiguration::parallelStepThreads)
+#ifdef __cplusplus
+#define SIM_THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+#define SIM_THREAD_LOCAL __declspec(thread)
+#else
+#define SIM_THREAD_LOCAL __thread
+#endif
+
 #ifdef __cplusplus
 typedef class Node Node;
 typedef class GlobalState GlobalState;
 
 //We keep a pointer to our GlobalState, this state contains the whole state of a node as known to FruityMesh
-extern GlobalState* simGlobalStatePtr;
+extern SIM_THREAD_LOCAL GlobalState* simGlobalStatePtr;
 #define GS (simGlobalStatePtr)
 #endif //__cplusplus
 
@@ -697,11 +707,11 @@ extern int globalBreakCounter;
 //We keep a number of pointers to hardware peripherals so that our FruityMesh implementation
 //does not have to include the simulator. It will access all hardware using these pointers and we can
 //therefore redirect all access
-extern NRF_FICR_Type* simFicrPtr;
-extern NRF_UICR_Type* simUicrPtr;
-extern NRF_GPIO_Type* simGpioPtr;
-extern NRF_UART_Type* simUartPtr;
-extern uint8_t* simFlashPtr;
+extern SIM_THREAD_LOCAL NRF_FICR_Type* simFicrPtr;
+extern SIM_THREAD_LOCAL NRF_UICR_Type* simUicrPtr;
+extern SIM_THREAD_LOCAL NRF_GPIO_Type* simGpioPtr;
+extern SIM_THREAD_LOCAL NRF_UART_Type* simUartPtr;
+extern SIM_THREAD_LOCAL uint8_t* simFlashPtr;
 #define NRF_FICR (simFicrPtr)
 #define NRF_UICR (simUicrPtr)
 #define NRF_GPIO (simGpioPtr)
@@ -779,6 +789,10 @@ void sim_print_statistics();
 
 uint32_t sim_get_stack_type();
 
+//Encrypts with a key that was expanded only once, the simulated ECB would expand it for every block
+void sim_ecb_expand_key(const uint8_t* key, uint8_t* roundKeys);
+void sim_ecb_encrypt_blocks(const uint8_t* roundKeys, const uint8_t* cleartext, uint8_t* ciphertext, uint32_t numBlocks);
+
 //Configuration
 struct ModuleConfiguration;
 #ifdef __cplusplus
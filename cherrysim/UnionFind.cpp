@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "UnionFind.h"
+#include <utility>
+
+void UnionFind::Reset(u32 numElements)
+{
+	parents.resize(numElements);
+	sizes.assign(numElements, 1);
+	for (u32 i = 0; i < numElements; i++)
+	{
+		parents[i] = i;
+	}
+}
+
+u32 UnionFind::GetNumElements() const
+{
+	return (u32)parents.size();
+}
+
+u32 UnionFind::Find(u32 element)
+{
+	while (parents[element] != element)
+	{
+		parents[element] = parents[parents[element]];
+		element = parents[element];
+	}
+	return element;
+}
+
+void UnionFind::Union(u32 elementA, u32 elementB)
+{
+	u32 rootA = Find(elementA);
+	u32 rootB = Find(elementB);
+	if (rootA == rootB) return;
+
+	//The smaller set is attached to the bigger one so that the trees stay flat
+	if (sizes[rootA] < sizes[rootB]) std::swap(rootA, rootB);
+	parents[rootB] = rootA;
+	sizes[rootA] += sizes[rootB];
+}
+
+u32 UnionFind::GetSetSize(u32 element)
+{
+	return sizes[Find(element)];
+}
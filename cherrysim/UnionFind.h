@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <types.h>
+#include <vector>
+
+/*
+A disjoint set forest over the node indices with path halving and union by size.
+Elements can only be merged, so removing a link between two elements requires a Reset
+and merging all remaining links again.
+*/
+class UnionFind
+{
+private:
+	std::vector<u32> parents;
+	std::vector<u32> sizes; //Only valid for the root of each set
+
+public:
+	//Puts each of the given amount of elements into its own set
+	void Reset(u32 numElements);
+	u32 GetNumElements() const;
+
+	//Returns the root element that represents the set of the given element
+	u32 Find(u32 element);
+
+	//Merges the sets of both elements
+	void Union(u32 elementA, u32 elementB);
+
+	//Returns the number of elements in the set of the given element
+	u32 GetSetSize(u32 element);
+};
@@ -81,6 +81,9 @@ static state_t* state;
 // The array that stores the round keys.
 static uint8_t RoundKey[keyExpSize];
 
+// The round keys used by the cipher, only differs from RoundKey while encrypting with an expanded key
+static const uint8_t* ActiveRoundKey = RoundKey;
+
 // The Key input to the AES Program
 static const uint8_t* Key;
 
@@ -259,7 +262,7 @@ static void AddRoundKey(uint8_t round)
   {
     for (j = 0; j < 4; ++j)
     {
-      (*state)[i][j] ^= RoundKey[round * Nb * 4 + i * Nb + j];
+      (*state)[i][j] ^= ActiveRoundKey[round * Nb * 4 + i * Nb + j];
     }
   }
 }
@@ -499,6 +502,27 @@ void AES_ECB_decrypt(const uint8_t* input, const uint8_t* key, uint8_t *output,
   InvCipher();
 }
 
+void AES_ECB_expand_key(const uint8_t* key, uint8_t* roundKey)
+{
+  Key = key;
+  KeyExpansion();
+  memcpy(roundKey, RoundKey, keyExpSize);
+}
+
+void AES_ECB_encrypt_expanded(const uint8_t* input, const uint8_t* roundKey, uint8_t* output, const uint32_t numBlocks)
+{
+  uint32_t i;
+
+  memcpy(output, input, numBlocks * BLOCKLEN);
+  ActiveRoundKey = roundKey;
+  for (i = 0; i < numBlocks; i++)
+  {
+    state = (state_t*)(output + i * BLOCKLEN);
+    Cipher();
+  }
+  ActiveRoundKey = RoundKey;
+}
+
 
 #endif // #if defined(ECB) && (ECB == 1)
 
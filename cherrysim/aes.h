@@ -27,6 +27,12 @@
 void AES_ECB_encrypt(const uint8_t* input, const uint8_t* key, uint8_t *output, const uint32_t length);
 void AES_ECB_decrypt(const uint8_t* input, const uint8_t* key, uint8_t *output, const uint32_t length);
 
+// Expands the 16 byte key into AES_EXPANDED_KEY_SIZE bytes of round keys that can be used for
+// encrypting any number of blocks without expanding the key again
+#define AES_EXPANDED_KEY_SIZE 176
+void AES_ECB_expand_key(const uint8_t* key, uint8_t* roundKey);
+void AES_ECB_encrypt_expanded(const uint8_t* input, const uint8_t* roundKey, uint8_t* output, const uint32_t numBlocks);
+
 #endif // #if defined(ECB) && (ECB == !)
 
 
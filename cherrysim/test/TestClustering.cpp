@@ -32,6 +32,10 @@
 #include <CherrySimUtils.h>
 #include <ConnectionManager.h>
 #include <cmath>
+#include <chrono>
+#include <map>
+#include <string>
+#include <atomic>
 
 
 //This test fixture is used to run a parametrized test based on the chosen BLE Stack
@@ -48,11 +52,11 @@ FeaturesetAndBleStack prod_mesh_nrf52 = { BleStackType::NRF_SD_132_ANY, "prod_me
 
 void DoClusteringTestImportedFromJson(const std::string &site, const std::string &device, u32 clusteringIterations, int maxClusteringTimeSec, FeaturesetAndBleStack config)
 {
-	int clusteringTimeTotalMs = 0;
+	std::atomic<int> clusteringTimeTotalMs{ 0 };
 
 	printf("Test with %s and stack %u" EOL, config.featuresetName.c_str(), (u32)config.bleStack);
 
-	for (u32 i = 0; i < clusteringIterations; i++) {
+	CherrySimTester::RunScenariosInParallel(clusteringIterations, [&](u32 i) {
 		printf("ClusterTest Iteration %u" EOL, i);
 		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
 		SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
@@ -68,7 +72,7 @@ void DoClusteringTestImportedFromJson(const std::string &site, const std::string
 		tester.Start();
 		tester.SimulateUntilClusteringDone(maxClusteringTimeSec* 1000);
 		clusteringTimeTotalMs += tester.sim->simState.simTimeMs;
-	}
+	});
 
 	printf("Average clustering time %u seconds" EOL, clusteringTimeTotalMs / clusteringIterations / 1000);
 }
@@ -76,12 +80,13 @@ void DoClusteringTestImportedFromJson(const std::string &site, const std::string
 TEST_P(MultiStackFixture, TestBasicClustering) {
 	const int maxClusteringTimeMs = 40 * 1000;
 	const int clusteringIterations = 5;
-	int clusteringTimeTotalMs = 0;
+	std::atomic<int> clusteringTimeTotalMs{ 0 };
 
 	FeaturesetAndBleStack config = GetParam();
 	printf("Test with %s and stack %u" EOL, config.featuresetName.c_str(), (u32)config.bleStack);
 
-	for (u32 i = 0; i < clusteringIterations; i++) {
+	//The iterations are independent, so they are simulated in parallel
+	CherrySimTester::RunScenariosInParallel(clusteringIterations, [&](u32 i) {
 		printf("ClusterTest Iteration %u" EOL, i);
 		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
 		SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
@@ -97,7 +102,7 @@ TEST_P(MultiStackFixture, TestBasicClustering) {
 		clusteringTimeTotalMs += tester.sim->simState.simTimeMs;
 
 		printf("Time %u", tester.sim->simState.simTimeMs);
-	}
+	});
 
 	printf("Average clustering time %d seconds" EOL, clusteringTimeTotalMs / clusteringIterations / 1000);
 }
@@ -160,11 +165,11 @@ TEST_P(MultiStackFixture, TestSinglePointFailureNetwork) {
 #endif //GITHUB_RELEASE
 
 TEST(TestClustering, TestClusteringWithManySdBusy) {
-	int clusteringTimeTotalMs = 0;
+	std::atomic<int> clusteringTimeTotalMs{ 0 };
 	const int maxClusteringTimeMs = 200 * 1000;
 	const int clusteringIterations = 5;
 
-	for (u32 i = 0; i < clusteringIterations; i++) {
+	CherrySimTester::RunScenariosInParallel(clusteringIterations, [&](u32 i) {
 		printf("ClusterTest Iteration %u" EOL, i);
 		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
 		SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
@@ -177,7 +182,7 @@ TEST(TestClustering, TestClusteringWithManySdBusy) {
 		tester.Start();
 		tester.SimulateUntilClusteringDone(maxClusteringTimeMs);
 		clusteringTimeTotalMs += tester.sim->simState.simTimeMs;
-	}
+	});
 
 	printf("Average clustering time %d seconds" EOL, clusteringTimeTotalMs / clusteringIterations / 1000);
 }
@@ -190,7 +195,7 @@ TEST_P(MultiStackFixture, TestBasicClusteringWithNodeReset) {
 	FeaturesetAndBleStack config = GetParam();
 	printf("Test with %s and stack %u" EOL, config.featuresetName.c_str(), (u32)config.bleStack);
 
-	for (u32 i = 0; i < clusteringIterations; i++) {
+	CherrySimTester::RunScenariosInParallel(clusteringIterations, [&](u32 i) {
 		printf("ClusterTest Iteration %u" EOL, i);
 		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
 		SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
@@ -223,7 +228,7 @@ TEST_P(MultiStackFixture, TestBasicClusteringWithNodeReset) {
 			tester.SimulateForGivenTime(1 * 1000);
 			tester.SimulateUntilClusteringDone(maxClusteringTimeMs);
 		}
-	}
+	});
 }
 
 //Tests different clustering scenarios
@@ -234,10 +239,10 @@ TEST(TestClustering, TestBasicClusteringWithNodeReset_scheduled) {
 
 	//Exceptions::DisableDebugBreakOnException disabler;
 
-	u32 seed = (u32)time(NULL);
+	const u32 startSeed = (u32)time(NULL);
 	
-	for (u32 i = 0; i < clusteringIterations; i++) {
-		seed++;
+	CherrySimTester::RunScenariosInParallel(clusteringIterations, [&](u32 i) {
+		u32 seed = startSeed + i + 1;
 		u32 numNodes = seed % 200 + 2;
 
 		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
@@ -295,7 +300,7 @@ TEST(TestClustering, TestBasicClusteringWithNodeReset_scheduled) {
 			printf("Clustering after reset after %u seconds" EOL, (tester.sim->simState.simTimeMs - lastClusterDoneTime) / 1000);
 			lastClusterDoneTime = tester.sim->simState.simTimeMs;
 		}
-	}
+	});
 }
 
 //FIXME: This will corrently result in an error
@@ -309,10 +314,10 @@ TEST(TestClustering, TestBasicClusteringWithNodeResetAndConnectionTimeouts_sched
 
 	//Exceptions::DisableDebugBreakOnException disabler;
 
-	u32 seed = (u32)time(NULL);
+	const u32 startSeed = (u32)time(NULL);
 
-	for (u32 i = 0; i < clusteringIterations; i++) {
-		seed++;
+	CherrySimTester::RunScenariosInParallel(clusteringIterations, [&](u32 i) {
+		u32 seed = startSeed + i + 1;
 		u32 numNodes = seed % 50 + 4;
 
 		printf("ClusterTest Iteration %u" EOL, i);
@@ -375,7 +380,7 @@ TEST(TestClustering, TestBasicClusteringWithNodeResetAndConnectionTimeouts_sched
 			printf("Clustering after reset after %u seconds" EOL, (tester.sim->simState.simTimeMs - lastClusterDoneTime) / 1000);
 			lastClusterDoneTime = tester.sim->simState.simTimeMs;
 		}
-	}
+	});
 }
 
 //Test if meshing works if we put load on the network
@@ -534,6 +539,252 @@ TEST_P(MultiStackFixture, TestSinkDetectionWithSingleSink)
 	}
 }
 
+//Makes sure that nodes still find each other if broadcasts only reach the nodes of the spatial grid
+TEST(TestClustering, TestClusteringWithSpatialBroadcastGrid) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.mapWidthInMeters = 200;
+	simConfig.mapHeightInMeters = 200;
+	simConfig.useSpatialBroadcastGrid = true;
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 50 });
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+
+	tester.SimulateUntilClusteringDone(200 * 1000);
+
+	printf("Clustering with spatial broadcast grid took %u seconds" EOL, tester.sim->simState.simTimeMs / 1000);
+}
+
+//Appends the events that are queued for every node to the trace
+static void AppendParallelStepEventTrace(CherrySimTester& tester, std::string& trace)
+{
+	for (u32 i = 0; i < tester.sim->getTotalNodes(); i++) {
+		const nodeEntry* node = &(tester.sim->nodes[i]);
+		trace += std::to_string(tester.sim->simState.simTimeMs) + " " + std::to_string(node->id) + " queued";
+		for (const simBleEvent& event : node->eventQueue) {
+			trace += " " + std::to_string(event.globalId) + ":" + std::to_string(event.bleEvent.header.evt_id) + ":" + std::to_string(event.additionalInfo);
+		}
+		trace += "\n";
+	}
+}
+
+//Describes the simulator and firmware state of every node, including a checksum of its flash
+static std::string GetParallelStepNodeState(CherrySimTester& tester)
+{
+	std::string state = "time " + std::to_string(tester.sim->simState.simTimeMs)
+		+ " eventIds " + std::to_string(tester.sim->simState.globalEventIdCounter)
+		+ " packetIds " + std::to_string(tester.sim->simState.globalPacketIdCounter) + "\n";
+	for (u32 i = 0; i < tester.sim->getTotalNodes(); i++) {
+		tester.sim->setNode(i);
+		const nodeEntry* node = &(tester.sim->nodes[i]);
+		state += "node " + std::to_string(node->id)
+			+ " frames " + std::to_string(node->simulatedFrames)
+			+ " restarts " + std::to_string(node->restartCounter)
+			+ " cluster " + std::to_string(node->gs.node.clusterId) + "/" + std::to_string(node->gs.node.clusterSize)
+			+ " adv " + std::to_string(node->state.advertisingActive) + " scan " + std::to_string(node->state.scanningActive)
+			+ " connecting " + std::to_string(node->state.connectingActive) + "\n";
+
+		for (int j = 0; j < SIM_MAX_CONNECTION_NUM; j++) {
+			const SoftdeviceConnection& connection = node->state.connections[j];
+			if (!connection.connectionActive) continue;
+			state += " sd " + std::to_string(connection.connectionHandle) + " partner " + std::to_string(connection.partner->id)
+				+ " encrypted " + std::to_string(connection.connectionEncrypted) + " packets";
+			for (int k = 0; k < SIM_NUM_RELIABLE_BUFFERS; k++) {
+				if (connection.reliableBuffers[k].sender != nullptr) state += " " + std::to_string(connection.reliableBuffers[k].globalPacketId);
+			}
+			for (int k = 0; k < SIM_NUM_UNRELIABLE_BUFFERS; k++) {
+				if (connection.unreliableBuffers[k].sender != nullptr) state += " " + std::to_string(connection.unreliableBuffers[k].globalPacketId);
+			}
+			state += "\n";
+		}
+
+		MeshConnections conns = node->gs.cm.GetMeshConnections(ConnectionDirection::INVALID);
+		for (int j = 0; j < conns.count; j++) {
+			MeshConnection* conn = conns.handles[j].GetConnection();
+			state += " mesh " + std::to_string(conn->connectionHandle) + " partner " + std::to_string(conn->partnerId)
+				+ " state " + std::to_string((u32)conn->connectionState) + "\n";
+		}
+
+		u32 flashChecksum = 2166136261u;
+		for (u32 j = 0; j < SimFlash::SIZE; j++) {
+			flashChecksum = (flashChecksum ^ node->flash.data()[j]) * 16777619u;
+		}
+		state += " flash " + std::to_string(flashChecksum) + "\n";
+	}
+	return state;
+}
+
+//Steps the nodes in parallel and makes sure that neither the state of the nodes nor the events that they
+//exchanged depend on the number of threads. A single thread uses the same two phases and outboxes.
+TEST(TestClustering, TestClusteringWithParallelSteps) {
+	const u32 threadCounts[3] = { 1, 2, 4 };
+	std::string eventTraces[3];
+	std::string nodeStates[3];
+	for (int i = 0; i < 3; i++) {
+		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+		SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+		simConfig.parallelStepThreads = threadCounts[i];
+		simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 30 });
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+
+		while (!tester.sim->IsClusteringDone()) {
+			tester.SimulateGivenNumberOfSteps(1);
+			AppendParallelStepEventTrace(tester, eventTraces[i]);
+			if (tester.sim->simState.simTimeMs > 200 * 1000) FAIL() << "Clustering with " << threadCounts[i] << " threads timed out";
+		}
+
+		//Keep stepping for a while, as the clustered mesh still exchanges packets
+		for (u32 step = 0; step < 100; step++) {
+			tester.SimulateGivenNumberOfSteps(1);
+			AppendParallelStepEventTrace(tester, eventTraces[i]);
+		}
+
+		nodeStates[i] = GetParallelStepNodeState(tester);
+	}
+
+	for (int i = 1; i < 3; i++) {
+		ASSERT_EQ(eventTraces[0], eventTraces[i]) << threadCounts[i] << " threads exchanged different events than 1 thread";
+		ASSERT_EQ(nodeStates[0], nodeStates[i]) << threadCounts[i] << " threads resulted in a different state than 1 thread";
+	}
+}
+
+//Makes sure that the incremental clustering check does not find a mismatch while nodes cluster and recluster after a reset
+TEST(TestClustering, TestIncrementalClusteringValidityCheck) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.enableClusteringValidityCheck = true;
+	//The full recomputation can report false positives, see CherrySim::CheckMeshingConsistency
+	simConfig.clusteringCrossCheckIntervalMs = 0;
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 20 });
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+
+	tester.SimulateUntilClusteringDone(100 * 1000);
+
+	tester.SendTerminalCommand(5, "reset");
+	tester.SimulateForGivenTime(1 * 1000);
+	tester.SimulateUntilClusteringDone(100 * 1000);
+	tester.SimulateForGivenTime(10 * 1000);
+
+	ASSERT_EQ(tester.sim->clusteringMismatchCount, 0u);
+
+	//Once the mesh is clustered, every node must have been checked
+	for (u32 i = 0; i < tester.sim->getTotalNodes(); i++) {
+		ASSERT_FALSE(tester.sim->nodes[i].clusterCheckPending);
+	}
+}
+
+//Runs the incremental clustering check together with the periodic cross check, which also makes the
+//incremental check verify all clusters again. A wrong cluster size must then be found in a settled mesh.
+TEST(TestClustering, TestIncrementalClusteringValidityCheckWithCrossCheck) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.enableClusteringValidityCheck = true;
+	simConfig.clusteringCrossCheckIntervalMs = 1 * 1000;
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 10 });
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+
+	tester.SimulateUntilClusteringDone(100 * 1000);
+	tester.SimulateForGivenTime(5 * 1000);
+	ASSERT_EQ(tester.sim->clusteringMismatchCount, 0u);
+	const std::vector<u8> snapshot = tester.sim->CreateSnapshot();
+
+	//Nothing changes in the mesh after the corruption, so only the cross check can trigger the incremental check
+	tester.sim->nodes[3].gs.node.clusterSize++;
+	tester.SimulateForGivenTime(3 * 1000);
+	ASSERT_GT(tester.sim->clusteringMismatchCount, 0u);
+
+	//The mismatches belong to the corrupted mesh and must not survive restoring the intact one
+	ASSERT_TRUE(tester.sim->RestoreSnapshot(snapshot));
+	ASSERT_EQ(tester.sim->clusteringMismatchCount, 0u);
+	tester.SimulateForGivenTime(3 * 1000);
+	ASSERT_EQ(tester.sim->clusteringMismatchCount, 0u);
+}
+
+//Skips idle ticks and makes sure that the firmware still sees its app timer trigger at the same times
+TEST(TestClustering, TestClusteringWithSkippedIdleTicks) {
+	std::map<u32, u32> appTimerDsAtNodeTime;
+	u32 numSteps[2] = {};
+	for (int i = 0; i < 2; i++) {
+		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+		SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+		simConfig.skipIdleTicks = i == 1;
+		simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 30 });
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+
+		tester.SimulateUntilClusteringDone(200 * 1000);
+
+		const u32 endTimeMs = tester.sim->simState.simTimeMs + 60 * 1000;
+		while (tester.sim->simState.simTimeMs < endTimeMs) {
+			tester.sim->SimulateStepForAllNodes();
+			numSteps[i]++;
+
+			const nodeEntry& node = tester.sim->nodes[0];
+			if (i == 0) {
+				appTimerDsAtNodeTime[node.state.timeMs] = node.gs.appTimerDs;
+			}
+			else if (appTimerDsAtNodeTime.find(node.state.timeMs) != appTimerDsAtNodeTime.end()) {
+				ASSERT_EQ(node.gs.appTimerDs, appTimerDsAtNodeTime[node.state.timeMs]);
+			}
+		}
+	}
+
+	printf("Simulating one minute of a clustered mesh took %u steps, %u with skipped idle ticks" EOL, numSteps[0], numSteps[1]);
+	ASSERT_LT(numSteps[1], numSteps[0]);
+}
+
+//Compares how fast a clustered mesh is simulated with and without skipping idle ticks
+TEST(TestClustering, BenchmarkSkippedIdleTicks_long) {
+	double simulatedSecondsPerSecond[2] = {};
+	for (int i = 0; i < 2; i++) {
+		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+		SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+		simConfig.skipIdleTicks = i == 1;
+		simConfig.terminalId = -1;
+		simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 50 });
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+
+		tester.SimulateUntilClusteringDone(100 * 1000);
+
+		const u32 startTimeMs = tester.sim->simState.simTimeMs;
+		const auto startTime = std::chrono::steady_clock::now();
+		tester.SimulateForGivenTime(10 * 60 * 1000);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		simulatedSecondsPerSecond[i] = (tester.sim->simState.simTimeMs - startTimeMs) / 1000.0 / seconds;
+	}
+
+	printf("Simulated seconds per second: %.1f with fixed steps, %.1f with skipped idle ticks" EOL, simulatedSecondsPerSecond[0], simulatedSecondsPerSecond[1]);
+}
+
+//Measures clustering in dense rooms where every node receives the join me packets of far more nodes than fit into its join me buffer
+TEST(TestClustering, BenchmarkDenseRoomClustering_long) {
+	const u32 nodeCounts[2] = { 200, 300 };
+	for (u32 numNodes : nodeCounts) {
+		for (u32 seed = 1; seed <= 3; seed++) {
+			CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+			SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+			simConfig.seed = seed;
+			simConfig.terminalId = -1;
+			simConfig.mapWidthInMeters = 20;
+			simConfig.mapHeightInMeters = 20;
+			simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", numNodes });
+			CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+			tester.Start();
+
+			const auto startTime = std::chrono::steady_clock::now();
+			tester.SimulateUntilClusteringDone(1000 * 1000);
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+			printf("Clustering %u nodes in a dense room (seed %u) took %u simulated seconds and %.1f seconds" EOL, numNodes, seed, tester.sim->simState.simTimeMs / 1000, seconds);
+		}
+	}
+}
+
 extern std::map<std::string, int> simStatCounts;
 TEST(TestClustering, TestHighPrioQueueFull) {
 	for (int seed = 0; seed < 3; seed++) {
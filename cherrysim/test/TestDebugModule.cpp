@@ -43,7 +43,7 @@ TEST(TestDebugModule, TestCommands) {
 	simConfig.nodeConfigName.insert( { "prod_mesh_nrf52", 2 } );
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
-	tester.SimulateUntilClusteringDone(10 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(10 * 1000);
 
 	tester.sim->findNodeById(1)->gs.logger.enableTag("DEBUGMOD");
 	tester.sim->findNodeById(1)->gs.logger.enableTag("WATCHDOG");
@@ -69,7 +69,7 @@ TEST(TestDebugModule, TestCommands) {
 	tester.SimulateUntilMessageReceived(10 * 1000, 2, "Resetting connection loss counter");
 
 	tester.SendTerminalCommand(1, "action 2 debug get_stats");
-	tester.SimulateUntilRegexMessageReceived(10 * 1000, 1, "\\{\"nodeId\":2,\"type\":\"debug_stats\", \"conLoss\":0,\"dropped\":\\d+,\"sentRel\":\\d+,\"sentUnr\":\\d+\\}");
+	tester.SimulateUntilRegexMessageReceived(10 * 1000, 1, "\\{\"nodeId\":2,\"type\":\"debug_stats\", \"conLoss\":0,\"dropped\":\\d+,\"sentRel\":\\d+,\"sentUnr\":\\d+,\"dupHits\":\\d+,\"dupMisses\":\\d+\\}");
 
 	{
 		Exceptions::DisableDebugBreakOnException disable;
@@ -157,7 +157,7 @@ TEST(TestDebugModule, TestClearQueue) {
 	simConfig.nodeConfigName.insert( { "prod_mesh_nrf52", 2 } );
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
-	tester.SimulateUntilClusteringDone(10 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(10 * 1000);
 
 	//We only test if the command does not crash
 	tester.SendTerminalCommand(1, "clearqueue 1");
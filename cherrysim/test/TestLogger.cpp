@@ -53,6 +53,25 @@ TEST(TestLogger, TestTags) {
 	ASSERT_TRUE (Logger::getInstance().IsTagEnabled(tag));
 	Logger::getInstance().toggleTag(tag);
 	ASSERT_FALSE(Logger::getInstance().IsTagEnabled(tag));
+
+	//The mask of a tag is computed at compile time and does not depend on the case
+	static_assert(Logger::GetTagMask("TEST123") != 0, "Tag mask must be computed at compile time");
+	ASSERT_EQ(Logger::GetTagMask("test123"), Logger::GetTagMask(tag));
+
+	ASSERT_FALSE(LOGT_ACTIVE(tag));
+	ASSERT_TRUE (LOGT_ACTIVE("ERROR"));
+	Logger::getInstance().enableTag("test123");
+	ASSERT_TRUE (LOGT_ACTIVE(tag));
+	Logger::getInstance().disableAll();
+	ASSERT_FALSE(LOGT_ACTIVE(tag));
+	Logger::getInstance().enableAll();
+	ASSERT_TRUE (LOGT_ACTIVE(tag));
+	Logger::getInstance().disableAll();
+
+	//Arguments of disabled tags must not be evaluated
+	u32 evaluations = 0;
+	logt("TEST123", "%u", ++evaluations);
+	ASSERT_EQ(evaluations, 0);
 }
 
 TEST(TestLogger, TestParseHexStringToBuffer) 
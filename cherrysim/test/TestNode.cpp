@@ -46,7 +46,7 @@ TEST(TestNode, TestCommands) {
 	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1});
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
-	tester.SimulateUntilClusteringDone(100 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
 
 	tester.sim->findNodeById(1)->gs.logger.enableTag("CM");
 	tester.sim->findNodeById(2)->gs.logger.enableTag("CM");
@@ -213,7 +213,7 @@ TEST(TestNode, TestCRCValidation)
 	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1});
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
-	tester.SimulateUntilClusteringDone(100 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
 
 	//Make sure that the commands are working without CRC...
 	tester.sim->setNode(0);
@@ -402,7 +402,7 @@ TEST(TestNode, TestMeshConnectionPacketQueuing) {
 	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1});
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
-	tester.SimulateUntilClusteringDone(10 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(10 * 1000);
 
 	u8 buffer[100];
 
@@ -526,7 +526,7 @@ TEST(TestNode, TestCapabilitySending) {
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 
 	tester.Start();
-	tester.SimulateUntilClusteringDone(10 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(10 * 1000);
 	tester.sim->enableTagForAll("VSMOD");
 
 	tester.SendTerminalCommand(1, "request_capability 2");
@@ -546,7 +546,7 @@ TEST(TestNode, TestRapidDisconnections) {
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
 
-	tester.SimulateUntilClusteringDone(10 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(10 * 1000);
 
 	//Simulate for some time so that the mesh connection is deemed stable
 	tester.SimulateForGivenTime(11 * 1000);
@@ -29,6 +29,9 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "gtest/gtest.h"
 #include <fstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
 #include <CherrySimTester.h>
 #include <Logger.h>
 #include <Utility.h>
@@ -37,12 +40,22 @@
 #include "StatusReporterModule.h"
 #include "CherrySimUtils.h"
 #include "RingIndexGenerator.h"
+#include "RecentPacketCache.h"
+#include "TimerWheel.h"
+#include "FruityMesh.h"
+#include "AssetTrackingTable.h"
+#include "JoinMeBuffer.h"
+#include "ReplayTrace.h"
+#include "FruitySimServer.h"
 #include "json.hpp"
 
 
 extern "C"{
 #include <ccm_soft.h>
 }
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 
 TEST(TestOther, BatteryTest)
@@ -222,7 +235,7 @@ TEST(TestOther, ConfigurationTest)
 	tester.Start();
 
 
-	tester.SimulateUntilClusteringDone(100 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
 }
 
 TEST(TestOther, TestJsonConfigSerialization)
@@ -272,6 +285,8 @@ TEST(TestOther, TestJsonConfigSerialization)
 	new (&simConfig->replayPath) std::string;
 	simConfig->replayPath = "path";
 	simConfig->logReplayCommands = true;
+	new (&simConfig->replayTracePath) std::string;
+	simConfig->replayTracePath = "trace";
 	simConfig->useLogAccumulator = true;
 	simConfig->defaultNetworkId = 19;
 	new (&simConfig->preDefinedPositions)std::vector<std::pair<double, double>>;
@@ -281,10 +296,14 @@ TEST(TestOther, TestJsonConfigSerialization)
 	simConfig->simulateJittering = true;
 	simConfig->verbose = true;
 	simConfig->enableClusteringValidityCheck = true;
+	simConfig->clusteringCrossCheckIntervalMs = 21;
 	simConfig->enableSimStatistics = true;
 	new (&simConfig->storeFlashToFile) std::string;
 	simConfig->storeFlashToFile = "eee";
 	simConfig->verboseCommands = true;
+	simConfig->useSpatialBroadcastGrid = true;
+	simConfig->parallelStepThreads = 20;
+	simConfig->skipIdleTicks = true;
 	simConfig->defaultBleStackType = BleStackType::NRF_SD_132_ANY;
 
 	for (size_t i = 0; i < sizeof(memoryArea) / sizeof(*memoryArea); i++)
@@ -297,6 +316,7 @@ TEST(TestOther, TestJsonConfigSerialization)
 		if(IsInSTLRange(siteJsonPath)
 		    || IsInSTLRange(devicesJsonPath)
 		    || IsInSTLRange(replayPath)
+		    || IsInSTLRange(replayTracePath)
 		    || IsInSTLRange(preDefinedPositions)
 		    || IsInSTLRange(nodeConfigName)
 		    || IsInSTLRange(storeFlashToFile)) continue;
@@ -329,6 +349,7 @@ TEST(TestOther, TestJsonConfigSerialization)
 	ASSERT_EQ(copy.devicesJsonPath, "bbb");
 	ASSERT_EQ(copy.replayPath, "path");
 	ASSERT_EQ(copy.logReplayCommands, true);
+	ASSERT_EQ(copy.replayTracePath, "trace");
 	ASSERT_EQ(copy.useLogAccumulator, true);
 	ASSERT_EQ(copy.defaultNetworkId, 19);
 	ASSERT_EQ(copy.preDefinedPositions.size(), 2);
@@ -341,9 +362,13 @@ TEST(TestOther, TestJsonConfigSerialization)
 	ASSERT_EQ(copy.simulateJittering, true);
 	ASSERT_EQ(copy.verbose, true);
 	ASSERT_EQ(copy.enableClusteringValidityCheck, true);
+	ASSERT_EQ(copy.clusteringCrossCheckIntervalMs, 21);
 	ASSERT_EQ(copy.enableSimStatistics, true);
 	ASSERT_EQ(copy.storeFlashToFile, "eee");
 	ASSERT_EQ(copy.verboseCommands, true);
+	ASSERT_EQ(copy.useSpatialBroadcastGrid, true);
+	ASSERT_EQ(copy.parallelStepThreads, 20);
+	ASSERT_EQ(copy.skipIdleTicks, true);
 	ASSERT_EQ(copy.defaultBleStackType, BleStackType::NRF_SD_132_ANY);
 
 	simConfig->storeFlashToFile.~basic_string();
@@ -351,6 +376,7 @@ TEST(TestOther, TestJsonConfigSerialization)
 	simConfig->preDefinedPositions.~vector();
 	simConfig->devicesJsonPath.~basic_string();
 	simConfig->replayPath.~basic_string();
+	simConfig->replayTracePath.~basic_string();
 	simConfig->siteJsonPath.~basic_string();
 }
 
@@ -613,7 +639,7 @@ TEST(TestOther, TestGattcEvtTimeoutReporting) {
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
 
-	tester.SimulateUntilClusteringDone(10 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(10 * 1000);
 
 	//Find the mesh connection to the other node
 	tester.sim->setNode(0);
@@ -1106,6 +1132,164 @@ TEST(TestOther, TestBoards) {
 }
 #endif //GITHUB_RELEASE
 
+TEST(TestOther, TestRecentPacketCache) {
+	RecentPacketCache cache;
+
+	//The first packet is new, a repetition over the same connection is a new packet as well
+	ASSERT_FALSE(cache.IsDuplicate(2, MessageType::DATA_1, 1234, 10, 100));
+	ASSERT_FALSE(cache.IsDuplicate(2, MessageType::DATA_1, 1234, 10, 101));
+
+	//The same packet over another connection is a duplicate until the entry times out
+	ASSERT_TRUE(cache.IsDuplicate(2, MessageType::DATA_1, 1234, 11, 102));
+	ASSERT_FALSE(cache.IsDuplicate(2, MessageType::DATA_1, 1234, 11, 102 + RecentPacketCache::ENTRY_TIMEOUT_DS));
+
+	//Other senders, types or payloads are not affected
+	ASSERT_FALSE(cache.IsDuplicate(3, MessageType::DATA_1, 1234, 10, 103));
+	ASSERT_FALSE(cache.IsDuplicate(2, MessageType::MODULE_TRIGGER_ACTION, 1234, 10, 103));
+	ASSERT_FALSE(cache.IsDuplicate(2, MessageType::DATA_1, 4321, 10, 103));
+
+	//Old entries are replaced once the cache is full
+	for (u32 i = 0; i < RecentPacketCache::NUM_ENTRIES; i++) {
+		ASSERT_FALSE(cache.IsDuplicate(4, MessageType::DATA_1, i, 10, 104));
+	}
+	ASSERT_FALSE(cache.IsDuplicate(3, MessageType::DATA_1, 1234, 11, 105));
+
+	//After nodes left the cluster, the sender may reach us over another connection
+	ASSERT_FALSE(cache.IsDuplicate(5, MessageType::DATA_1, 1234, 10, 106));
+	cache.Clear();
+	ASSERT_FALSE(cache.IsDuplicate(5, MessageType::DATA_1, 1234, 11, 107));
+
+	ASSERT_EQ(cache.hits, 1);
+	ASSERT_EQ(cache.misses, 6 + RecentPacketCache::NUM_ENTRIES + 3);
+}
+
+class TestTimerWheelListener : public TimerWheelEventListener
+{
+public:
+	TimerWheel* wheel = nullptr;
+	u32 nowDs = 0;
+	u32 numTimer3Calls = 0;
+	std::vector<std::pair<u8, u32>> calls;
+
+	void TimerWheelEventHandler(u8 timerId) override
+	{
+		calls.push_back({ timerId, nowDs });
+		//Timer 3 stops itself after its second call
+		if (timerId == 3 && ++numTimer3Calls == 2) wheel->Stop(this, 3);
+	}
+};
+
+TEST(TestOther, TestTimerWheel) {
+	TimerWheel wheel;
+	TestTimerWheelListener listener;
+	listener.wheel = &wheel;
+
+	//Aligned timers must trigger at the same times as SHOULD_IV_TRIGGER, also for intervals that need the overflow list
+	const u32 intervals[] = { 7, 50, 3000 };
+	const u32 offset = 23;
+	for (u8 i = 0; i < 3; i++) ASSERT_TRUE(wheel.StartAligned(&listener, i, intervals[i], offset));
+	ASSERT_EQ(wheel.GetNumActiveTimers(), 3u);
+
+	std::vector<std::pair<u8, u32>> expectedCalls;
+	u32 passedTimeDs = 1;
+	while (listener.nowDs < 10000) {
+		passedTimeDs = passedTimeDs % 5 + 1;
+		listener.nowDs += passedTimeDs;
+		for (u8 i = 0; i < 3; i++) {
+			if (SHOULD_IV_TRIGGER(listener.nowDs + offset, passedTimeDs, intervals[i])) expectedCalls.push_back({ i, listener.nowDs });
+		}
+		const size_t numCallsBefore = listener.calls.size();
+		wheel.Advance(listener.nowDs);
+		//Timers that are due within the same advance are called in order of their deadlines, so only compare the set of calls
+		std::sort(listener.calls.begin() + numCallsBefore, listener.calls.end());
+	}
+	ASSERT_EQ(listener.calls, expectedCalls);
+
+	for (u8 i = 0; i < 3; i++) wheel.Stop(&listener, i);
+	ASSERT_EQ(wheel.GetNumActiveTimers(), 0u);
+
+	//One-shot timers are freed after they were called, periodic timers can stop themselves
+	listener.calls.clear();
+	ASSERT_TRUE(wheel.Start(&listener, 4, 100, 0));
+	ASSERT_TRUE(wheel.Start(&listener, 3, 10, 10));
+	ASSERT_TRUE(wheel.IsRunning(&listener, 4));
+	listener.nowDs += 150;
+	wheel.Advance(listener.nowDs);
+	ASSERT_FALSE(wheel.IsRunning(&listener, 4));
+	ASSERT_EQ(wheel.GetNumActiveTimers(), 0u);
+	ASSERT_EQ(std::count_if(listener.calls.begin(), listener.calls.end(), [](const std::pair<u8, u32>& call) { return call.first == 4; }), 1);
+	ASSERT_EQ(std::count_if(listener.calls.begin(), listener.calls.end(), [](const std::pair<u8, u32>& call) { return call.first == 3; }), 2);
+
+	//Restarting a timer does not use another timer, all timers can be used
+	for (u32 i = 0; i < TimerWheel::NUM_TIMERS; i++) {
+		ASSERT_TRUE(wheel.Start(&listener, (u8)i, 10, 0));
+		ASSERT_TRUE(wheel.Start(&listener, (u8)i, 20, 0));
+	}
+	ASSERT_EQ(wheel.GetNumActiveTimers(), TimerWheel::NUM_TIMERS);
+}
+
+//Records the order in which the legacy TimerEventHandler and the timers of the wheel are called
+class TimerOrderTestModule : public Module
+{
+private:
+	ModuleConfiguration configuration;
+
+public:
+	std::vector<std::string> calls;
+
+	TimerOrderTestModule()
+		: Module(ModuleId::TEMPLATE_MODULE, "timerorder")
+	{
+		configurationPointer = &configuration;
+		configurationLength = sizeof(ModuleConfiguration);
+		ResetToDefaultConfiguration();
+	}
+
+	void ResetToDefaultConfiguration() override
+	{
+		configuration.moduleId = moduleId;
+		configuration.moduleActive = true;
+		configuration.moduleVersion = 1;
+	}
+
+	void TimerEventHandler(u16 passedTimeDs) override
+	{
+		calls.push_back("legacy");
+	}
+
+	void TimerWheelEventHandler(u8 timerId) override
+	{
+		calls.push_back("wheel");
+	}
+};
+
+TEST(TestOther, TestTimerWheelOrderWithLegacyTimers) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1 });
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+	tester.SimulateGivenNumberOfSteps(10);
+
+	NodeIndexSetter setter(0);
+	ASSERT_TRUE(GS->amountOfModules < MAX_MODULE_COUNT);
+	TimerOrderTestModule module;
+	GS->activeModules[GS->amountOfModules] = &module;
+	GS->amountOfModules++;
+
+	//Modules that still poll on every tick are called before the timers of the wheel that are due in the same tick
+	ASSERT_TRUE(GS->timerWheel.Start(&module, 0, 1, 0));
+	DispatchTimerEvents(1);
+
+	//The module is removed before checking so that the node does not keep a pointer to it if the check fails
+	GS->timerWheel.Stop(&module, 0);
+	GS->amountOfModules--;
+	GS->activeModules[GS->amountOfModules] = nullptr;
+
+	const std::vector<std::string> expectedCalls = { "legacy", "wheel" };
+	ASSERT_EQ(module.calls, expectedCalls);
+}
+
 TEST(TestOther, TestRingIndexGenerator) {
 	Exceptions::DisableDebugBreakOnException ddboe;
 
@@ -1264,3 +1448,673 @@ TEST(TestOther, TestSimulatorFlashToFileStorage) {
 
 }
 #endif //GITHUB_RELEASE
+
+//Reports how many simulation steps per second can be simulated with and without the spatial broadcast grid
+TEST(TestOther, BenchmarkSpatialBroadcastGrid_long) {
+	constexpr int numSteps = 200;
+
+	for (int numNodes : { 100, 500, 2000 })
+	{
+		for (bool useGrid : { false, true })
+		{
+			CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+			SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+			//The node density is kept constant so that each node has roughly the same amount of neighbours
+			simConfig.mapWidthInMeters = (u32)std::sqrt(numNodes * 100.0);
+			simConfig.mapHeightInMeters = simConfig.mapWidthInMeters;
+			simConfig.terminalId = -1;
+			simConfig.useSpatialBroadcastGrid = useGrid;
+			simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", numNodes });
+			CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+			tester.Start();
+
+			const auto startTime = std::chrono::steady_clock::now();
+			tester.SimulateGivenNumberOfSteps(numSteps);
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+			printf("%d nodes, spatial grid %s: %.1f ticks/sec" EOL, numNodes, useGrid ? "on" : "off", numSteps / seconds);
+		}
+	}
+}
+
+//Checks that the cached path loss gives the same rssi as a fresh calculation and that it follows position changes
+TEST(TestOther, TestPathLossCache) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.rssiNoise = false;
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 3 });
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+	tester.SimulateGivenNumberOfSteps(1);
+
+	nodeEntry* nodeA = &tester.sim->nodes[0];
+	nodeEntry* nodeB = &tester.sim->nodes[1];
+	tester.sim->SetPosition(0, 0.1f, 0.1f, 0.0f);
+	tester.sim->SetPosition(1, 0.2f, 0.1f, 0.0f);
+	const float rssiNear = tester.sim->GetReceptionRssi(nodeA, nodeB);
+
+	//Moving a node must be visible immediately, not only after the next step
+	tester.sim->SetPosition(1, 0.4f, 0.1f, 0.0f);
+	const float rssiFar = tester.sim->GetReceptionRssi(nodeA, nodeB);
+	ASSERT_LT(rssiFar, rssiNear);
+
+	tester.SimulateGivenNumberOfSteps(1);
+	ASSERT_EQ(tester.sim->GetReceptionRssi(nodeA, nodeB), rssiFar);
+	ASSERT_EQ(tester.sim->GetReceptionRssi(nodeB, nodeA), rssiFar);
+
+	nodeB->impossibleConnection.push_back(0);
+	tester.SimulateGivenNumberOfSteps(1);
+	ASSERT_EQ(tester.sim->GetReceptionRssi(nodeA, nodeB), -10000);
+
+	//Big simulations only keep the pairs that were set
+	PathLossCache cache;
+	cache.Reset(PathLossCache::MAX_DENSE_NODES + 1);
+	ASSERT_FALSE(cache.IsDense());
+	cache.Set(1, 2, 50);
+	float pathLoss = 0;
+	ASSERT_FALSE(cache.Get(1, 2, pathLoss)); //All nodes are dirty after a reset
+	cache.ClearDirty();
+	ASSERT_TRUE(cache.Get(2, 1, pathLoss));
+	ASSERT_EQ(pathLoss, 50);
+	ASSERT_FALSE(cache.Get(1, 3, pathLoss));
+	cache.MarkDirty(2);
+	cache.RemoveNode(2);
+	cache.ClearDirty();
+	ASSERT_FALSE(cache.Get(1, 2, pathLoss));
+}
+
+TEST(TestOther, TestSimFlash) {
+	SimFlash flash;
+
+	//A new flash is erased
+	ASSERT_EQ(flash.GetNumWrittenPages(), 0);
+	ASSERT_EQ(flash[0], 0xFF);
+	ASSERT_EQ(flash[SimFlash::SIZE - 1], 0xFF);
+
+	flash[SimFlash::PAGE_SIZE * 3 + 10] = 0x12;
+	flash[SimFlash::PAGE_SIZE * 5] = 0x34;
+	ASSERT_EQ(flash.GetNumWrittenPages(), 2);
+	ASSERT_FALSE(flash.IsPageErased(3));
+	ASSERT_TRUE(flash.IsPageErased(4));
+
+	//Other flashes share the erased image but not the written pages
+	SimFlash otherFlash;
+	ASSERT_EQ(otherFlash[SimFlash::PAGE_SIZE * 3 + 10], 0xFF);
+
+	flash.Erase(SimFlash::PAGE_SIZE * 3, SimFlash::PAGE_SIZE);
+	ASSERT_TRUE(flash.IsPageErased(3));
+	ASSERT_EQ(flash[SimFlash::PAGE_SIZE * 5], 0x34);
+
+	//Erasing less than a page must only erase the given range
+	flash[SimFlash::PAGE_SIZE * 5 + 1] = 0x56;
+	flash.Erase(SimFlash::PAGE_SIZE * 5, 1);
+	ASSERT_EQ(flash[SimFlash::PAGE_SIZE * 5], 0xFF);
+	ASSERT_EQ(flash[SimFlash::PAGE_SIZE * 5 + 1], 0x56);
+
+	flash.EraseAll();
+	ASSERT_EQ(flash.GetNumWrittenPages(), 0);
+}
+
+//Returns the resident memory of the process in KB or 0 if unknown
+static u32 GetResidentMemoryKb()
+{
+#ifdef __linux__
+	std::ifstream statm("/proc/self/statm");
+	unsigned long size = 0;
+	unsigned long resident = 0;
+	if (statm >> size >> resident) return (u32)(resident * (sysconf(_SC_PAGESIZE) / 1024));
+#endif
+	return 0;
+}
+
+//Reports the memory and time needed to initialize simulations of different sizes
+TEST(TestOther, BenchmarkSimulatorInit_long) {
+	for (int numNodes : { 100, 500, 2000 })
+	{
+		const u32 residentBeforeKb = GetResidentMemoryKb();
+		const auto startTime = std::chrono::steady_clock::now();
+
+		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+		SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+		simConfig.mapWidthInMeters = (u32)std::sqrt(numNodes * 100.0);
+		simConfig.mapHeightInMeters = simConfig.mapWidthInMeters;
+		simConfig.terminalId = -1;
+		simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", numNodes });
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		const int residentKb = (int)GetResidentMemoryKb() - (int)residentBeforeKb;
+
+		u32 writtenPages = 0;
+		for (u32 i = 0; i < tester.sim->getTotalNodes(); i++) writtenPages += tester.sim->nodes[i].flash.GetNumWrittenPages();
+
+		printf("%d nodes: init %.2f s (%.2f ms/node), resident memory %+d KB (%d KB/node), %.1f written flash pages/node" EOL,
+			numNodes, seconds, seconds * 1000 / numNodes, residentKb, residentKb / numNodes,
+			(double)writtenPages / numNodes);
+	}
+}
+
+//Checks a line the way the CherrySimTester did before it used the SimulationMessageMatcher
+static void CheckLineWithAllMessages(std::vector<SimulationMessage>& messages, NodeId nodeId, const char* line, bool useRegex)
+{
+	for (SimulationMessage& message : messages)
+	{
+		if (!message.isFound() && message.getNodeId() == nodeId && message.checkAndSet(line, useRegex)) break;
+	}
+}
+
+TEST(TestOther, TestSimulationMessageMatcher) {
+	const char alphabet[] = "abcd";
+	const std::vector<std::string> regexParts = { "a.c", "^b", "d$", "(ab)+c", "c{2}", "[cd]a" };
+
+	for (bool useRegex : { false, true })
+	{
+		for (u32 seed = 0; seed < 20; seed++)
+		{
+			MersenneTwister mt(seed);
+
+			//Short messageParts from a small alphabet overlap a lot, including empty ones and duplicates
+			std::vector<SimulationMessage> expected;
+			for (u32 i = 0; i < 30; i++)
+			{
+				std::string messagePart;
+				if (useRegex && mt.nextU32(0, 1) == 0)
+				{
+					messagePart = regexParts[mt.nextU32(0, (u32)regexParts.size() - 1)];
+				}
+				else
+				{
+					const u32 length = mt.nextU32(0, 4);
+					for (u32 k = 0; k < length; k++) messagePart += alphabet[mt.nextU32(0, 3)];
+				}
+				expected.push_back(SimulationMessage((NodeId)mt.nextU32(1, 3), messagePart));
+			}
+			std::vector<SimulationMessage> actual = expected;
+
+			SimulationMessageMatcher matcher;
+			matcher.Prepare(actual, useRegex);
+
+			for (u32 i = 0; i < 200 && !matcher.AllMessagesFound(); i++)
+			{
+				std::string line;
+				const u32 length = mt.nextU32(0, 12);
+				for (u32 k = 0; k < length; k++) line += alphabet[mt.nextU32(0, 3)];
+				const NodeId nodeId = (NodeId)mt.nextU32(1, 4);
+
+				CheckLineWithAllMessages(expected, nodeId, line.c_str(), useRegex);
+				matcher.CheckLine(nodeId, line.c_str());
+
+				for (u32 k = 0; k < expected.size(); k++)
+				{
+					ASSERT_EQ(expected[k].isFound(), actual[k].isFound());
+					if (expected[k].isFound()) ASSERT_EQ(expected[k].getCompleteMessage(), actual[k].getCompleteMessage());
+				}
+			}
+
+			const bool allFound = std::all_of(expected.begin(), expected.end(), [](const SimulationMessage& sm) {return sm.isFound(); });
+			ASSERT_EQ(allFound, matcher.AllMessagesFound());
+		}
+	}
+}
+
+TEST(TestOther, BenchmarkSimulationMessageMatcher_long) {
+	//Each node of a big mesh awaits one message while all of them print unrelated lines
+	constexpr u32 numNodes = 1000;
+	constexpr u32 numLines = 20000;
+
+	for (bool useRegex : { false, true })
+	{
+		std::vector<SimulationMessage> messages;
+		for (u32 i = 1; i <= numNodes; i++)
+		{
+			messages.push_back(SimulationMessage(i, useRegex ? "clusterSize [0-9]+ reached" : "clusterSize 1000 reached"));
+		}
+		std::vector<SimulationMessage> matcherMessages = messages;
+
+		std::vector<std::string> lines;
+		for (u32 i = 0; i < numLines; i++)
+		{
+			lines.push_back("[Node.cpp@1234 DISCOVERY]: JOIN_ME: sender:" + std::to_string(i % numNodes + 1) + ", clusterId:1234, clusterSize:5, freeIn:1, freeOut:3");
+		}
+
+		auto startTime = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < numLines; i++) CheckLineWithAllMessages(messages, i % numNodes + 1, lines[i].c_str(), useRegex);
+		const double secondsAllMessages = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		startTime = std::chrono::steady_clock::now();
+		SimulationMessageMatcher matcher;
+		matcher.Prepare(matcherMessages, useRegex);
+		for (u32 i = 0; i < numLines; i++) matcher.CheckLine(i % numNodes + 1, lines[i].c_str());
+		const double secondsMatcher = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		ASSERT_FALSE(matcher.AllMessagesFound());
+		printf("%s: %.0f lines/sec checked against all messages, %.0f lines/sec with the matcher" EOL,
+			useRegex ? "Regex" : "Literal", numLines / secondsAllMessages, numLines / secondsMatcher);
+	}
+}
+
+struct TestAssetTrackingEntry
+{
+	u32 key;
+	u8 rssi;
+
+	u32 GetKey() const { return key; }
+	void SetKey(u32 newKey) { key = newKey; }
+	u8 GetRssi() const { return rssi; }
+};
+
+TEST(TestOther, TestAssetTrackingTable) {
+	AssetTrackingTable<TestAssetTrackingEntry, 8> table;
+
+	//Keys that are a multiple of the table size apart collide often
+	for (u32 i = 1; i <= 8; i++)
+	{
+		TestAssetTrackingEntry* entry = table.GetOrInsert(i * 8, 50);
+		ASSERT_TRUE(entry != nullptr);
+		ASSERT_EQ(entry->GetKey(), i * 8);
+		entry->rssi = (u8)(40 + i);
+	}
+	ASSERT_EQ(table.GetNumEntries(), 8);
+	ASSERT_EQ(table.GetOrInsert(16, 10)->rssi, 42);
+
+	//A full table only accepts assets that are stronger than its weakest one
+	ASSERT_TRUE(table.GetOrInsert(1000, 48) == nullptr);
+	TestAssetTrackingEntry* entry = table.GetOrInsert(1000, 30);
+	ASSERT_TRUE(entry != nullptr);
+	entry->rssi = 30;
+	ASSERT_TRUE(table.Get(64) == nullptr);
+	ASSERT_EQ(table.GetNumEntries(), 8);
+
+	//All other entries must still be found after the weakest one was removed
+	for (u32 i = 1; i <= 7; i++)
+	{
+		ASSERT_TRUE(table.Get(i * 8) != nullptr);
+		ASSERT_EQ(table.Get(i * 8)->rssi, 40 + i);
+	}
+
+	std::array<u16, 8> indices;
+	ASSERT_EQ(table.GetIndicesByRssi(indices), 8);
+	ASSERT_EQ(table[indices[0]].GetKey(), 1000);
+	for (u32 i = 1; i < 8; i++)
+	{
+		ASSERT_EQ(table[indices[i]].GetKey(), i * 8);
+	}
+
+	table.Clear();
+	ASSERT_EQ(table.GetNumEntries(), 0);
+	ASSERT_TRUE(table.Get(1000) == nullptr);
+	ASSERT_EQ(table.GetIndicesByRssi(indices), 0);
+}
+
+TEST(TestOther, TestJoinMeBuffer) {
+	JoinMeBuffer buffer;
+
+	//Fill the buffer, the scores increase with the sender
+	for (NodeId sender = 1; sender <= JoinMeBuffer::NUM_ELEMENTS; sender++)
+	{
+		joinMeBufferPacket* packet = buffer.Add(sender);
+		ASSERT_TRUE(packet != nullptr);
+		packet->receivedTimeDs = 100;
+		buffer.Update(packet, sender * 100, sender * 10);
+	}
+	ASSERT_EQ(buffer.GetNumPackets(), JoinMeBuffer::NUM_ELEMENTS);
+	ASSERT_TRUE(buffer.Add(100) == nullptr);
+	ASSERT_TRUE(buffer.Add(1) == nullptr);
+
+	//The worst candidate is the one where the better of both scores is the lowest
+	ASSERT_EQ(buffer.GetWorstPacket(100, 50)->payload.sender, 1);
+	buffer.SetScores(buffer.Find(1) - &buffer[0], 0, 5000);
+	ASSERT_EQ(buffer.GetWorstPacket(100, 50)->payload.sender, 2);
+
+	//With equal scores, the older packet is the worse candidate
+	joinMeBufferPacket* packet = buffer.Find(3);
+	packet->receivedTimeDs = 120;
+	buffer.Update(packet, 200, 0);
+	ASSERT_EQ(buffer.GetWorstPacket(120, 50)->payload.sender, 2);
+
+	//Stale packets are replaced before the worst candidate
+	ASSERT_EQ(buffer.GetWorstPacket(160, 50)->payload.sender, 1);
+
+	buffer.Remove(2);
+	ASSERT_TRUE(buffer.Find(2) == nullptr);
+	ASSERT_EQ(buffer.GetNumPackets(), JoinMeBuffer::NUM_ELEMENTS - 1);
+	ASSERT_EQ(buffer.GetWorstPacket(120, 50)->payload.sender, 3);
+	for (NodeId sender = 3; sender <= JoinMeBuffer::NUM_ELEMENTS; sender++)
+	{
+		ASSERT_EQ(buffer.Find(sender)->payload.sender, sender);
+	}
+
+	//The senders 143 + 9 * i all have the same home slot in the sender index and must still be found after removals
+	buffer.Clear();
+	for (u32 i = 0; i < JoinMeBuffer::NUM_ELEMENTS; i++)
+	{
+		packet = buffer.Add(143 + 9 * i);
+		packet->receivedTimeDs = i;
+		buffer.Update(packet, 0, 0);
+	}
+	ASSERT_EQ(buffer.GetWorstPacket(20, 50)->payload.sender, 143);
+	for (u32 i = 0; i < JoinMeBuffer::NUM_ELEMENTS; i += 2)
+	{
+		buffer.Remove(143 + 9 * i);
+	}
+	for (u32 i = 1; i < JoinMeBuffer::NUM_ELEMENTS; i += 2)
+	{
+		ASSERT_EQ(buffer.Find(143 + 9 * i)->payload.sender, 143 + 9 * i);
+	}
+	ASSERT_EQ(buffer.GetWorstPacket(20, 50)->payload.sender, 152);
+	ASSERT_TRUE(buffer.Find(143) == nullptr);
+}
+
+//Records the clustering state of all nodes so that simulation runs can be compared
+static std::vector<u32> GetClusterState(CherrySimTester& tester)
+{
+	std::vector<u32> state;
+	state.push_back(tester.sim->simState.simTimeMs);
+	for (u32 i = 0; i < tester.sim->getTotalNodes(); i++)
+	{
+		NodeIndexSetter setter(i);
+		state.push_back(GS->node.clusterId);
+		state.push_back(GS->node.clusterSize);
+	}
+	return state;
+}
+
+TEST(TestOther, TestSimulatorSnapshot) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 9 });
+	std::vector<u32> clusteredState;
+	std::vector<u32> laterState;
+	{
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+		tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
+		clusteredState = GetClusterState(tester);
+
+		//A restored snapshot must continue exactly as the simulation it was taken from
+		const std::vector<u8> snapshot = tester.sim->CreateSnapshot();
+		tester.SimulateForGivenTime(20 * 1000);
+		laterState = GetClusterState(tester);
+		ASSERT_TRUE(tester.sim->RestoreSnapshot(snapshot));
+		ASSERT_EQ(GetClusterState(tester), clusteredState);
+		tester.SimulateForGivenTime(20 * 1000);
+		ASSERT_EQ(GetClusterState(tester), laterState);
+	}
+	{
+		//The second tester with the same configuration continues from the kept clustered snapshot
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+		tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
+		ASSERT_EQ(GetClusterState(tester), clusteredState);
+		tester.SimulateForGivenTime(20 * 1000);
+		ASSERT_EQ(GetClusterState(tester), laterState);
+	}
+	{
+		//A tester that changes a node after Start must not continue from the snapshot of the unchanged mesh
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+		tester.sim->nodes[3].gs.config.enableTxScheduler = true;
+		tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
+		ASSERT_TRUE(tester.sim->nodes[3].gs.config.enableTxScheduler);
+	}
+	{
+		//Queued terminal commands own memory and must be restored by value
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+		tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
+		tester.sim->setNode(1);
+		std::string command = "action this status get_status";
+		GS->terminal.PutIntoTerminalCommandQueue(command, true);
+		const std::vector<u8> snapshot = tester.sim->CreateSnapshot();
+		tester.SimulateUntilMessageReceived(10 * 1000, 2, "{\"nodeId\":2,\"type\":\"status\",\"module\":3");
+		ASSERT_FALSE(tester.sim->nodes[1].gs.terminal.HasQueuedTerminalCommands());
+		ASSERT_TRUE(tester.sim->RestoreSnapshot(snapshot));
+		ASSERT_TRUE(tester.sim->nodes[1].gs.terminal.HasQueuedTerminalCommands());
+		tester.SimulateUntilMessageReceived(10 * 1000, 2, "{\"nodeId\":2,\"type\":\"status\",\"module\":3");
+	}
+	{
+		//A corrupted snapshot must be rejected
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+		std::vector<u8> snapshot = tester.sim->CreateSnapshot();
+		snapshot[0] ^= 0xFF;
+		Exceptions::ExceptionDisabler<CorruptOrOutdatedSavefile> disabler;
+		ASSERT_FALSE(tester.sim->RestoreSnapshot(snapshot));
+	}
+	{
+		//A snapshot of a simulator with another configuration must be rejected
+		std::vector<u8> snapshot;
+		{
+			SimConfiguration otherSimConfig = CherrySimTester::CreateDefaultSimConfiguration();
+			otherSimConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+			otherSimConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 4 });
+			CherrySimTester otherTester = CherrySimTester(testerConfig, otherSimConfig);
+			otherTester.Start();
+			snapshot = otherTester.sim->CreateSnapshot();
+		}
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+		Exceptions::ExceptionDisabler<CorruptOrOutdatedSavefile> disabler;
+		ASSERT_FALSE(tester.sim->RestoreSnapshot(snapshot));
+	}
+}
+
+TEST(TestOther, TestParallelScenarios) {
+	constexpr u32 numScenarios = 4;
+	auto runScenario = [](u32 seed) {
+		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+		SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+		simConfig.seed = seed;
+		simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 10 });
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+		tester.SimulateForGivenTime(30 * 1000);
+		return GetClusterState(tester);
+	};
+
+	std::vector<std::vector<u32>> sequentialStates;
+	for (u32 i = 0; i < numScenarios; i++)
+	{
+		sequentialStates.push_back(runScenario(i));
+	}
+
+	//Simulators on different threads must not influence each other
+	std::vector<std::vector<u32>> parallelStates(numScenarios);
+	CherrySimTester::RunScenariosInParallel(numScenarios, [&](u32 i) {
+		parallelStates[i] = runScenario(i);
+	});
+	ASSERT_EQ(parallelStates, sequentialStates);
+
+	//Exceptions of a scenario are passed to the caller
+	ASSERT_THROW(CherrySimTester::RunScenariosInParallel(numScenarios, [](u32 i) {
+		if (i == 2) throw IllegalArgumentException();
+	}), IllegalArgumentException);
+}
+
+TEST(TestOther, TestReplayTrace) {
+	const std::string tracePath = "TestReplayTrace.trace";
+	{
+		ReplayTraceWriter writer(tracePath.c_str());
+		writer.WriteConfiguration("{}");
+		writer.WriteVersion(FM_VERSION);
+		writer.WriteCommand(3, 1000, "status");
+		writer.WriteEvent(4, 1500, "NODE_RESET");
+		writer.WriteCommand(0, 2000, "");
+	}
+	ASSERT_TRUE(ReplayTraceReader::IsTrace(tracePath.c_str()));
+
+	std::vector<u8> traceContents;
+	{
+		ReplayTraceReader reader(tracePath.c_str());
+		ReplayTraceRecord record;
+		ASSERT_TRUE(reader.Next(record));
+		ASSERT_EQ(record.type, ReplayTraceRecordType::CONFIGURATION);
+		ASSERT_EQ(std::string(record.data, record.dataLength), "{}");
+		ASSERT_TRUE(reader.Next(record));
+		ASSERT_EQ(record.type, ReplayTraceRecordType::VERSION);
+		ASSERT_EQ(record.dataLength, sizeof(u32));
+		ASSERT_TRUE(reader.Next(record));
+		ASSERT_EQ(record.type, ReplayTraceRecordType::COMMAND);
+		ASSERT_EQ(record.index, 3);
+		ASSERT_EQ(record.timeMs, 1000);
+		ASSERT_EQ(std::string(record.data, record.dataLength), "status");
+		ASSERT_TRUE(reader.Next(record));
+		ASSERT_EQ(record.type, ReplayTraceRecordType::EVENT);
+		ASSERT_EQ(record.index, 4);
+		ASSERT_EQ(std::string(record.data, record.dataLength), "NODE_RESET");
+		ASSERT_TRUE(reader.Next(record));
+		ASSERT_EQ(record.type, ReplayTraceRecordType::COMMAND);
+		ASSERT_EQ(record.dataLength, 0);
+		ASSERT_FALSE(reader.Next(record));
+	}
+
+	//A trace that was cut off is readable up to its last complete record
+	{
+		std::ifstream in(tracePath, std::ios::binary);
+		traceContents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		std::ofstream out(tracePath, std::ios::binary | std::ios::trunc);
+		out.write((const char*)traceContents.data(), traceContents.size() - 3);
+	}
+	{
+		ReplayTraceReader reader(tracePath.c_str());
+		ReplayTraceRecord record;
+		u32 numRecords = 0;
+		while (reader.Next(record)) numRecords++;
+		ASSERT_EQ(numRecords, 4);
+	}
+
+	//Text replays are not traces
+	{
+		std::ofstream out(tracePath, std::ios::trunc);
+		out << "[!]CONFIGURATION START:[!]";
+	}
+	ASSERT_FALSE(ReplayTraceReader::IsTrace(tracePath.c_str()));
+	{
+		Exceptions::ExceptionDisabler<CorruptOrOutdatedSavefile> disabler;
+		ReplayTraceReader reader(tracePath.c_str());
+		ReplayTraceRecord record;
+		ASSERT_FALSE(reader.Next(record));
+	}
+}
+
+#ifndef GITHUB_RELEASE
+TEST(TestOther, TestReplayFromTrace) {
+	const std::string tracePath = "TestReplayFromTrace.trace";
+	const std::string convertedTracePath = "TestReplayFromTraceConverted.trace";
+	const std::string replayPath = "TestReplayFromTrace.log";
+	std::string logAccumulatorDemonstrator;
+	{
+		SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+		simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+		simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 9 });
+		simConfig.logReplayCommands = true;
+		simConfig.replayTracePath = tracePath;
+		simConfig.useLogAccumulator = true;
+		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+
+		tester.SimulateForGivenTime(1000);
+		tester.SendTerminalCommand(1, "action 0 status get_status");
+		tester.SimulateForGivenTime(1234);
+		tester.SendTerminalCommand(7, "status");
+		tester.SimulateForGivenTime(1000);
+		logAccumulatorDemonstrator = tester.sim->logAccumulator;
+	}
+
+	std::string logAccumulatorReplay;
+	{
+		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+		SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+		simConfig.replayPath = tracePath;
+		CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+		tester.Start();
+		tester.SimulateForGivenTime(1000 + 1234 + 1000);
+		logAccumulatorReplay = tester.sim->logAccumulator;
+	}
+	ASSERT_TRUE(logAccumulatorReplay.find("[!]COMMAND EXECUTION START:[!]index:0,time:1000,cmd:action 0 status get_status CRC: 1730502495[!]COMMAND EXECUTION END[!]") != std::string::npos);
+	ASSERT_TRUE(logAccumulatorReplay.find("[!]COMMAND EXECUTION START:[!]index:6,time:2250,cmd:status[!]COMMAND EXECUTION END[!]") != std::string::npos);
+
+	//The converted text replay contains the same commands as the trace
+	{
+		std::ofstream out(replayPath);
+		out << logAccumulatorDemonstrator;
+	}
+	CherrySim::ConvertReplayToTrace(replayPath.c_str(), convertedTracePath.c_str());
+	auto readCommands = [](const std::string& path) {
+		std::vector<std::string> commands;
+		ReplayTraceReader reader(path.c_str());
+		ReplayTraceRecord record;
+		while (reader.Next(record))
+		{
+			if (record.type != ReplayTraceRecordType::COMMAND) continue;
+			commands.push_back(std::to_string(record.index) + ":" + std::to_string(record.timeMs) + ":" + std::string(record.data, record.dataLength));
+		}
+		return commands;
+	};
+	ASSERT_EQ(readCommands(convertedTracePath), readCommands(tracePath));
+	ASSERT_EQ(readCommands(tracePath).size(), 2);
+}
+#endif //GITHUB_RELEASE
+
+//The map only receives the devices that changed since the version it already has
+TEST(TestOther, TestFruitySimServerDeviceDeltas) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 4 });
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+	tester.SimulateForGivenTime(1000);
+
+	//The change log does not need the http thread, so the server can be driven directly
+	FruitySimServer server(tester.sim);
+	auto getUuids = [](const nlohmann::json& devices) {
+		std::vector<std::string> uuids;
+		for (const nlohmann::json& device : devices["result"]) uuids.push_back(device["uuid"].get<std::string>());
+		return uuids;
+	};
+
+	server.UpdateDeviceStates();
+	nlohmann::json devices = nlohmann::json::parse(server.GenerateDevicesJson(0));
+	ASSERT_TRUE(devices["full"].get<bool>());
+	ASSERT_EQ(devices["result"].size(), 5);
+	const u32 version = devices["version"].get<u32>();
+
+	//A version that the server never handed out must lead to a full resync
+	devices = nlohmann::json::parse(server.GenerateDevicesJson(version + 100));
+	ASSERT_TRUE(devices["full"].get<bool>());
+	ASSERT_EQ(devices["result"].size(), 5);
+
+	//Nodes that did not change are left out
+	server.UpdateDeviceStates();
+	devices = nlohmann::json::parse(server.GenerateDevicesJson(version));
+	ASSERT_FALSE(devices["full"].get<bool>());
+	ASSERT_EQ(devices["version"].get<u32>(), version);
+	ASSERT_EQ(devices["result"].size(), 0);
+
+	//Only the changed node is part of the delta
+	tester.sim->nodes[2].ledOn = !tester.sim->nodes[2].ledOn;
+	server.UpdateDeviceStates();
+	devices = nlohmann::json::parse(server.GenerateDevicesJson(version));
+	ASSERT_FALSE(devices["full"].get<bool>());
+	ASSERT_EQ(devices["version"].get<u32>(), version + 1);
+	ASSERT_EQ(getUuids(devices), std::vector<std::string>{ "00000000-1111-2222-3333-000000000002" });
+
+	//If the map knows a device that no longer exists, it must get the full list so that it removes it
+	{
+		std::lock_guard<std::mutex> lock(server.deviceStatesMutex);
+		server.deviceStates.push_back(server.deviceStates.back());
+		server.deviceStates.back().index = 5;
+		server.deviceStateVersions.push_back(server.devicesVersion);
+	}
+	devices = nlohmann::json::parse(server.GenerateDevicesJson(0));
+	ASSERT_EQ(devices["result"].size(), 6);
+	const u32 versionWithRemovedNode = devices["version"].get<u32>();
+	server.UpdateDeviceStates();
+	devices = nlohmann::json::parse(server.GenerateDevicesJson(versionWithRemovedNode));
+	ASSERT_TRUE(devices["full"].get<bool>());
+	ASSERT_EQ(devices["result"].size(), 5);
+}
@@ -0,0 +1,173 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include <types.h>
+#include <CherrySimTester.h>
+#include <PooledPacketQueue.h>
+#include <Utility.h>
+#include <memory>
+
+#ifdef SIM_ENABLED
+
+class TestPooledPacketQueue : public ::testing::Test {
+private:
+	CherrySimTester* tester;
+public:
+	TestPooledPacketQueue() {
+		//We have to boot up a simulator for this test because the PooledPacketQueue uses the Logger
+		CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+		SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+		simConfig.nodeConfigName.insert( { "prod_sink_nrf52", 1 } );
+		tester = new CherrySimTester(testerConfig, simConfig);
+		tester->Start();
+	}
+
+	~TestPooledPacketQueue() {
+		delete tester;
+	}
+};
+
+TEST_F(TestPooledPacketQueue, TestReserveAndDiscard) {
+	std::unique_ptr<PacketPool> pool(new PacketPool());
+	PooledPacketQueue queue(*pool, 1, PacketPool::NUM_BLOCKS);
+
+	//Fill more elements than fit into a single block
+	const u32 numElements = 3 * PacketPool::BLOCK_SIZE / 24;
+	for (u32 i = 0; i < numElements; i++) {
+		u8* dest = queue.Reserve(20 + i % 3);
+		ASSERT_NE(dest, nullptr);
+		dest[0] = (u8)i;
+	}
+	ASSERT_EQ(queue._numElements, numElements);
+	ASSERT_GE(queue.GetNumBlocks(), 3);
+	ASSERT_EQ(pool->GetNumUsedBlocks(), queue.GetNumBlocks());
+
+	for (u32 i = 0; i < numElements; i++) {
+		SizedData data = queue.PeekNext(i);
+		ASSERT_EQ(data.length, 20 + i % 3);
+		ASSERT_EQ(data.data[0], (u8)i);
+	}
+	ASSERT_EQ(queue.PeekNext(numElements).length, 0);
+	ASSERT_EQ(queue.PeekLast().data[0], (u8)(numElements - 1));
+
+	//Discarding from the back must give an emptied tail block back to the pool
+	while (queue.PeekLast().data != queue.PeekNext(0).data && queue.GetNumBlocks() > 2) {
+		queue.DiscardLast();
+	}
+	ASSERT_EQ(queue.GetNumBlocks(), 2);
+	u8 last = queue.PeekLast().data[0];
+	u8* dest = queue.Reserve(20);
+	ASSERT_NE(dest, nullptr);
+	dest[0] = last + 1;
+	ASSERT_EQ(queue.PeekLast().data[0], (u8)(last + 1));
+
+	//Discarding from the front must free the blocks that were fully read
+	u8 expected = 0;
+	while (queue._numElements > 0) {
+		ASSERT_EQ(queue.PeekNext().data[0], expected);
+		queue.DiscardNext();
+		expected++;
+	}
+	ASSERT_EQ(expected, (u8)(last + 2));
+	ASSERT_EQ(queue.GetNumBlocks(), 0);
+	ASSERT_EQ(pool->GetNumUsedBlocks(), 0);
+}
+
+TEST_F(TestPooledPacketQueue, TestLimitsAndReservations) {
+	std::unique_ptr<PacketPool> pool(new PacketPool());
+	const u16 maxBlocks = PacketPool::NUM_BLOCKS / 2;
+	PooledPacketQueue congested(*pool, 1, maxBlocks);
+	PooledPacketQueue idle(*pool, 2, PacketPool::NUM_BLOCKS);
+	PooledPacketQueue other(*pool, 1, PacketPool::NUM_BLOCKS);
+
+	//A single element must fit into one block
+	ASSERT_NE(congested.Reserve(PacketPool::BLOCK_SIZE - 4), nullptr);
+	congested.Clean();
+
+	//The congested queue is capped at its maximum
+	while (congested.Reserve(PacketPool::BLOCK_SIZE - 4) != nullptr);
+	ASSERT_EQ(congested.GetNumBlocks(), maxBlocks);
+
+	//Another queue can take all blocks except for the ones reserved for the idle queue
+	while (other.Reserve(PacketPool::BLOCK_SIZE - 4) != nullptr);
+	ASSERT_EQ(other.GetNumBlocks(), PacketPool::NUM_BLOCKS - maxBlocks - 2);
+	ASSERT_EQ(pool->GetNumFreeBlocks(), 2);
+
+	//The idle queue still gets its reserved blocks but not more
+	ASSERT_NE(idle.Reserve(PacketPool::BLOCK_SIZE - 4), nullptr);
+	ASSERT_NE(idle.Reserve(PacketPool::BLOCK_SIZE - 4), nullptr);
+	ASSERT_EQ(idle.Reserve(PacketPool::BLOCK_SIZE - 4), nullptr);
+
+	ASSERT_EQ(pool->GetHighWaterMark(), PacketPool::NUM_BLOCKS);
+
+	//After freeing, the mark is only reset to the current usage
+	congested.Clean();
+	other.Clean();
+	ASSERT_EQ(pool->GetHighWaterMark(), PacketPool::NUM_BLOCKS);
+	pool->ResetHighWaterMark();
+	ASSERT_EQ(pool->GetHighWaterMark(), 2);
+
+	//Freed blocks go back into the reservation of the queue
+	idle.Clean();
+	ASSERT_EQ(pool->GetNumUsedBlocks(), 0);
+	while (other.Reserve(PacketPool::BLOCK_SIZE - 4) != nullptr);
+	ASSERT_EQ(other.GetNumBlocks(), PacketPool::NUM_BLOCKS - 2 - 1);
+}
+
+TEST_F(TestPooledPacketQueue, TestRandomFill) {
+	std::unique_ptr<PacketPool> pool(new PacketPool());
+	PooledPacketQueue queue(*pool, 1, 4);
+
+	u8 fillCounter = 0;
+	u8 readCounter = 0;
+	for (int i = 0; i < 5000; i++) {
+		u32 rnd = Utility::GetRandomInteger() % 3;
+		if (rnd < 2) {
+			u16 length = 1 + Utility::GetRandomInteger() % (PacketPool::BLOCK_SIZE - 4);
+			u8* dest = queue.Reserve(length);
+			if (dest != nullptr) {
+				CheckedMemset(dest, fillCounter, length);
+				fillCounter++;
+			}
+		}
+		else if (queue._numElements > 0) {
+			SizedData data = queue.PeekNext();
+			ASSERT_EQ(data.data[0], readCounter);
+			ASSERT_EQ(data.data[data.length - 1], readCounter);
+			queue.DiscardNext();
+			readCounter++;
+		}
+		ASSERT_LE(queue.GetNumBlocks(), 4);
+	}
+	queue.Clean();
+	ASSERT_EQ(pool->GetNumUsedBlocks(), 0);
+}
+
+#endif //SIM_ENABLED
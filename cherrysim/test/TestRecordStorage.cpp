@@ -36,6 +36,7 @@
 #include <Utility.h>
 #include <Logger.h>
 #include <CherrySimTester.h>
+#include <chrono>
 
 class TestRecordStorage : public ::testing::Test, public RecordStorageEventListener
 {
@@ -517,3 +518,53 @@ TEST_F(TestRecordStorage, TestRandomMultiRecordUpdates) {
 		}
 	}
 }
+
+//Must be below RECORD_STORAGE_INDEX_SIZE so that all records can be found through the index
+#define BOOT_BENCHMARK_NUM_RECORD_IDS 30
+#define BOOT_BENCHMARK_NUM_UPDATES 10
+#define BOOT_BENCHMARK_NUM_BOOTS 200
+
+TEST_F(TestRecordStorage, TestBootWithManyRecords) {
+	logt("WARNING", "---- TEST BOOT WITH MANY RECORDS ----");
+
+	//Setup
+	CheckedMemset(startPage, 0xff, numPages*FruityHal::GetCodePageSize());
+	RepairPages();
+
+	cherrySimInstance->sim_commit_flash_operations();
+
+	//Store multiple versions of many records so that the newest version must be searched
+	u8 data[32];
+	for (int update = 0; update < BOOT_BENCHMARK_NUM_UPDATES; update++) {
+		for (u16 recordId = 1; recordId <= BOOT_BENCHMARK_NUM_RECORD_IDS; recordId++) {
+			CheckedMemset(data, (u8)recordId, sizeof(data));
+			data[1] = (u8)update;
+			GS->recordStorage.SaveRecord(recordId, data, 4 + (recordId % 7) * 4, nullptr, 0);
+
+			cherrySimInstance->sim_commit_flash_operations();
+		}
+	}
+
+	//Simulate a boot by repairing the pages, which will forget all records validated so far,
+	//afterwards all records are read as it is done by the modules during boot
+	auto start = std::chrono::steady_clock::now();
+	for (int boot = 0; boot < BOOT_BENCHMARK_NUM_BOOTS; boot++) {
+		RepairPages();
+
+		cherrySimInstance->sim_commit_flash_operations();
+
+		for (u16 recordId = 1; recordId <= BOOT_BENCHMARK_NUM_RECORD_IDS; recordId++) {
+			SizedData dataB = GS->recordStorage.GetRecordData(recordId);
+
+			if (dataB.length != 4 + (recordId % 7) * 4) {
+				FAIL() << "Record " << recordId << " had wrong length after boot " << boot; //LCOV_EXCL_LINE assertion
+			}
+			if (dataB.data[0] != (u8)recordId || dataB.data[1] != BOOT_BENCHMARK_NUM_UPDATES - 1) {
+				FAIL() << "Record " << recordId << " not in latest version after boot " << boot; //LCOV_EXCL_LINE assertion
+			}
+		}
+	}
+	auto durationUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	printf("Average boot time with %u records: %u us" EOL, BOOT_BENCHMARK_NUM_RECORD_IDS, (u32)(durationUs / BOOT_BENCHMARK_NUM_BOOTS));
+}
@@ -0,0 +1,324 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include <CherrySimTester.h>
+#include <CherrySimUtils.h>
+#include <Node.h>
+#include "RuuviLogModule.h"
+#include <json.hpp>
+#include <vector>
+#include <string>
+
+using json = nlohmann::json;
+
+//Samples change slowly like real measurements so that most deltas fit into a single byte
+static RuuviLogSample CreateSample(u32 index)
+{
+	RuuviLogSample sample;
+	sample.timestamp = 1000 + index * 60;
+	sample.temperature = (i16)(2000 + (index % 50) - 25);
+	sample.humidity = (u16)(4500 + (index % 20));
+	sample.pressure = 101325 + (index % 30);
+	sample.batteryMv = (u16)(3000 - index / 100);
+	return sample;
+}
+
+static void AssertSampleEqual(const RuuviLogSample& actual, const RuuviLogSample& expected)
+{
+	ASSERT_EQ(actual.timestamp, expected.timestamp);
+	ASSERT_EQ(actual.temperature, expected.temperature);
+	ASSERT_EQ(actual.humidity, expected.humidity);
+	ASSERT_EQ(actual.pressure, expected.pressure);
+	ASSERT_EQ(actual.batteryMv, expected.batteryMv);
+}
+
+//Must be called with the NodeIndexSetter of the node as the module lives in its GlobalState
+static RuuviLogModule* GetRuuviLogModule()
+{
+	return static_cast<RuuviLogModule*>(GS->node.GetModuleById(ModuleId::RUUVI_LOG_MODULE));
+}
+
+TEST(TestRuuviLogModule, TestWrapAround) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.terminalId = 0;
+	//testerConfig.verbose = true;
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1});
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1});
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+	tester.SimulateGivenNumberOfSteps(10);
+
+	//Log a lot more samples than the ring can hold
+	constexpr u32 numLoggedSamples = 6000;
+	NodeIndexSetter setter(1);
+	RuuviLogModule* module = GetRuuviLogModule();
+	ASSERT_TRUE(module != nullptr);
+	for (u32 i = 0; i < numLoggedSamples; i++)
+	{
+		ASSERT_TRUE(module->LogSample(CreateSample(i)));
+	}
+	ASSERT_EQ(module->droppedSamples, 0u);
+
+	std::vector<RuuviLogSample> samples(numLoggedSamples);
+	const u32 numSamples = module->ReadSamples(0, 0xFFFFFFFF, samples.data(), numLoggedSamples);
+
+	//The oldest samples were overwritten, but at least all pages except the one that was erased last are full
+	ASSERT_LT(numSamples, numLoggedSamples);
+	ASSERT_GT(numSamples, 1000u);
+
+	//The remaining samples are the newest ones without any gap
+	const u32 firstIndex = numLoggedSamples - numSamples;
+	for (u32 i = 0; i < numSamples; i++)
+	{
+		AssertSampleEqual(samples[i], CreateSample(firstIndex + i));
+	}
+
+	//Reading a window only returns the samples within it
+	const u32 numWindowSamples = module->ReadSamples(CreateSample(numLoggedSamples - 100).timestamp, CreateSample(numLoggedSamples - 51).timestamp, samples.data(), numLoggedSamples);
+	ASSERT_EQ(numWindowSamples, 50u);
+	AssertSampleEqual(samples[0], CreateSample(numLoggedSamples - 100));
+	AssertSampleEqual(samples[49], CreateSample(numLoggedSamples - 51));
+}
+
+TEST(TestRuuviLogModule, TestPowerLossDuringWrite) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.terminalId = 0;
+	//testerConfig.verbose = true;
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1});
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1});
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+	tester.SimulateGivenNumberOfSteps(10);
+
+	constexpr u32 numCommittedSamples = 100;
+	u8 tornPage = 0;
+	{
+		NodeIndexSetter setter(1);
+		RuuviLogModule* module = GetRuuviLogModule();
+		for (u32 i = 0; i < numCommittedSamples; i++)
+		{
+			ASSERT_TRUE(module->LogSample(CreateSample(i)));
+		}
+		ASSERT_TRUE(module->FlushPendingBlock());
+
+		//These samples are only held in RAM and are lost with the power loss
+		for (u32 i = numCommittedSamples; i < numCommittedSamples + 5; i++)
+		{
+			ASSERT_TRUE(module->LogSample(CreateSample(i)));
+		}
+
+		//Simulate that the power was lost while the next block was written, only its header and a part of the payload made it to flash
+		tornPage = module->headPage;
+		u8* blockAddress = (u8*)(module->GetPageAddress(tornPage) + module->pageEnds[tornPage]);
+		RuuviLogBlockHeader header;
+		header.payloadLength = 80;
+		header.numSamples = 12;
+		header.reserved = 0xFF;
+		header.minTimestamp = CreateSample(numCommittedSamples).timestamp;
+		header.maxTimestamp = CreateSample(numCommittedSamples + 11).timestamp;
+		header.crc = 0x12345678;
+		CheckedMemcpy(blockAddress, &header, sizeof(header));
+		CheckedMemset(blockAddress + sizeof(header), 0x11, 20);
+	}
+
+	tester.SendTerminalCommand(2, "reset");
+	tester.SimulateUntilMessageReceived(10 * 1000, 2, "\"type\":\"reboot\"");
+	tester.SimulateGivenNumberOfSteps(10);
+
+	{
+		NodeIndexSetter setter(1);
+		RuuviLogModule* module = GetRuuviLogModule();
+
+		//All committed samples survived and the torn block is ignored
+		std::vector<RuuviLogSample> samples(numCommittedSamples + 10);
+		u32 numSamples = module->ReadSamples(0, 0xFFFFFFFF, samples.data(), (u32)samples.size());
+		ASSERT_EQ(numSamples, numCommittedSamples);
+		for (u32 i = 0; i < numSamples; i++)
+		{
+			AssertSampleEqual(samples[i], CreateSample(i));
+		}
+
+		//Nothing is appended behind the torn block, logging continues on the next page
+		ASSERT_TRUE(module->headPageClosed);
+		ASSERT_TRUE(module->LogSample(CreateSample(numCommittedSamples + 5)));
+		ASSERT_TRUE(module->FlushPendingBlock());
+		ASSERT_EQ(module->headPage, (tornPage + 1) % RUUVI_LOG_NUM_PAGES);
+
+		numSamples = module->ReadSamples(0, 0xFFFFFFFF, samples.data(), (u32)samples.size());
+		ASSERT_EQ(numSamples, numCommittedSamples + 1);
+		AssertSampleEqual(samples[numCommittedSamples], CreateSample(numCommittedSamples + 5));
+	}
+
+	//The log is also intact after another reboot
+	tester.SendTerminalCommand(2, "reset");
+	tester.SimulateUntilMessageReceived(10 * 1000, 2, "\"type\":\"reboot\"");
+	tester.SimulateGivenNumberOfSteps(10);
+	tester.SendTerminalCommand(2, "action this ruuvilog info");
+	tester.SimulateUntilMessageReceived(10 * 1000, 2, "\"type\":\"ruuvi_log_info\",\"module\":%u,\"numPages\":2,", (u32)ModuleId::RUUVI_LOG_MODULE);
+}
+
+TEST(TestRuuviLogModule, TestQueryThroughput) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.terminalId = 0;
+	//testerConfig.verbose = true;
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1});
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1});
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
+
+	//Fill most of the log of the mesh node without wrapping around
+	constexpr u32 numLoggedSamples = 1500;
+	{
+		NodeIndexSetter setter(1);
+		RuuviLogModule* module = GetRuuviLogModule();
+		for (u32 i = 0; i < numLoggedSamples; i++)
+		{
+			ASSERT_TRUE(module->LogSample(CreateSample(i)));
+		}
+	}
+
+	tester.SendTerminalCommand(1, "action 2 ruuvilog query 0 4294967295 7");
+	std::vector<SimulationMessage> responses = {
+		SimulationMessage(1, "{\"nodeId\":2,\"type\":\"ruuvi_log_query_response\",\"module\":" + std::to_string((u32)ModuleId::RUUVI_LOG_MODULE) + ",\"result\":0,\"numSamples\":" + std::to_string(numLoggedSamples) + ","),
+	};
+	tester.SimulateUntilMessagesReceived(10 * 1000, responses);
+	const u32 startTimeMs = tester.sim->simState.simTimeMs;
+
+	std::vector<SimulationMessage> received = {
+		SimulationMessage(1, "{\"nodeId\":2,\"type\":\"ruuvi_log_received\""),
+	};
+	tester.SimulateUntilMessagesReceived(300 * 1000, received);
+	const u32 durationMs = tester.sim->simState.simTimeMs - startTimeMs;
+
+	//All samples arrived intact
+	auto j = json::parse(received[0].getCompleteMessage());
+	ASSERT_EQ(j["numSamples"].get<u32>(), numLoggedSamples);
+	ASSERT_EQ(j["minTimestamp"].get<u32>(), CreateSample(0).timestamp);
+	ASSERT_EQ(j["maxTimestamp"].get<u32>(), CreateSample(numLoggedSamples - 1).timestamp);
+	ASSERT_EQ(j["requestHandle"].get<u32>(), 7u);
+
+	//The stream timer fires every 100 ms and queues at least one chunk per tick, so the transfer
+	//must at least reach one full chunk per 100 ms including the final report
+	u32 chunkPayload = 0;
+	{
+		NodeIndexSetter setter(1);
+		chunkPayload = GetRuuviLogModule()->sender.chunkPayload;
+	}
+	const u32 numChunks = j["numChunks"].get<u32>();
+	ASSERT_GT(durationMs, 0u);
+	const u32 bytesPerSecond = numChunks * chunkPayload * 1000 / durationMs;
+	const u32 minBytesPerSecond = chunkPayload * 10;
+	if (testerConfig.verbose) printf("Transferred %u samples in %u chunks within %u ms (about %u bytes/s)" EOL, numLoggedSamples, numChunks, durationMs, bytesPerSecond);
+	ASSERT_GE(bytesPerSecond, minBytesPerSecond);
+
+	//A second query is accepted once the transfer is done
+	tester.SendTerminalCommand(1, "action 2 ruuvilog query 0 0 8");
+	tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"nodeId\":2,\"type\":\"ruuvi_log_query_response\",\"module\":%u,\"result\":1,", (u32)ModuleId::RUUVI_LOG_MODULE);
+}
+
+TEST(TestRuuviLogModule, TestRemoteCommands) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.terminalId = 0;
+	//testerConfig.verbose = true;
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1});
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1});
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
+
+	//The commands are executed by the addressed node and answered to the node that sent them
+	tester.SendTerminalCommand(1, "action 2 ruuvilog sample 2150 4600 101300 2950 3");
+	tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"nodeId\":2,\"type\":\"ruuvi_log_sample_response\",\"module\":%u,\"result\":0,\"requestHandle\":3}", (u32)ModuleId::RUUVI_LOG_MODULE);
+
+	tester.SendTerminalCommand(1, "action 2 ruuvilog info 4");
+	tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"nodeId\":2,\"type\":\"ruuvi_log_info\",\"module\":%u,\"numPages\":0,\"numBlocks\":0,\"numSamples\":0,\"pendingSamples\":1,", (u32)ModuleId::RUUVI_LOG_MODULE);
+
+	tester.SendTerminalCommand(1, "action 2 ruuvilog flush 5");
+	tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"nodeId\":2,\"type\":\"ruuvi_log_flush_response\",\"module\":%u,\"result\":0,\"requestHandle\":5}", (u32)ModuleId::RUUVI_LOG_MODULE);
+	tester.SimulateGivenNumberOfSteps(10);
+
+	tester.SendTerminalCommand(1, "action 2 ruuvilog info 6");
+	tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"nodeId\":2,\"type\":\"ruuvi_log_info\",\"module\":%u,\"numPages\":1,\"numBlocks\":1,\"numSamples\":1,\"pendingSamples\":0,", (u32)ModuleId::RUUVI_LOG_MODULE);
+
+	//Only the addressed node logged the sample
+	RuuviLogSample samples[2];
+	{
+		NodeIndexSetter setter(0);
+		ASSERT_EQ(GetRuuviLogModule()->ReadSamples(0, 0xFFFFFFFF, samples, 2), 0u);
+	}
+	{
+		NodeIndexSetter setter(1);
+		ASSERT_EQ(GetRuuviLogModule()->ReadSamples(0, 0xFFFFFFFF, samples, 2), 1u);
+		ASSERT_EQ(samples[0].temperature, 2150);
+		ASSERT_EQ(samples[0].humidity, 4600);
+		ASSERT_EQ(samples[0].pressure, 101300u);
+		ASSERT_EQ(samples[0].batteryMv, 2950);
+	}
+}
+
+TEST(TestRuuviLogModule, TestDisabledIfPagesAreNotFree) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.terminalId = 0;
+	//testerConfig.verbose = true;
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1});
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1});
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+	tester.SimulateGivenNumberOfSteps(10);
+
+	NodeIndexSetter setter(1);
+	RuuviLogModule* module = GetRuuviLogModule();
+
+	//The simulated flash layout leaves enough space for the application and a DFU image
+	ASSERT_TRUE(module->IsLogRegionFree());
+	ASSERT_TRUE(module->configurationPointer->moduleActive);
+	ASSERT_TRUE(module->logLoaded);
+
+	//An application that is so large that its DFU image would reach into the log pages disables the module.
+	//The linker variable is set again by the simulator once another node is simulated.
+	__application_end_address = module->GetPageAddress(0);
+	ASSERT_FALSE(module->IsLogRegionFree());
+	module->ConfigurationLoadedHandler(nullptr, 0);
+	ASSERT_FALSE(module->configurationPointer->moduleActive);
+	ASSERT_FALSE(module->LogSample(CreateSample(0)));
+
+	bool errorLogged = false;
+	for (u32 i = 0; i < GS->logger.errorLogPosition; i++)
+	{
+		if (GS->logger.errorLog[i].errorType == LoggingError::CUSTOM && GS->logger.errorLog[i].errorCode == (u32)CustomErrorTypes::FATAL_RUUVI_LOG_PAGES_NOT_AVAILABLE) errorLogged = true;
+	}
+	ASSERT_TRUE(errorLogged);
+}
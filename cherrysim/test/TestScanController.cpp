@@ -32,6 +32,7 @@
 #include <CherrySimUtils.h>
 #include <Node.h>
 #include <ScanController.h>
+#include <chrono>
 
 static int current_node_idx;
 
@@ -93,7 +94,7 @@ TEST(TestScanController, TestIfScannerGetsEnabled) {
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
 
-	tester.SimulateUntilClusteringDone(100 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
 
 	ScanJob job;
 	job.timeMode = ScanJobTimeMode::ENDLESS;
@@ -144,7 +145,7 @@ TEST(TestScanController, TestScannerChooseJobWithHighestDutyCycle) {
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
 
-	tester.SimulateUntilClusteringDone(100 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
 	ForceStopAllScanJobs(tester);
 
 	ScanJob job;
@@ -189,7 +190,7 @@ TEST(TestScanController, TestScannerWillStopOnceAllJobsTimeout) {
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
 
-	tester.SimulateUntilClusteringDone(100 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
 	ForceStopAllScanJobs(tester);
 
 	ScanJob job;
@@ -221,7 +222,7 @@ TEST(TestScanController, TestScannerWillStopOnceAllJobsAreDeleted) {
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
 
-	tester.SimulateUntilClusteringDone(100 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
 	ForceStopAllScanJobs(tester);
 
 	ScanJob job;
@@ -244,4 +245,135 @@ TEST(TestScanController, TestScannerWillStopOnceAllJobsAreDeleted) {
 	RemoveJob(p_job_2, tester);
 
 	simulateAndCheckScanning(1000, false, tester);
-}
\ No newline at end of file
+}
+
+static void CreateAssetAdvertisement(u8* data, u32 serialNumberIndex)
+{
+	CheckedMemset(data, 0, 31);
+	advPacketServiceAndDataHeader* header = (advPacketServiceAndDataHeader*)data;
+	header->flags.len = SIZEOF_ADV_STRUCTURE_FLAGS - 1;
+	header->flags.type = (u8)BleGapAdType::TYPE_FLAGS;
+	header->flags.flags = FH_BLE_GAP_ADV_FLAG_LE_GENERAL_DISC_MODE | FH_BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
+	header->uuid.len = SIZEOF_ADV_STRUCTURE_UUID16 - 1;
+	header->uuid.type = (u8)BleGapAdType::TYPE_16BIT_SERVICE_UUID_COMPLETE;
+	header->uuid.uuid = MESH_SERVICE_DATA_SERVICE_UUID16;
+
+	advPacketAssetServiceData* asset = (advPacketAssetServiceData*)&header->data;
+	asset->data.uuid.len = SIZEOF_ADV_STRUCTURE_ASSET_SERVICE_DATA - 1;
+	asset->data.uuid.type = (u8)BleGapAdType::TYPE_SERVICE_DATA;
+	asset->data.uuid.uuid = MESH_SERVICE_DATA_SERVICE_UUID16;
+	asset->data.messageType = ServiceDataMessageType::STANDARD_ASSET;
+	asset->serialNumberIndex = serialNumberIndex;
+}
+
+static void CreateJoinMeAdvertisement(u8* data, NodeId sender)
+{
+	CheckedMemset(data, 0, 31);
+	advPacketJoinMeV0* packet = (advPacketJoinMeV0*)data;
+	packet->header.flags.len = SIZEOF_ADV_STRUCTURE_FLAGS - 1;
+	packet->header.flags.type = (u8)BleGapAdType::TYPE_FLAGS;
+	packet->header.flags.flags = FH_BLE_GAP_ADV_FLAG_LE_GENERAL_DISC_MODE | FH_BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
+	packet->header.manufacturer.len = SIZEOF_ADV_PACKET_JOIN_ME - SIZEOF_ADV_STRUCTURE_FLAGS - 1;
+	packet->header.manufacturer.type = (u8)BleGapAdType::TYPE_MANUFACTURER_SPECIFIC_DATA;
+	packet->header.manufacturer.companyIdentifier = MESH_COMPANY_IDENTIFIER;
+	packet->header.meshIdentifier = MESH_IDENTIFIER;
+	packet->header.networkId = 123;
+	packet->header.messageType = ServiceDataMessageType::JOIN_ME_V0;
+	packet->payload.sender = sender;
+}
+
+static void CreateForeignBeaconAdvertisement(u8* data)
+{
+	//Flags followed by the manufacturer specific data of another vendor
+	const u8 beacon[] = { 0x02, 0x01, 0x06, 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15 };
+	CheckedMemset(data, 0, 31);
+	CheckedMemcpy(data, beacon, sizeof(beacon));
+}
+
+TEST(TestScanController, TestParseAdvertisement) {
+	u8 data[31];
+	std::array<AdvertisementKey, ScanController::MAX_ADVERTISEMENT_KEYS> keys;
+
+	CreateAssetAdvertisement(data, 1234);
+	ASSERT_EQ(ScanController::ParseAdvertisement(data, sizeof(data), keys.data(), keys.size()), 1);
+	ASSERT_EQ(keys[0].adType, BleGapAdType::TYPE_SERVICE_DATA);
+	ASSERT_EQ(keys[0].uuid, MESH_SERVICE_DATA_SERVICE_UUID16);
+	ASSERT_EQ(keys[0].messageType, ServiceDataMessageType::STANDARD_ASSET);
+
+	CreateJoinMeAdvertisement(data, 5);
+	ASSERT_EQ(ScanController::ParseAdvertisement(data, sizeof(data), keys.data(), keys.size()), 1);
+	ASSERT_EQ(keys[0].adType, BleGapAdType::TYPE_MANUFACTURER_SPECIFIC_DATA);
+	ASSERT_EQ(keys[0].uuid, MESH_COMPANY_IDENTIFIER);
+	ASSERT_EQ(keys[0].messageType, ServiceDataMessageType::JOIN_ME_V0);
+
+	//Other vendors data is keyed by its company identifier only
+	CreateForeignBeaconAdvertisement(data);
+	ASSERT_EQ(ScanController::ParseAdvertisement(data, sizeof(data), keys.data(), keys.size()), 1);
+	ASSERT_EQ(keys[0].adType, BleGapAdType::TYPE_MANUFACTURER_SPECIFIC_DATA);
+	ASSERT_EQ(keys[0].uuid, 0x004C);
+	ASSERT_EQ(keys[0].messageType, ServiceDataMessageType::INVALID);
+
+	//Zero padding after the last structure is valid
+	bool complete = false;
+	CreateAssetAdvertisement(data, 1234);
+	ASSERT_EQ(ScanController::ParseAdvertisement(data, sizeof(data), keys.data(), keys.size(), &complete), 1);
+	ASSERT_TRUE(complete);
+
+	//A structure that is longer than the advertisement must not be parsed and marks the advertisement as malformed
+	CreateAssetAdvertisement(data, 1234);
+	ASSERT_EQ(ScanController::ParseAdvertisement(data, sizeof(data) - 1, keys.data(), keys.size(), &complete), 0);
+	ASSERT_FALSE(complete);
+
+	//A zero length structure that is followed by more data is malformed as well
+	CreateAssetAdvertisement(data, 1234);
+	((advPacketServiceAndDataHeader*)data)->data.uuid.len = 0;
+	ASSERT_EQ(ScanController::ParseAdvertisement(data, sizeof(data), keys.data(), keys.size(), &complete), 0);
+	ASSERT_FALSE(complete);
+}
+
+TEST(TestScanController, BenchmarkAdvertisementDispatch_long) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.terminalId = -1;
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1});
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 9});
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+
+	tester.SimulateUntilClusteringDone(100 * 1000);
+
+	//All nodes scan continuously so that every broadcast is reported to every node
+	for (u32 i = 0; i < tester.sim->getTotalNodes(); i++)
+	{
+		NodeIndexSetter setter(i);
+		ScanJob job;
+		job.timeMode = ScanJobTimeMode::ENDLESS;
+		job.interval = MSEC_TO_UNITS(100, CONFIG_UNIT_0_625_MS);
+		job.window = MSEC_TO_UNITS(100, CONFIG_UNIT_0_625_MS);
+		job.state = ScanJobState::ACTIVE;
+		job.type = ScanState::CUSTOM;
+		GS->scanController.AddJob(job);
+	}
+	tester.SimulateGivenNumberOfSteps(10);
+
+	//A mix of asset tracking, mesh and foreign packets as seen by a gateway in an asset hall
+	constexpr u32 NUM_ADVERTISEMENTS = 4;
+	ble_gap_evt_adv_report_t advReports[NUM_ADVERTISEMENTS];
+	CheckedMemset(advReports, 0, sizeof(advReports));
+	CreateAssetAdvertisement(advReports[0].data, 1234);
+	CreateAssetAdvertisement(advReports[1].data, 5678);
+	CreateJoinMeAdvertisement(advReports[2].data, 1000);
+	CreateForeignBeaconAdvertisement(advReports[3].data);
+
+	constexpr u32 NUM_BROADCASTS = 100 * 1000;
+	constexpr u32 BROADCASTS_PER_STEP = 50;
+	const auto startTime = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < NUM_BROADCASTS; i++)
+	{
+		tester.SimulateBroadcastMessage(tester.sim->currentNode->x, tester.sim->currentNode->y, advReports[i % NUM_ADVERTISEMENTS], true);
+		if (i % BROADCASTS_PER_STEP == BROADCASTS_PER_STEP - 1) tester.SimulateGivenNumberOfSteps(1);
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	printf("Dispatched %.0f advertisement reports per second" EOL, NUM_BROADCASTS * tester.sim->getTotalNodes() / seconds);
+}
@@ -36,6 +36,34 @@
 #include "AssetModule.h"
 #endif //GITHUB_RELEASE
 #include "ScanningModule.h"
+#include <json.hpp>
+#include <set>
+#include <algorithm>
+
+using json = nlohmann::json;
+
+//Dispatches the advertisement of an asset to the current node
+static void DispatchAssetAdvertisement(u32 serialNumberIndex, NodeId nodeId, i8 rssi)
+{
+	alignas(ble_evt_t) u8 buffer[1024];
+	CheckedMemset(buffer, 0, sizeof(buffer));
+	ble_evt_t& evt = *(ble_evt_t*)buffer;
+	advPacketServiceAndDataHeader* packet = (advPacketServiceAndDataHeader*)evt.evt.gap_evt.params.adv_report.data;
+	advPacketAssetServiceData* assetPacket = (advPacketAssetServiceData*)&packet->data;
+	evt.header.evt_id = BLE_GAP_EVT_ADV_REPORT;
+	evt.evt.gap_evt.params.adv_report.dlen = SIZEOF_ADV_STRUCTURE_FLAGS + SIZEOF_ADV_STRUCTURE_UUID16 + SIZEOF_ADV_STRUCTURE_ASSET_SERVICE_DATA;
+	evt.evt.gap_evt.params.adv_report.rssi = rssi;
+	packet->flags.len = SIZEOF_ADV_STRUCTURE_FLAGS - 1;
+	packet->uuid.len = SIZEOF_ADV_STRUCTURE_UUID16 - 1;
+	packet->data.uuid.len = SIZEOF_ADV_STRUCTURE_ASSET_SERVICE_DATA - 1;
+	packet->data.uuid.type = (u8)BleGapAdType::TYPE_SERVICE_DATA;
+	packet->data.uuid.uuid = MESH_SERVICE_DATA_SERVICE_UUID16;
+	packet->data.messageType = ServiceDataMessageType::STANDARD_ASSET;
+	assetPacket->serialNumberIndex = serialNumberIndex;
+	assetPacket->nodeId = nodeId;
+
+	FruityHal::DispatchBleEvents(&evt);
+}
 
 TEST(TestScanningModule, TestCommands) {
 	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
@@ -49,7 +77,7 @@ TEST(TestScanningModule, TestCommands) {
 
 
 
-	tester.SimulateUntilClusteringDone(100 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
 
 	//Creates a asset ble event and later checks if this asset is now tracked by the scanning module.
 	alignas(ble_evt_t) u8 buffer[1024];
@@ -73,4 +101,114 @@ TEST(TestScanningModule, TestCommands) {
 	tester.SimulateGivenNumberOfSteps(1);
 
 	//jstodo This test currently doesn't do much. Investigate if it is still needed.
-}
\ No newline at end of file
+}
+
+TEST(TestScanningModule, TestStrongestAssetsAreReported) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.terminalId = 0;
+	//testerConfig.verbose = true;
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1});
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1});
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
+
+	//The mesh node scans many more assets than it can track between two reports
+	constexpr u32 numAssets = 250;
+	std::vector<u32> rssis;
+	{
+		NodeIndexSetter setter(1);
+		ScanningModule* scanningModule = (ScanningModule*)GS->node.GetModuleById(ModuleId::SCANNING_MODULE);
+		ASSERT_TRUE(scanningModule != nullptr);
+		scanningModule->assetReportingIntervalDs = 100;
+		scanningModule->ConfigurationLoadedHandler(nullptr, 0);
+
+		for (u32 i = 1; i <= numAssets; i++)
+		{
+			const u32 rssi = 10 + (i * 37) % 80;
+			rssis.push_back(rssi);
+			DispatchAssetAdvertisement(i, 0, -(i8)rssi);
+		}
+	}
+	std::sort(rssis.begin(), rssis.end());
+	const u32 weakestReportedRssi = rssis[ASSET_PACKET_BUFFER_SIZE - 1];
+
+	//The tracked assets do not fit into a single message
+	std::vector<SimulationMessage> messages = {
+		SimulationMessage(1, "{\"nodeId\":2,\"type\":\"tracked_assets\",\"assets\":["),
+		SimulationMessage(1, "{\"nodeId\":2,\"type\":\"tracked_assets\",\"assets\":["),
+	};
+	tester.SimulateUntilMessagesReceived(30 * 1000, messages);
+
+	//Only the strongest assets are reported and the strongest ones are sent first
+	std::set<u32> reportedIds;
+	i32 previousRssi = 0;
+	for (const SimulationMessage& message : messages)
+	{
+		auto j = json::parse(message.getCompleteMessage());
+		for (const auto& asset : j["assets"])
+		{
+			const u32 id = asset["id"].get<u32>();
+			const i32 rssi = asset["rssi1"].get<i32>();
+			ASSERT_TRUE(id >= 1 && id <= numAssets);
+			ASSERT_EQ(rssi, (i32)(10 + (id * 37) % 80));
+			ASSERT_TRUE(rssi <= (i32)weakestReportedRssi);
+			ASSERT_TRUE(rssi >= previousRssi);
+			previousRssi = rssi;
+			reportedIds.insert(id);
+		}
+	}
+	ASSERT_EQ(reportedIds.size(), (size_t)ASSET_PACKET_BUFFER_SIZE);
+}
+
+TEST(TestScanningModule, TestMalformedAdvertisementIsDelivered) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.terminalId = 0;
+	//testerConfig.verbose = true;
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1});
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1});
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
+
+	//Some assets send their service data with a wrong structure length. The ScanningModule only subscribed to
+	//the asset service data, but it must still receive these reports as it checks the layout on its own.
+	alignas(ble_evt_t) u8 buffer[1024];
+	CheckedMemset(buffer, 0, sizeof(buffer));
+	ble_evt_t& evt = *(ble_evt_t*)buffer;
+	advPacketServiceAndDataHeader* packet = (advPacketServiceAndDataHeader*)evt.evt.gap_evt.params.adv_report.data;
+	advPacketAssetServiceData* assetPacket = (advPacketAssetServiceData*)&packet->data;
+	evt.header.evt_id = BLE_GAP_EVT_ADV_REPORT;
+	evt.evt.gap_evt.params.adv_report.dlen = SIZEOF_ADV_STRUCTURE_FLAGS + SIZEOF_ADV_STRUCTURE_UUID16 + SIZEOF_ADV_STRUCTURE_ASSET_SERVICE_DATA;
+	evt.evt.gap_evt.params.adv_report.rssi = -45;
+	packet->flags.len = SIZEOF_ADV_STRUCTURE_FLAGS - 1;
+	packet->uuid.len = SIZEOF_ADV_STRUCTURE_UUID16 - 1;
+	packet->data.uuid.len = 0xFF;
+	packet->data.uuid.type = (u8)BleGapAdType::TYPE_SERVICE_DATA;
+	packet->data.uuid.uuid = MESH_SERVICE_DATA_SERVICE_UUID16;
+	packet->data.messageType = ServiceDataMessageType::STANDARD_ASSET;
+	assetPacket->serialNumberIndex = 10;
+
+	{
+		NodeIndexSetter setter(1);
+		ScanningModule* scanningModule = (ScanningModule*)GS->node.GetModuleById(ModuleId::SCANNING_MODULE);
+		ASSERT_TRUE(scanningModule != nullptr);
+		scanningModule->assetReportingIntervalDs = 100;
+		scanningModule->ConfigurationLoadedHandler(nullptr, 0);
+
+		FruityHal::DispatchBleEvents(&evt);
+	}
+
+	std::vector<SimulationMessage> messages = {
+		SimulationMessage(1, "{\"nodeId\":2,\"type\":\"tracked_assets\",\"assets\":["),
+	};
+	tester.SimulateUntilMessagesReceived(30 * 1000, messages);
+
+	auto j = json::parse(messages[0].getCompleteMessage());
+	ASSERT_EQ(j["assets"].size(), (size_t)1);
+	ASSERT_EQ(j["assets"][0]["id"].get<u32>(), (u32)10);
+}
@@ -28,6 +28,7 @@
 // ****************************************************************************/
 ////////////////////////////////////////////////////////////////////////////////
 #include "gtest/gtest.h"
+#include <algorithm>
 #include <CherrySimTester.h>
 #include <CherrySimUtils.h>
 #include <Node.h>
@@ -70,6 +71,291 @@ TEST(TestStatistics, TestNumberClusteringMessagesSent) {
 	checkStatEmpty(stat);
 }
 
+//Sums up how often module action requests and responses were sent by all nodes
+static u32 countActionPacketsSent(CherrySimTester& tester)
+{
+	u32 count = 0;
+	for (u32 i = 0; i < tester.sim->getTotalNodes(); i++) {
+		for (u32 j = 0; j < PACKET_STAT_SIZE; j++) {
+			const PacketStat& entry = tester.sim->nodes[i].routedPackets[j];
+			if (entry.messageType == MessageType::MODULE_TRIGGER_ACTION || entry.messageType == MessageType::MODULE_ACTION_RESPONSE) {
+				count += entry.count;
+			}
+		}
+	}
+	return count;
+}
+
+//Builds a line or a 10x10 grid of 100 nodes in which only direct neighbours are able to connect
+//and returns the number of packets that are sent while node 1 queries the status of some other nodes
+static u32 countUnicastPacketsInTopology(bool grid, bool enableUnicastRouteLearning)
+{
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	const u32 numNodes = 100;
+	const u32 gridWidth = grid ? 10 : numNodes;
+
+	simConfig.enableSimStatistics = true;
+	for (u32 i = 0; i < numNodes; i++) {
+		simConfig.preDefinedPositions.push_back({ 0.05 + 0.9 * (i % gridWidth) / gridWidth, 0.05 + 0.09 * (i / gridWidth) });
+	}
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", numNodes });
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+
+	for (u32 i = 0; i < numNodes; i++) {
+		tester.sim->nodes[i].gs.config.enableUnicastRouteLearning = enableUnicastRouteLearning;
+		for (u32 k = 0; k < numNodes; k++) {
+			u32 distance = (u32)std::abs((i32)(i % gridWidth) - (i32)(k % gridWidth)) + (u32)std::abs((i32)(i / gridWidth) - (i32)(k / gridWidth));
+			if (distance > 1) tester.sim->nodes[i].impossibleConnection.push_back(k);
+		}
+	}
+
+	tester.SimulateUntilClusteringDone(1000 * 1000);
+
+	const u32 packetsBefore = countActionPacketsSent(tester);
+
+	//Each node is queried twice, the first request is flooded until the route is known
+	const NodeId receivers[] = { 10, 45, 78, 100 };
+	for (u32 round = 0; round < 2; round++) {
+		for (NodeId receiver : receivers) {
+			char expectedMessage[100];
+			snprintf(expectedMessage, sizeof(expectedMessage), "{\"nodeId\":%u,\"type\":\"status\",\"module\":3", receiver);
+			tester.SendTerminalCommand(1, "action %u status get_status", receiver);
+			tester.SimulateUntilMessageReceived(30 * 1000, 1, expectedMessage);
+		}
+	}
+
+	return countActionPacketsSent(tester) - packetsBefore;
+}
+
+//Unicast packets should only travel along the learned route instead of being flooded through the cluster
+TEST(TestStatistics, TestUnicastRouteLearningInLine_long) {
+	const u32 floodedPackets = countUnicastPacketsInTopology(false, false);
+	const u32 routedPackets = countUnicastPacketsInTopology(false, true);
+
+	printf("Unicast packets in line: %u flooded, %u with route learning" EOL, floodedPackets, routedPackets);
+	ASSERT_LT(routedPackets, floodedPackets);
+}
+
+TEST(TestStatistics, TestUnicastRouteLearningInGrid_long) {
+	const u32 floodedPackets = countUnicastPacketsInTopology(true, false);
+	const u32 routedPackets = countUnicastPacketsInTopology(true, true);
+
+	printf("Unicast packets in grid: %u flooded, %u with route learning" EOL, floodedPackets, routedPackets);
+	ASSERT_LT(routedPackets, floodedPackets);
+}
+
+//Builds a line of nodes with the sink at one end, lets the node at the other end send small packets to the sink
+//faster than they can be transmitted and returns the number of packets per second that reached the sink
+static u32 measureSinkThroughputInLine(bool enablePacketAggregation)
+{
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	const u32 numNodes = 5;
+	const u32 measurementTimeSec = 30;
+
+	simConfig.enableSimStatistics = true;
+	for (u32 i = 0; i < numNodes; i++) {
+		simConfig.preDefinedPositions.push_back({ 0.1 + 0.8 * i / numNodes, 0.5 });
+	}
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", numNodes - 1 });
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+
+	for (u32 i = 0; i < numNodes; i++) {
+		tester.sim->nodes[i].gs.config.enablePacketAggregation = enablePacketAggregation;
+		for (u32 k = 0; k < numNodes; k++) {
+			if ((u32)std::abs((i32)i - (i32)k) > 1) tester.sim->nodes[i].impossibleConnection.push_back(k);
+		}
+	}
+
+	tester.SimulateUntilClusteringDone(100 * 1000);
+
+	PacketStat* sinkLinkStat = tester.sim->nodes[1].routedPackets;
+	clearStat(sinkLinkStat);
+
+	for (u32 time = 0; time < measurementTimeSec * 1000; time += 100) {
+		{
+			NodeIndexSetter setter(numNodes - 1);
+			for (u32 i = 0; i < 20; i++) {
+				connPacketData1 data;
+				CheckedMemset(&data, 0x00, sizeof(data));
+				data.header.messageType = MessageType::DATA_1;
+				data.header.sender = GS->node.configuration.nodeId;
+				data.header.receiver = 1;
+				data.payload.length = 2;
+				data.payload.data[0] = (u8)i;
+				GS->cm.SendMeshMessage((u8*)&data, SIZEOF_CONN_PACKET_HEADER + 3, DeliveryPriority::LOW);
+			}
+		}
+		tester.SimulateForGivenTime(100);
+	}
+
+	u32 packetsToSink = 0;
+	for (u32 i = 0; i < PACKET_STAT_SIZE; i++) {
+		if (sinkLinkStat[i].messageType == MessageType::DATA_1) packetsToSink += sinkLinkStat[i].count;
+	}
+
+	return packetsToSink / measurementTimeSec;
+}
+
+//Packing small packets into a single write must increase the throughput of a saturated chain towards the sink
+TEST(TestStatistics, TestPacketAggregationThroughputInLine) {
+	const u32 packetsPerSecondWithoutAggregation = measureSinkThroughputInLine(false);
+	const u32 packetsPerSecondWithAggregation = measureSinkThroughputInLine(true);
+
+	printf("Packets per second to the sink: %u without aggregation, %u with aggregation" EOL, packetsPerSecondWithoutAggregation, packetsPerSecondWithAggregation);
+	ASSERT_GT(packetsPerSecondWithoutAggregation, 0);
+	ASSERT_GT(packetsPerSecondWithAggregation, packetsPerSecondWithoutAggregation);
+}
+
+struct SinkLatencyResult
+{
+	u32 numSent = 0;
+	u32 numReceived = 0;
+	u32 p50Ms = 0;
+	u32 p90Ms = 0;
+	u32 p99Ms = 0;
+};
+
+//Records the time at which each probe packet was first seen in a write towards the sink
+static void recordProbeArrivals(const u8* message, u16 messageLength, NodeId probeSender, u32 timeMs, std::vector<i32>& arrivalTimesMs)
+{
+	if (messageLength == 0) return;
+
+	//Probes might have been packed into a single write together with other packets
+	if ((MessageType)message[0] == MessageType::AGGREGATED_WRITE_CMD) {
+		for (u16 i = SIZEOF_CONN_PACKET_AGGREGATION_HEADER; i + 1 < messageLength; i += 1 + message[i]) {
+			recordProbeArrivals(message + i + 1, message[i], probeSender, timeMs, arrivalTimesMs);
+		}
+		return;
+	}
+
+	if (messageLength < SIZEOF_CONN_PACKET_HEADER + 3) return;
+	const connPacketData1* data = (const connPacketData1*)message;
+	if (data->header.messageType != MessageType::DATA_1 || data->header.sender != probeSender) return;
+
+	const u16 sequenceNumber = data->payload.data[0] | (data->payload.data[1] << 8);
+	if (sequenceNumber < arrivalTimesMs.size() && arrivalTimesMs[sequenceNumber] < 0) arrivalTimesMs[sequenceNumber] = (i32)timeMs;
+}
+
+//Sends probe packets from the end of a line towards the sink while a node in the middle floods the mesh
+//with low priority broadcasts and returns the latency percentiles of the probes
+static SinkLatencyResult measureSinkLatencyUnderMixedLoad(bool enableTxScheduler, u32 seed)
+{
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.seed = seed;
+	const u32 numNodes = 5;
+	const u32 loadNodeIndex = 2;
+	const u32 measurementTimeSec = 30;
+
+	for (u32 i = 0; i < numNodes; i++) {
+		simConfig.preDefinedPositions.push_back({ 0.1 + 0.8 * i / numNodes, 0.5 });
+	}
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", numNodes - 1 });
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+
+	for (u32 i = 0; i < numNodes; i++) {
+		tester.sim->nodes[i].gs.config.enableTxScheduler = enableTxScheduler;
+		for (u32 k = 0; k < numNodes; k++) {
+			if ((u32)std::abs((i32)i - (i32)k) > 1) tester.sim->nodes[i].impossibleConnection.push_back(k);
+		}
+	}
+
+	tester.SimulateUntilClusteringDone(100 * 1000);
+
+	const NodeId probeSender = tester.sim->nodes[numNodes - 1].gs.node.configuration.nodeId;
+	std::vector<i32> sendTimesMs;
+	std::vector<i32> arrivalTimesMs;
+
+	const u32 endTimeMs = tester.sim->simState.simTimeMs + measurementTimeSec * 1000;
+	u32 nextLoadTimeMs = tester.sim->simState.simTimeMs;
+	while (tester.sim->simState.simTimeMs < endTimeMs) {
+		if (tester.sim->simState.simTimeMs >= nextLoadTimeMs) {
+			nextLoadTimeMs += 100;
+			{
+				NodeIndexSetter setter(loadNodeIndex);
+				for (u32 i = 0; i < 5; i++) {
+					connPacketData1 data;
+					CheckedMemset(&data, 0x00, sizeof(data));
+					data.header.messageType = MessageType::DATA_1;
+					data.header.sender = GS->node.configuration.nodeId;
+					data.header.receiver = NODE_ID_BROADCAST;
+					data.payload.length = 2;
+					GS->cm.SendMeshMessage((u8*)&data, SIZEOF_CONN_PACKET_HEADER + 3, DeliveryPriority::LOWEST);
+				}
+			}
+			{
+				NodeIndexSetter setter(numNodes - 1);
+				const u16 sequenceNumber = (u16)sendTimesMs.size();
+				connPacketData1 data;
+				CheckedMemset(&data, 0x00, sizeof(data));
+				data.header.messageType = MessageType::DATA_1;
+				data.header.sender = GS->node.configuration.nodeId;
+				data.header.receiver = 1;
+				data.payload.length = 2;
+				data.payload.data[0] = (u8)(sequenceNumber & 0xFF);
+				data.payload.data[1] = (u8)(sequenceNumber >> 8);
+				GS->cm.SendMeshMessage((u8*)&data, SIZEOF_CONN_PACKET_HEADER + 3, DeliveryPriority::MEDIUM);
+				sendTimesMs.push_back((i32)tester.sim->simState.simTimeMs);
+				arrivalTimesMs.push_back(-1);
+			}
+		}
+
+		tester.sim->SimulateStepForAllNodes();
+
+		//The sink is simulated first, so all writes that it received during this step are still in its event queue
+		for (const simBleEvent& event : tester.sim->nodes[0].eventQueue) {
+			if (event.bleEvent.header.evt_id != BLE_GATTS_EVT_WRITE) continue;
+			const ble_gatts_evt_write_t& write = event.bleEvent.evt.gatts_evt.params.write;
+			recordProbeArrivals(write.data, write.len, probeSender, tester.sim->simState.simTimeMs, arrivalTimesMs);
+		}
+	}
+
+	std::vector<u32> latenciesMs;
+	for (size_t i = 0; i < sendTimesMs.size(); i++) {
+		if (arrivalTimesMs[i] >= 0) latenciesMs.push_back((u32)(arrivalTimesMs[i] - sendTimesMs[i]));
+	}
+	std::sort(latenciesMs.begin(), latenciesMs.end());
+
+	SinkLatencyResult result;
+	result.numSent = (u32)sendTimesMs.size();
+	result.numReceived = (u32)latenciesMs.size();
+	if (!latenciesMs.empty()) {
+		result.p50Ms = latenciesMs[(latenciesMs.size() - 1) * 50 / 100];
+		result.p90Ms = latenciesMs[(latenciesMs.size() - 1) * 90 / 100];
+		result.p99Ms = latenciesMs[(latenciesMs.size() - 1) * 99 / 100];
+	}
+	return result;
+}
+
+//Packets towards the sink must still arrive in time if low priority traffic competes for the same connections
+TEST(TestStatistics, TestTxSchedulerSinkLatencyUnderMixedLoad) {
+	//Both runs use the same seed so that they only differ in the tx scheduler
+	const u32 seed = 1;
+	const SinkLatencyResult withoutScheduler = measureSinkLatencyUnderMixedLoad(false, seed);
+	const SinkLatencyResult withScheduler = measureSinkLatencyUnderMixedLoad(true, seed);
+
+	printf("Sink latency without tx scheduler: %u/%u received, p50 %ums, p90 %ums, p99 %ums" EOL,
+		withoutScheduler.numReceived, withoutScheduler.numSent, withoutScheduler.p50Ms, withoutScheduler.p90Ms, withoutScheduler.p99Ms);
+	printf("Sink latency with tx scheduler: %u/%u received, p50 %ums, p90 %ums, p99 %ums" EOL,
+		withScheduler.numReceived, withScheduler.numSent, withScheduler.p50Ms, withScheduler.p90Ms, withScheduler.p99Ms);
+
+	ASSERT_GT(withScheduler.numReceived, withScheduler.numSent / 2);
+	ASSERT_GT(withoutScheduler.numReceived, 0u);
+	ASSERT_LT(withScheduler.p99Ms, 10 * 1000u);
+
+	//The probes no longer wait behind the broadcasts in the same queue, so the tail latency
+	//must drop by at least a quarter compared to the shared fifo queue
+	ASSERT_LE(withScheduler.p90Ms * 4, withoutScheduler.p90Ms * 3);
+	ASSERT_LE(withScheduler.p99Ms * 4, withoutScheduler.p99Ms * 3);
+}
+
 //#################################### Helpers for Statistic Tests #######################################
 
 //Helper function that checks a given message type for a maximum count and clears it if it was ok
@@ -32,6 +32,7 @@
 #include "CherrySimTester.h"
 #include "CherrySimUtils.h"
 #include "Logger.h"
+#include "PooledPacketQueue.h"
 #include <json.hpp>
 
 using json = nlohmann::json;
@@ -47,7 +48,7 @@ TEST(TestStatusReporterModule, TestCommands) {
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
 
-	tester.SimulateUntilClusteringDone(100 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
 
 	tester.sim->findNodeById(1)->gs.logger.enableTag("DEBUGMOD");
 	tester.sim->findNodeById(2)->gs.logger.enableTag("DEBUGMOD");
@@ -81,6 +82,52 @@ TEST(TestStatusReporterModule, TestCommands) {
 	tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"type\":\"reboot_reason\",\"nodeId\":2,\"module\":3,");
 }
 
+TEST(TestStatusReporterModule, TestPacketPoolHighWaterMark) {
+	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+	simConfig.terminalId = 0;
+	//testerConfig.verbose = true;
+
+	simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1});
+	simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1});
+	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+	tester.Start();
+
+	tester.SimulateUntilClusteringDoneWithSnapshot(100 * 1000);
+
+	auto getReportedHighWaterMark = [&]() {
+		tester.SendTerminalCommand(1, "action 2 status get_status");
+		std::vector<SimulationMessage> messages = {
+			SimulationMessage(1, "{\"nodeId\":2,\"type\":\"status\",\"module\":3"),
+		};
+		tester.SimulateUntilMessagesReceived(10 * 1000, messages);
+		return json::parse(messages[0].getCompleteMessage())["poolHighWaterMark"].get<u32>();
+	};
+
+	//Take all blocks of the pool that are not reserved for other queues
+	u32 filledHighWaterMark = 0;
+	{
+		NodeIndexSetter setter(1);
+		PooledPacketQueue queue(GS->packetPool, 0, PacketPool::NUM_BLOCKS);
+		while (queue.Reserve(PacketPool::BLOCK_SIZE - 4) != nullptr);
+		ASSERT_GT(queue.GetNumBlocks(), 0);
+		filledHighWaterMark = GS->packetPool.GetHighWaterMark();
+		ASSERT_GE(filledHighWaterMark, (u32)queue.GetNumBlocks());
+		queue.Clean();
+	}
+
+	//Requesting the status or the errors does not reset the mark
+	ASSERT_GE(getReportedHighWaterMark(), filledHighWaterMark);
+	tester.SendTerminalCommand(1, "action 2 status get_errors");
+	tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"type\":\"error_log_entry\",\"nodeId\":2,\"module\":3,");
+	ASSERT_GE(getReportedHighWaterMark(), filledHighWaterMark);
+
+	//Only the explicit reset starts a new measurement
+	tester.SendTerminalCommand(1, "action 2 status reset_pool_hwm");
+	tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"type\":\"reset_pool_hwm_result\",\"nodeId\":2,\"module\":3}");
+	ASSERT_LT(getReportedHighWaterMark(), filledHighWaterMark);
+}
+
 TEST(TestStatusReporterModule, TestPeriodicTimeSend) {
 	CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
 	SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
@@ -92,7 +139,7 @@ TEST(TestStatusReporterModule, TestPeriodicTimeSend) {
 	CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
 	tester.Start();
 
-	tester.SimulateUntilClusteringDone(10 * 1000);
+	tester.SimulateUntilClusteringDoneWithSnapshot(10 * 1000);
 	tester.sim->findNodeById(2)->gs.logger.enableTag("STATUSMOD");
 
 	//Send a write command
@@ -32,6 +32,8 @@
 #include "CherrySimTester.h"
 #include "CherrySimUtils.h"
 #include <set>
+#include <chrono>
+#include <vector>
 
 TEST(TestUtility, TestGetIndexForSerial) {
 	//The original serial number range had 5 characters
@@ -192,6 +194,54 @@ TEST(TestUtility, TestCRC) {
 	ASSERT_EQ(Utility::CalculateCrc32((u8*)data, len), 1322553117);
 }
 
+//The bitwise crc32 that was used before the table driven implementation
+static u32 CalculateCrc32Bitwise(const u8* message, const u32 messageLength, u32 previousCrc = 0) {
+	u32 crc = ~previousCrc;
+	for (u32 i = 0; i < messageLength; i++) {
+		crc = crc ^ message[i];
+		for (u32 j = 0; j < 8; j++) {
+			u32 mask = -(crc & 1);
+			crc = (crc >> 1) ^ (0xEDB88320 & mask);
+		}
+	}
+	return ~crc;
+}
+
+TEST(TestUtility, TestCRC32MatchesBitwise) {
+	std::vector<u8> data(1024);
+	for (size_t i = 0; i < data.size(); i++) data[i] = (u8)Utility::GetRandomInteger();
+
+	//Check all lengths and alignments that are handled differently by the sliced implementation
+	for (u32 offset = 0; offset < 8; offset++) {
+		for (u32 length = 0; length < 100; length++) {
+			const u32 previousCrc = Utility::GetRandomInteger();
+			ASSERT_EQ(Utility::CalculateCrc32(data.data() + offset, length, previousCrc), CalculateCrc32Bitwise(data.data() + offset, length, previousCrc));
+		}
+	}
+	ASSERT_EQ(Utility::CalculateCrc32(data.data(), data.size()), CalculateCrc32Bitwise(data.data(), data.size()));
+}
+
+TEST(TestUtility, TestCRC32Performance) {
+	std::vector<u8> data(64 * 1024);
+	for (size_t i = 0; i < data.size(); i++) data[i] = (u8)Utility::GetRandomInteger();
+	constexpr u32 iterations = 50;
+
+	u32 crcBitwise = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < iterations; i++) crcBitwise = CalculateCrc32Bitwise(data.data(), data.size(), crcBitwise);
+	const double bitwiseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	u32 crcTable = 0;
+	start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < iterations; i++) crcTable = Utility::CalculateCrc32(data.data(), data.size(), crcTable);
+	const double tableSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	ASSERT_EQ(crcTable, crcBitwise);
+
+	const double megabytes = data.size() * iterations / (1024.0 * 1024.0);
+	printf("CRC32 bitwise: %.1f MB/s, table driven: %.1f MB/s" EOL, megabytes / bitwiseSeconds, megabytes / tableSeconds);
+}
+
 TEST(TestUtility, TestFindLast) {
 	char data[] = "This string has many sheeps! The reason for this is that sheeps are cool. sheeps? sheeps! And apples.";
 	ASSERT_STREQ(Utility::FindLast(data, "sheep"), "sheeps! And apples.");
@@ -235,6 +285,28 @@ TEST(TestUtility, TestAes128BlockEncrypt) {
 	ASSERT_EQ(encrypted.data[15], 0xC6);
 }
 
+TEST(TestUtility, TestAes128PreparedKeyEncrypt) {
+	Aes128Block key;
+	Aes128Block msgBlocks[3];
+	for (u32 i = 0; i < sizeof(key.data); i++) key.data[i] = (u8)Utility::GetRandomInteger();
+	for (u32 i = 0; i < sizeof(msgBlocks); i++) ((u8*)msgBlocks)[i] = (u8)Utility::GetRandomInteger();
+
+	Aes128KeyContext keyContext;
+	Utility::Aes128PrepareKey(&key, &keyContext);
+
+	//The prepared key must produce the same result as encrypting each block with the plain key
+	Aes128Block expected[3];
+	for (u32 i = 0; i < 3; i++) Utility::Aes128BlockEncrypt(&msgBlocks[i], &key, &expected[i]);
+
+	Aes128Block encrypted;
+	Utility::Aes128BlockEncrypt(&msgBlocks[1], keyContext, &encrypted);
+	ASSERT_EQ(memcmp(encrypted.data, expected[1].data, sizeof(encrypted.data)), 0);
+
+	Aes128Block encryptedBlocks[3];
+	Utility::Aes128BlocksEncrypt(msgBlocks, keyContext, encryptedBlocks, 3);
+	ASSERT_EQ(memcmp(encryptedBlocks, expected, sizeof(expected)), 0);
+}
+
 TEST(TestUtility, TestXorWords) {
 	u32 src1[]    = {  100,  1000, 100000, 324543, 23491291, 20, 1 };
 	u32 src2[]    = { 2919, 13282,     10,  10492,    12245, 20, 2 };
@@ -29379,14 +29379,22 @@ define("test/tests/mesh/testSimulatorMap", ["require", "exports", "src/app/relut
         startUpdatingDeviceModels(fruityMap, serverUrl, intervalDurationMs);
     }
     function startUpdatingDeviceModels(fruityMap, serverUrl, intervalDurationMs) {
-        let lastDevicesObject = "";
+        //The server only sends the devices that changed since the version we already have
+        let devicesByUuid = new Map();
+        let devicesVersion = 0;
         setInterval(function () {
-            HttpUtils_5.HttpUtils.getJson(serverUrl + "/devices", function (resultObject) {
+            HttpUtils_5.HttpUtils.getJson(serverUrl + "/devices?since=" + devicesVersion, function (resultObject) {
                 if (resultObject["status"] === "success") {
-                    let devicesObject = resultObject.result;
-                    let stringifiedDevicesObject = JSON.stringify(devicesObject);
-                    if (stringifiedDevicesObject !== lastDevicesObject) {
-                        lastDevicesObject = stringifiedDevicesObject;
+                    let changedDevices = resultObject.result;
+                    if (resultObject.full) {
+                        devicesByUuid.clear();
+                    }
+                    devicesVersion = resultObject.version;
+                    if (resultObject.full || changedDevices.length > 0) {
+                        for (let device of changedDevices) {
+                            devicesByUuid.set(device.uuid, device);
+                        }
+                        let devicesObject = Array.from(devicesByUuid.values());
                         let deviceModels = RelutionMapModelLoader_5.RelutionMapModelLoader.loadModels(devicesObject, DeviceModel_9.DeviceModel, false);
                         fruityMap.getBuilding().getCurrentFloor().updateDevices(deviceModels);
                     }
@@ -112,10 +112,16 @@ typedef struct BoardConfiguration
 #endif //__cplusplus
 
 //Can be used to make the boardconfig available to C
+//In the simulator, every thread points to the board of the node that it booted last
+#ifdef SIM_ENABLED
+#define FM_BOARD_CONFIG_PTR_STORAGE SIM_THREAD_LOCAL
+#else
+#define FM_BOARD_CONFIG_PTR_STORAGE
+#endif
 #ifdef __cplusplus
-extern void* fmBoardConfigPtr;
+extern FM_BOARD_CONFIG_PTR_STORAGE void* fmBoardConfigPtr;
 #else
-extern struct BoardConfiguration* fmBoardConfigPtr;
+extern FM_BOARD_CONFIG_PTR_STORAGE struct BoardConfiguration* fmBoardConfigPtr;
 #endif
 
 #endif //BOARDCONFIG_H
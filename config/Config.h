@@ -117,6 +117,17 @@ static_assert(false, "Featureset was not defined, which is mandatory!");
 #define STABLE_CONNECTION_RSSI_THRESHOLD -85
 #endif
 
+// The send queues of all connections are served with a deficit round robin scheduler. Per round, each queue
+// may transmit this number of bytes multiplied with the weight of the priority of its next packet
+#ifndef TX_SCHEDULER_QUANTUM
+#define TX_SCHEDULER_QUANTUM 20
+#endif
+
+// Scheduler weights for each DeliveryPriority, from MESH_INTERNAL_HIGH to LOWEST
+#ifndef TX_SCHEDULER_WEIGHTS
+#define TX_SCHEDULER_WEIGHTS { 8, 4, 2, 1 }
+#endif
+
 // ########### Ram Buffer Settings ##########################################
 // These settings affect the ram or usage a lot
 
@@ -125,16 +136,38 @@ static_assert(false, "Featureset was not defined, which is mandatory!");
 #define MAX_MESH_PACKET_SIZE 200
 #endif
 
-// Each of the connections has a buffer for outgoing packets, this is its size in bytes
+// The outgoing packets of all connections are stored in a node wide packet pool, this is the share of each connection in bytes
 #ifndef PACKET_SEND_BUFFER_SIZE
 #define PACKET_SEND_BUFFER_SIZE 2000
 #endif
 
-// Each connection also has a high prio buffer e.g. for mesh clustering packets
+// Each connection also has a high prio queue e.g. for mesh clustering packets, this is its share of the pool in bytes.
+// The high prio queue always has a single block of the pool reserved
 #ifndef PACKET_SEND_BUFFER_HIGH_PRIO_SIZE
 #define PACKET_SEND_BUFFER_HIGH_PRIO_SIZE 100
 #endif
 
+// The packet pool is split into blocks of this size, a block must be able to hold a packet of MAX_MESH_PACKET_SIZE
+// together with its 4 byte length field and 6 byte send metadata
+#ifndef PACKET_POOL_BLOCK_SIZE
+#define PACKET_POOL_BLOCK_SIZE ((MAX_MESH_PACKET_SIZE + 10 + 3) / 4 * 4)
+#endif
+
+// The pool has the same size as the buffers of all connection slots (including the resolver connection) together
+#ifndef PACKET_POOL_NUM_BLOCKS
+#define PACKET_POOL_NUM_BLOCKS ((TOTAL_NUM_CONNECTIONS + 1) * (PACKET_SEND_BUFFER_SIZE + PACKET_SEND_BUFFER_HIGH_PRIO_SIZE) / PACKET_POOL_BLOCK_SIZE)
+#endif
+
+// Each normal prio send queue always gets this number of blocks, no matter how many blocks other queues use
+#ifndef PACKET_POOL_MIN_BLOCKS_PER_QUEUE
+#define PACKET_POOL_MIN_BLOCKS_PER_QUEUE 2
+#endif
+
+// A single congested connection can not use more than this number of blocks for its normal prio queue
+#ifndef PACKET_POOL_MAX_BLOCKS_PER_QUEUE
+#define PACKET_POOL_MAX_BLOCKS_PER_QUEUE (PACKET_POOL_NUM_BLOCKS / 2)
+#endif
+
 // Each connection does also have a buffer to assemble packets that were split into 20 byte chunks
 // This is the maximum size that these packets can have
 #ifndef PACKET_REASSEMBLY_BUFFER_SIZE
@@ -162,12 +195,27 @@ static_assert(false, "Featureset was not defined, which is mandatory!");
 #define ADVERTISING_CONTROLLER_MAX_NUM_JOBS 4
 #endif
 
+// Number of assets that the ScanningModule tracks between two asset reports. Once full,
+// the asset with the weakest rssi is replaced if a stronger asset is scanned
+#ifndef ASSET_PACKET_BUFFER_SIZE
+#define ASSET_PACKET_BUFFER_SIZE 30
+#endif
+
+#ifndef ASSET_INS_PACKET_BUFFER_SIZE
+#define ASSET_INS_PACKET_BUFFER_SIZE 30
+#endif
+
 // ########### Flash Settings ##########################################
 // Number of pages used to store records, at least 2 are required for swapping
 #ifndef RECORD_STORAGE_NUM_PAGES
 #define RECORD_STORAGE_NUM_PAGES 2
 #endif
 
+// Number of pages that the RuuviLogModule uses as a ring log for sensor samples, they are placed directly below the record storage
+#ifndef RUUVI_LOG_NUM_PAGES
+#define RUUVI_LOG_NUM_PAGES 4
+#endif
+
 // ########### General ##########################################
 // GAP device name (Not used by the mesh)
 #ifndef DEVICE_NAME
@@ -421,6 +469,14 @@ class Conf
 		TerminalMode terminalMode : 8;
 
 		bool enableSinkRouting = false;
+		//Unicast packets are only sent over the connection that the receiver was last heard of instead of being flooded
+		bool enableUnicastRouteLearning = false;
+		//Multiple small packets are packed into a single write on mesh connections if the partner supports it as well
+		bool enablePacketAggregation = false;
+		//The send queues of all connections share the softdevice in a weighted round robin instead of being filled in array order
+		bool enableTxScheduler = false;
+		//Weights of the tx scheduler, indexed by DeliveryPriority
+		u8 txSchedulerWeights[4] = TX_SCHEDULER_WEIGHTS;
 		// ########### TIMINGS ################################################
 
 		//Mesh connection parameters (used when a connection is set up)
@@ -500,11 +556,11 @@ class Conf
 
 // Linker variables
 #if defined(SIM_ENABLED)
-	extern u32 __application_start_address;
-	extern u32 __application_end_address;
-	extern u32 __application_ram_start_address;
-	extern u32 __start_conn_type_resolvers;
-	extern u32 __stop_conn_type_resolvers;
+	extern SIM_THREAD_LOCAL u32 __application_start_address;
+	extern SIM_THREAD_LOCAL u32 __application_end_address;
+	extern SIM_THREAD_LOCAL u32 __application_ram_start_address;
+	extern SIM_THREAD_LOCAL u32 __start_conn_type_resolvers;
+	extern SIM_THREAD_LOCAL u32 __stop_conn_type_resolvers;
 #else
 	extern u32 __application_start_address[]; //Variable is set in the linker script
 	extern u32 __application_end_address[]; //Variable is set in the linker script
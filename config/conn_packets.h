@@ -56,6 +56,7 @@ enum class MessageType : u8
 	INVALID = 0,
 	SPLIT_WRITE_CMD = 16, //Used if a WRITE_CMD message is split
 	SPLIT_WRITE_CMD_END = 17, //Used if a WRITE_CMD message is split
+	AGGREGATED_WRITE_CMD = 18, //Used if multiple small WRITE_CMD messages are packed into one write
 
 	//Mesh clustering and handshake: Protocol defined
 	CLUSTER_WELCOME = 20, //The initial message after a connection setup (Sent between two nodes)
@@ -150,9 +151,24 @@ typedef struct
 }connPacketSplitHeader;
 STATIC_ASSERT_SIZE(connPacketSplitHeader, SIZEOF_CONN_PACKET_SPLIT_HEADER);
 
+//Used if multiple messages are packed into a single write, the header is followed
+//by a length byte and the data of each message
+//First byte must be identical in with connPacketHeader
+constexpr size_t SIZEOF_CONN_PACKET_AGGREGATION_HEADER = 1;
+typedef struct
+{
+	MessageType aggregationMessageType;
+}connPacketAggregationHeader;
+STATIC_ASSERT_SIZE(connPacketAggregationHeader, SIZEOF_CONN_PACKET_AGGREGATION_HEADER);
+
+//Optional features of a mesh connection that are exchanged during the handshake
+//and that are only used if both partners support them
+constexpr u8 MESH_FEATURE_PACKET_AGGREGATION = 0x01;
+
 //CLUSTER_WELCOME
 constexpr size_t SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_WELCOME = 11;
 constexpr size_t SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_WELCOME_WITH_NETWORK_ID = 13;
+constexpr size_t SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_WELCOME_WITH_FEATURES = 14;
 typedef struct
 {
 	ClusterId clusterId;
@@ -161,35 +177,40 @@ typedef struct
 	ClusterSize hopsToSink;
 	u8 preferredConnectionInterval;
 	NetworkId networkId;
+	u8 meshFeatures;
 }connPacketPayloadClusterWelcome;
-STATIC_ASSERT_SIZE(connPacketPayloadClusterWelcome, SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_WELCOME_WITH_NETWORK_ID);
+STATIC_ASSERT_SIZE(connPacketPayloadClusterWelcome, SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_WELCOME_WITH_FEATURES);
 
 constexpr size_t SIZEOF_CONN_PACKET_CLUSTER_WELCOME = (SIZEOF_CONN_PACKET_HEADER + SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_WELCOME);
 constexpr size_t SIZEOF_CONN_PACKET_CLUSTER_WELCOME_WITH_NETWORK_ID = (SIZEOF_CONN_PACKET_HEADER + SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_WELCOME_WITH_NETWORK_ID);
+constexpr size_t SIZEOF_CONN_PACKET_CLUSTER_WELCOME_WITH_FEATURES = (SIZEOF_CONN_PACKET_HEADER + SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_WELCOME_WITH_FEATURES);
 typedef struct
 {
 	connPacketHeader header;
 	connPacketPayloadClusterWelcome payload;
 }connPacketClusterWelcome;
-STATIC_ASSERT_SIZE(connPacketClusterWelcome, SIZEOF_CONN_PACKET_CLUSTER_WELCOME_WITH_NETWORK_ID);
+STATIC_ASSERT_SIZE(connPacketClusterWelcome, SIZEOF_CONN_PACKET_CLUSTER_WELCOME_WITH_FEATURES);
 
 
 //CLUSTER_ACK_1
 constexpr size_t SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_ACK_1 = 3;
+constexpr size_t SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_ACK_1_WITH_FEATURES = 4;
 typedef struct
 {
 	ClusterSize hopsToSink;
 	u8 preferredConnectionInterval;
+	u8 meshFeatures;
 }connPacketPayloadClusterAck1;
-STATIC_ASSERT_SIZE(connPacketPayloadClusterAck1, SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_ACK_1);
+STATIC_ASSERT_SIZE(connPacketPayloadClusterAck1, SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_ACK_1_WITH_FEATURES);
 
 constexpr size_t SIZEOF_CONN_PACKET_CLUSTER_ACK_1 = (SIZEOF_CONN_PACKET_HEADER + SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_ACK_1);
+constexpr size_t SIZEOF_CONN_PACKET_CLUSTER_ACK_1_WITH_FEATURES = (SIZEOF_CONN_PACKET_HEADER + SIZEOF_CONN_PACKET_PAYLOAD_CLUSTER_ACK_1_WITH_FEATURES);
 typedef struct
 {
 	connPacketHeader header;
 	connPacketPayloadClusterAck1 payload;
 }connPacketClusterAck1;
-STATIC_ASSERT_SIZE(connPacketClusterAck1, SIZEOF_CONN_PACKET_CLUSTER_ACK_1);
+STATIC_ASSERT_SIZE(connPacketClusterAck1, SIZEOF_CONN_PACKET_CLUSTER_ACK_1_WITH_FEATURES);
 
 
 //CLUSTER_ACK_2
@@ -38,7 +38,7 @@ extern void setBoard_4(BoardConfiguration* c);
 extern void setBoard_18(BoardConfiguration* c);
 extern void setBoard_19(BoardConfiguration* c);
 
-void* fmBoardConfigPtr;
+FM_BOARD_CONFIG_PTR_STORAGE void* fmBoardConfigPtr;
 
 Boardconf::Boardconf()
 {
@@ -118,6 +118,9 @@ void Conf::LoadDefaults(){
 	defaultLedMode = LedMode::CONNECTIONS;
 
 	enableSinkRouting = true;
+	enableUnicastRouteLearning = true;
+	enablePacketAggregation = true;
+	enableTxScheduler = true;
 	//Check if the BLE stack supports the number of connections and correct if not
 #ifdef SIM_ENABLED
 	totalInConnections = 3;
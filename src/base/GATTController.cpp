@@ -77,9 +77,12 @@ ErrorType GATTController::bleWriteCharacteristic(u16 connectionHandle, u16 chara
 {
 	logt("CONN_DATA", "TX Data size is: %d, handles(%d, %d), reliable %d", dataLength, connectionHandle, characteristicHandle, reliable);
 
-	char stringBuffer[100];
-	Logger::convertBufferToHexString(data, dataLength, stringBuffer, sizeof(stringBuffer));
-	logt("CONN_DATA", "%s", stringBuffer);
+	if (LOGT_ACTIVE("CONN_DATA"))
+	{
+		char stringBuffer[100];
+		Logger::convertBufferToHexString(data, dataLength, stringBuffer, sizeof(stringBuffer));
+		logt("CONN_DATA", "%s", stringBuffer);
+	}
 
 
 	//Configure the write parameters with reliable/unreliable, writehandle, etc...
@@ -109,9 +112,12 @@ ErrorType GATTController::bleSendNotification(u16 connectionHandle, u16 characte
 {
 	logt("CONN_DATA", "hvx Data size is: %d, handles(%d, %d)", dataLength, connectionHandle, characteristicHandle);
 
-	char stringBuffer[100];
-	Logger::convertBufferToHexString(data, dataLength, stringBuffer, sizeof(stringBuffer));
-	logt("CONN_DATA", "%s", stringBuffer);
+	if (LOGT_ACTIVE("CONN_DATA"))
+	{
+		char stringBuffer[100];
+		Logger::convertBufferToHexString(data, dataLength, stringBuffer, sizeof(stringBuffer));
+		logt("CONN_DATA", "%s", stringBuffer);
+	}
 
 
 	FruityHal::BleGattWriteParams notificationParams;
@@ -34,6 +34,7 @@
 #include <array>
 #include "FruityHal.h"
 #include "TimeManager.h"
+#include "TimerWheel.h"
 #include "AdvertisingController.h"
 #include "ScanController.h"
 #include "GAPController.h"
@@ -102,6 +103,9 @@ class GlobalState
 
 		TimeManager timeManager;
 
+		//Calls modules once their deadlines are reached so that they do not have to check them on every tick
+		TimerWheel timerWheel;
+
 		u32 amountOfRemovedConnections = 0;
 
 		//########## Singletons ###############
@@ -115,6 +119,7 @@ class GlobalState
 		Node node;
 		Conf config;
 		Boardconf boardconf;
+		PacketPool packetPool;
 		ConnectionManager cm;
 		Logger logger;
 		Terminal terminal;
@@ -33,6 +33,7 @@
 #include <Logger.h>
 #include <Config.h>
 #include <GlobalState.h>
+#include <Module.h>
 #include "Utility.h"
 
 
@@ -45,6 +46,7 @@
 ScanController::ScanController()
 {
 	CheckedMemset(&currentScanParams, 0, sizeof(currentScanParams));
+	subscriptionBuckets.fill(INVALID_SUBSCRIPTION);
 }
 
 void ScanController::TimerEventHandler(u16 passedTimeDs)
@@ -231,5 +233,159 @@ bool ScanController::ScanEventHandler(const FruityHal::GapAdvertisementReportEve
 	return true;
 }
 
+bool ScanController::SubscribeToAdvertisements(Module* module, BleGapAdType adType, u16 uuid, ServiceDataMessageType messageType)
+{
+	const AdvertisementKey key = { adType, uuid, messageType };
+	const u8 bucket = GetAdvertisementBucket(key);
+
+	for (u8 index = subscriptionBuckets[bucket]; index != INVALID_SUBSCRIPTION; index = subscriptions[index].next)
+	{
+		const AdvertisementSubscription& subscription = subscriptions[index];
+		if (subscription.module == module
+			&& subscription.key.adType == adType
+			&& subscription.key.uuid == uuid
+			&& subscription.key.messageType == messageType)
+		{
+			return true;
+		}
+	}
+
+	if (numSubscriptions >= subscriptions.size())
+	{
+		logt("ERROR", "No free advertisement subscription");
+		SIMEXCEPTION(BufferTooSmallException);
+		GS->logger.logCustomError(CustomErrorTypes::FATAL_FAILED_TO_SUBSCRIBE_ADVERTISEMENT, (u32)module->moduleId);
+		return false;
+	}
+
+	AdvertisementSubscription& subscription = subscriptions[numSubscriptions];
+	subscription.module = module;
+	subscription.key = key;
+	subscription.next = subscriptionBuckets[bucket];
+	subscriptionBuckets[bucket] = numSubscriptions;
+	numSubscriptions++;
+
+	module->receivesAllAdvertisements = false;
+
+	return true;
+}
+
+u8 ScanController::GetAdvertisementBucket(const AdvertisementKey& key)
+{
+	//The message types and the low byte of the uuid are what differs between the keys that are used
+	return ((u8)key.adType ^ (u8)key.uuid ^ (u8)(key.uuid >> 8) ^ ((u8)key.messageType * 3)) % NUM_ADVERTISEMENT_BUCKETS;
+}
+
+u8 ScanController::ParseAdvertisement(const u8* data, u32 dataLength, AdvertisementKey* keys, u8 maxKeys, bool* outComplete)
+{
+	u8 numKeys = 0;
+	bool complete = true;
+
+	//Each AD structure starts with its length, followed by the AD type and length - 1 bytes of data
+	u32 offset = 0;
+	while (offset + 1 < dataLength)
+	{
+		const u8* structure = data + offset;
+		const u8 length = structure[0];
+		//A zero length terminates the advertisement early, which is only valid if just the padding follows
+		if (length == 0)
+		{
+			for (u32 i = offset; i < dataLength; i++)
+			{
+				if (data[i] != 0) complete = false;
+			}
+			break;
+		}
+		if (offset + 1 + length > dataLength)
+		{
+			complete = false;
+			break;
+		}
+		offset += 1 + length;
+
+		const BleGapAdType adType = (BleGapAdType)structure[1];
+		if ((adType != BleGapAdType::TYPE_SERVICE_DATA && adType != BleGapAdType::TYPE_MANUFACTURER_SPECIFIC_DATA) || length < 3)
+		{
+			continue;
+		}
+		if (numKeys >= maxKeys)
+		{
+			complete = false;
+			break;
+		}
+
+		AdvertisementKey& key = keys[numKeys];
+		numKeys++;
+		key.adType = adType;
+		key.uuid = (u16)(structure[2] | (structure[3] << 8));
+		key.messageType = ServiceDataMessageType::INVALID;
+
+		//Our service data has the messageType directly after the service UUID
+		if (adType == BleGapAdType::TYPE_SERVICE_DATA
+			&& key.uuid == MESH_SERVICE_DATA_SERVICE_UUID16
+			&& length >= 4)
+		{
+			key.messageType = (ServiceDataMessageType)structure[4];
+		}
+		//Mesh advertising messages have the meshIdentifier and networkId before the messageType
+		else if (adType == BleGapAdType::TYPE_MANUFACTURER_SPECIFIC_DATA
+			&& key.uuid == MESH_COMPANY_IDENTIFIER
+			&& length >= 7
+			&& structure[4] == MESH_IDENTIFIER)
+		{
+			key.messageType = (ServiceDataMessageType)structure[7];
+		}
+	}
+
+	if (outComplete != nullptr) *outComplete = complete;
+	return numKeys;
+}
+
+bool ScanController::IsSubscribedToAdvertisement(const Module* module, const AdvertisementKey* keys, u8 numKeys) const
+{
+	for (u8 i = 0; i < numKeys; i++)
+	{
+		const AdvertisementKey& key = keys[i];
+		for (u8 index = subscriptionBuckets[GetAdvertisementBucket(key)]; index != INVALID_SUBSCRIPTION; index = subscriptions[index].next)
+		{
+			const AdvertisementSubscription& subscription = subscriptions[index];
+			if (subscription.module == module
+				&& subscription.key.adType == key.adType
+				&& subscription.key.uuid == key.uuid
+				&& subscription.key.messageType == key.messageType)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void ScanController::DispatchAdvertisement(const FruityHal::GapAdvertisementReportEvent& advertisementReportEvent) const
+{
+	std::array<AdvertisementKey, MAX_ADVERTISEMENT_KEYS> keys;
+	u8 numKeys = 0;
+	bool complete = true;
+	if (numSubscriptions > 0)
+	{
+		numKeys = ParseAdvertisement(advertisementReportEvent.getData(), advertisementReportEvent.getDataLength(), keys.data(), keys.size(), &complete);
+	}
+
+	//The modules are called in the same order as before the subscriptions existed. If the advertisement could
+	//not be parsed completely, the subscribed modules receive it as well and do their own length checks.
+	for (u32 i = 0; i < GS->amountOfModules; i++)
+	{
+		Module* module = GS->activeModules[i];
+		if (!module->configurationPointer->moduleActive) continue;
+
+		if (module->receivesAllAdvertisements
+			|| !complete
+			|| IsSubscribedToAdvertisement(module, keys.data(), numKeys))
+		{
+			module->GapAdvertisementReportEventHandler(advertisementReportEvent);
+		}
+	}
+}
+
 
 //EOF
@@ -54,6 +54,16 @@ typedef struct ScanJob
 	ScanState		type;
 }ScanJob;
 
+class Module;
+
+//The part of an advertisement under which modules can subscribe to it
+typedef struct AdvertisementKey
+{
+	BleGapAdType adType;
+	u16 uuid; //The 16 bit service UUID for service data or the company identifier for manufacturer specific data
+	ServiceDataMessageType messageType; //Only set for our own service data and mesh advertising messages, INVALID otherwise
+}AdvertisementKey;
+
 /*
  * The ScanController wraps SoftDevice calls around scanning/observing and
  * provides an interface to control this behaviour.
@@ -66,6 +76,23 @@ private:
 	bool scanStateOk = true;
 	std::array<ScanJob, 4> jobs{};
 
+	//Subscriptions are chained in a small hash table so that an advertisement is only given to the modules that want it
+	static constexpr u8 MAX_ADVERTISEMENT_SUBSCRIPTIONS = 16;
+	static constexpr u8 NUM_ADVERTISEMENT_BUCKETS = 8;
+	static constexpr u8 INVALID_SUBSCRIPTION = 0xFF;
+	struct AdvertisementSubscription
+	{
+		Module* module;
+		AdvertisementKey key;
+		u8 next;
+	};
+	std::array<AdvertisementSubscription, MAX_ADVERTISEMENT_SUBSCRIPTIONS> subscriptions{};
+	std::array<u8, NUM_ADVERTISEMENT_BUCKETS> subscriptionBuckets;
+	u8 numSubscriptions = 0;
+
+	static u8 GetAdvertisementBucket(const AdvertisementKey& key);
+	bool IsSubscribedToAdvertisement(const Module* module, const AdvertisementKey* keys, u8 numKeys) const;
+
 	void TryConfiguringScanState();
 
 public:
@@ -84,6 +111,17 @@ public:
 
 	bool ScanEventHandler(const FruityHal::GapAdvertisementReportEvent& advertisementReportEvent) const;
 
+	//A module that subscribes to at least one key will only receive the advertisements that match one of its keys
+	//instead of all advertisements. Use ServiceDataMessageType::INVALID to subscribe to structures of other vendors.
+	bool SubscribeToAdvertisements(Module* module, BleGapAdType adType, u16 uuid, ServiceDataMessageType messageType);
+	//Calls the GapAdvertisementReportEventHandler of all active modules in module order, skipping
+	//subscribed modules if none of their keys is part of a completely parsed advertisement
+	void DispatchAdvertisement(const FruityHal::GapAdvertisementReportEvent& advertisementReportEvent) const;
+	//Parses the service data and manufacturer specific data structures of an advertisement into keys, returns the number of keys
+	//outComplete is set to false if a structure was malformed or truncated or if not all keys fit into keys
+	static u8 ParseAdvertisement(const u8* data, u32 dataLength, AdvertisementKey* keys, u8 maxKeys, bool* outComplete = nullptr);
+	static constexpr u8 MAX_ADVERTISEMENT_KEYS = 4;
+
 	//Must be called if scanning was stopped by any external procedure
 	void ScanningHasStopped();
 
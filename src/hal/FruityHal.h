@@ -413,6 +413,19 @@ namespace FruityHal
 	void DelayUs(u32 delayMicroSeconds);
 	void DelayMs(u32 delayMs);
 	void EcbEncryptBlock(const u8 * p_key, const u8 * p_clearText, u8 * p_cipherText);
+	//A key that is prepared once and then used for multiple encryptions
+	struct EcbKeyContext
+	{
+#ifdef SIM_ENABLED
+		//The simulator encrypts in software and stores the expanded round keys
+		u8 roundKeys[176];
+#else
+		u8 key[16];
+#endif
+	};
+	void EcbPrepareKey(const u8 * p_key, EcbKeyContext* p_context);
+	//Encrypts numBlocks consecutive blocks of 16 bytes each
+	void EcbEncryptBlocks(const EcbKeyContext& context, const u8 * p_clearText, u8 * p_cipherText, u32 numBlocks);
 	u8 ConvertPortToGpio(u8 port, u8 pin);
 
 	// ######################### FLASH ############################
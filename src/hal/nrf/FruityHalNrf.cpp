@@ -2205,6 +2205,33 @@ void FruityHal::EcbEncryptBlock(const u8 * p_key, const u8 * p_clearText, u8 * p
 	CheckedMemcpy(p_cipherText, ecbData.ciphertext, SOC_ECB_CIPHERTEXT_LENGTH);
 }
 
+void FruityHal::EcbPrepareKey(const u8 * p_key, EcbKeyContext* p_context)
+{
+#ifdef SIM_ENABLED
+	sim_ecb_expand_key(p_key, p_context->roundKeys);
+#else
+	CheckedMemcpy(p_context->key, p_key, SOC_ECB_KEY_LENGTH);
+#endif
+}
+
+void FruityHal::EcbEncryptBlocks(const EcbKeyContext& context, const u8 * p_clearText, u8 * p_cipherText, u32 numBlocks)
+{
+#ifdef SIM_ENABLED
+	sim_ecb_encrypt_blocks(context.roundKeys, p_clearText, p_cipherText, numBlocks);
+#else
+	//The key is only copied once, the peripheral still has to be started for each block
+	nrf_ecb_hal_data_t ecbData;
+	CheckedMemcpy(ecbData.key, context.key, SOC_ECB_KEY_LENGTH);
+	for (u32 i = 0; i < numBlocks; i++)
+	{
+		CheckedMemcpy(ecbData.cleartext, p_clearText + i * SOC_ECB_CLEARTEXT_LENGTH, SOC_ECB_CLEARTEXT_LENGTH);
+		//Only returns NRF_SUCCESS
+		sd_ecb_block_encrypt(&ecbData);
+		CheckedMemcpy(p_cipherText + i * SOC_ECB_CIPHERTEXT_LENGTH, ecbData.ciphertext, SOC_ECB_CIPHERTEXT_LENGTH);
+	}
+#endif
+}
+
 ErrorType FruityHal::FlashPageErase(u32 page)
 {
 	return nrfErrToGeneric(sd_flash_page_erase(page));
@@ -187,6 +187,8 @@ void FruityHal::ActivateBootloaderOnReset(){ }
 void FruityHal::DelayUs(u32 delayMicroSeconds){ }
 void FruityHal::DelayMs(u32 delayMs){ }
 void FruityHal::EcbEncryptBlock(const u8 * p_key, const u8 * p_clearText, u8 * p_cipherText){ }
+void FruityHal::EcbPrepareKey(const u8 * p_key, EcbKeyContext* p_context){ }
+void FruityHal::EcbEncryptBlocks(const EcbKeyContext& context, const u8 * p_clearText, u8 * p_cipherText, u32 numBlocks){ }
 u8 FruityHal::ConvertPortToGpio(u8 port, u8 pin){ return 0; }
 
 // ######################### FLASH ############################
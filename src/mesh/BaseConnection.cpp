@@ -47,8 +47,10 @@ BaseConnection::BaseConnection(u8 id, ConnectionDirection direction, FruityHal::
 	: connectionId(id),
 	uniqueConnectionId(GS->cm.GenerateUniqueConnectionId()),
 	direction(direction),
-	packetSendQueue(packetSendBuffer, PACKET_SEND_BUFFER_SIZE),
-	packetSendQueueHighPrio(packetSendBufferHighPrio, PACKET_SEND_BUFFER_HIGH_PRIO_SIZE),
+	packetSendQueue(GS->packetPool, PACKET_POOL_MIN_BLOCKS_PER_QUEUE, PACKET_POOL_MAX_BLOCKS_PER_QUEUE),
+	packetSendQueueHighPrio(GS->packetPool, 1, 1),
+	packetSendQueueLowPrio(GS->packetPool, 0, PACKET_POOL_MAX_BLOCKS_PER_QUEUE),
+	packetSendQueueLowestPrio(GS->packetPool, 0, PACKET_POOL_MAX_BLOCKS_PER_QUEUE),
 	partnerAddress(*partnerAddress),
 	creationTimeDs(GS->appTimerDs)
 {
@@ -114,15 +116,18 @@ bool BaseConnection::QueueData(const BaseConnectionSendData &sendData, u8 const
 
 	//Select the correct packet Queue
 	//TODO: currently we only allow non-split data for high prio
-	PacketQueue* activeQueue;
+	PooledPacketQueue* activeQueue;
 
 	if(sendData.priority == DeliveryPriority::MESH_INTERNAL_HIGH && sendData.dataLength <= connectionMtu)
 	{
 		logt("CM", "Queuing in high prio queue");
 		activeQueue = &packetSendQueueHighPrio;
-	} else {
+	} else if(sendData.priority == DeliveryPriority::MESH_INTERNAL_HIGH) {
 		logt("CM", "Queuing in normal prio queue");
 		activeQueue = &packetSendQueue;
+	} else {
+		logt("CM", "Queuing in queue of priority %u", (u32)sendData.priority);
+		activeQueue = &GetQueueForPriority(sendData.priority);
 	}
 
 	buffer = activeQueue->Reserve(SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + sendData.dataLength);
@@ -160,137 +165,268 @@ bool BaseConnection::QueueData(const BaseConnectionSendData &sendData, u8 const
 
 void BaseConnection::FillTransmitBuffers()
 {
-	ErrorType err = ErrorType::SUCCESS;
-
 	if (bufferFull) return;
 
-	DYNAMIC_ARRAY(packetBuffer, connectionMtu);
-	BaseConnectionSendData sendDataStruct;
-	BaseConnectionSendData* sendData = &sendDataStruct;
+	//With the tx scheduler, the queues of all priorities share the softdevice buffers according to their weights
+	if (GS->config.enableTxScheduler) {
+		while (FillTransmitBuffersScheduled());
+		return;
+	}
 
-	while(isConnected() && connectionState != ConnectionState::REESTABLISHING && connectionState != ConnectionState::REESTABLISHING_HANDSHAKE)
+	while(CanTransmit())
 	{
 		//Check if there is important data from the subclass to be sent
-		if(packetSendQueue.packetSendPosition == 0){
+		if(GetSplittingQueue() == nullptr){
 			TransmitHighPrioData();
 		}
 
 		//Next, select the correct Queue from which we should be transmitting
 		//TODO: Currently we do not allow message splitting in HighPrio Queue
-		PacketQueue* activeQueue;
-		if(packetSendQueueHighPrio.numUnsentElements > 0 && packetSendQueue.packetSendPosition == 0){
+		//The low prio queues only hold packets that were queued while the tx scheduler was enabled
+		PooledPacketQueue* activeQueue;
+		if(IsQueueReadyToTransmit(packetSendQueueHighPrio)){
 			//logt("CONN", "Queuing from high prio queue");
 			activeQueue = &packetSendQueueHighPrio;
-		} else if(packetSendQueue.numUnsentElements > 0){
+		} else if(IsQueueReadyToTransmit(packetSendQueue)){
 			//logt("CONN", "Queuing from normal prio queue");
 			activeQueue = &packetSendQueue;
+		} else if(IsQueueReadyToTransmit(packetSendQueueLowPrio)){
+			activeQueue = &packetSendQueueLowPrio;
+		} else if(IsQueueReadyToTransmit(packetSendQueueLowestPrio)){
+			activeQueue = &packetSendQueueLowestPrio;
 		} else {
 			return;
 		}
 
-		if (activeQueue->_numElements < activeQueue->numUnsentElements) {
-			logt("ERROR", "Fail: Queue numElements");
-			SIMEXCEPTION(IllegalStateException);
-			GS->logger.logCustomError(CustomErrorTypes::FATAL_QUEUE_NUM_MISMATCH, (u16)(activeQueue == &packetSendQueue));
+		if (TransmitNextPacket(*activeQueue) == 0) return;
+	}
+}
 
-			GS->cm.ForceDisconnectAllConnections(AppDisconnectReason::QUEUE_NUM_MISMATCH);
-			return;
-		}
+bool BaseConnection::FillTransmitBuffersScheduled()
+{
+	if (bufferFull || !CanTransmit()) return false;
 
-		//Get the next packet from the packet queue that was not yet queued
-		SizedData packet = activeQueue->PeekNext(activeQueue->_numElements - activeQueue->numUnsentElements);
+	//Check if there is important data from the subclass to be sent
+	if (GetSplittingQueue() == nullptr) {
+		TransmitHighPrioData();
+	}
 
-		//Unpack data from sendQueue
-		BaseConnectionSendDataPacked* sendDataPacked = (BaseConnectionSendDataPacked*)packet.data;
-		sendData->characteristicHandle = sendDataPacked->characteristicHandle;
-		sendData->deliveryOption = (DeliveryOption)sendDataPacked->deliveryOption;
-		sendData->priority = (DeliveryPriority)sendDataPacked->priority;
-		sendData->dataLength = sendDataPacked->dataLength;
-		u8* data = (packet.data + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
-
-		//Check if this packet must be split, if yes make sure that there is no other split packet currently queued, we only allow one split
-		//packet to be queued at one time (after one was queued, the packetSendPosition is reset to 0, as long as there are packetSentRemaining
-		//we have not received acknowledgements for all parts
-		if (packet.length > connectionPayloadSize && activeQueue->packetSendPosition == 0 && activeQueue->packetSentRemaining != 0) {
-			return;
-		}
+	bool transmitted = false;
+	for (u8 priority = 0; priority < (u8)DeliveryPriority::INVALID; priority++) {
+		if (!TransmitScheduled((DeliveryPriority)priority, &transmitted)) return false;
+	}
 
-		//The subclass is allowed to modify the packet before it is sent, it will place the modified packet into the sentData struct
-		//This could be e.g. only a part of the original packet ( a split packet )
-		SizedData sentData = ProcessDataBeforeTransmission(sendData, data, packetBuffer);
+	return transmitted;
+}
 
-		if(sentData.length == 0){
-			logt("ERROR", "Packet processing failed");
-			GS->logger.logCustomError(CustomErrorTypes::FATAL_PACKET_PROCESSING_FAILED, partnerId);
-			DisconnectAndRemove(AppDisconnectReason::INVALID_PACKET);
-			return;
-		}
+bool BaseConnection::TransmitScheduled(DeliveryPriority priority, bool* transmitted)
+{
+	PooledPacketQueue& queue = priority == DeliveryPriority::MESH_INTERNAL_HIGH ? packetSendQueueHighPrio : GetQueueForPriority(priority);
+	i16& deficit = txDeficits[(u8)priority];
 
-		//Send the packet to the SoftDevice
-		if(sendData->deliveryOption == DeliveryOption::WRITE_REQ)
-		{
-			err = GS->gattController.bleWriteCharacteristic(
-					connectionHandle,
-					sendData->characteristicHandle,
-					sentData.data,
-					sentData.length,
-					true);
-		}
-		else if(sendData->deliveryOption == DeliveryOption::WRITE_CMD)
-		{
-			err = GS->gattController.bleWriteCharacteristic(
-					connectionHandle,
-					sendData->characteristicHandle,
-					sentData.data,
-					sentData.length,
-					false);
-		}
-		else
-		{
-			err = GS->gattController.bleSendNotification(
-					connectionHandle,
-					sendData->characteristicHandle,
-					sentData.data,
-					sentData.length);
-		}
+	//An idle queue must not save up a deficit for later bursts
+	if (queue.numUnsentElements == 0) {
+		deficit = 0;
+		return true;
+	}
 
-		if(err == ErrorType::SUCCESS)
-		{
-			//FIXME: This is not using the preprocessed data (sentData)
-			PacketSuccessfullyQueuedWithSoftdevice(activeQueue, sendDataPacked, data, &sentData);
-		}
-		else if(err == ErrorType::BUSY)
+	//A blocked queue, e.g. one waiting for its split packet to be acknowledged, is skipped
+	//so that it does not hold back the other queues and it does not get a quantum for this round
+	if (!IsQueueReadyToTransmit(queue)) return true;
+
+	deficit += GetTxSchedulerQuantum(priority);
+
+	while (deficit > 0 && IsQueueReadyToTransmit(queue)) {
+		const u16 sentLength = TransmitNextPacket(queue);
+		//The connection might have been removed, so we must not access it anymore
+		if (sentLength == 0) return false;
+
+		deficit -= sentLength;
+		*transmitted = true;
+	}
+
+	if (queue.numUnsentElements == 0) deficit = 0;
+
+	return true;
+}
+
+bool BaseConnection::CanTransmit() const
+{
+	return isConnected() && connectionState != ConnectionState::REESTABLISHING && connectionState != ConnectionState::REESTABLISHING_HANDSHAKE;
+}
+
+bool BaseConnection::IsQueueReadyToTransmit(const PooledPacketQueue& queue) const
+{
+	if (queue.numUnsentElements == 0) return false;
+
+	//All parts of a split packet must be queued before another queue may transmit, otherwise we would not be
+	//able to tell from which queue a sent packet was once it is acknowledged and the partner could not reassemble it
+	const PooledPacketQueue* splittingQueue = GetSplittingQueue();
+	if (splittingQueue != nullptr && splittingQueue != &queue) return false;
+
+	if (&queue == &packetSendQueueHighPrio) return true;
+
+	//Inconsistent queues are handled once we try to transmit from them
+	if (queue._numElements < queue.numUnsentElements) return true;
+
+	//Check if this packet must be split, if yes make sure that there is no other split packet currently queued, we only allow one split
+	//packet to be queued at one time (after one was queued, the packetSendPosition is reset to 0, as long as there are packetSentRemaining
+	//we have not received acknowledgements for all parts
+	if (queue.packetSendPosition == 0 && queue.packetSentRemaining != 0) {
+		const SizedData packet = queue.PeekNext(queue._numElements - queue.numUnsentElements);
+		if (packet.length > connectionPayloadSize) return false;
+	}
+
+	return true;
+}
+
+u16 BaseConnection::GetTxSchedulerQuantum(DeliveryPriority priority)
+{
+	//A weight of 0 would stall the queue forever
+	u16 weight = GS->config.txSchedulerWeights[(u8)priority];
+	if (weight == 0) weight = 1;
+
+	return weight * TX_SCHEDULER_QUANTUM;
+}
+
+PooledPacketQueue& BaseConnection::GetQueueForPriority(DeliveryPriority priority)
+{
+	//Without the tx scheduler, all packets share the normal queue in the order in which they were sent
+	if (!GS->config.enableTxScheduler) return packetSendQueue;
+
+	if (priority == DeliveryPriority::LOW) return packetSendQueueLowPrio;
+	if (priority == DeliveryPriority::LOWEST || priority == DeliveryPriority::INVALID) return packetSendQueueLowestPrio;
+	//High prio packets that are too big for the high prio queue are sent with medium priority
+	return packetSendQueue;
+}
+
+const PooledPacketQueue* BaseConnection::GetSplittingQueue() const
+{
+	if (packetSendQueue.packetSendPosition != 0) return &packetSendQueue;
+	if (packetSendQueueLowPrio.packetSendPosition != 0) return &packetSendQueueLowPrio;
+	if (packetSendQueueLowestPrio.packetSendPosition != 0) return &packetSendQueueLowestPrio;
+	return nullptr;
+}
+
+u16 BaseConnection::TransmitNextPacket(PooledPacketQueue& activeQueue)
+{
+	ErrorType err = ErrorType::SUCCESS;
+
+	DYNAMIC_ARRAY(packetBuffer, connectionMtu);
+	BaseConnectionSendData sendDataStruct;
+	BaseConnectionSendData* sendData = &sendDataStruct;
+
+	if (activeQueue._numElements < activeQueue.numUnsentElements) {
+		logt("ERROR", "Fail: Queue numElements");
+		SIMEXCEPTION(IllegalStateException);
+		GS->logger.logCustomError(CustomErrorTypes::FATAL_QUEUE_NUM_MISMATCH, (u16)(&activeQueue == &packetSendQueue));
+
+		GS->cm.ForceDisconnectAllConnections(AppDisconnectReason::QUEUE_NUM_MISMATCH);
+		return 0;
+	}
+
+	//Get the next packet from the packet queue that was not yet queued
+	const u16 packetPosition = activeQueue._numElements - activeQueue.numUnsentElements;
+	SizedData packet = activeQueue.PeekNext(packetPosition);
+
+	//Unpack data from sendQueue
+	BaseConnectionSendDataPacked* sendDataPacked = (BaseConnectionSendDataPacked*)packet.data;
+	sendData->characteristicHandle = sendDataPacked->characteristicHandle;
+	sendData->deliveryOption = (DeliveryOption)sendDataPacked->deliveryOption;
+	sendData->priority = (DeliveryPriority)sendDataPacked->priority;
+	sendData->dataLength = sendDataPacked->dataLength;
+	u8* data = (packet.data + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
+
+	//Small packets are packed into a single write if the partner supports this, otherwise
+	//the subclass is allowed to modify the packet before it is sent, it will place the modified packet into the sentData struct
+	//This could be e.g. only a part of the original packet ( a split packet )
+	u16 numAggregatedPackets = 0;
+	SizedData sentData = { nullptr, 0 };
+	if (packetAggregationEnabled && &activeQueue != &packetSendQueueHighPrio && activeQueue.packetSendPosition == 0) {
+		sentData = GetAggregatedData(activeQueue, packetPosition, packetBuffer, &numAggregatedPackets);
+	}
+	if (numAggregatedPackets <= 1) {
+		numAggregatedPackets = 0;
+		sentData = ProcessDataBeforeTransmission(sendData, data, packetBuffer);
+	}
+
+	if(sentData.length == 0){
+		logt("ERROR", "Packet processing failed");
+		GS->logger.logCustomError(CustomErrorTypes::FATAL_PACKET_PROCESSING_FAILED, partnerId);
+		DisconnectAndRemove(AppDisconnectReason::INVALID_PACKET);
+		return 0;
+	}
+
+	//Send the packet to the SoftDevice
+	if(sendData->deliveryOption == DeliveryOption::WRITE_REQ)
+	{
+		err = GS->gattController.bleWriteCharacteristic(
+				connectionHandle,
+				sendData->characteristicHandle,
+				sentData.data,
+				sentData.length,
+				true);
+	}
+	else if(sendData->deliveryOption == DeliveryOption::WRITE_CMD)
+	{
+		err = GS->gattController.bleWriteCharacteristic(
+				connectionHandle,
+				sendData->characteristicHandle,
+				sentData.data,
+				sentData.length,
+				false);
+	}
+	else
+	{
+		err = GS->gattController.bleSendNotification(
+				connectionHandle,
+				sendData->characteristicHandle,
+				sentData.data,
+				sentData.length);
+	}
+
+	if(err == ErrorType::SUCCESS && numAggregatedPackets > 0)
+	{
+		HandleAggregatedPacketsQueued(&activeQueue, packetPosition, numAggregatedPackets);
+	}
+	else if(err == ErrorType::SUCCESS)
+	{
+		//FIXME: This is not using the preprocessed data (sentData)
+		PacketSuccessfullyQueuedWithSoftdevice(&activeQueue, sendDataPacked, data, &sentData);
+	}
+	else if(err == ErrorType::BUSY)
+	{
+		return 0;
+	}
+	else if(err == ErrorType::RESOURCES){
+		//No free buffers in the softdevice, so packet could not be queued, go to next connection
+		//Also set the bufferFull variable
+		bufferFull = true;
+		return 0;
+	}
+	else
+	{
+		const char* tag = "WARNING";
+		if (
+			err != ErrorType::BLE_INVALID_CONN_HANDLE // May happen e.g. if the connection is not fully created yet or was destroyed already.
+			)
 		{
-			return;
+			tag = "ERROR";
 		}
-		else if(err == ErrorType::RESOURCES){
-			//No free buffers in the softdevice, so packet could not be queued, go to next connection
-			//Also set the bufferFull variable
-			bufferFull = true;
-			return;
-		}
-		else
-		{
-			const char* tag = "WARNING";
-			if (
-				err != ErrorType::BLE_INVALID_CONN_HANDLE // May happen e.g. if the connection is not fully created yet or was destroyed already.
-				)
-			{
-				tag = "ERROR";
-			}
-			logt(tag, "GATT WRITE ERROR 0x%x on handle %u", (u32)err, connectionHandle);
+		logt(tag, "GATT WRITE ERROR 0x%x on handle %u", (u32)err, connectionHandle);
 
-			GS->logger.logCustomError(CustomErrorTypes::WARN_GATT_WRITE_ERROR, (u32)err);
+		GS->logger.logCustomError(CustomErrorTypes::WARN_GATT_WRITE_ERROR, (u32)err);
 
-			HandlePacketQueuingFail(*activeQueue, sendDataPacked, (u32)err);
+		HandlePacketQueuingFail(activeQueue, sendDataPacked, (u32)err);
 
-			//Stop queuing packets for this connection to prevent infinite loops
-			return;
-		}
+		//Stop queuing packets for this connection to prevent infinite loops
+		return 0;
 	}
+
+	return sentData.length;
 }
 
-void BaseConnection::HandlePacketQueued(PacketQueue* activeQueue, BaseConnectionSendDataPacked* sendDataPacked)
+void BaseConnection::HandlePacketQueued(PooledPacketQueue* activeQueue, BaseConnectionSendDataPacked* sendDataPacked)
 {
 	//Save the queue handle in the packet, decrease the number of packets to be sent from that queue and reset our fail counter for that queue
 	sendDataPacked->sendHandle = GetNextQueueHandle();
@@ -302,6 +438,19 @@ void BaseConnection::HandlePacketQueued(PacketQueue* activeQueue, BaseConnection
 #endif
 }
 
+void BaseConnection::HandleAggregatedPacketsQueued(PooledPacketQueue* activeQueue, u16 position, u16 numPackets)
+{
+	//All packets of the write share the same handle so that they are removed together once the write was sent
+	BaseConnectionSendDataPacked* firstSendDataPacked = (BaseConnectionSendDataPacked*)activeQueue->PeekNext(position).data;
+	HandlePacketQueued(activeQueue, firstSendDataPacked);
+
+	for (u16 i = 1; i < numPackets; i++) {
+		BaseConnectionSendDataPacked* sendDataPacked = (BaseConnectionSendDataPacked*)activeQueue->PeekNext(position + i).data;
+		sendDataPacked->sendHandle = firstSendDataPacked->sendHandle;
+		activeQueue->numUnsentElements--;
+	}
+}
+
 void BaseConnection::HandlePacketSent(u8 sentUnreliable, u8 sentReliable)
 {
 	bufferFull = false;
@@ -323,45 +472,41 @@ void BaseConnection::HandlePacketSent(u8 sentUnreliable, u8 sentReliable)
 			continue;
 		}
 
-		//Find the queue from which the packet was sent
-		PacketQueue* activeQueue;
-
-		SizedData packet = packetSendQueue.PeekNext();
-		BaseConnectionSendDataPacked* sendDataPacked = (BaseConnectionSendDataPacked*)packet.data;
-		u8 handle = sendDataPacked != nullptr ? sendDataPacked->sendHandle : PACKET_QUEUED_HANDLE_NOT_QUEUED_IN_SD;
-
-		packet = packetSendQueueHighPrio.PeekNext();
-		BaseConnectionSendDataPacked* sendDataPackedHighPrio = (BaseConnectionSendDataPacked*)packet.data;
-		u8 handleHighPrio = sendDataPackedHighPrio != nullptr ? sendDataPackedHighPrio->sendHandle : PACKET_QUEUED_HANDLE_NOT_QUEUED_IN_SD;
+		//Find the queue from which the packet was sent, which is the queue whose first packet has the oldest handle
+		PooledPacketQueue* queues[] = { &packetSendQueueHighPrio, &packetSendQueue, &packetSendQueueLowPrio, &packetSendQueueLowestPrio };
+		PooledPacketQueue* activeQueue = nullptr;
+		u8 activeHandle = PACKET_QUEUED_HANDLE_NOT_QUEUED_IN_SD;
+		for (PooledPacketQueue* queue : queues) {
+			const SizedData packet = queue->PeekNext();
+			const u8 handle = packet.data != nullptr ? ((BaseConnectionSendDataPacked*)packet.data)->sendHandle : PACKET_QUEUED_HANDLE_NOT_QUEUED_IN_SD;
+			if (handle < PACKET_QUEUED_HANDLE_COUNTER_START) continue;
 
-		//If no queue has a handle, the packets must be from the normal queue because it was sending a split packet (but not all parts yet)
-		if (handle < PACKET_QUEUED_HANDLE_COUNTER_START && handleHighPrio < PACKET_QUEUED_HANDLE_COUNTER_START) {
-			activeQueue = &packetSendQueue;
-#ifdef SIM_ENABLED
-			if (packetSendQueue.packetSentRemaining == 0) {
-				SIMEXCEPTION(IllegalStateException);
+			//Check which handle is lower than the other handle using unsigned variables that will wrap
+			//Must be casted to u8, otherwhise type promotion results in an integer!
+			if (activeQueue == nullptr || (u8)(activeHandle - handle) < 100) {
+				activeQueue = queue;
+				activeHandle = handle;
 			}
-#endif
 		}
-		//Check if we do not have a queued packet in the normal queue
-		else if (handle < PACKET_QUEUED_HANDLE_COUNTER_START) {
-			activeQueue = &packetSendQueueHighPrio;
+
+		//If no queue has a handle, the packets must be from the queue that was sending a split packet (but not all parts yet)
+		if (activeQueue == nullptr) {
+			for (PooledPacketQueue* queue : queues) {
+				if (queue->packetSentRemaining > 0) {
+					activeQueue = queue;
+					break;
+				}
+			}
 		}
-		//Check if we do not have a queued packet in the high prio queue
-		else if (handleHighPrio < PACKET_QUEUED_HANDLE_COUNTER_START) {
+		if (activeQueue == nullptr) {
 			activeQueue = &packetSendQueue;
-		}
-		//Check which handle is lower than the other handle using unsigned variables that will wrap
-		else {
-			//Must be casted to u8, otherwhise type promotion results in an integer!
-			if ((u8)(handle - handleHighPrio) < 100) {
-				activeQueue = &packetSendQueueHighPrio;
-			}
-			else {
-				activeQueue = &packetSendQueue;
-			}
+#ifdef SIM_ENABLED
+			SIMEXCEPTION(IllegalStateException);
+#endif
 		}
 
+		SizedData packet = activeQueue->PeekNext();
+		BaseConnectionSendDataPacked* sendDataPacked = (BaseConnectionSendDataPacked*)packet.data;
 
 		if(activeQueue->_numElements == 0){
 			//TODO: Save Error
@@ -373,7 +518,7 @@ void BaseConnection::HandlePacketSent(u8 sentUnreliable, u8 sentReliable)
 
 		//Check if a split packet should be acknowledged
 		bool ackForSplitPacket = false;
-		if (activeQueue == &packetSendQueue && activeQueue->packetSentRemaining > 0 && sendDataPacked != nullptr && sendDataPacked->dataLength > connectionPayloadSize) {
+		if (activeQueue != &packetSendQueueHighPrio && activeQueue->packetSentRemaining > 0 && sendDataPacked != nullptr && sendDataPacked->dataLength > connectionPayloadSize) {
 			activeQueue->packetSentRemaining--;
 			ackForSplitPacket = true;
 		}
@@ -397,8 +542,18 @@ void BaseConnection::HandlePacketSent(u8 sentUnreliable, u8 sentReliable)
 				}
 #endif
 
+				const u8 sentHandle = sendData->sendHandle;
 				DataSentHandler(data.data + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, data.length - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
 				activeQueue->DiscardNext();
+
+				//Packets that were aggregated into the same write share its handle and were sent as well
+				while (activeQueue->_numElements > 0) {
+					data = activeQueue->PeekNext();
+					if (((BaseConnectionSendDataPacked*)data.data)->sendHandle != sentHandle) break;
+
+					DataSentHandler(data.data + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, data.length - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
+					activeQueue->DiscardNext();
+				}
 			}
 		}
 	}
@@ -408,7 +563,7 @@ void BaseConnection::HandlePacketSent(u8 sentUnreliable, u8 sentReliable)
 	this->sentReliable += sentReliable;
 }
 
-void BaseConnection::HandlePacketQueuingFail(PacketQueue& activeQueue, BaseConnectionSendDataPacked* sendDataPacked, u32 err)
+void BaseConnection::HandlePacketQueuingFail(PooledPacketQueue& activeQueue, BaseConnectionSendDataPacked* sendDataPacked, u32 err)
 {
 	activeQueue.packetFailedToQueueCounter++;
 
@@ -428,7 +583,7 @@ void BaseConnection::HandlePacketQueuingFail(PacketQueue& activeQueue, BaseConne
 }
 
 
-void BaseConnection::ResendAllPackets(PacketQueue& queueToReset) const
+void BaseConnection::ResendAllPackets(PooledPacketQueue& queueToReset) const
 {
 	queueToReset.numUnsentElements = queueToReset._numElements;
 	queueToReset.packetSendPosition = 0;
@@ -452,7 +607,7 @@ SizedData BaseConnection::ProcessDataBeforeTransmission(BaseConnectionSendData*
 	return result;
 }
 
-void BaseConnection::PacketSuccessfullyQueuedWithSoftdevice(PacketQueue* queue, BaseConnectionSendDataPacked* sendDataPacked, u8* data, SizedData* sentData)
+void BaseConnection::PacketSuccessfullyQueuedWithSoftdevice(PooledPacketQueue* queue, BaseConnectionSendDataPacked* sendDataPacked, u8* data, SizedData* sentData)
 {
 	HandlePacketQueued(queue, sendDataPacked);
 }
@@ -476,39 +631,80 @@ SizedData BaseConnection::GetSplitData(const BaseConnectionSendData &sendData, u
 
 	u16 payloadSize = connectionPayloadSize - SIZEOF_CONN_PACKET_SPLIT_HEADER;
 
+	//Only one queue at a time can be in the middle of sending a split packet
+	const PooledPacketQueue* splittingQueue = GetSplittingQueue();
+	const u8 packetSendPosition = splittingQueue != nullptr ? splittingQueue->packetSendPosition : 0;
+
 	//Check if this is the last packet
-	if((packetSendQueue.packetSendPosition+1) * payloadSize >= sendData.dataLength){
+	if((packetSendPosition+1) * payloadSize >= sendData.dataLength){
 		//End packet
 		resultHeader->splitMessageType = MessageType::SPLIT_WRITE_CMD_END;
-		resultHeader->splitCounter = packetSendQueue.packetSendPosition;
+		resultHeader->splitCounter = packetSendPosition;
 		CheckedMemcpy(
 				packetBuffer + SIZEOF_CONN_PACKET_SPLIT_HEADER,
-			data + packetSendQueue.packetSendPosition * payloadSize,
-			sendData.dataLength - packetSendQueue.packetSendPosition * payloadSize);
+			data + packetSendPosition * payloadSize,
+			sendData.dataLength - packetSendPosition * payloadSize);
 		result.data = packetBuffer;
-		result.length = (sendData.dataLength - packetSendQueue.packetSendPosition * payloadSize) + SIZEOF_CONN_PACKET_SPLIT_HEADER;
+		result.length = (sendData.dataLength - packetSendPosition * payloadSize) + SIZEOF_CONN_PACKET_SPLIT_HEADER;
 		if(result.length < 5){
 			logt("WARNING", "Split packet because of very few bytes, optimisation?");
 		}
 
-		char stringBuffer[100];
-		Logger::convertBufferToHexString(result.data, result.length, stringBuffer, sizeof(stringBuffer));
-		logt("CONN_DATA", "SPLIT_END_%u: %s", resultHeader->splitCounter, stringBuffer);
+		if (LOGT_ACTIVE("CONN_DATA"))
+		{
+			char stringBuffer[100];
+			Logger::convertBufferToHexString(result.data, result.length, stringBuffer, sizeof(stringBuffer));
+			logt("CONN_DATA", "SPLIT_END_%u: %s", resultHeader->splitCounter, stringBuffer);
+		}
 
 	} else {
 		//Intermediate packet
 		resultHeader->splitMessageType = MessageType::SPLIT_WRITE_CMD;
-		resultHeader->splitCounter = packetSendQueue.packetSendPosition;
+		resultHeader->splitCounter = packetSendPosition;
 		CheckedMemcpy(
 				packetBuffer + SIZEOF_CONN_PACKET_SPLIT_HEADER,
-			data + packetSendQueue.packetSendPosition * payloadSize,
+			data + packetSendPosition * payloadSize,
 			payloadSize);
 		result.data = packetBuffer;
 		result.length = connectionPayloadSize;
 
-		char stringBuffer[100];
-		Logger::convertBufferToHexString(result.data, result.length, stringBuffer, sizeof(stringBuffer));
-		logt("CONN_DATA", "SPLIT_%u: %s", resultHeader->splitCounter, stringBuffer);
+		if (LOGT_ACTIVE("CONN_DATA"))
+		{
+			char stringBuffer[100];
+			Logger::convertBufferToHexString(result.data, result.length, stringBuffer, sizeof(stringBuffer));
+			logt("CONN_DATA", "SPLIT_%u: %s", resultHeader->splitCounter, stringBuffer);
+		}
+	}
+
+	return result;
+}
+
+SizedData BaseConnection::GetAggregatedData(const PooledPacketQueue& queue, u16 position, u8* packetBuffer, u16* numPackets) const
+{
+	SizedData result = { packetBuffer, SIZEOF_CONN_PACKET_AGGREGATION_HEADER };
+	*numPackets = 0;
+
+	connPacketAggregationHeader* resultHeader = (connPacketAggregationHeader*)packetBuffer;
+	resultHeader->aggregationMessageType = MessageType::AGGREGATED_WRITE_CMD;
+
+	u16 characteristicHandle = 0;
+	for (u16 i = position; i < queue._numElements; i++) {
+		SizedData packet = queue.PeekNext(i);
+		BaseConnectionSendDataPacked const * sendDataPacked = (BaseConnectionSendDataPacked const *)packet.data;
+
+		//Only unreliable packets for the same characteristic can be packed and each must still fit into the write
+		if (sendDataPacked->deliveryOption != (u8)DeliveryOption::WRITE_CMD
+			|| sendDataPacked->dataLength > UINT8_MAX
+			|| result.length + 1 + sendDataPacked->dataLength > connectionPayloadSize
+			|| (*numPackets > 0 && sendDataPacked->characteristicHandle != characteristicHandle)) {
+			break;
+		}
+
+		characteristicHandle = sendDataPacked->characteristicHandle;
+		packetBuffer[result.length] = (u8)sendDataPacked->dataLength;
+		CheckedMemcpy(packetBuffer + result.length + 1, packet.data + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, sendDataPacked->dataLength);
+		result.length += 1 + sendDataPacked->dataLength;
+		(*numPackets)++;
 	}
 
 	return result;
@@ -683,7 +879,7 @@ u8 BaseConnection::GetNextQueueHandle()
 }
 
 
-SizedData BaseConnection::GetNextPacketToSend(const PacketQueue& queue) const
+SizedData BaseConnection::GetNextPacketToSend(const PooledPacketQueue& queue) const
 {
 	for (u32 i = 0; i < queue._numElements; i++) {
 		SizedData data = queue.PeekNext(i); //TODO: Optimize this, as this will iterate again through all items each loop
@@ -708,8 +904,8 @@ u32 BaseConnection::GetAmountOfRemovedConnections()
 //in the debugger
 void BaseConnection::PrintQueueInfo()
 {
-	PacketQueue* queue = nullptr;
-	for (int i = 0; i < 2; i++)
+	PooledPacketQueue* queue = nullptr;
+	for (int i = 0; i < 4; i++)
 	{
 		if (i == 0) 
 		{
@@ -721,6 +917,16 @@ void BaseConnection::PrintQueueInfo()
 			queue = &packetSendQueueHighPrio;
 			printf("------ High Prio Queue Last to First (%u), sendRemaining %u ------" EOL, queue->_numElements, queue->packetSentRemaining);
 		}
+		else if (i == 2)
+		{
+			queue = &packetSendQueueLowPrio;
+			printf("------ Low Prio Queue Last to First (%u), sendRemaining %u ------" EOL, queue->_numElements, queue->packetSentRemaining);
+		}
+		else
+		{
+			queue = &packetSendQueueLowestPrio;
+			printf("------ Lowest Prio Queue Last to First (%u), sendRemaining %u ------" EOL, queue->_numElements, queue->packetSentRemaining);
+		}
 
 		for (int k = 0; k < queue->_numElements; k++) {
 			SizedData data = queue->PeekNext(k);
@@ -33,7 +33,7 @@
 
 #include <types.h>
 #include <Config.h>
-#include <PacketQueue.h>
+#include <PooledPacketQueue.h>
 #include <Logger.h>
 #include <FruityHal.h>
 #include <array>
@@ -199,9 +199,23 @@ class BaseConnection
 		virtual SizedData ProcessDataBeforeTransmission(BaseConnectionSendData* sendData, u8* data, u8* packetBuffer);
 		//Called after data has been queued in the softdevice, pay attention that data points to the full packet in the queue
 		//whereas sentData is the data that was really sent (e.g. the packet was split or preprocessed in some way before sending)
-		virtual void PacketSuccessfullyQueuedWithSoftdevice(PacketQueue* queue, BaseConnectionSendDataPacked* sendDataPacked, u8* data, SizedData* sentData);
+		virtual void PacketSuccessfullyQueuedWithSoftdevice(PooledPacketQueue* queue, BaseConnectionSendDataPacked* sendDataPacked, u8* data, SizedData* sentData);
 		//Fills the tx buffers of the softdevice with the packets from the packet queue
 		virtual void FillTransmitBuffers();
+		//Gives the queues of all priorities one round of the deficit round robin tx scheduler
+		//Returns true if packets were queued with the softdevice and the connection might be able to transmit more
+		bool FillTransmitBuffersScheduled();
+		bool TransmitScheduled(DeliveryPriority priority, bool* transmitted);
+		bool CanTransmit() const;
+		bool IsQueueReadyToTransmit(const PooledPacketQueue& queue) const;
+		static u16 GetTxSchedulerQuantum(DeliveryPriority priority);
+		//Returns the queue for packets of the given priority, with the tx scheduler each priority has its own queue
+		PooledPacketQueue& GetQueueForPriority(DeliveryPriority priority);
+		//Returns the queue that is in the middle of queuing the parts of a split packet or nullptr
+		const PooledPacketQueue* GetSplittingQueue() const;
+		//Queues the next unsent packet (or the next part of it) of the given queue with the softdevice
+		//Returns the number of bytes that were queued or 0 if the connection can not transmit anymore
+		u16 TransmitNextPacket(PooledPacketQueue& activeQueue);
 		virtual void DataSentHandler(const u8* data, u16 length) {};
 
 		//Handler
@@ -216,22 +230,25 @@ class BaseConnection
 		//Can be called by subclasses to use the connPacketHeader reassembly
 		u8 const * ReassembleData(BaseConnectionSendData* sendData, u8 const * data);
 		SizedData GetSplitData(const BaseConnectionSendData &sendData, u8* data, u8* packetBuffer) const;
+		//Packs the unsent packet at the given position and as many following packets as possible into one write
+		SizedData GetAggregatedData(const PooledPacketQueue& queue, u16 position, u8* packetBuffer, u16* numPackets) const;
 
 		//Helpers
 		virtual void PrintStatus() = 0;
 
 		i8 GetAverageRSSI() const;
 		//Must return the number of packets that are queued. (Not just in the Packetqueues, also HighPrioData!)
-		virtual bool GetPendingPackets() { return packetSendQueue._numElements + packetSendQueueHighPrio._numElements; };
+		virtual bool GetPendingPackets() { return packetSendQueue._numElements + packetSendQueueHighPrio._numElements + packetSendQueueLowPrio._numElements + packetSendQueueLowestPrio._numElements; };
 
 
-		SizedData GetNextPacketToSend(const PacketQueue& queue) const;
+		SizedData GetNextPacketToSend(const PooledPacketQueue& queue) const;
 
-		void HandlePacketQueued(PacketQueue* activeQueue, BaseConnectionSendDataPacked* sendDataPacked);
-		void HandlePacketQueuingFail(PacketQueue& activeQueue, BaseConnectionSendDataPacked* sendDataPacked, u32 err);
+		void HandlePacketQueued(PooledPacketQueue* activeQueue, BaseConnectionSendDataPacked* sendDataPacked);
+		void HandleAggregatedPacketsQueued(PooledPacketQueue* activeQueue, u16 position, u16 numPackets);
+		void HandlePacketQueuingFail(PooledPacketQueue& activeQueue, BaseConnectionSendDataPacked* sendDataPacked, u32 err);
 		void HandlePacketSent(u8 sentUnreliable, u8 sentReliable);
 
-		void ResendAllPackets(PacketQueue& queueToReset) const;
+		void ResendAllPackets(PooledPacketQueue& queueToReset) const;
 
 		u8 GetNextQueueHandle();
 
@@ -255,14 +272,20 @@ class BaseConnection
 		//Buffers
 		bool bufferFull = false; //Set to true once the softdevice reports that all buffers are full
 		u8 manualPacketsSent = 0; //Used to count the packets manually sent to the softdevice using bleWriteCharacteristic, will be decremented first before packets from the queue are removed. Packets must not be sent while the queue is working
+		bool packetAggregationEnabled = false; //Set by subclasses if the partner is able to unpack multiple packets from a single write
 
-		//Normal Prio Queue
-		u32 packetSendBuffer[PACKET_SEND_BUFFER_SIZE / sizeof(u32)] = {};
-		PacketQueue packetSendQueue;
+		//Normal Prio Queue, holds all packets that are not high prio if the tx scheduler is disabled
+		PooledPacketQueue packetSendQueue;
 
 		//High Prio Queue
-		u32 packetSendBufferHighPrio[PACKET_SEND_BUFFER_HIGH_PRIO_SIZE / sizeof(u32)] = {};
-		PacketQueue packetSendQueueHighPrio;
+		PooledPacketQueue packetSendQueueHighPrio;
+
+		//Queues for DeliveryPriority::LOW and LOWEST, only used by the tx scheduler
+		PooledPacketQueue packetSendQueueLowPrio;
+		PooledPacketQueue packetSendQueueLowestPrio;
+
+		//Deficits of the queues in the tx scheduler in bytes, indexed by DeliveryPriority
+		i16 txDeficits[(u8)DeliveryPriority::INVALID] = {};
 
 		u8 packetQueuedHandleCounter = PACKET_QUEUED_HANDLE_COUNTER_START; //Used to assign handles to queued packets
 
@@ -255,7 +255,7 @@ u32 BaseConnectionHandle::GetUniqueConnectionId()
 	return uniqueConnectionId;
 }
 
-PacketQueue* BaseConnectionHandle::GetPacketSendQueue()
+PooledPacketQueue* BaseConnectionHandle::GetPacketSendQueue()
 {
 	BaseConnection* con = GetConnection();
 	if (con)
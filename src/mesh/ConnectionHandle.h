@@ -33,7 +33,7 @@
 #include "BaseConnection.h"
 #include "MeshConnection.h"
 #include "MeshAccessConnection.h"
-#include "PacketQueue.h"
+#include "PooledPacketQueue.h"
 
 class ConnectionManager;
 
@@ -82,7 +82,7 @@ public:
 	i8 GetAverageRSSI();
 	u16 GetSentUnreliable();
 	u32 GetUniqueConnectionId();
-	PacketQueue* GetPacketSendQueue();
+	PooledPacketQueue* GetPacketSendQueue();
 };
 
 class MeshConnectionHandle : public BaseConnectionHandle
@@ -376,7 +376,12 @@ ErrorType ConnectionManager::SendMeshMessageInternal(u8* data, u16 dataLength, D
 			}
 		}
 
-		//Send to receiver or broadcast if not directly connected to us
+		//If the receiver is not directly connected to us, we might have learned the route to it
+		if(!receiverConn){
+			receiverConn = GetMeshConnectionToLearnedRoute(packetHeader->receiver);
+		}
+
+		//Send to receiver or broadcast if we do not know where it is
 		if(receiverConn){
 			receiverConn.SendData(data, dataLength, priority, reliable);
 		} else {
@@ -468,12 +473,32 @@ ConnectionManager & ConnectionManager::getInstance()
 	return GS->cm;
 }
 
-void ConnectionManager::fillTransmitBuffers() const
+void ConnectionManager::fillTransmitBuffers()
 {
 	BaseConnections conn = GetBaseConnections(ConnectionDirection::INVALID);
-	for(u32 i=0; i< conn.count; i++){
-		if (conn.handles[i]) {
-			conn.handles[i].FillTransmitBuffers();
+
+	if (!GS->config.enableTxScheduler) {
+		for(u32 i=0; i< conn.count; i++){
+			if (conn.handles[i]) {
+				conn.handles[i].FillTransmitBuffers();
+			}
+		}
+		return;
+	}
+
+	if (conn.count == 0) return;
+
+	//Deficit round robin over the queues of all connections, each connection gets one turn per round
+	//until no queue can transmit anymore. The first connection is rotated so that no connection
+	//is preferred because of its position in the connection array
+	const u32 startIndex = txSchedulerStartIndex++;
+	bool transmitted = true;
+	while (transmitted) {
+		transmitted = false;
+		for (u32 i = 0; i < conn.count; i++) {
+			BaseConnectionHandle& handle = conn.handles[(startIndex + i) % conn.count];
+			if (!handle) continue;
+			if (handle.GetConnection()->FillTransmitBuffersScheduled()) transmitted = true;
 		}
 	}
 }
@@ -550,9 +575,12 @@ void ConnectionManager::ForwardReceivedDataToConnection(u16 connectionHandle, Ba
 {
 	logt("CM", "RX Data size is: %d, handles(%d, %d), delivery %d", sendData.dataLength, connectionHandle, sendData.characteristicHandle, (u32)sendData.deliveryOption);
 
-	char stringBuffer[100];
-	Logger::convertBufferToHexString(data, sendData.dataLength, stringBuffer, sizeof(stringBuffer));
-	logt("CM", "%s", stringBuffer);
+	if (LOGT_ACTIVE("CM"))
+	{
+		char stringBuffer[100];
+		Logger::convertBufferToHexString(data, sendData.dataLength, stringBuffer, sizeof(stringBuffer));
+		logt("CM", "%s", stringBuffer);
+	}
 	//Get the handling connection for this write
 	BaseConnection* connection = GS->cm.GetRawConnectionFromHandle(connectionHandle);
 
@@ -601,6 +629,8 @@ void ConnectionManager::RouteMeshData(BaseConnection* connection, BaseConnection
 		}
 	}
 
+	LearnUnicastRoute(connection, packetHeader);
+
 	/*#################### ROUTING ############################*/
 
 	//We are the last receiver for this packet
@@ -611,6 +641,14 @@ void ConnectionManager::RouteMeshData(BaseConnection* connection, BaseConnection
 	{
 		//No packet forwarding needed here.
 	}
+	//The packet reached us over another connection before, so it was already forwarded
+	else if(connection != nullptr
+		&& packetHeader->messageType != MessageType::CLUSTER_INFO_UPDATE
+		&& packetHeader->messageType != MessageType::UPDATE_TIMESTAMP
+		&& IsRecentlyRoutedPacket(connection, sendData, data))
+	{
+		logt("CM", "Dropping duplicate packet %u from %u", (u32)packetHeader->messageType, packetHeader->sender);
+	}
 	//The packet should continue to the shortest sink
 	else if(packetHeader->receiver == NODE_ID_SHORTEST_SINK)
 	{
@@ -646,12 +684,83 @@ void ConnectionManager::RouteMeshData(BaseConnection* connection, BaseConnection
 		if(packetHeader->messageType != MessageType::CLUSTER_INFO_UPDATE
 			&& packetHeader->messageType != MessageType::UPDATE_TIMESTAMP)
 		{
-			//Send to all other connections
-			BroadcastMeshData(connection, sendData, data, routingDecision);
+			MeshConnectionHandle routeConnection = GetMeshConnectionToLearnedRoute(packetHeader->receiver);
+
+			//Forward unicast packets only along the learned route, MeshAccess connections are not learned and still receive the packet
+			if (routeConnection && routeConnection.GetConnection() != connection)
+			{
+				if (!(routingDecision & ROUTING_DECISION_BLOCK_TO_MESH)) {
+					sendData->characteristicHandle = routeConnection.GetConnection()->partnerWriteCharacteristicHandle;
+					routeConnection.SendData(sendData, data);
+				}
+				BroadcastMeshData(connection, sendData, data, routingDecision | ROUTING_DECISION_BLOCK_TO_MESH);
+			}
+			else
+			{
+				//Send to all other connections
+				BroadcastMeshData(connection, sendData, data, routingDecision);
+			}
 		}
 	}
 }
 
+void ConnectionManager::LearnUnicastRoute(const BaseConnection* connection, connPacketHeader const * packetHeader) const
+{
+	//Only handshaked mesh connections belong to the cluster tree in which each node is reachable over exactly one connection
+	if (!GS->config.enableUnicastRouteLearning
+		|| connection == nullptr
+		|| connection->connectionType != ConnectionType::FRUITYMESH
+		|| connection->connectionState < ConnectionState::HANDSHAKE_DONE
+		|| packetHeader->sender < NODE_ID_DEVICE_BASE
+		|| packetHeader->sender >= NODE_ID_DEVICE_BASE + NODE_ID_DEVICE_BASE_SIZE
+		|| packetHeader->sender == GS->node.configuration.nodeId)
+	{
+		return;
+	}
+
+	unicastRoutes.Learn(packetHeader->sender, connection->uniqueConnectionId, GS->appTimerDs);
+}
+
+MeshConnectionHandle ConnectionManager::GetMeshConnectionToLearnedRoute(NodeId nodeId) const
+{
+	if (!GS->config.enableUnicastRouteLearning
+		|| nodeId < NODE_ID_DEVICE_BASE
+		|| nodeId >= NODE_ID_DEVICE_BASE + NODE_ID_DEVICE_BASE_SIZE)
+	{
+		return MeshConnectionHandle();
+	}
+
+	u32 connectionId = unicastRoutes.GetConnectionId(nodeId, GS->appTimerDs);
+	if (connectionId == 0) return MeshConnectionHandle();
+
+	BaseConnection* bc = GetRawConnectionByUniqueId(connectionId);
+	if (bc == nullptr
+		|| bc->connectionType != ConnectionType::FRUITYMESH
+		|| bc->connectionState < ConnectionState::HANDSHAKE_DONE)
+	{
+		//The connection is gone, so are all routes over it
+		unicastRoutes.RemoveConnection(connectionId);
+		return MeshConnectionHandle();
+	}
+
+	return MeshConnectionHandle(*(MeshConnection*)bc);
+}
+
+bool ConnectionManager::IsRecentlyRoutedPacket(const BaseConnection* connection, const BaseConnectionSendData* sendData, u8 const * data) const
+{
+	connPacketHeader const * packetHeader = (connPacketHeader const *)data;
+	if (sendData->dataLength < SIZEOF_CONN_PACKET_HEADER) return false;
+
+	//The receiver is decremented for packets that travel a number of hops, so it is only part of the hash for other receivers
+	u32 payloadHash = Utility::CalculateCrc32(data + SIZEOF_CONN_PACKET_HEADER, sendData->dataLength - SIZEOF_CONN_PACKET_HEADER);
+	if (packetHeader->receiver <= NODE_ID_HOPS_BASE || packetHeader->receiver >= NODE_ID_HOPS_BASE + 1000)
+	{
+		payloadHash = Utility::CalculateCrc32((u8 const *)&packetHeader->receiver, sizeof(packetHeader->receiver), payloadHash);
+	}
+
+	return recentlyRoutedPackets.IsDuplicate(packetHeader->sender, packetHeader->messageType, payloadHash, connection->uniqueConnectionId, GS->appTimerDs);
+}
+
 void ConnectionManager::BroadcastMeshData(const BaseConnection* ignoreConnection, BaseConnectionSendData* sendData, u8 const * data, RoutingDecision routingDecision) const
 {
 	//Iterate through all mesh connections except the ignored one and send the packet
@@ -40,6 +40,8 @@
 #include <BaseConnection.h>
 #include <MeshConnection.h>
 #include <ConnectionHandle.h>
+#include <RecentPacketCache.h>
+#include <UnicastRouteTable.h>
 
 struct BaseConnections
 {
@@ -99,10 +101,11 @@ public:
 	static ConnectionManager& getInstance();
 
 	//This method is called when empty buffers are available and there is data to send
-	void fillTransmitBuffers() const;
+	void fillTransmitBuffers();
 
 	u8 freeMeshInConnections = 0;
 	u8 freeMeshOutConnections = 0;
+	u32 meshConnectionChanges = 0; //Counts all created and deleted mesh connections and changes of their partners
 
 	BaseConnection* pendingConnection = nullptr;
 
@@ -110,6 +113,13 @@ public:
 	u16 sentMeshPacketsUnreliable = 0;
 	u16 sentMeshPacketsReliable = 0;
 
+	//Mutable as it is updated while routing, which does not change the connections
+	mutable RecentPacketCache recentlyRoutedPackets;
+	//Learned next hops for unicast packets, also updated while routing
+	mutable UnicastRouteTable unicastRoutes;
+	//The connection that the tx scheduler starts with, rotated with each call to fillTransmitBuffers
+	u32 txSchedulerStartIndex = 0;
+
 	//ConnectionType Resolving
 	void ResolveConnection(BaseConnection* oldConnection, BaseConnectionSendData* sendData, u8 const * data);
 
@@ -145,6 +155,12 @@ public:
 
 	void RouteMeshData(BaseConnection* connection, BaseConnectionSendData* sendData, u8 const * data) const;
 	void BroadcastMeshData(const BaseConnection* ignoreConnection, BaseConnectionSendData* sendData, u8 const * data, RoutingDecision routingDecision) const;
+	//Checks if the packet was received over another connection before and remembers it otherwise
+	bool IsRecentlyRoutedPacket(const BaseConnection* connection, const BaseConnectionSendData* sendData, u8 const * data) const;
+	//Remembers the connection over which the sender of a routed packet can be reached
+	void LearnUnicastRoute(const BaseConnection* connection, connPacketHeader const * packetHeader) const;
+	//Returns the mesh connection that leads to the given node if it was learned before, otherwise an invalid handle
+	MeshConnectionHandle GetMeshConnectionToLearnedRoute(NodeId nodeId) const;
 
 	//Whether or not the node should receive and dispatch messages that are sent to the given nodeId
 	bool IsReceiverOfNodeId(NodeId nodeId) const;
@@ -379,12 +379,15 @@ void DispatchTimerEvents(u16 passedTimeDs)
 
 	ScanController::getInstance().TimerEventHandler(passedTimeDs);
 
-	//Dispatch event to all modules
+	//Dispatch event to all modules that still check their timings on every tick
 	for(u32 i=0; i<GS->amountOfModules; i++){
-		if(GS->activeModules[i]->configurationPointer->moduleActive){
+		if(GS->activeModules[i]->configurationPointer->moduleActive && GS->activeModules[i]->needsTimerEventHandler){
 			GS->activeModules[i]->TimerEventHandler(passedTimeDs);
 		}
 	}
+
+	//Only the timers that are due are dispatched
+	GS->timerWheel.Advance(GS->appTimerDs);
 }
 
 void DispatchEvent(const FruityHal::GapRssiChangedEvent & e)
@@ -395,11 +398,7 @@ void DispatchEvent(const FruityHal::GapRssiChangedEvent & e)
 void DispatchEvent(const FruityHal::GapAdvertisementReportEvent & e)
 {
 	ScanController::getInstance().ScanEventHandler(e);
-	for (u32 i = 0; i < GS->amountOfModules; i++) {
-		if (GS->activeModules[i]->configurationPointer->moduleActive) {
-			GS->activeModules[i]->GapAdvertisementReportEventHandler(e);
-		}
-	}
+	ScanController::getInstance().DispatchAdvertisement(e);
 }
 
 void DispatchEvent(const FruityHal::GapConnectedEvent & e)
@@ -0,0 +1,228 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "JoinMeBuffer.h"
+#include "Utility.h"
+
+JoinMeBuffer::JoinMeBuffer()
+{
+	Clear();
+}
+
+u8 JoinMeBuffer::GetSenderSlot(NodeId sender)
+{
+	return (u8)((((u32)sender * 2654435761U) >> 24) & (SENDER_INDEX_SIZE - 1));
+}
+
+//Returns the slot of the sender in the index or the empty slot where it would have to be inserted
+u8 JoinMeBuffer::FindSenderSlot(NodeId sender) const
+{
+	u8 slot = GetSenderSlot(sender);
+	while (senderIndex[slot] != INVALID_INDEX && packets[senderIndex[slot]].payload.sender != sender)
+	{
+		slot = (slot + 1) & (SENDER_INDEX_SIZE - 1);
+	}
+	return slot;
+}
+
+bool JoinMeBuffer::IsWorseCandidate(u8 indexA, u8 indexB) const
+{
+	const u32 scoreA = scores[indexA].asMaster > scores[indexA].asSlave ? scores[indexA].asMaster : scores[indexA].asSlave;
+	const u32 scoreB = scores[indexB].asMaster > scores[indexB].asSlave ? scores[indexB].asMaster : scores[indexB].asSlave;
+	if (scoreA != scoreB) return scoreA < scoreB;
+	return packets[indexA].receivedTimeDs < packets[indexB].receivedTimeDs;
+}
+
+void JoinMeBuffer::SwapHeapEntries(u8 positionA, u8 positionB)
+{
+	const u8 indexA = heap[positionA];
+	heap[positionA] = heap[positionB];
+	heap[positionB] = indexA;
+	heapPositions[heap[positionA]] = positionA;
+	heapPositions[heap[positionB]] = positionB;
+}
+
+void JoinMeBuffer::SiftUp(u8 position)
+{
+	while (position > 0)
+	{
+		const u8 parent = (position - 1) / 2;
+		if (!IsWorseCandidate(heap[position], heap[parent])) break;
+		SwapHeapEntries(position, parent);
+		position = parent;
+	}
+}
+
+void JoinMeBuffer::SiftDown(u8 position)
+{
+	while (true)
+	{
+		u8 worst = position;
+		const u8 left = 2 * position + 1;
+		const u8 right = 2 * position + 2;
+		if (left < numPackets && IsWorseCandidate(heap[left], heap[worst])) worst = left;
+		if (right < numPackets && IsWorseCandidate(heap[right], heap[worst])) worst = right;
+		if (worst == position) break;
+		SwapHeapEntries(position, worst);
+		position = worst;
+	}
+}
+
+void JoinMeBuffer::Unlink(u8 index)
+{
+	if (olderPackets[index] != INVALID_INDEX) newerPackets[olderPackets[index]] = newerPackets[index];
+	else oldestPacket = newerPackets[index];
+	if (newerPackets[index] != INVALID_INDEX) olderPackets[newerPackets[index]] = olderPackets[index];
+	else newestPacket = olderPackets[index];
+
+	olderPackets[index] = INVALID_INDEX;
+	newerPackets[index] = INVALID_INDEX;
+}
+
+void JoinMeBuffer::LinkAsNewest(u8 index)
+{
+	olderPackets[index] = newestPacket;
+	newerPackets[index] = INVALID_INDEX;
+	if (newestPacket != INVALID_INDEX) newerPackets[newestPacket] = index;
+	else oldestPacket = index;
+	newestPacket = index;
+}
+
+joinMeBufferPacket* JoinMeBuffer::Find(NodeId sender)
+{
+	if (sender == 0) return nullptr;
+
+	const u8 index = senderIndex[FindSenderSlot(sender)];
+	return index != INVALID_INDEX ? &packets[index] : nullptr;
+}
+
+joinMeBufferPacket* JoinMeBuffer::Add(NodeId sender)
+{
+	if (sender == 0 || numPackets >= NUM_ELEMENTS) return nullptr;
+
+	const u8 slot = FindSenderSlot(sender);
+	if (senderIndex[slot] != INVALID_INDEX) return nullptr;
+
+	//The heap array holds the unused indices behind the used ones
+	const u8 index = heap[numPackets];
+	numPackets++;
+
+	CheckedMemset(&packets[index], 0x00, sizeof(joinMeBufferPacket));
+	packets[index].payload.sender = sender;
+	scores[index] = {};
+	senderIndex[slot] = index;
+
+	SiftUp(heapPositions[index]);
+	LinkAsNewest(index);
+
+	return &packets[index];
+}
+
+void JoinMeBuffer::Update(joinMeBufferPacket* packet, u32 scoreAsMaster, u32 scoreAsSlave)
+{
+	const u8 index = (u8)(packet - packets.data());
+
+	Unlink(index);
+	LinkAsNewest(index);
+	SetScores(index, scoreAsMaster, scoreAsSlave);
+}
+
+void JoinMeBuffer::SetScores(u32 index, u32 scoreAsMaster, u32 scoreAsSlave)
+{
+	scores[index].asMaster = scoreAsMaster;
+	scores[index].asSlave = scoreAsSlave;
+
+	SiftUp(heapPositions[index]);
+	SiftDown(heapPositions[index]);
+}
+
+joinMeBufferPacket* JoinMeBuffer::GetWorstPacket(u32 nowDs, u32 maxAgeDs)
+{
+	if (numPackets == 0) return nullptr;
+
+	if (nowDs - packets[oldestPacket].receivedTimeDs > maxAgeDs) return &packets[oldestPacket];
+
+	return &packets[heap[0]];
+}
+
+void JoinMeBuffer::Remove(NodeId sender)
+{
+	if (sender == 0) return;
+
+	u8 hole = FindSenderSlot(sender);
+	const u8 index = senderIndex[hole];
+	if (index == INVALID_INDEX) return;
+
+	//Entries behind the removed one are shifted back if that does not move them before their home slot
+	u8 slot = (hole + 1) & (SENDER_INDEX_SIZE - 1);
+	while (senderIndex[slot] != INVALID_INDEX)
+	{
+		const u8 home = GetSenderSlot(packets[senderIndex[slot]].payload.sender);
+		if (((slot - home) & (SENDER_INDEX_SIZE - 1)) >= ((slot - hole) & (SENDER_INDEX_SIZE - 1)))
+		{
+			senderIndex[hole] = senderIndex[slot];
+			hole = slot;
+		}
+		slot = (slot + 1) & (SENDER_INDEX_SIZE - 1);
+	}
+	senderIndex[hole] = INVALID_INDEX;
+
+	Unlink(index);
+
+	numPackets--;
+	const u8 position = heapPositions[index];
+	if (position != numPackets)
+	{
+		SwapHeapEntries(position, numPackets);
+		const u8 movedIndex = heap[position];
+		SiftUp(position);
+		SiftDown(heapPositions[movedIndex]);
+	}
+
+	CheckedMemset(&packets[index], 0x00, sizeof(joinMeBufferPacket));
+	scores[index] = {};
+}
+
+void JoinMeBuffer::Clear()
+{
+	CheckedMemset(packets.data(), 0x00, sizeof(packets));
+	CheckedMemset(scores.data(), 0x00, sizeof(scores));
+	for (u8 i = 0; i < NUM_ELEMENTS; i++)
+	{
+		heap[i] = i;
+		heapPositions[i] = i;
+		olderPackets[i] = INVALID_INDEX;
+		newerPackets[i] = INVALID_INDEX;
+	}
+	senderIndex.fill(INVALID_INDEX);
+	numPackets = 0;
+	oldestPacket = INVALID_INDEX;
+	newestPacket = INVALID_INDEX;
+}
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <types.h>
+#include <FruityHal.h>
+#include <array>
+
+typedef struct
+{
+	FruityHal::BleGapAddr    addr;
+	FruityHal::BleGapAdvType advType;
+	i8                       rssi;
+	u8                       attemptsToConnect;
+	u32                      receivedTimeDs;
+	u32                      lastConnectAttemptDs;
+	advPacketPayloadJoinMeV0 payload;
+}joinMeBufferPacket;
+
+/*
+ * The JoinMeBuffer stores the latest JOIN_ME packet of a limited number of senders together with
+ * the scores that the node calculated for them, so that the scores do not have to be recalculated
+ * for every decision. A packet is found by its sender through a small open addressing index.
+ * If the buffer is full, a stale packet is replaced first, otherwise the worst candidate, which is
+ * kept on top of a binary heap that is ordered by the better of both scores and then by age.
+ * Unused packets have a sender of 0 so that the packets can still be iterated by index.
+ */
+class JoinMeBuffer
+{
+public:
+	static constexpr u8 NUM_ELEMENTS = 10;
+
+	struct Scores
+	{
+		u32 asMaster;
+		u32 asSlave;
+	};
+
+private:
+	static constexpr u8 INVALID_INDEX = 0xFF;
+	static constexpr u8 SENDER_INDEX_SIZE = 16;
+	static_assert(SENDER_INDEX_SIZE > NUM_ELEMENTS && (SENDER_INDEX_SIZE & (SENDER_INDEX_SIZE - 1)) == 0, "Sender index must be a power of 2 with at least one free entry");
+
+	std::array<joinMeBufferPacket, NUM_ELEMENTS> packets{};
+	std::array<Scores, NUM_ELEMENTS> scores{};
+
+	//Indices of all used packets, the worst candidate for eviction first
+	std::array<u8, NUM_ELEMENTS> heap;
+	std::array<u8, NUM_ELEMENTS> heapPositions;
+	u8 numPackets = 0;
+
+	//Used packets in the order in which they were last received, to find the oldest one
+	std::array<u8, NUM_ELEMENTS> olderPackets;
+	std::array<u8, NUM_ELEMENTS> newerPackets;
+	u8 oldestPacket = INVALID_INDEX;
+	u8 newestPacket = INVALID_INDEX;
+
+	//Maps the sender of a packet to its index, uses linear probing
+	std::array<u8, SENDER_INDEX_SIZE> senderIndex;
+
+	static u8 GetSenderSlot(NodeId sender);
+	u8 FindSenderSlot(NodeId sender) const;
+
+	bool IsWorseCandidate(u8 indexA, u8 indexB) const;
+	void SwapHeapEntries(u8 positionA, u8 positionB);
+	void SiftUp(u8 position);
+	void SiftDown(u8 position);
+
+	void Unlink(u8 index);
+	void LinkAsNewest(u8 index);
+
+public:
+	JoinMeBuffer();
+
+	u32 size() const { return NUM_ELEMENTS; }
+	joinMeBufferPacket& operator[](u32 index) { return packets[index]; }
+	const joinMeBufferPacket& operator[](u32 index) const { return packets[index]; }
+	const Scores& GetScores(u32 index) const { return scores[index]; }
+	u8 GetNumPackets() const { return numPackets; }
+
+	//Returns the packet of the given sender or nullptr if there is none
+	joinMeBufferPacket* Find(NodeId sender);
+
+	//Returns an empty packet for the given sender or nullptr if the buffer is full
+	//The packet must be filled and then passed to Update so that it is sorted into the buffer
+	joinMeBufferPacket* Add(NodeId sender);
+
+	//Must be called once a packet was received again, marks it as the newest one and stores its scores
+	void Update(joinMeBufferPacket* packet, u32 scoreAsMaster, u32 scoreAsSlave);
+
+	//Stores new scores for a packet without changing its age
+	void SetScores(u32 index, u32 scoreAsMaster, u32 scoreAsSlave);
+
+	//Returns the packet that should be replaced first: the oldest one if it is older than maxAgeDs,
+	//otherwise the one with the lowest score. Returns nullptr if the buffer is empty.
+	joinMeBufferPacket* GetWorstPacket(u32 nowDs, u32 maxAgeDs);
+
+	void Remove(NodeId sender);
+	void Clear();
+};
@@ -312,6 +312,8 @@ void MeshAccessConnection::HandshakeANonce(connPacketEncryptCustomStart const *
 		return;
 	}
 
+	Utility::Aes128PrepareKey((Aes128Block*)sessionDecryptionKey, &sessionDecryptionKeyContext);
+
 	SendData(
 		(u8*)&packet,
 		SIZEOF_CONN_PACKET_ENCRYPT_CUSTOM_ANONCE,
@@ -359,6 +361,9 @@ void MeshAccessConnection::HandshakeSNonce(connPacketEncryptCustomANonce const *
 		return;
 	}
 
+	Utility::Aes128PrepareKey((Aes128Block*)sessionEncryptionKey, &sessionEncryptionKeyContext);
+	Utility::Aes128PrepareKey((Aes128Block*)sessionDecryptionKey, &sessionDecryptionKeyContext);
+
 	LogKeys();
 
 	//Pay attention that we must only increment the encryption counter once the
@@ -409,6 +414,8 @@ void MeshAccessConnection::HandshakeDone(connPacketEncryptCustomSNonce const * i
 		return;
 	}
 
+	Utility::Aes128PrepareKey((Aes128Block*)sessionEncryptionKey, &sessionEncryptionKeyContext);
+
 	LogKeys();
 
 	//Send an encrypted packet to say that we are done
@@ -532,7 +539,7 @@ bool MeshAccessConnection::GenerateSessionKey(const u8* nonce, NodeId centralNod
 		return false;
 	}
 
-	// TO_HEX(ltKey, 16);
+	// TO_HEX("ERROR", ltKey, 16);
 	// logt("ERROR", "LongTerm Key is %s", ltKeyHex);
 
 	//Check if Long Term Key is empty
@@ -547,7 +554,7 @@ bool MeshAccessConnection::GenerateSessionKey(const u8* nonce, NodeId centralNod
 	CheckedMemcpy(cleartext, (u8*)&centralNodeId, 2);
 	CheckedMemcpy(((u8*)cleartext) + 2, nonce, MESH_ACCESS_HANDSHAKE_NONCE_LENGTH);
 
-//	TO_HEX(cleartext, 16);
+//	TO_HEX("ERROR", cleartext, 16);
 //	logt("ERROR", "SessionKeyCleartext %s", cleartextHex);
 
 	//Encrypt with our chosen Long Term Key
@@ -590,8 +597,8 @@ void MeshAccessConnection::OnCorruptedMessage()
 void MeshAccessConnection::LogKeys()
 {
 	//Log encryption and decryption keys
-	TO_HEX(sessionEncryptionKey, 16);
-	TO_HEX(sessionDecryptionKey, 16);
+	TO_HEX("MACONN", sessionEncryptionKey, 16);
+	TO_HEX("MACONN", sessionDecryptionKey, 16);
 	logt("MACONN", "EncrKey: %s", sessionEncryptionKeyHex);
 	logt("MACONN", "DecrKey: %s", sessionDecryptionKeyHex);
 }
@@ -609,129 +616,86 @@ void MeshAccessConnection::LogKeys()
  */
 void MeshAccessConnection::EncryptPacket(u8* data, u16 dataLength)
 {
-	TO_HEX(data, dataLength);
+	TO_HEX("MACONN", data, dataLength);
 	logt("MACONN", "Encrypting %s (%u) with nonce %u", dataHex, dataLength, encryptionNonce[1]);
 
-	u8 cleartext[16];
-	u8 keystream[16];
-	u8 ciphertext[16];
-
-	//Generate keystream with nonce
-	CheckedMemset(cleartext, 0x00, 16);
-	CheckedMemcpy(cleartext, encryptionNonce, MESH_ACCESS_HANDSHAKE_NONCE_LENGTH);
-	Utility::Aes128BlockEncrypt(
-			(Aes128Block*)cleartext,
-			(Aes128Block*)sessionEncryptionKey,
-			(Aes128Block*)keystream);
-
-//	TO_HEX(keystream, 16);
-//	logt("ERROR", "Encryption Keystream %s", keystreamHex);
-
-	//Xor cleartext with keystream to get the ciphertext
-	CheckedMemcpy(cleartext, data, dataLength);
-	Utility::XorBytes(keystream, cleartext, 16, ciphertext);
-	CheckedMemcpy(data, ciphertext, dataLength);
-
-	//Increment nonce being used as a counter
+	//Both keystreams only depend on the nonce and are generated at once, the first one
+	//is used to encrypt the data and the second one with the incremented counter for the MIC
+	Aes128Block counterBlocks[2];
+	Aes128Block keystreams[2];
+	CheckedMemset(counterBlocks, 0x00, sizeof(counterBlocks));
+	CheckedMemcpy(counterBlocks[0].data, encryptionNonce, MESH_ACCESS_HANDSHAKE_NONCE_LENGTH);
 	encryptionNonce[1]++;
+	CheckedMemcpy(counterBlocks[1].data, encryptionNonce, MESH_ACCESS_HANDSHAKE_NONCE_LENGTH);
+	//Reset nonce, it is incremented once the packet was successfully queued with the softdevice
+	encryptionNonce[1]--;
+	Utility::Aes128BlocksEncrypt(counterBlocks, sessionEncryptionKeyContext, keystreams, 2);
 
-	//Generate a new Keystream with an updated counter for MIC calculateion
-	CheckedMemset(cleartext, 0x00, 16);
-	CheckedMemcpy(cleartext, encryptionNonce, MESH_ACCESS_HANDSHAKE_NONCE_LENGTH);
-	Utility::Aes128BlockEncrypt( //encrypts nonce
-				(Aes128Block*)cleartext,
-				(Aes128Block*)sessionEncryptionKey,
-				(Aes128Block*)keystream);
+	//Xor cleartext with keystream to get the ciphertext
+	Utility::XorBytes(keystreams[0].data, data, dataLength, data);
 
-	//To generate the MIC, we xor the new keystream with our cleartext and encrypt it again
+	//To generate the MIC, we xor the new keystream with our ciphertext and encrypt it again
 	//we therefore create a pair that cannot be reproduced by an attacker (hopefully :-))
-	CheckedMemset(cleartext, 0x00, 16);
-	CheckedMemcpy(cleartext, data, dataLength);
-	Utility::XorBytes(keystream, cleartext, 16, cleartext);
-	Utility::Aes128BlockEncrypt(
-			(Aes128Block*)cleartext,
-			(Aes128Block*)sessionEncryptionKey,
-			(Aes128Block*)keystream);
-
-//	//Log the keystream generated by the nonce, 4 bytes of keystream are used as MIC
-//	u8 keystream2[16];
-//	CheckedMemcpy(keystream2, keystream, 16);
-//	TO_HEX(keystream2, 16);
-//	logt("ERROR", "MIC nonce %u produces Keystream %s", encryptionNonce[1], keystream2Hex);
-
-	//Reset nonce, it is incremented once the packet was successfully queued with the softdevice
-	encryptionNonce[1]--;
+	Aes128Block micBlock;
+	Aes128Block keystream;
+	CheckedMemset(&micBlock, 0x00, sizeof(micBlock));
+	CheckedMemcpy(micBlock.data, data, dataLength);
+	Utility::XorBytes(keystreams[1].data, micBlock.data, 16, micBlock.data);
+	Utility::Aes128BlockEncrypt(&micBlock, sessionEncryptionKeyContext, &keystream);
 
 	//Copy nonce to the end of the packet
 	u8* micPtr = data + dataLength;
-	CheckedMemcpy(micPtr, keystream, MESH_ACCESS_MIC_LENGTH);
+	CheckedMemcpy(micPtr, keystream.data, MESH_ACCESS_MIC_LENGTH);
 
 	//Log the encrypted packet
-	DYNAMIC_ARRAY(data2, dataLength + MESH_ACCESS_MIC_LENGTH);
-	CheckedMemcpy(data2, data, dataLength + MESH_ACCESS_MIC_LENGTH);
-	TO_HEX(data2, dataLength + MESH_ACCESS_MIC_LENGTH);
-	logt("MACONN", "Encrypted as %s (%u)", data2Hex, dataLength + MESH_ACCESS_MIC_LENGTH);
+	if (LOGT_ACTIVE("MACONN"))
+	{
+		DYNAMIC_ARRAY(data2, dataLength + MESH_ACCESS_MIC_LENGTH);
+		CheckedMemcpy(data2, data, dataLength + MESH_ACCESS_MIC_LENGTH);
+		TO_HEX("MACONN", data2, dataLength + MESH_ACCESS_MIC_LENGTH);
+		logt("MACONN", "Encrypted as %s (%u)", data2Hex, dataLength + MESH_ACCESS_MIC_LENGTH);
+	}
 }
 
 bool MeshAccessConnection::DecryptPacket(u8 const * data, u8 * decryptedOut, u16 dataLength)
 {
 	if(dataLength < 4) return false;
 
-	TO_HEX(data, dataLength);
+	TO_HEX("MACONN", data, dataLength);
 	logt("MACONN", "Decrypting %s (%u) with nonce %u", dataHex, dataLength, decryptionNonce[1]);
 
-	u8 cleartext[16];
-	u8 keystream[16];
-	u8 ciphertext[16];
-
-	//We need to calculate the MIC from the ciphertext as was done by the sender
+	//Generate the keystream for the message and the one with the incremented counter for the MIC at once
+	Aes128Block counterBlocks[2];
+	Aes128Block keystreams[2];
+	CheckedMemset(counterBlocks, 0x00, sizeof(counterBlocks));
+	CheckedMemcpy(counterBlocks[0].data, decryptionNonce, MESH_ACCESS_HANDSHAKE_NONCE_LENGTH);
 	decryptionNonce[1]++;
+	CheckedMemcpy(counterBlocks[1].data, decryptionNonce, MESH_ACCESS_HANDSHAKE_NONCE_LENGTH);
+	decryptionNonce[1]--;
+	Utility::Aes128BlocksEncrypt(counterBlocks, sessionDecryptionKeyContext, keystreams, 2);
 
-	//Generate a keystream from the nonce
-	CheckedMemset(cleartext, 0x00, 16);
-	CheckedMemcpy(cleartext, decryptionNonce, MESH_ACCESS_HANDSHAKE_NONCE_LENGTH);
-	Utility::Aes128BlockEncrypt( //encrypts nonce
-				(Aes128Block*)cleartext,
-				(Aes128Block*)sessionDecryptionKey,
-				(Aes128Block*)keystream);
-
-	//Xor the keystream with the ciphertext
-	CheckedMemset(ciphertext, 0x00, 16);
-	CheckedMemcpy(ciphertext, data, dataLength - MESH_ACCESS_MIC_LENGTH);
-	Utility::XorBytes(ciphertext, keystream, 16, cleartext);
-	//Encrypt the resulting cleartext
-	Utility::Aes128BlockEncrypt(
-			(Aes128Block*)cleartext,
-			(Aes128Block*)sessionDecryptionKey,
-			(Aes128Block*)keystream);
+	//We need to calculate the MIC from the ciphertext as was done by the sender
+	//Xor the keystream with the ciphertext and encrypt the result
+	Aes128Block micBlock;
+	Aes128Block keystream;
+	CheckedMemset(&micBlock, 0x00, sizeof(micBlock));
+	CheckedMemcpy(micBlock.data, data, dataLength - MESH_ACCESS_MIC_LENGTH);
+	Utility::XorBytes(micBlock.data, keystreams[1].data, 16, micBlock.data);
+	Utility::Aes128BlockEncrypt(&micBlock, sessionDecryptionKeyContext, &keystream);
 
 	//Check if the two MICs match
 	u8 const * micPtr = data + (dataLength - MESH_ACCESS_MIC_LENGTH);
-	u32 micCheck = memcmp(keystream, micPtr, MESH_ACCESS_MIC_LENGTH);
-
-	//Reset decryptionNonce for decrypting the message
-	decryptionNonce[1]--;
-
-	//Generate keystream with nonce
-	CheckedMemset(cleartext, 0x00, 16);
-	CheckedMemcpy(cleartext, decryptionNonce, MESH_ACCESS_HANDSHAKE_NONCE_LENGTH);
-	Utility::Aes128BlockEncrypt(
-			(Aes128Block*)cleartext,
-			(Aes128Block*)sessionDecryptionKey,
-			(Aes128Block*)keystream);
-
-//	TO_HEX(keystream, 16);
-//	logt("ERROR", "Keystream %s", keystreamHex);
+	u32 micCheck = memcmp(keystream.data, micPtr, MESH_ACCESS_MIC_LENGTH);
 
 	//Xor keystream with ciphertext to retrieve original message
-	Utility::XorBytes(keystream, data, dataLength - MESH_ACCESS_MIC_LENGTH, decryptedOut);
+	Utility::XorBytes(keystreams[0].data, data, dataLength - MESH_ACCESS_MIC_LENGTH, decryptedOut);
 
 	//Increment nonce being used as a counter
 	decryptionNonce[1] += 2;
 
 //	u8 keystream2[16];
 //	CheckedMemcpy(keystream2, keystream, 16);
-//	TO_HEX(keystream2, 16);
+//	TO_HEX("ERROR", keystream2, 16);
 //	logt("ERROR", "MIC nonce %u, Keystream %s", decryptionNonce[1], keystream2Hex);
 
 
@@ -890,7 +854,7 @@ bool MeshAccessConnection::SendData(BaseConnectionSendData* sendData, u8 const *
 }
 
 //Because we are using packet splitting, we must handle packetSendPosition and Discarding here
-void MeshAccessConnection::PacketSuccessfullyQueuedWithSoftdevice(PacketQueue* queue, BaseConnectionSendDataPacked* sendDataPacked, u8* data, SizedData* sentData)
+void MeshAccessConnection::PacketSuccessfullyQueuedWithSoftdevice(PooledPacketQueue* queue, BaseConnectionSendDataPacked* sendDataPacked, u8* data, SizedData* sentData)
 {
 	//The queued packet might be encrypted, so we must rely on the saved messageType that is saved
 	//by the ProcessDataBeforeTransmission method
@@ -902,12 +866,12 @@ void MeshAccessConnection::PacketSuccessfullyQueuedWithSoftdevice(PacketQueue* q
 	//If this was an intermediate split packet
 	if (lastProcessedMessageType == MessageType::SPLIT_WRITE_CMD) {
 		queue->packetSendPosition++;
-		packetSendQueue.packetSentRemaining++;
+		queue->packetSentRemaining++;
 	}
 	//The end of a split packet
 	else if (lastProcessedMessageType == MessageType::SPLIT_WRITE_CMD_END) {
 		queue->packetSendPosition = 0;
-		packetSendQueue.packetSentRemaining++;
+		queue->packetSentRemaining++;
 
 		//Save a queue handle for that packet
 		HandlePacketQueued(queue, sendDataPacked);
@@ -1037,7 +1001,7 @@ void MeshAccessConnection::ReceiveMeshAccessMessageHandler(BaseConnectionSendDat
 		tunnelType == MeshAccessTunnelType::PEER_TO_PEER
 		|| tunnelType == MeshAccessTunnelType::REMOTE_MESH
 	){
-		TO_HEX(data, sendData->dataLength);
+		TO_HEX("MACONN", data, sendData->dataLength);
 		logt("MACONN", "Received remote mesh data %s (%u) from %u", dataHex, sendData->dataLength, packetHeader->sender);
 
 		//Only dispatch to the local node, virtualPartnerId and remote nodeIds are kept in tact
@@ -1045,7 +1009,7 @@ void MeshAccessConnection::ReceiveMeshAccessMessageHandler(BaseConnectionSendDat
 	}
 	else if(tunnelType == MeshAccessTunnelType::LOCAL_MESH)
 	{
-		TO_HEX(data, sendData->dataLength);
+		TO_HEX("MACONN", data, sendData->dataLength);
 		logt("MACONN", "Received data for local mesh %s (%u) from %u aka %u", dataHex, sendData->dataLength, packetHeader->sender, virtualPartnerId);
 
 		//Send to other Mesh-like Connections
@@ -1140,11 +1104,10 @@ void MeshAccessConnection::PrintStatus()
 {
 	const char* directionString = (direction == ConnectionDirection::DIRECTION_IN) ? "IN " : "OUT";
 
-	trace("%s MA state:%u, Queue:%u-%u(%u), hnd:%u, partnerId/virtual:%u/%u, tunnel %u" EOL,
+	trace("%s MA state:%u, Queue:%u blocks(%u), hnd:%u, partnerId/virtual:%u/%u, tunnel %u" EOL,
 		directionString, 
 		(u32)this->connectionState, 
-		(packetSendQueue.readPointer - packetSendQueue.bufferStart), 
-		(packetSendQueue.writePointer - packetSendQueue.bufferStart), 
+		packetSendQueue.GetNumBlocks(), 
 		packetSendQueue._numElements,
 		connectionHandle, 
 		partnerId, 
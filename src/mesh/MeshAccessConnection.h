@@ -85,6 +85,9 @@ private:
 
 	u8 sessionEncryptionKey[16] = {};
 	u8 sessionDecryptionKey[16] = {};
+	//The session keys prepared for encryption, set up once per handshake
+	FruityHal::EcbKeyContext sessionEncryptionKeyContext = {};
+	FruityHal::EcbKeyContext sessionDecryptionKeyContext = {};
 
 	u32 encryptionNonce[2] = {};
 	u32 decryptionNonce[2] = {};
@@ -161,7 +164,7 @@ public:
 	bool SendData(BaseConnectionSendData* sendData, u8 const * data);
 	bool SendData(u8 const * data, u16 dataLength, DeliveryPriority priority, bool reliable) override final;
 	bool ShouldSendDataToNodeId(NodeId nodeId) const;
-	void PacketSuccessfullyQueuedWithSoftdevice(PacketQueue* queue, BaseConnectionSendDataPacked* sendDataPacked, u8* data, SizedData* sentData) override final;
+	void PacketSuccessfullyQueuedWithSoftdevice(PooledPacketQueue* queue, BaseConnectionSendDataPacked* sendDataPacked, u8* data, SizedData* sentData) override final;
 
 	/*############### Receiving ##################*/
 	void ReceiveDataHandler(BaseConnectionSendData* sendData, u8 const * data) override final;
@@ -65,6 +65,7 @@ MeshConnection::MeshConnection(u8 id, ConnectionDirection direction, FruityHal::
 	} else if (direction == ConnectionDirection::DIRECTION_OUT){
 		GS->cm.freeMeshOutConnections--;
 	}
+	GS->cm.meshConnectionChanges++;
 }
 
 MeshConnection::~MeshConnection(){
@@ -76,6 +77,7 @@ MeshConnection::~MeshConnection(){
 	else if (direction == ConnectionDirection::DIRECTION_OUT) {
 		GS->cm.freeMeshOutConnections++;
 	}
+	GS->cm.meshConnectionChanges++;
 }
 
 BaseConnection* MeshConnection::ConnTypeResolver(BaseConnection* oldConnection, BaseConnectionSendData* sendData, u8 const * data)
@@ -278,6 +280,8 @@ void MeshConnection::GapReconnectionSuccessfulHandler(const FruityHal::GapConnec
 	//Reset all send queues so that the packets are being sent again
 	ResendAllPackets(packetSendQueue);
 	ResendAllPackets(packetSendQueueHighPrio);
+	ResendAllPackets(packetSendQueueLowPrio);
+	ResendAllPackets(packetSendQueueLowestPrio);
 
 	//Also reset our reassembly buffer
 	packetReassemblyPosition = 0;
@@ -326,11 +330,6 @@ bool MeshConnection::SendData(BaseConnectionSendData* sendData, u8 const * data)
 {
 	if(!handshakeDone()) return false; //Do not allow data being sent when Handshake has not finished yet
 
-	//Print packet as hex
-	connPacketHeader const * packetHeader = (connPacketHeader const *)data;
-	char stringBuffer[100];
-	Logger::convertBufferToHexString(data, sendData->dataLength, stringBuffer, sizeof(stringBuffer));
-
 	//Mesh connections only support write cmd and req, no notifications,...
 	if(sendData->deliveryOption != DeliveryOption::WRITE_CMD
 		&& sendData->deliveryOption != DeliveryOption::WRITE_REQ){
@@ -343,8 +342,15 @@ bool MeshConnection::SendData(BaseConnectionSendData* sendData, u8 const * data)
 	//sending of packets by a factor of 14, so we only use them for mesh critical functionality such as clustering
 	sendData->deliveryOption = DeliveryOption::WRITE_CMD;
 
-	logt("CONN_DATA", "PUT_PACKET(%d):len:%d,type:%d,prio:%u,hex:%s",
-			connectionId, sendData->dataLength, (u32)packetHeader->messageType, (u32)sendData->priority, stringBuffer);
+	//Print packet as hex
+	if (LOGT_ACTIVE("CONN_DATA"))
+	{
+		connPacketHeader const * packetHeader = (connPacketHeader const *)data;
+		char stringBuffer[100];
+		Logger::convertBufferToHexString(data, sendData->dataLength, stringBuffer, sizeof(stringBuffer));
+		logt("CONN_DATA", "PUT_PACKET(%d):len:%d,type:%d,prio:%u,hex:%s",
+				connectionId, sendData->dataLength, (u32)packetHeader->messageType, (u32)sendData->priority, stringBuffer);
+	}
 
 	//Put packet in the queue for sending
 	return QueueData(*sendData, data);
@@ -422,25 +428,25 @@ SizedData MeshConnection::ProcessDataBeforeTransmission(BaseConnectionSendData*
 	return GetSplitData(*sendData, data, packetBuffer);
 }
 
-void MeshConnection::PacketSuccessfullyQueuedWithSoftdevice(PacketQueue* queue, BaseConnectionSendDataPacked* sendDataPacked, u8* data, SizedData* sentData)
+void MeshConnection::PacketSuccessfullyQueuedWithSoftdevice(PooledPacketQueue* queue, BaseConnectionSendDataPacked* sendDataPacked, u8* data, SizedData* sentData)
 {
 	connPacketHeader* splitPacketHeader = (connPacketHeader*) sentData->data;
 	//If this was an intermediate split packet
 	if (splitPacketHeader->messageType == MessageType::SPLIT_WRITE_CMD) {
-		packetSendQueue.packetSendPosition++;
-		packetSendQueue.packetSentRemaining++;
+		queue->packetSendPosition++;
+		queue->packetSentRemaining++;
 	}
 	//The end of a split packet
 	else if (splitPacketHeader->messageType == MessageType::SPLIT_WRITE_CMD_END) {
 		queue->packetSendPosition = 0;
-		packetSendQueue.packetSentRemaining++;
+		queue->packetSentRemaining++;
 
 		//Save a queue handle for that packet
 		HandlePacketQueued(queue, sendDataPacked);
 	}
 	//If this was a normal packet
 	else {
-		packetSendQueue.packetSendPosition = 0;
+		queue->packetSendPosition = 0;
 
 		//Save a queue handle for that packet
 		HandlePacketQueued(queue, sendDataPacked);
@@ -481,14 +487,22 @@ void MeshConnection::ReceiveDataHandler(BaseConnectionSendData* sendData, u8 con
 
 	connPacketHeader const * packetHeader = (connPacketHeader const *)data;
 
-	char stringBuffer[200];
-	Logger::convertBufferToHexString(data, sendData->dataLength, stringBuffer, sizeof(stringBuffer));
-	logt("CONN_DATA", "Mesh RX %d,length:%d,deliv:%d,data:%s", (u32)packetHeader->messageType, sendData->dataLength, (u32)sendData->deliveryOption, stringBuffer);
+	if (LOGT_ACTIVE("CONN_DATA"))
+	{
+		char stringBuffer[200];
+		Logger::convertBufferToHexString(data, sendData->dataLength, stringBuffer, sizeof(stringBuffer));
+		logt("CONN_DATA", "Mesh RX %d,length:%d,deliv:%d,data:%s", (u32)packetHeader->messageType, sendData->dataLength, (u32)sendData->deliveryOption, stringBuffer);
+	}
 
 	//This will reassemble the data for us
 	data = ReassembleData(sendData, data);
 
 	if(data != nullptr){
+		if (((connPacketHeader const *)data)->messageType == MessageType::AGGREGATED_WRITE_CMD) {
+			ReceiveAggregatedDataHandler(sendData, data);
+			return;
+		}
+
 		//Route the packet to our other mesh connections
 		GS->cm.RouteMeshData(this, sendData, data);
 
@@ -497,6 +511,32 @@ void MeshConnection::ReceiveDataHandler(BaseConnectionSendData* sendData, u8 con
 	}
 }
 
+void MeshConnection::ReceiveAggregatedDataHandler(BaseConnectionSendData* sendData, u8 const * data)
+{
+	//Handling a message might remove this connection, so we must check if it still exists before handling the next one
+	MeshConnectionHandle connection(*this);
+
+	u16 position = SIZEOF_CONN_PACKET_AGGREGATION_HEADER;
+	while (position < sendData->dataLength)
+	{
+		BaseConnectionSendData messageSendData = *sendData;
+		messageSendData.dataLength = data[position];
+		u8 const * message = data + position + 1;
+		position += 1 + messageSendData.dataLength;
+
+		if (messageSendData.dataLength < SIZEOF_CONN_PACKET_HEADER || position > sendData->dataLength) {
+			logt("ERROR", "Malformed aggregated packet");
+			GS->logger.logCustomError(CustomErrorTypes::WARN_RX_WRONG_DATA, sendData->dataLength);
+			return;
+		}
+
+		GS->cm.RouteMeshData(this, &messageSendData, message);
+		ReceiveMeshMessageHandler(&messageSendData, message);
+
+		if (!connection) return;
+	}
+}
+
 void MeshConnection::ReceiveMeshMessageHandler(BaseConnectionSendData* sendData, u8 const * data)
 {
 	connPacketHeader const * packetHeader = (connPacketHeader const *) data;
@@ -512,6 +552,7 @@ void MeshConnection::ReceiveMeshMessageHandler(BaseConnectionSendData* sendData,
 		GS->logger.logCustomError(CustomErrorTypes::WARN_RX_WRONG_DATA, (u32)sendData->dataLength);
 	}
 	//Print packet as hex
+	if (LOGT_ACTIVE("CONN_DATA"))
 	{
 		char stringBuffer[100];
 		Logger::convertBufferToHexString(data, sendData->dataLength, stringBuffer, sizeof(stringBuffer));
@@ -603,10 +644,11 @@ void MeshConnection::StartHandshakeAfterMtuExchange()
 
 	packet.payload.preferredConnectionInterval = 0; //Unused at the moment
 	packet.payload.networkId = GS->node.configuration.networkId;
+	packet.payload.meshFeatures = GetSupportedFeatures();
 
 	logt("HANDSHAKE", "OUT => conn(%u) CLUSTER_WELCOME, cID:%x, cSize:%d, hops:%d", connectionId, packet.payload.clusterId, packet.payload.clusterSize, packet.payload.hopsToSink);
 
-	SendHandshakeMessage((u8*) &packet, SIZEOF_CONN_PACKET_CLUSTER_WELCOME_WITH_NETWORK_ID, true);
+	SendHandshakeMessage((u8*) &packet, SIZEOF_CONN_PACKET_CLUSTER_WELCOME_WITH_FEATURES, true);
 }
 
 void MeshConnection::ReceiveHandshakePacketHandler(BaseConnectionSendData* sendData, u8 const * data)
@@ -699,6 +741,11 @@ void MeshConnection::ReceiveHandshakePacketHandler(BaseConnectionSendData* sendD
 
 				//Update my own information on the connection
 				this->partnerId = packet->header.sender;
+				GS->cm.meshConnectionChanges++;
+
+				//Later versions of the packet tell us about the optional features of our partner
+				const u8 partnerFeatures = sendData->dataLength >= SIZEOF_CONN_PACKET_CLUSTER_WELCOME_WITH_FEATURES ? packet->payload.meshFeatures : 0;
+				packetAggregationEnabled = (GetSupportedFeatures() & partnerFeatures & MESH_FEATURE_PACKET_AGGREGATION) != 0;
 
 				//Send an update to the connected cluster to increase the size by one
 				//This is also the ACK message for our connecting node
@@ -709,10 +756,12 @@ void MeshConnection::ReceiveHandshakePacketHandler(BaseConnectionSendData* sendD
 				packet.header.receiver = this->partnerId;
 
 				packet.payload.hopsToSink = GET_DEVICE_TYPE() == DeviceType::SINK ? 0 : -1;
+				packet.payload.preferredConnectionInterval = 0; //Unused at the moment
+				packet.payload.meshFeatures = GetSupportedFeatures();
 
 				logt("HANDSHAKE", "OUT => %d CLUSTER_ACK_1, hops:%d", packet.header.receiver, packet.payload.hopsToSink);
 
-				SendHandshakeMessage((u8*) &packet, SIZEOF_CONN_PACKET_CLUSTER_ACK_1, true);
+				SendHandshakeMessage((u8*) &packet, SIZEOF_CONN_PACKET_CLUSTER_ACK_1_WITH_FEATURES, true);
 				
 				//Kill other Connections and check if this connection has been removed in the process
 				GS->cm.ForceDisconnectOtherMeshConnections(this, AppDisconnectReason::I_AM_SMALLER);
@@ -743,8 +792,10 @@ void MeshConnection::ReceiveHandshakePacketHandler(BaseConnectionSendData* sendD
 				GS->logger.logCustomCount(CustomErrorTypes::COUNT_HANDSHAKE_ACK1_DUPLICATE);
 			}
 
-			//Save ACK1 packet for later
-			CheckedMemcpy(&clusterAck1Packet, data, sizeof(connPacketClusterAck1));
+			//Save ACK1 packet for later, older versions of the packet do not contain the features
+			CheckedMemset(&clusterAck1Packet, 0x00, sizeof(connPacketClusterAck1));
+			CheckedMemcpy(&clusterAck1Packet, data, sendData->dataLength < sizeof(connPacketClusterAck1) ? sendData->dataLength : sizeof(connPacketClusterAck1));
+			packetAggregationEnabled = (GetSupportedFeatures() & clusterAck1Packet.payload.meshFeatures & MESH_FEATURE_PACKET_AGGREGATION) != 0;
 
 			logt("HANDSHAKE", "IN <= %d  CLUSTER_ACK_1, hops:%d", clusterAck1Packet.header.sender, clusterAck1Packet.payload.hopsToSink);
 
@@ -752,6 +803,7 @@ void MeshConnection::ReceiveHandshakePacketHandler(BaseConnectionSendData* sendD
 			//Set the master bit for the connection. If the connection would disconnect
 			//Then we could keep intact and the other one must dissolve
 			this->partnerId = clusterAck1Packet.header.sender;
+			GS->cm.meshConnectionChanges++;
 			this->connectionMasterBit = 1;
 			this->hopsToSink = clusterAck1Packet.payload.hopsToSink;
 			logt("HANDSHAKE", "NODE %u CREATED MASTERBIT", GS->node.configuration.nodeId);
@@ -897,13 +949,19 @@ void MeshConnection::ReceiveReconnectionHandshakePacket(connPacketReconnect cons
 
 bool MeshConnection::GetPendingPackets() {
 	//Adds 1 if a clusterUpdatePacket must be send
-	return packetSendQueue._numElements + packetSendQueueHighPrio._numElements + (currentClusterInfoUpdatePacket.header.messageType == MessageType::INVALID ? 0 : 1);
+	return packetSendQueue._numElements + packetSendQueueHighPrio._numElements + packetSendQueueLowPrio._numElements + packetSendQueueLowestPrio._numElements + (currentClusterInfoUpdatePacket.header.messageType == MessageType::INVALID ? 0 : 1);
 }
+u8 MeshConnection::GetSupportedFeatures() const
+{
+	return GS->config.enablePacketAggregation ? MESH_FEATURE_PACKET_AGGREGATION : 0;
+}
+
 bool MeshConnection::IsValidMessageType(MessageType t)
 {
 	switch (t) {
 		case(MessageType::SPLIT_WRITE_CMD):
 		case(MessageType::SPLIT_WRITE_CMD_END):
+		case(MessageType::AGGREGATED_WRITE_CMD):
 		case(MessageType::CLUSTER_WELCOME):
 		case(MessageType::CLUSTER_ACK_1):
 		case(MessageType::CLUSTER_ACK_2):
@@ -939,7 +997,7 @@ void MeshConnection::PrintStatus()
 {
 	const char* directionString = (direction == ConnectionDirection::DIRECTION_IN) ? "IN " : "OUT";
 
-	trace("%s(%d) FM %u, state:%u, cluster:%x(%d), sink:%d, Queue:%u-%u(%u), mb:%u, hnd:%u, tSync:%u, sent:%u, rssi:%d" EOL, directionString, connectionId, this->partnerId, (u32)this->connectionState, this->connectedClusterId, this->connectedClusterSize, this->hopsToSink, (packetSendQueue.readPointer - packetSendQueue.bufferStart), (packetSendQueue.writePointer - packetSendQueue.bufferStart), packetSendQueue._numElements, connectionMasterBit, connectionHandle, (u32)timeSyncState, sentUnreliable, GetAverageRSSI());
+	trace("%s(%d) FM %u, state:%u, cluster:%x(%d), sink:%d, Queue:%u blocks(%u), mb:%u, hnd:%u, tSync:%u, sent:%u, rssi:%d" EOL, directionString, connectionId, this->partnerId, (u32)this->connectionState, this->connectedClusterId, this->connectedClusterSize, this->hopsToSink, packetSendQueue.GetNumBlocks(), packetSendQueue._numElements, connectionMasterBit, connectionHandle, (u32)timeSyncState, sentUnreliable, GetAverageRSSI());
 }
 
 void MeshConnection::setHopsToSink(ClusterSize hops)
@@ -125,7 +125,7 @@ class MeshConnection
 		bool TransmitHighPrioData() override final;
 		void ClearCurrentClusterInfoUpdatePacket();
 		SizedData ProcessDataBeforeTransmission(BaseConnectionSendData* sendData, u8* data, u8* packetBuffer) override final;
-		void PacketSuccessfullyQueuedWithSoftdevice(PacketQueue* queue, BaseConnectionSendDataPacked* sendDataPacked, u8* data, SizedData* sentData) override final;
+		void PacketSuccessfullyQueuedWithSoftdevice(PooledPacketQueue* queue, BaseConnectionSendDataPacked* sendDataPacked, u8* data, SizedData* sentData) override final;
 		void DataSentHandler(const u8* data, u16 length) override final;
 
 		bool SendData(BaseConnectionSendData* sendData, u8 const * data);
@@ -135,6 +135,8 @@ class MeshConnection
 		void ReceiveDataHandler(BaseConnectionSendData* sendData, u8 const * data) override final;
 		//Called for received mesh messages after data has been processed
 		void ReceiveMeshMessageHandler(BaseConnectionSendData* sendData, u8 const * data);
+		//Unpacks the messages of an aggregated write and handles each of them
+		void ReceiveAggregatedDataHandler(BaseConnectionSendData* sendData, u8 const * data);
 
 		//Handler
 		bool GapDisconnectionHandler(FruityHal::BleHciError hciDisconnectReason) override final;
@@ -144,6 +146,8 @@ class MeshConnection
 		void PrintStatus() override final;
 		bool GetPendingPackets() override final;
 		bool IsValidMessageType(MessageType type);
+		//Returns the optional features (MESH_FEATURE_...) that this node offers during the handshake
+		u8 GetSupportedFeatures() const;
 
 		//Setter
 		void setHopsToSink(ClusterSize hops);
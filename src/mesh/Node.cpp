@@ -118,7 +118,15 @@ void Node::ConfigurationLoadedHandler(ModuleConfiguration* migratableConfig, u16
 	}
 
 	//Random offset that can be used to disperse packets from different nodes over time
+	const u16 previousAppTimerRandomOffsetDs = GS->appTimerRandomOffsetDs;
 	GS->appTimerRandomOffsetDs = (configuration.nodeId % 100);
+	if (GS->appTimerRandomOffsetDs != previousAppTimerRandomOffsetDs) {
+		//The timers of the StatusReporterModule were aligned to the previous offset
+		StatusReporterModule* statusMod = (StatusReporterModule*)GetModuleById(ModuleId::STATUS_REPORTER_MODULE);
+		if (statusMod != nullptr) {
+			statusMod->AppTimerRandomOffsetChangedHandler();
+		}
+	}
 
 	//Change window title of the Terminal
 	SetTerminalTitle();
@@ -262,13 +270,7 @@ void Node::HandshakeDoneHandler(MeshConnection* connection, bool completedAsWinn
 	GS->logger.logCustomCount(CustomErrorTypes::COUNT_HANDSHAKE_DONE);
 
 	//We delete the joinMe packet of this node from the join me buffer
-	for (u32 i = 0; i < joinMePackets.size(); i++)
-	{
-		joinMeBufferPacket* packet = &joinMePackets[i];
-		if (packet->payload.sender == connection->partnerId) {
-			CheckedMemset(packet, 0x00, sizeof(joinMeBufferPacket));
-		}
-	}
+	joinMePackets.Remove(connection->partnerId);
 
 	//We can now commit the changes that were part of the handshake
 	//This node was the winner of the handshake and successfully acquired a new member
@@ -282,6 +284,7 @@ void Node::HandshakeDoneHandler(MeshConnection* connection, bool completedAsWinn
 		//Update connection data
 		connection->connectedClusterId = connection->clusterIDBackup;
 		connection->partnerId = connection->clusterAck1Packet.header.sender;
+		GS->cm.meshConnectionChanges++;
 		connection->connectedClusterSize = 1;
 
 		//Broadcast cluster update to other connections
@@ -426,6 +429,10 @@ void Node::MeshConnectionDisconnectedHandler(AppDisconnectReason appDisconnectRe
 	if (
 		connectionStateBeforeDisconnection >= ConnectionState::HANDSHAKE_DONE
 	){
+		//Nodes behind this connection might reappear somewhere else in the cluster
+		GS->cm.unicastRoutes.Clear();
+		GS->cm.recentlyRoutedPackets.Clear();
+
 		//CASE 1: if our partner has the connection master bit, we must dissolve
 		//It may happen rarely that the connection master bit was just passed over and that neither node has it
 		//This will result in two clusters dissolving
@@ -515,6 +522,13 @@ void Node::ReceiveClusterInfoUpdate(MeshConnection* connection, connPacketCluste
 		logt("HANDSHAKE", "ClusterSize Change from %d to %d", this->clusterSize, this->clusterSize + packet->payload.clusterSizeChange);
 		this->clusterSize += packet->payload.clusterSizeChange;
 		connection->connectedClusterSize += packet->payload.clusterSizeChange;
+
+		//Nodes left the cluster somewhere, they might reconnect at a different position
+		if (packet->payload.clusterSizeChange < 0)
+		{
+			GS->cm.unicastRoutes.Clear();
+			GS->cm.recentlyRoutedPackets.Clear();
+		}
 	}
 
 	//Update hops to sink
@@ -1496,8 +1510,10 @@ u32 Node::ModifyScoreBasedOnPreferredPartners(u32 score, NodeId partner) const
 	return score;
 }
 
-joinMeBufferPacket * Node::DetermineBestCluster(u32(Node::*clusterRatingFunction)(const joinMeBufferPacket &packet) const)
+joinMeBufferPacket * Node::DetermineBestCluster(bool asMaster)
 {
+	UpdateJoinMeScores();
+
 	u32 bestScore = 0;
 	joinMeBufferPacket* bestCluster = nullptr;
 
@@ -1506,8 +1522,8 @@ joinMeBufferPacket * Node::DetermineBestCluster(u32(Node::*clusterRatingFunction
 		joinMeBufferPacket* packet = &joinMePackets[i];
 		if (packet->payload.sender == 0) continue;
 
-		u32 score = (this->*clusterRatingFunction)(*packet);
-		if (score > bestScore)
+		u32 score = asMaster ? joinMePackets.GetScores(i).asMaster : joinMePackets.GetScores(i).asSlave;
+		if (score > bestScore && IsClusterAvailable(*packet, asMaster))
 		{
 			bestScore = score;
 			bestCluster = packet;
@@ -1518,21 +1534,60 @@ joinMeBufferPacket * Node::DetermineBestCluster(u32(Node::*clusterRatingFunction
 
 joinMeBufferPacket* Node::DetermineBestClusterAsSlave()
 {
-	return DetermineBestCluster(&Node::CalculateClusterScoreAsSlave);
+	return DetermineBestCluster(false);
 }
 
 joinMeBufferPacket* Node::DetermineBestClusterAsMaster()
 {
-	return DetermineBestCluster(&Node::CalculateClusterScoreAsMaster);
+	return DetermineBestCluster(true);
+}
+
+void Node::UpdateJoinMeScores()
+{
+	if (
+		joinMeScoreContext.clusterId == clusterId
+		&& joinMeScoreContext.clusterSize == clusterSize
+		&& joinMeScoreContext.meshConnectionChanges == GS->cm.meshConnectionChanges
+	) {
+		return;
+	}
+
+	joinMeScoreContext.clusterId = clusterId;
+	joinMeScoreContext.clusterSize = clusterSize;
+	joinMeScoreContext.meshConnectionChanges = GS->cm.meshConnectionChanges;
+
+	for (u32 i = 0; i < joinMePackets.size(); i++)
+	{
+		const joinMeBufferPacket& packet = joinMePackets[i];
+		if (packet.payload.sender == 0) continue;
+
+		joinMePackets.SetScores(i, CalculateClusterScoreAsMaster(packet), CalculateClusterScoreAsSlave(packet));
+	}
+}
+
+bool Node::IsClusterAvailable(const joinMeBufferPacket& packet, bool asMaster) const
+{
+	//If the packet is too old, filter it out
+	if (GS->appTimerDs - packet.receivedTimeDs > MAX_JOIN_ME_PACKET_AGE_DS) return false;
+
+	//Check if we recently tried to connect to him and blacklist him for a short amount of time
+	if (
+		asMaster
+		&& packet.lastConnectAttemptDs != 0
+		&& packet.attemptsToConnect > connectAttemptsBeforeBlacklisting
+		&& packet.lastConnectAttemptDs + SEC_TO_DS(1) * packet.attemptsToConnect > GS->appTimerDs) {
+		SIMSTATCOUNT("tempBlacklist");
+		logt("NODE", "temporarily blacklisting node %u, attempts: %u", packet.payload.sender, packet.attemptsToConnect);
+		return false;
+	}
+
+	return true;
 }
 
 //Calculates the score for a cluster
 //Connect to big clusters but big clusters must connect nodes that are not able 
 u32 Node::CalculateClusterScoreAsMaster(const joinMeBufferPacket& packet) const
 {
-	//If the packet is too old, filter it out
-	if (GS->appTimerDs - packet.receivedTimeDs > MAX_JOIN_ME_PACKET_AGE_DS) return 0;
-
 	//If we are already connected to that cluster, the score is 0
 	if (packet.payload.clusterId == this->clusterId) return 0;
 
@@ -1545,16 +1600,6 @@ u32 Node::CalculateClusterScoreAsMaster(const joinMeBufferPacket& packet) const
 	//If the other cluster is bigger, we cannot connect as master
 	if (packet.payload.clusterSize > this->clusterSize) return 0;
 
-	//Check if we recently tried to connect to him and blacklist him for a short amount of time
-	if (
-		packet.lastConnectAttemptDs != 0
-		&& packet.attemptsToConnect > connectAttemptsBeforeBlacklisting
-		&& packet.lastConnectAttemptDs + SEC_TO_DS(1) * packet.attemptsToConnect > GS->appTimerDs) {
-		SIMSTATCOUNT("tempBlacklist");
-		logt("NODE", "temporarily blacklisting node %u, attempts: %u", packet.payload.sender, packet.attemptsToConnect);
-		return 0;
-	}
-
 	//Do not connect if we are already connected to that partner
 	if (GS->cm.GetMeshConnectionToPartner(packet.payload.sender)) return 0;
 
@@ -1577,9 +1622,6 @@ u32 Node::CalculateClusterScoreAsMaster(const joinMeBufferPacket& packet) const
 //And set its id in our ack field
 u32 Node::CalculateClusterScoreAsSlave(const joinMeBufferPacket& packet) const
 {
-	//If the packet is too old, filter it out
-	if (GS->appTimerDs - packet.receivedTimeDs > MAX_JOIN_ME_PACKET_AGE_DS) return 0;
-
 	//If we are already connected to that cluster, the score is 0
 	if (packet.payload.clusterId == this->clusterId) return 0;
 
@@ -1634,6 +1676,9 @@ void Node::GapAdvertisementMessageHandler(const FruityHal::GapAdvertisementRepor
 
 			logt("DISCOVERY", "JOIN_ME: sender:%u, clusterId:%x, clusterSize:%d, freeIn:%u, freeOut:%u, ack:%u", packet->payload.sender, packet->payload.clusterId, packet->payload.clusterSize, packet->payload.freeMeshInConnections, packet->payload.freeMeshOutConnections, packet->payload.ackField);
 
+			//The scores of the other packets must be up to date before one of them is replaced
+			UpdateJoinMeScores();
+
 			//Look through the buffer and determine a space where we can put the packet in
 			joinMeBufferPacket* targetBuffer = findTargetBuffer(packet);
 
@@ -1647,6 +1692,8 @@ void Node::GapAdvertisementMessageHandler(const FruityHal::GapAdvertisementRepor
 				targetBuffer->receivedTimeDs = GS->appTimerDs;
 
 				targetBuffer->payload = packet->payload;
+
+				joinMePackets.Update(targetBuffer, CalculateClusterScoreAsMaster(*targetBuffer), CalculateClusterScoreAsSlave(*targetBuffer));
 			}
 		}
 	}
@@ -1655,75 +1702,32 @@ void Node::GapAdvertisementMessageHandler(const FruityHal::GapAdvertisementRepor
 
 joinMeBufferPacket* Node::findTargetBuffer(const advPacketJoinMeV0* packet)
 {
-	joinMeBufferPacket* targetBuffer = nullptr;
-
 	//First, look if a packet from this node is already in the buffer, if yes, we use this space
-	for (u32 i = 0; i < joinMePackets.size(); i++)
+	joinMeBufferPacket* targetBuffer = joinMePackets.Find(packet->payload.sender);
+	if (targetBuffer != nullptr)
 	{
-		targetBuffer = &joinMePackets[i];
-
-		if (packet->payload.sender == targetBuffer->payload.sender)
-		{
-			logt("DISCOVERY", "Updated old buffer packet");
-			return targetBuffer;
-		}
+		logt("DISCOVERY", "Updated old buffer packet");
+		return targetBuffer;
 	}
-	targetBuffer = nullptr;
 
 	//Next, we look if there's an empty space
-	for (u32 i = 0; i < joinMePackets.size(); i++)
+	targetBuffer = joinMePackets.Add(packet->payload.sender);
+	if (targetBuffer != nullptr)
 	{
-		targetBuffer = &(joinMePackets[i]);
-
-		if(targetBuffer->payload.sender == 0)
-		{
-			logt("DISCOVERY", "Used empty space");
-			KeepHighDiscoveryActive();
-			return targetBuffer;
-		}
-	}
-	targetBuffer = nullptr;
-
-	//Next, we can overwrite the oldest packet that we saved from our own cluster
-	u32 oldestTimestamp = UINT32_MAX;
-	for (u32 i = 0; i < joinMePackets.size(); i++)
-	{
-		joinMeBufferPacket* tmpPacket = &joinMePackets[i];
-
-		if(tmpPacket->payload.clusterId == clusterId && tmpPacket->receivedTimeDs < oldestTimestamp){
-			oldestTimestamp = tmpPacket->receivedTimeDs;
-			targetBuffer = tmpPacket;
-		}
-	}
-
-	if(targetBuffer != nullptr){
-		logt("DISCOVERY", "Overwrote one from our own cluster");
+		logt("DISCOVERY", "Used empty space");
+		KeepHighDiscoveryActive();
 		return targetBuffer;
 	}
 
-	//If there's still no space, we overwrite the oldest packet that we received, this will not fail
-	//TODO: maybe do not use oldest one but worst candidate?? Use clusterScore on all packets to find the least interesting
-	u32 minScore = UINT32_MAX;
-	for (u32 i = 0; i < joinMePackets.size(); i++)
-	{
-		joinMeBufferPacket* tmpPacket = &joinMePackets[i];
+	//If there's still no space, we overwrite a packet that is too old or otherwise the worst candidate,
+	//packets from our own cluster have a score of 0 and are therefore replaced before all others
+	const joinMeBufferPacket* worstPacket = joinMePackets.GetWorstPacket(GS->appTimerDs, MAX_JOIN_ME_PACKET_AGE_DS);
+	if (worstPacket == nullptr) return nullptr;
 
-		u32 score = 0;
-		if (packet->payload.clusterSize >= clusterSize) {
-			score = CalculateClusterScoreAsMaster(*tmpPacket);
-		}
-		else {
-			score = CalculateClusterScoreAsSlave(*tmpPacket);
-		}
-
-		if(score < minScore){
-			minScore = score;
-			targetBuffer = tmpPacket;
-		}
-	}
+	logt("DISCOVERY", "Overwrote worst packet from %u", worstPacket->payload.sender);
+	joinMePackets.Remove(worstPacket->payload.sender);
 
-	logt("DISCOVERY", "Overwrote worst packet from different cluster");
-	return targetBuffer;
+	return joinMePackets.Add(packet->payload.sender);
 }
 
 /*
@@ -40,6 +40,7 @@
 #include <AdvertisingController.h>
 #include <ScanController.h>
 #include "MeshConnection.h"
+#include "JoinMeBuffer.h"
 #include <RecordStorage.h>
 #include <Module.h>
 #include <Terminal.h>
@@ -211,17 +212,6 @@ struct EmergencyDisconnectResponseMessage
 STATIC_ASSERT_SIZE(EmergencyDisconnectResponseMessage, 1);
 #pragma pack(pop)
 
-typedef struct
-{
-	FruityHal::BleGapAddr    addr;
-	FruityHal::BleGapAdvType advType;
-	i8                       rssi;
-	u8                       attemptsToConnect;
-	u32                      receivedTimeDs;
-	u32                      lastConnectAttemptDs;
-	advPacketPayloadJoinMeV0 payload;
-}joinMeBufferPacket;
-
 //meshServiceStruct that contains all information about the meshService
 typedef struct meshServiceStruct_temporary
 {
@@ -283,17 +273,30 @@ private:
 
 		void SendModuleList(NodeId toNode, u8 requestHandle) const;
 
-		void SendRawError(NodeId receiver, ModuleId moduleId, RawDataErrorType type, RawDataErrorDestination destination, u8 requestHandle) const;
 		bool CreateRawHeader(RawDataHeader* outVal, RawDataActionType type, const char* commandArgs[], const char* requestHandle) const;
 
 		u32 ModifyScoreBasedOnPreferredPartners(u32 score, NodeId partner) const;
 		
-		joinMeBufferPacket* DetermineBestCluster		(u32(Node::*clusterRatingFunction)(const joinMeBufferPacket& packet) const);
+		joinMeBufferPacket* DetermineBestCluster		(bool asMaster);
 		joinMeBufferPacket* DetermineBestClusterAsSlave ();
 		joinMeBufferPacket* DetermineBestClusterAsMaster();
 
+		//The scores only depend on the packet, our cluster and our mesh connections so that they can be cached in the join me buffer
 		u32 CalculateClusterScoreAsMaster(const joinMeBufferPacket& packet) const;
 		u32 CalculateClusterScoreAsSlave(const joinMeBufferPacket& packet) const;
+		//Checks the time dependent conditions that can not be cached in the scores
+		bool IsClusterAvailable(const joinMeBufferPacket& packet, bool asMaster) const;
+
+		//The state on which the cached scores of the join me buffer are based
+		struct JoinMeScoreContext
+		{
+			ClusterId clusterId;
+			ClusterSize clusterSize;
+			u32 meshConnectionChanges;
+		};
+		JoinMeScoreContext joinMeScoreContext = {};
+		//Recalculates the cached scores of all join me packets if our cluster or connections changed since they were calculated
+		void UpdateJoinMeScores();
 
 		bool DoesBiggerKnownClusterExist();
 
@@ -335,8 +338,8 @@ private:
 
 
 		static constexpr int MAX_JOIN_ME_PACKET_AGE_DS = SEC_TO_DS(10);
-		static constexpr int JOIN_ME_PACKET_BUFFER_MAX_ELEMENTS = 10;
-		std::array<joinMeBufferPacket, JOIN_ME_PACKET_BUFFER_MAX_ELEMENTS> joinMePackets{};
+		static constexpr int JOIN_ME_PACKET_BUFFER_MAX_ELEMENTS = JoinMeBuffer::NUM_ELEMENTS;
+		JoinMeBuffer joinMePackets;
 		ClusterId currentAckId = 0;
 		u16 connectionLossCounter = 0;
 		u16 randomBootNumber = 0;
@@ -420,6 +423,9 @@ private:
 
 		void SendComponentMessage(connPacketComponentMessage& message, u16 payloadSize);
 
+		//Cancels a raw data transmission, can also be used by modules that send raw data
+		void SendRawError(NodeId receiver, ModuleId moduleId, RawDataErrorType type, RawDataErrorDestination destination, u8 requestHandle) const;
+
 		//Stuff
 		Node::DecisionStruct DetermineBestClusterAvailable(void);
 		void UpdateJoinMePacket() const;
@@ -73,5 +73,5 @@ void ResolverConnection::PrintStatus()
 {
 	const char* directionString = (direction == ConnectionDirection::DIRECTION_IN) ? "IN " : "OUT";
 
-	trace("%s RSV state:%u, Queue:%u-%u(%u), hnd:%u" EOL, directionString, (u32)this->connectionState, (packetSendQueue.readPointer - packetSendQueue.bufferStart), (packetSendQueue.writePointer - packetSendQueue.bufferStart), packetSendQueue._numElements, connectionHandle);
+	trace("%s RSV state:%u, Queue:%u blocks(%u), hnd:%u" EOL, directionString, (u32)this->connectionState, packetSendQueue.GetNumBlocks(), packetSendQueue._numElements, connectionHandle);
 }
@@ -52,6 +52,9 @@ AdvertisingModule::AdvertisingModule()
 	configurationPointer = &configuration;
 	configurationLength = sizeof(AdvertisingModuleConfiguration);
 
+	//The advertising jobs are scheduled by the AdvertisingController
+	needsTimerEventHandler = false;
+
 	//Set defaults
 	ResetToDefaultConfiguration();
 }
@@ -96,15 +96,17 @@ class DebugModule: public Module
 		#pragma pack(push)
 		#pragma pack(1)
 
-		static constexpr int SIZEOF_DEBUG_MODULE_INFO_MESSAGE = 8;
+		static constexpr int SIZEOF_DEBUG_MODULE_INFO_MESSAGE = 12;
 		typedef struct
 		{
 			u16 connectionLossCounter;
 			u16 droppedPackets;
 			u16 sentPacketsReliable;
 			u16 sentPacketsUnreliable;
+			u16 duplicatePacketCacheHits;
+			u16 duplicatePacketCacheMisses;
 		} DebugModuleInfoMessage;
-		STATIC_ASSERT_SIZE(DebugModuleInfoMessage, 8);
+		STATIC_ASSERT_SIZE(DebugModuleInfoMessage, 12);
 
 		static constexpr int SIZEOF_DEBUG_MODULE_PINGPONG_MESSAGE = 1;
 		typedef struct
@@ -60,6 +60,9 @@ EnrollmentModule::EnrollmentModule()
 	configurationPointer = &configuration;
 	configurationLength = sizeof(EnrollmentModuleConfiguration);
 
+	//Only mesh access packets of other beacons are of interest for enrollments
+	GS->scanController.SubscribeToAdvertisements(this, BleGapAdType::TYPE_SERVICE_DATA, MESH_SERVICE_DATA_SERVICE_UUID16, ServiceDataMessageType::MESH_ACCESS);
+
 	//Set defaults
 	ResetToDefaultConfiguration();
 }
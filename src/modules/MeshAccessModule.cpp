@@ -52,6 +52,8 @@ MeshAccessModule::MeshAccessModule()
 	gattRegistered = false;
 	CheckedMemset(&meshAccessSerialConnectMessage, 0, sizeof(meshAccessSerialConnectMessage));
 
+	GS->scanController.SubscribeToAdvertisements(this, BleGapAdType::TYPE_SERVICE_DATA, MESH_SERVICE_DATA_SERVICE_UUID16, ServiceDataMessageType::MESH_ACCESS);
+
 	//Set defaults
 	ResetToDefaultConfiguration();
 }
@@ -334,9 +336,12 @@ void MeshAccessModule::UpdateMeshAccessBroadcastPacket(u16 advIntervalMs)
 
 	//FIXME: Adv data must be worng, not advertising
 
-	char cbuffer[100];
-	Logger::convertBufferToHexString(buffer, length, cbuffer, sizeof(cbuffer));
-	logt("MAMOD", "Broadcasting mesh access %s, len %u", cbuffer, length);
+	if (LOGT_ACTIVE("MAMOD"))
+	{
+		char cbuffer[100];
+		Logger::convertBufferToHexString(buffer, length, cbuffer, sizeof(cbuffer));
+		logt("MAMOD", "Broadcasting mesh access %s, len %u", cbuffer, length);
+	}
 
 }
 
@@ -39,6 +39,7 @@ constexpr int INVALID_U32_CONFIG = 0xFFFFFFFF;
 #include <Logger.h>
 #include <Terminal.h>
 #include <RecordStorage.h>
+#include <TimerWheel.h>
 #include <MeshConnection.h>
 #include <BaseConnection.h>
 
@@ -88,7 +89,8 @@ class Node;
  * delivery of actions and responses.
  */
 class Module:
-		public RecordStorageEventListener
+		public RecordStorageEventListener,
+		public TimerWheelEventListener
 {
 	friend class FruityMesh;
 
@@ -116,6 +118,14 @@ protected:
 		ModuleConfiguration* configurationPointer;
 		u16 configurationLength;
 
+		//Modules that do all of their periodic work with timers of the GS->timerWheel can set this to false
+		//in their constructor so that their TimerEventHandler is not called on every timer tick
+		bool needsTimerEventHandler = true;
+
+		//Cleared once the module subscribes to advertisements with the GS->scanController, from then on
+		//its GapAdvertisementReportEventHandler is only called for the advertisements it subscribed to
+		bool receivesAllAdvertisements = true;
+
 		enum class ModuleConfigMessages : u8
 		{
 			SET_CONFIG = 0, 
@@ -165,6 +175,9 @@ protected:
 		//This handler receives all timer events
 		virtual void TimerEventHandler(u16 passedTimeDs){};
 
+		//This handler is called once a timer that the module started with the GS->timerWheel is due
+		virtual void TimerWheelEventHandler(u8 timerId) override {};
+
 		//This handler receives all ble events and can act on them
 		virtual void GapAdvertisementReportEventHandler(const FruityHal::GapAdvertisementReportEvent& advertisementReportEvent) {};
 		virtual void GapConnectedEventHandler(const FruityHal::GapConnectedEvent& connectedEvent) {};
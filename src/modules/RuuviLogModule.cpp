@@ -11,7 +11,7 @@
 // ** Licensees holding valid commercial Bluerange licenses may use this file in
 // ** accordance with the commercial license agreement provided with the
 // ** Software or, alternatively, in accordance with the terms contained in
-// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** a written agreement between them and M-Way Solutions GmbH.
 // ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
 // ** information use the contact form at https://www.bluerange.io/contact.
 // **
@@ -27,25 +27,72 @@
 // **
 // ****************************************************************************/
 ////////////////////////////////////////////////////////////////////////////////
-
 #include <RuuviLogModule.h>
 #include <Logger.h>
 #include <Utility.h>
 #include <Node.h>
-#include <ruuvi_interface_log.h>
+#include <GlobalState.h>
 
-constexpr u8 TEMPLATE_MODULE_CONFIG_VERSION = 1;
+constexpr u8 RUUVI_LOG_MODULE_CONFIG_VERSION = 1;
 
-RuuviLogModule::RuuviLogModule()
-	: Module(ModuleId::RUUVI_LOG_MODULE, "template")
+//Zigzag encoding maps small negative and positive deltas to small unsigned numbers
+static u32 ZigZagEncode(i32 value)
+{
+	return ((u32)value << 1) ^ (u32)(value >> 31);
+}
+
+static i32 ZigZagDecode(u32 value)
+{
+	return (i32)(value >> 1) ^ -(i32)(value & 1);
+}
+
+static u8* WriteVarint(u8* write, u32 value)
+{
+	while (value >= 0x80)
+	{
+		*write++ = (u8)(value | 0x80);
+		value >>= 7;
+	}
+	*write++ = (u8)value;
+	return write;
+}
+
+static bool ReadVarint(const u8*& read, const u8* end, u32& outValue)
 {
-	//Register callbacks n' stuff
+	u32 value = 0;
+	for (u32 shift = 0; shift < 35; shift += 7)
+	{
+		if (read >= end) return false;
+		const u8 byte = *read++;
+		value |= (u32)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			outValue = value;
+			return true;
+		}
+	}
+	return false;
+}
 
+RuuviLogModule::RuuviLogModule()
+	: Module(ModuleId::RUUVI_LOG_MODULE, "ruuvilog")
+{
 	//Save configuration to base class variables
 	//sizeof configuration must be a multiple of 4 bytes
 	configurationPointer = &configuration;
 	configurationLength = sizeof(RuuviLogModuleConfiguration);
 
+	//Sampling is driven by the sensor driver and the transfers use timers of the GS->timerWheel
+	needsTimerEventHandler = false;
+
+	CheckedMemset(pageSequenceNumbers, 0, sizeof(pageSequenceNumbers));
+	CheckedMemset(pageEnds, 0, sizeof(pageEnds));
+	CheckedMemset(pageErased, 0, sizeof(pageErased));
+	CheckedMemset(&sender, 0, sizeof(sender));
+	CheckedMemset(&receiver, 0, sizeof(receiver));
+	receiver.toTimestamp = 0xFFFFFFFF;
+	ResetPendingBlock();
+
 	//Set defaults
 	ResetToDefaultConfiguration();
 }
@@ -55,53 +102,1021 @@ void RuuviLogModule::ResetToDefaultConfiguration()
 	//Set default configuration values
 	configuration.moduleId = moduleId;
 	configuration.moduleActive = true;
-	configuration.moduleVersion = TEMPLATE_MODULE_CONFIG_VERSION;
-
-	//Set additional config values...
+	configuration.moduleVersion = RUUVI_LOG_MODULE_CONFIG_VERSION;
 
+	SET_FEATURESET_CONFIGURATION(&configuration, this);
 }
 
 void RuuviLogModule::ConfigurationLoadedHandler(ModuleConfiguration* migratableConfig, u16 migratableConfigLength)
 {
-	//Version migration can be added here, e.g. if module has version 2 and config is version 1
-	if(migratableConfig->moduleVersion == 1){/* ... */};
+	if (!IsLogRegionFree())
+	{
+		logt("ERROR", "Ruuvi log pages at %u are not available", GetPageAddress(0) - FLASH_REGION_START_ADDRESS);
+		GS->logger.logCustomError(CustomErrorTypes::FATAL_RUUVI_LOG_PAGES_NOT_AVAILABLE, GetPageAddress(0) - FLASH_REGION_START_ADDRESS);
+		configuration.moduleActive = false;
+		logLoaded = false;
+		return;
+	}
+
+	//The log lives in its own pages and is independent of the configuration, it only has to be loaded once
+	if (!logLoaded) LoadLog();
+}
+
+//################ Flash layout ################
+
+u32 RuuviLogModule::GetPageAddress(u8 page) const
+{
+	//The log pages are placed directly below the record storage
+	return Utility::GetSettingsPageBaseAddress() - (RUUVI_LOG_NUM_PAGES - page) * FruityHal::GetCodePageSize();
+}
+
+//The log pages are not reserved by the linker script, so they must be checked against the
+//application and against the space behind it where a DFU stores the new image. The new image
+//is assumed to be at most as large as the running application.
+bool RuuviLogModule::IsLogRegionFree() const
+{
+	const u32 applicationStart = (u32)__application_start_address;
+	const u32 applicationEnd = (u32)__application_end_address;
+	const u32 dfuEnd = applicationEnd + (applicationEnd - applicationStart);
+	return GetPageAddress(0) >= dfuEnd;
+}
+
+bool RuuviLogModule::IsErased(u32 address, u32 length)
+{
+	const u32* word = (const u32*)address;
+	for (u32 i = 0; i < length / sizeof(u32); i++)
+	{
+		if (word[i] != 0xFFFFFFFF) return false;
+	}
+	return true;
+}
+
+u32 RuuviLogModule::GetStoredBlockSize(u16 payloadLength)
+{
+	//Blocks are padded so that every block starts word aligned
+	return (sizeof(RuuviLogBlockHeader) + payloadLength + 3) / 4 * 4;
+}
+
+u32 RuuviLogModule::CalculateBlockCrc(const RuuviLogBlockHeader* header)
+{
+	const u32 crc = Utility::CalculateCrc32((const u8*)header, offsetof(RuuviLogBlockHeader, crc));
+	return Utility::CalculateCrc32((const u8*)(header + 1), header->payloadLength, crc);
+}
+
+//Returns the offset behind the last intact block of a page
+u16 RuuviLogModule::ScanPage(u8 page) const
+{
+	const u32 pageAddress = GetPageAddress(page);
+	const u32 pageSize = FruityHal::GetCodePageSize();
+	u32 offset = sizeof(RuuviLogPageHeader);
+	while (offset + sizeof(RuuviLogBlockHeader) <= pageSize)
+	{
+		const RuuviLogBlockHeader* header = (const RuuviLogBlockHeader*)(pageAddress + offset);
+		if (header->payloadLength > MAX_BLOCK_PAYLOAD) break;
+		if (offset + GetStoredBlockSize(header->payloadLength) > pageSize) break;
+		//A block that was torn by a power loss does not match its crc, everything behind it is discarded
+		if (header->crc != CalculateBlockCrc(header)) break;
+		offset += GetStoredBlockSize(header->payloadLength);
+	}
+	return (u16)offset;
+}
+
+void RuuviLogModule::LoadLog()
+{
+	const u32 pageSize = FruityHal::GetCodePageSize();
+	if (pageSize > MAX_PAGE_SIZE)
+	{
+		logt("ERROR", "Page size %u not supported", pageSize);
+		SIMEXCEPTION(IllegalStateException);
+		return;
+	}
+
+	u32 maxSequenceNumber = 0;
+	for (u8 page = 0; page < RUUVI_LOG_NUM_PAGES; page++)
+	{
+		const u32 pageAddress = GetPageAddress(page);
+		const RuuviLogPageHeader* pageHeader = (const RuuviLogPageHeader*)pageAddress;
+
+		pageErased[page] = IsErased(pageAddress, pageSize);
+		pageSequenceNumbers[page] = 0;
+		pageEnds[page] = 0;
+
+		if (pageHeader->magic == PAGE_MAGIC && pageHeader->sequenceNumber != 0 && pageHeader->sequenceNumber != 0xFFFFFFFF)
+		{
+			pageSequenceNumbers[page] = pageHeader->sequenceNumber;
+			pageEnds[page] = ScanPage(page);
+			if (pageHeader->sequenceNumber > maxSequenceNumber)
+			{
+				maxSequenceNumber = pageHeader->sequenceNumber;
+				headPage = page;
+			}
+		}
+	}
+
+	if (maxSequenceNumber == 0)
+	{
+		//An empty log starts on the first page
+		headPage = RUUVI_LOG_NUM_PAGES - 1;
+		headPageClosed = true;
+		nextSequenceNumber = 1;
+	}
+	else
+	{
+		//Blocks can only be appended if the flash behind the last intact block is still erased
+		nextSequenceNumber = maxSequenceNumber + 1;
+		headPageClosed = !IsErased(GetPageAddress(headPage) + pageEnds[headPage], pageSize - pageEnds[headPage]);
+	}
+
+	logLoaded = true;
+
+	logt("RUUVILOG", "Log loaded, head page %u (%u bytes), closed %u", (u32)headPage, (u32)pageEnds[headPage], (u32)headPageClosed);
+}
+
+//################ Writing ################
+
+u32 RuuviLogModule::EncodeSample(const RuuviLogSample& sample, const RuuviLogSample& reference, u8* out)
+{
+	u8* write = out;
+	write = WriteVarint(write, ZigZagEncode((i32)(sample.timestamp - reference.timestamp)));
+	write = WriteVarint(write, ZigZagEncode((i32)sample.temperature - (i32)reference.temperature));
+	write = WriteVarint(write, ZigZagEncode((i32)sample.humidity - (i32)reference.humidity));
+	write = WriteVarint(write, ZigZagEncode((i32)(sample.pressure - reference.pressure)));
+	write = WriteVarint(write, ZigZagEncode((i32)sample.batteryMv - (i32)reference.batteryMv));
+	return (u32)(write - out);
+}
+
+bool RuuviLogModule::DecodeSample(const u8*& read, const u8* end, RuuviLogSample& inOutSample)
+{
+	u32 value = 0;
+	if (!ReadVarint(read, end, value)) return false;
+	inOutSample.timestamp += (u32)ZigZagDecode(value);
+	if (!ReadVarint(read, end, value)) return false;
+	inOutSample.temperature = (i16)(inOutSample.temperature + ZigZagDecode(value));
+	if (!ReadVarint(read, end, value)) return false;
+	inOutSample.humidity = (u16)(inOutSample.humidity + ZigZagDecode(value));
+	if (!ReadVarint(read, end, value)) return false;
+	inOutSample.pressure += (u32)ZigZagDecode(value);
+	if (!ReadVarint(read, end, value)) return false;
+	inOutSample.batteryMv = (u16)(inOutSample.batteryMv + ZigZagDecode(value));
+	return true;
+}
+
+RuuviLogBlockHeader* RuuviLogModule::GetPendingHeader()
+{
+	return (RuuviLogBlockHeader*)pendingBlock;
+}
+
+void RuuviLogModule::ResetPendingBlock()
+{
+	CheckedMemset(pendingBlock, 0xFF, sizeof(pendingBlock));
+	RuuviLogBlockHeader* header = GetPendingHeader();
+	header->payloadLength = 0;
+	header->numSamples = 0;
+	header->reserved = 0xFF;
+	header->minTimestamp = 0xFFFFFFFF;
+	header->maxTimestamp = 0;
+	CheckedMemset(&lastPendingSample, 0, sizeof(lastPendingSample));
+}
+
+bool RuuviLogModule::LogSample(const RuuviLogSample& sample)
+{
+	if (!logLoaded)
+	{
+		droppedSamples++;
+		return false;
+	}
+
+	//The first sample of a block is encoded against an all zero sample so that every block can be decoded on its own
+	RuuviLogSample zeroSample;
+	CheckedMemset(&zeroSample, 0, sizeof(zeroSample));
+
+	RuuviLogBlockHeader* header = GetPendingHeader();
+	u8 encoded[MAX_ENCODED_SAMPLE_SIZE];
+	u32 encodedLength = EncodeSample(sample, header->numSamples == 0 ? zeroSample : lastPendingSample, encoded);
+
+	if (header->payloadLength + encodedLength > MAX_BLOCK_PAYLOAD || header->numSamples == 0xFF)
+	{
+		if (!FlushPendingBlock())
+		{
+			droppedSamples++;
+			return false;
+		}
+		encodedLength = EncodeSample(sample, zeroSample, encoded);
+	}
+
+	CheckedMemcpy(((u8*)(header + 1)) + header->payloadLength, encoded, encodedLength);
+	header->payloadLength += encodedLength;
+	header->numSamples++;
+	if (sample.timestamp < header->minTimestamp) header->minTimestamp = sample.timestamp;
+	if (sample.timestamp > header->maxTimestamp) header->maxTimestamp = sample.timestamp;
+	lastPendingSample = sample;
+
+	//Commit the block as soon as the next sample might not fit anymore
+	if (header->payloadLength + MAX_ENCODED_SAMPLE_SIZE > MAX_BLOCK_PAYLOAD)
+	{
+		FlushPendingBlock();
+	}
+
+	return true;
+}
+
+//Makes sure that the head page has enough space for a block, moves on to the next page of the ring if necessary
+bool RuuviLogModule::PrepareHeadPage(u32 storedSize)
+{
+	const u32 pageSize = FruityHal::GetCodePageSize();
+	if (!headPageClosed && pageSequenceNumbers[headPage] != 0 && pageEnds[headPage] + storedSize <= pageSize) return true;
+
+	const u8 nextPage = (headPage + 1) % RUUVI_LOG_NUM_PAGES;
+	const u32 nextPageAddress = GetPageAddress(nextPage);
+
+	//The oldest page is overwritten, a transfer that still streams it must not read the new data
+	if (sender.state != SenderState::IDLE && pageSequenceNumbers[nextPage] != 0 && pageSequenceNumbers[nextPage] >= sender.firstSequenceNumber)
+	{
+		logt("RUUVILOG", "Aborting transfer, page %u is overwritten", (u32)nextPage);
+		AbortSending(RawDataErrorType::UNEXPECTED_END_OF_TRANSMISSION);
+	}
+	pageSequenceNumbers[nextPage] = 0;
+	pageEnds[nextPage] = 0;
+
+	//All steps can be repeated if queueing one of the flash operations failed
+	if (!pageErased[nextPage])
+	{
+		pageErased[nextPage] = true;
+		const FlashStorageError err = GS->flashStorage.ErasePage((u16)((nextPageAddress - FLASH_REGION_START_ADDRESS) / pageSize), this, (u32)RuuviLogFlashUserTypes::ERASE, nextPage);
+		if (err != FlashStorageError::SUCCESS)
+		{
+			pageErased[nextPage] = false;
+			return false;
+		}
+		if (!pageErased[nextPage]) return false;
+	}
+
+	alignas(u32) RuuviLogPageHeader pageHeader;
+	pageHeader.magic = PAGE_MAGIC;
+	pageHeader.sequenceNumber = nextSequenceNumber;
+
+	const u8 previousHeadPage = headPage;
+	headPage = nextPage;
+	headPageClosed = false;
+	pageSequenceNumbers[nextPage] = nextSequenceNumber;
+	pageEnds[nextPage] = sizeof(RuuviLogPageHeader);
+	pageErased[nextPage] = false;
+
+	const FlashStorageError err = GS->flashStorage.CacheAndWriteData((u32 const *)&pageHeader, (u32*)nextPageAddress, sizeof(RuuviLogPageHeader), this, (u32)RuuviLogFlashUserTypes::PAGE_HEADER, nextPage);
+	if (err != FlashStorageError::SUCCESS)
+	{
+		headPage = previousHeadPage;
+		headPageClosed = true;
+		pageSequenceNumbers[nextPage] = 0;
+		pageEnds[nextPage] = 0;
+		pageErased[nextPage] = true;
+		return false;
+	}
+
+	nextSequenceNumber++;
+	return !headPageClosed;
+}
+
+bool RuuviLogModule::FlushPendingBlock()
+{
+	RuuviLogBlockHeader* header = GetPendingHeader();
+	if (header->numSamples == 0) return true;
+	if (!logLoaded) return false;
+
+	const u32 storedSize = GetStoredBlockSize(header->payloadLength);
+	if (!PrepareHeadPage(storedSize)) return false;
+
+	header->crc = CalculateBlockCrc(header);
+
+	const u8 page = headPage;
+	const u16 offset = pageEnds[page];
+	pageEnds[page] = (u16)(offset + storedSize);
+
+	const FlashStorageError err = GS->flashStorage.CacheAndWriteData(pendingBlock, (u32*)(GetPageAddress(page) + offset), (u16)storedSize, this, (u32)RuuviLogFlashUserTypes::BLOCK, ((u32)page << 16) | offset);
+	if (err != FlashStorageError::SUCCESS)
+	{
+		if (pageEnds[page] == offset + storedSize) pageEnds[page] = offset;
+		return false;
+	}
+
+	logt("RUUVILOG", "Committed block with %u samples to page %u offset %u", (u32)header->numSamples, (u32)page, (u32)offset);
+
+	ResetPendingBlock();
+	return true;
+}
+
+void RuuviLogModule::FlashStorageItemExecuted(FlashStorageTaskItem* task, FlashStorageError errorCode)
+{
+	if (errorCode == FlashStorageError::SUCCESS) return;
+
+	logt("ERROR", "Ruuvi log flash operation %u failed with %u", task->header.userType, (u32)errorCode);
+	GS->logger.logCustomError(CustomErrorTypes::COUNT_FLASH_OPERATION_ERROR, task->header.extraInfo);
+
+	//No further blocks are written to a page behind a failed operation, logging continues on the next page
+	const RuuviLogFlashUserTypes userType = (RuuviLogFlashUserTypes)task->header.userType;
+	const u8 page = (u8)(task->header.extraInfo >> 16);
+	if (userType == RuuviLogFlashUserTypes::BLOCK)
+	{
+		const u16 offset = (u16)task->header.extraInfo;
+		if (offset < pageEnds[page]) pageEnds[page] = offset;
+		if (page == headPage) headPageClosed = true;
+	}
+	else if (userType == RuuviLogFlashUserTypes::PAGE_HEADER || userType == RuuviLogFlashUserTypes::ERASE)
+	{
+		const u8 headerPage = (u8)task->header.extraInfo;
+		if (userType == RuuviLogFlashUserTypes::ERASE) pageErased[headerPage] = false;
+		pageSequenceNumbers[headerPage] = 0;
+		pageEnds[headerPage] = 0;
+		if (headerPage == headPage) headPageClosed = true;
+	}
+}
+
+//################ Reading ################
+
+RuuviLogModule::BlockPosition RuuviLogModule::GetFirstBlockPosition() const
+{
+	//The page behind the head page holds the oldest samples
+	BlockPosition position;
+	position.page = (headPage + 1) % RUUVI_LOG_NUM_PAGES;
+	position.pagesLeft = RUUVI_LOG_NUM_PAGES;
+	position.offset = sizeof(RuuviLogPageHeader);
+	return position;
+}
 
-	//Do additional initialization upon loading the config
+//Returns the committed block at the given position and advances the position behind it, the last page is only read up to the end offset
+const RuuviLogBlockHeader* RuuviLogModule::NextBlock(BlockPosition& position, u8 endPage, u16 endOffset) const
+{
+	while (position.pagesLeft > 0)
+	{
+		const u8 page = position.page;
+		const u16 pageEnd = (position.pagesLeft == 1 && page == endPage && endOffset < pageEnds[page]) ? endOffset : pageEnds[page];
+		if (pageSequenceNumbers[page] != 0 && position.offset + sizeof(RuuviLogBlockHeader) <= pageEnd)
+		{
+			const RuuviLogBlockHeader* header = (const RuuviLogBlockHeader*)(GetPageAddress(page) + position.offset);
+			//A block that is still queued in the FlashStorage is not readable yet
+			if (header->payloadLength <= MAX_BLOCK_PAYLOAD)
+			{
+				position.offset += GetStoredBlockSize(header->payloadLength);
+				return header;
+			}
+		}
+		position.page = (page + 1) % RUUVI_LOG_NUM_PAGES;
+		position.pagesLeft--;
+		position.offset = sizeof(RuuviLogPageHeader);
+	}
+	return nullptr;
+}
 
+//Decodes the samples of a block that are within the window, out may be a nullptr if the samples should only be counted
+u32 RuuviLogModule::DecodeBlock(const RuuviLogBlockHeader* header, u32 fromTimestamp, u32 toTimestamp, RuuviLogSample* out, u32 maxSamples, u32* inOutMinTimestamp, u32* inOutMaxTimestamp)
+{
+	RuuviLogSample sample;
+	CheckedMemset(&sample, 0, sizeof(sample));
 
-	//Start the Module...
+	const u8* read = (const u8*)(header + 1);
+	const u8* end = read + header->payloadLength;
+	u32 numSamples = 0;
+	for (u32 i = 0; i < header->numSamples && numSamples < maxSamples; i++)
+	{
+		if (!DecodeSample(read, end, sample)) break;
+		if (sample.timestamp < fromTimestamp || sample.timestamp > toTimestamp) continue;
 
+		if (out != nullptr) out[numSamples] = sample;
+		if (inOutMinTimestamp != nullptr && sample.timestamp < *inOutMinTimestamp) *inOutMinTimestamp = sample.timestamp;
+		if (inOutMaxTimestamp != nullptr && sample.timestamp > *inOutMaxTimestamp) *inOutMaxTimestamp = sample.timestamp;
+		numSamples++;
+	}
+	return numSamples;
 }
 
-void RuuviLogModule::TimerEventHandler(u16 passedTimeDs)
+u32 RuuviLogModule::ReadSamples(u32 fromTimestamp, u32 toTimestamp, RuuviLogSample* out, u32 maxSamples) const
 {
-	//Do stuff on timer...
-  ri_log(RI_LOG_LEVEL_INFO, "LOG!");
+	u32 numSamples = 0;
+	BlockPosition position = GetFirstBlockPosition();
+	const RuuviLogBlockHeader* header = nullptr;
+	while (numSamples < maxSamples && (header = NextBlock(position, headPage, pageEnds[headPage])) != nullptr)
+	{
+		if (header->maxTimestamp < fromTimestamp || header->minTimestamp > toTimestamp) continue;
+		numSamples += DecodeBlock(header, fromTimestamp, toTimestamp, out + numSamples, maxSamples - numSamples, nullptr, nullptr);
+	}
+
+	//Samples that are not yet committed are read as well
+	const RuuviLogBlockHeader* pendingHeader = (const RuuviLogBlockHeader*)pendingBlock;
+	if (numSamples < maxSamples && pendingHeader->numSamples != 0)
+	{
+		numSamples += DecodeBlock(pendingHeader, fromTimestamp, toTimestamp, out + numSamples, maxSamples - numSamples, nullptr, nullptr);
+	}
+
+	return numSamples;
+}
+
+void RuuviLogModule::FillInfo(RuuviLogModuleInfoMessage& info) const
+{
+	CheckedMemset(&info, 0, sizeof(info));
+	for (u32 page = 0; page < RUUVI_LOG_NUM_PAGES; page++)
+	{
+		if (pageSequenceNumbers[page] != 0) info.numPages++;
+	}
+
+	u32 minTimestamp = 0xFFFFFFFF;
+	u32 maxTimestamp = 0;
+	BlockPosition position = GetFirstBlockPosition();
+	const RuuviLogBlockHeader* header = nullptr;
+	while ((header = NextBlock(position, headPage, pageEnds[headPage])) != nullptr)
+	{
+		info.numBlocks++;
+		info.numSamples += header->numSamples;
+		if (header->minTimestamp < minTimestamp) minTimestamp = header->minTimestamp;
+		if (header->maxTimestamp > maxTimestamp) maxTimestamp = header->maxTimestamp;
+	}
+	const RuuviLogBlockHeader* pendingHeader = (const RuuviLogBlockHeader*)pendingBlock;
+	if (pendingHeader->numSamples != 0)
+	{
+		if (pendingHeader->minTimestamp < minTimestamp) minTimestamp = pendingHeader->minTimestamp;
+		if (pendingHeader->maxTimestamp > maxTimestamp) maxTimestamp = pendingHeader->maxTimestamp;
+	}
+
+	info.pendingSamples = pendingHeader->numSamples;
+	info.minTimestamp = info.numSamples + info.pendingSamples != 0 ? minTimestamp : 0;
+	info.maxTimestamp = maxTimestamp;
+	info.droppedSamples = droppedSamples;
+}
+
+//################ Sending a queried window ################
+
+void RuuviLogModule::FillRawDataHeader(RawDataHeader& header, NodeId receiverId, u8 requestHandle, RawDataActionType actionType) const
+{
+	header.connHeader.messageType = MessageType::MODULE_RAW_DATA;
+	header.connHeader.sender = GS->node.configuration.nodeId;
+	header.connHeader.receiver = receiverId;
+	header.moduleId = moduleId;
+	header.requestHandle = requestHandle;
+	header.actionType = actionType;
+}
+
+void RuuviLogModule::HandleQuery(NodeId requester, u8 requestHandle, const RuuviLogModuleQueryMessage& query)
+{
+	RuuviLogModuleQueryResponseMessage response;
+	CheckedMemset(&response, 0, sizeof(response));
+
+	//Blocks that are still queued for writing could change while they are streamed
+	if (sender.state != SenderState::IDLE || GS->flashStorage.GetNumberOfActiveTasks() != 0)
+	{
+		response.result = RuuviLogQueryResult::BUSY;
+	}
+	else
+	{
+		sender.fromTimestamp = query.fromTimestamp;
+		sender.toTimestamp = query.toTimestamp;
+		sender.endPage = headPage;
+		sender.endOffset = pageEnds[headPage];
+
+		//The samples that are still in RAM are streamed from a copy so that logging can continue
+		RuuviLogBlockHeader* pendingHeader = GetPendingHeader();
+		sender.includesSnapshot = pendingHeader->numSamples != 0 && pendingHeader->maxTimestamp >= query.fromTimestamp && pendingHeader->minTimestamp <= query.toTimestamp;
+		if (sender.includesSnapshot)
+		{
+			pendingHeader->crc = CalculateBlockCrc(pendingHeader);
+			CheckedMemcpy(sender.snapshot, pendingBlock, sizeof(sender.snapshot));
+		}
+
+		//The stream consists of all blocks that overlap the window, walk it once to determine its size
+		u32 streamLength = 0;
+		sender.firstSequenceNumber = 0xFFFFFFFF;
+		ResetTransferCursor();
+		for (const u8* block = sender.cursorBlock; block != nullptr; block = NextTransferBlock())
+		{
+			const RuuviLogBlockHeader* header = (const RuuviLogBlockHeader*)block;
+			if (block != (const u8*)sender.snapshot && sender.firstSequenceNumber == 0xFFFFFFFF)
+			{
+				sender.firstSequenceNumber = pageSequenceNumbers[sender.cursorPosition.page];
+			}
+			streamLength += sizeof(RuuviLogBlockHeader) + header->payloadLength;
+			response.numSamples += DecodeBlock(header, query.fromTimestamp, query.toTimestamp, nullptr, 0xFFFFFFFF, nullptr, nullptr);
+		}
+
+		if (streamLength == 0)
+		{
+			response.result = RuuviLogQueryResult::NO_DATA;
+		}
+		else
+		{
+			sender.state = SenderState::WAITING_FOR_START_RECEIVED;
+			sender.partner = requester;
+			sender.requestHandle = requestHandle;
+			sender.retries = 0;
+			sender.chunkPayload = GetChunkPayloadSize(requester);
+			sender.numChunks = (streamLength + sender.chunkPayload - 1) / sender.chunkPayload;
+			sender.nextChunkId = 1;
+			sender.rewindChunkId = 0;
+			ResetTransferCursor();
+
+			response.result = RuuviLogQueryResult::SUCCESS;
+			response.numChunks = sender.numChunks;
+		}
+	}
+
+	logt("RUUVILOG", "Query from %u, result %u, %u samples in %u chunks", (u32)requester, (u32)response.result, response.numSamples, response.numChunks);
+
+	SendModuleActionMessage(
+		MessageType::MODULE_ACTION_RESPONSE,
+		requester,
+		(u8)RuuviLogModuleActionResponseMessages::QUERY_RESPONSE,
+		requestHandle,
+		(u8*)&response,
+		SIZEOF_RUUVI_LOG_MODULE_QUERY_RESPONSE_MESSAGE,
+		false
+	);
+
+	if (response.result == RuuviLogQueryResult::SUCCESS)
+	{
+		SendStart();
+		GS->timerWheel.Start(this, (u8)RuuviLogModuleTimers::SENDER_TIMEOUT, SENDER_TIMEOUT_DS, SENDER_TIMEOUT_DS);
+	}
+}
+
+//Returns the next block of the stream, these are the committed blocks within the window followed by the snapshot of the pending block
+const u8* RuuviLogModule::NextTransferBlock()
+{
+	if (sender.cursorAtSnapshot) return nullptr;
+
+	const RuuviLogBlockHeader* header = nullptr;
+	while ((header = NextBlock(sender.cursorPosition, sender.endPage, sender.endOffset)) != nullptr)
+	{
+		if (header->maxTimestamp >= sender.fromTimestamp && header->minTimestamp <= sender.toTimestamp) return (const u8*)header;
+	}
+
+	sender.cursorAtSnapshot = true;
+	return sender.includesSnapshot ? (const u8*)sender.snapshot : nullptr;
+}
+
+void RuuviLogModule::ResetTransferCursor()
+{
+	sender.cursorPosition = GetFirstBlockPosition();
+	sender.cursorAtSnapshot = false;
+	sender.cursorStreamOffset = 0;
+	sender.cursorBlock = NextTransferBlock();
+}
+
+//Reads a part of the stream, chunks are usually read in order so that the cursor only has to move forward
+u32 RuuviLogModule::ReadTransferStream(u32 offset, u8* out, u32 length)
+{
+	if (offset < sender.cursorStreamOffset) ResetTransferCursor();
+
+	u32 readLength = 0;
+	while (readLength < length && sender.cursorBlock != nullptr)
+	{
+		const RuuviLogBlockHeader* header = (const RuuviLogBlockHeader*)sender.cursorBlock;
+		const u32 blockLength = sizeof(RuuviLogBlockHeader) + header->payloadLength;
+		if (offset >= sender.cursorStreamOffset + blockLength)
+		{
+			sender.cursorStreamOffset += blockLength;
+			sender.cursorBlock = NextTransferBlock();
+			continue;
+		}
+
+		const u32 blockOffset = offset - sender.cursorStreamOffset;
+		u32 copyLength = blockLength - blockOffset;
+		if (copyLength > length - readLength) copyLength = length - readLength;
+		CheckedMemcpy(out + readLength, sender.cursorBlock + blockOffset, copyLength);
+		readLength += copyLength;
+		offset += copyLength;
+	}
+	return readLength;
+}
+
+//Chooses the chunk size so that the chunks fill the writes on the route to the receiver
+u16 RuuviLogModule::GetChunkPayloadSize(NodeId receiverId) const
+{
+	u32 payloadSize = 0;
+	MeshConnectionHandle route = GS->cm.GetMeshConnectionToLearnedRoute(receiverId);
+	if (route)
+	{
+		payloadSize = route.GetConnection()->connectionPayloadSize;
+	}
+	else
+	{
+		//Without a learned route the packet is broadcasted, so the smallest connection counts
+		MeshConnections conns = GS->cm.GetMeshConnections(ConnectionDirection::INVALID);
+		for (u32 i = 0; i < conns.count; i++)
+		{
+			if (!conns.handles[i].IsHandshakeDone()) continue;
+			const u32 connectionPayloadSize = conns.handles[i].GetConnection()->connectionPayloadSize;
+			if (payloadSize == 0 || connectionPayloadSize < payloadSize) payloadSize = connectionPayloadSize;
+		}
+	}
+	if (payloadSize <= SIZEOF_CONN_PACKET_SPLIT_HEADER) payloadSize = MAX_DATA_SIZE_PER_WRITE;
+
+	constexpr u32 chunkHeaderSize = sizeof(RawDataChunk) - 1;
+
+	//Either the chunk fits into a single write...
+	u32 unsplitPayload = payloadSize > chunkHeaderSize ? payloadSize - chunkHeaderSize : 0;
+	if (unsplitPayload > MAX_RAW_CHUNK_SIZE) unsplitPayload = MAX_RAW_CHUNK_SIZE;
+
+	//...or it is split into parts that are all completely filled
+	const u32 partSize = payloadSize - SIZEOF_CONN_PACKET_SPLIT_HEADER;
+	const u32 splitPacketSize = (chunkHeaderSize + MAX_RAW_CHUNK_SIZE) / partSize * partSize;
+	const u32 splitPayload = splitPacketSize > chunkHeaderSize ? splitPacketSize - chunkHeaderSize : 0;
+
+	u32 chunkPayload = unsplitPayload > splitPayload ? unsplitPayload : splitPayload;
+	if (chunkPayload < MIN_CHUNK_PAYLOAD) chunkPayload = MIN_CHUNK_PAYLOAD;
+	return (u16)chunkPayload;
+}
+
+void RuuviLogModule::SendStart()
+{
+	RawDataStart packet;
+	CheckedMemset(&packet, 0, sizeof(packet));
+	FillRawDataHeader(packet.header, sender.partner, sender.requestHandle, RawDataActionType::START);
+	packet.numChunks = sender.numChunks;
+	packet.protocolId = (u32)RawDataProtocol::START_OF_USER_DEFINED_IDS;
+
+	GS->cm.SendMeshMessage((u8*)&packet, sizeof(RawDataStart), DeliveryPriority::LOW);
+}
+
+void RuuviLogModule::SendChunk(u32 chunkId)
+{
+	alignas(RawDataChunk) u8 buffer[sizeof(RawDataChunk) - 1 + MAX_RAW_CHUNK_SIZE];
+	CheckedMemset(buffer, 0, sizeof(buffer));
+	RawDataChunk& packet = (RawDataChunk&)buffer;
+	FillRawDataHeader(packet.header, sender.partner, sender.requestHandle, RawDataActionType::CHUNK);
+	packet.chunkId = chunkId;
+
+	const u32 payloadLength = ReadTransferStream((chunkId - 1) * sender.chunkPayload, packet.payload, sender.chunkPayload);
+
+	GS->cm.SendMeshMessage(buffer, (u16)(sizeof(RawDataChunk) - 1 + payloadLength), DeliveryPriority::LOW);
+}
+
+//Sends as many chunks as the packet queues accept without crowding out other traffic
+void RuuviLogModule::StreamChunks()
+{
+	while (sender.state == SenderState::SENDING && sender.nextChunkId <= sender.numChunks && GS->cm.GetPendingPackets() < MAX_PENDING_PACKETS_WHILE_STREAMING)
+	{
+		SendChunk(sender.nextChunkId);
+		sender.nextChunkId++;
+	}
+
+	if (sender.state == SenderState::SENDING && sender.nextChunkId > sender.numChunks)
+	{
+		sender.state = SenderState::WAITING_FOR_REPORT;
+		sender.retries = 0;
+		GS->timerWheel.Stop(this, (u8)RuuviLogModuleTimers::STREAM);
+		GS->timerWheel.Start(this, (u8)RuuviLogModuleTimers::SENDER_TIMEOUT, SENDER_TIMEOUT_DS, SENDER_TIMEOUT_DS);
+	}
+}
+
+void RuuviLogModule::StopSending()
+{
+	sender.state = SenderState::IDLE;
+	GS->timerWheel.Stop(this, (u8)RuuviLogModuleTimers::STREAM);
+	GS->timerWheel.Stop(this, (u8)RuuviLogModuleTimers::SENDER_TIMEOUT);
+}
+
+void RuuviLogModule::AbortSending(RawDataErrorType type)
+{
+	GS->node.SendRawError(sender.partner, moduleId, type, RawDataErrorDestination::RECEIVER, sender.requestHandle);
+	StopSending();
+}
+
+//################ Receiving a queried window ################
+
+void RuuviLogModule::HandleRawData(RawDataHeader const* packet, u16 dataLength)
+{
+	const NodeId partner = packet->connHeader.sender;
+	const RawDataActionType actionType = packet->actionType;
+
+	if (actionType == RawDataActionType::START && dataLength >= sizeof(RawDataStart))
+	{
+		RawDataStart const * startPacket = (RawDataStart const *)packet;
+		if (startPacket->protocolId != (u32)RawDataProtocol::START_OF_USER_DEFINED_IDS || startPacket->numChunks == 0) return;
+
+		//A repeated start restarts the transmission, the window of the last query is kept to filter the samples
+		receiver.active = true;
+		receiver.partner = partner;
+		receiver.requestHandle = packet->requestHandle;
+		receiver.numChunks = startPacket->numChunks;
+		receiver.nextChunkId = 1;
+		receiver.reportedChunkId = 0;
+		receiver.parseError = false;
+		receiver.numBlocks = 0;
+		receiver.numSamples = 0;
+		receiver.minTimestamp = 0xFFFFFFFF;
+		receiver.maxTimestamp = 0;
+		receiver.blockFill = 0;
+
+		RawDataStartReceived reply;
+		CheckedMemset(&reply, 0, sizeof(reply));
+		FillRawDataHeader(reply.header, partner, packet->requestHandle, RawDataActionType::START_RECEIVED);
+		GS->cm.SendMeshMessage((u8*)&reply, sizeof(RawDataStartReceived), DeliveryPriority::LOW);
+
+		GS->timerWheel.Start(this, (u8)RuuviLogModuleTimers::RECEIVER_TIMEOUT, RECEIVER_TIMEOUT_DS, 0);
+	}
+	else if (actionType == RawDataActionType::START_RECEIVED && dataLength >= sizeof(RawDataStartReceived))
+	{
+		if (sender.state != SenderState::WAITING_FOR_START_RECEIVED || partner != sender.partner || packet->requestHandle != sender.requestHandle) return;
+
+		sender.state = SenderState::SENDING;
+		GS->timerWheel.Stop(this, (u8)RuuviLogModuleTimers::SENDER_TIMEOUT);
+		GS->timerWheel.Start(this, (u8)RuuviLogModuleTimers::STREAM, 1, 1);
+		StreamChunks();
+	}
+	else if (actionType == RawDataActionType::CHUNK && dataLength >= sizeof(RawDataChunk))
+	{
+		if (partner != receiver.partner || packet->requestHandle != receiver.requestHandle) return;
+		RawDataChunk const * chunk = (RawDataChunk const *)packet;
+		const u32 payloadLength = dataLength - sizeof(RawDataChunk) + 1;
+
+		//If the final report got lost, the sender repeats the last chunk
+		if (!receiver.active)
+		{
+			if (chunk->chunkId == receiver.numChunks && receiver.nextChunkId > receiver.numChunks) SendReport();
+			return;
+		}
+
+		GS->timerWheel.Start(this, (u8)RuuviLogModuleTimers::RECEIVER_TIMEOUT, RECEIVER_TIMEOUT_DS, 0);
+
+		//Only the next chunk in order is accepted, after a gap the sender is asked to continue with the first missing chunk
+		bool sendReport = chunk->chunkId == receiver.numChunks;
+		if (chunk->chunkId == receiver.nextChunkId)
+		{
+			char payload[(MAX_RAW_CHUNK_SIZE + 2) / 3 * 4 + 1];
+			if (payloadLength > MAX_RAW_CHUNK_SIZE)
+			{
+				SIMEXCEPTION(PaketTooBigException); //LCOV_EXCL_LINE assertion
+				return;
+			}
+			Logger::convertBufferToBase64String(chunk->payload, payloadLength, payload, sizeof(payload));
+
+			logjson("RUUVILOG",
+				"{"
+					"\"nodeId\":%u,"
+					"\"type\":\"raw_data_chunk\","
+					"\"module\":%u,"
+					"\"chunkId\":%u,"
+					"\"payload\":\"%s\","
+					"\"requestHandle\":%u"
+				"}" SEP,
+				partner,
+				(u32)moduleId,
+				chunk->chunkId,
+				payload,
+				packet->requestHandle
+			);
+
+			ParseReceivedBytes(chunk->payload, payloadLength);
+			receiver.nextChunkId++;
+		}
+		else if (chunk->chunkId > receiver.nextChunkId && receiver.reportedChunkId != receiver.nextChunkId)
+		{
+			receiver.reportedChunkId = receiver.nextChunkId;
+			sendReport = true;
+		}
+
+		if (receiver.nextChunkId > receiver.numChunks)
+		{
+			if (receiver.parseError || receiver.blockFill != 0)
+			{
+				logt("ERROR", "Received ruuvi log is corrupt after %u blocks", receiver.numBlocks);
+			}
+
+			logjson("RUUVILOG",
+				"{"
+					"\"nodeId\":%u,"
+					"\"type\":\"ruuvi_log_received\","
+					"\"module\":%u,"
+					"\"numChunks\":%u,"
+					"\"numBlocks\":%u,"
+					"\"numSamples\":%u,"
+					"\"minTimestamp\":%u,"
+					"\"maxTimestamp\":%u,"
+					"\"requestHandle\":%u"
+				"}" SEP,
+				partner,
+				(u32)moduleId,
+				receiver.numChunks,
+				receiver.numBlocks,
+				receiver.numSamples,
+				receiver.numSamples != 0 ? receiver.minTimestamp : 0,
+				receiver.maxTimestamp,
+				packet->requestHandle
+			);
+
+			SendReport();
+			StopReceiving();
+		}
+		else if (sendReport)
+		{
+			SendReport();
+		}
+	}
+	else if (actionType == RawDataActionType::REPORT && dataLength >= sizeof(RawDataReport))
+	{
+		if ((sender.state != SenderState::SENDING && sender.state != SenderState::WAITING_FOR_REPORT) || partner != sender.partner || packet->requestHandle != sender.requestHandle) return;
+		RawDataReport const * report = (RawDataReport const *)packet;
+
+		u32 lowestMissing = 0;
+		for (u32 i = 0; i < sizeof(report->missings) / sizeof(report->missings[0]); i++)
+		{
+			if (report->missings[i] != 0 && (lowestMissing == 0 || report->missings[i] < lowestMissing)) lowestMissing = report->missings[i];
+		}
+
+		if (lowestMissing == 0)
+		{
+			logt("RUUVILOG", "Transfer of %u chunks to %u done", sender.numChunks, (u32)sender.partner);
+			StopSending();
+		}
+		else if (lowestMissing <= sender.numChunks)
+		{
+			//The same gap is reported again by the last chunk, it is already being resent
+			if (sender.state == SenderState::SENDING && lowestMissing == sender.rewindChunkId) return;
+
+			if (lowestMissing < sender.nextChunkId) sender.nextChunkId = lowestMissing;
+			sender.rewindChunkId = lowestMissing;
+			sender.state = SenderState::SENDING;
+			sender.retries = 0;
+			GS->timerWheel.Stop(this, (u8)RuuviLogModuleTimers::SENDER_TIMEOUT);
+			GS->timerWheel.Start(this, (u8)RuuviLogModuleTimers::STREAM, 1, 1);
+		}
+	}
+	else if (actionType == RawDataActionType::ERROR_T && dataLength >= sizeof(RawDataError))
+	{
+		if (sender.state != SenderState::IDLE && partner == sender.partner && packet->requestHandle == sender.requestHandle) StopSending();
+		if (receiver.active && partner == receiver.partner && packet->requestHandle == receiver.requestHandle) StopReceiving();
+	}
+}
+
+//The stream is reassembled into blocks, which are verified and decoded
+void RuuviLogModule::ParseReceivedBytes(const u8* data, u32 length)
+{
+	u8* block = (u8*)receiver.block;
+	const RuuviLogBlockHeader* header = (const RuuviLogBlockHeader*)receiver.block;
+	while (length > 0 && !receiver.parseError)
+	{
+		const u32 missingLength = receiver.blockFill < sizeof(RuuviLogBlockHeader)
+			? sizeof(RuuviLogBlockHeader) - receiver.blockFill
+			: sizeof(RuuviLogBlockHeader) + header->payloadLength - receiver.blockFill;
+		const u32 copyLength = missingLength < length ? missingLength : length;
+		CheckedMemcpy(block + receiver.blockFill, data, copyLength);
+		receiver.blockFill += copyLength;
+		data += copyLength;
+		length -= copyLength;
+
+		if (receiver.blockFill < sizeof(RuuviLogBlockHeader)) continue;
+		if (header->payloadLength > MAX_BLOCK_PAYLOAD)
+		{
+			receiver.parseError = true;
+		}
+		else if (receiver.blockFill == sizeof(RuuviLogBlockHeader) + header->payloadLength)
+		{
+			ProcessReceivedBlock();
+			receiver.blockFill = 0;
+		}
+	}
+}
+
+void RuuviLogModule::ProcessReceivedBlock()
+{
+	const RuuviLogBlockHeader* header = (const RuuviLogBlockHeader*)receiver.block;
+	if (header->crc != CalculateBlockCrc(header))
+	{
+		receiver.parseError = true;
+		return;
+	}
+
+	receiver.numBlocks++;
+	receiver.numSamples += DecodeBlock(header, receiver.fromTimestamp, receiver.toTimestamp, nullptr, 0xFFFFFFFF, &receiver.minTimestamp, &receiver.maxTimestamp);
+}
+
+//Reports up to three missing chunks starting with the next expected one, an empty report finishes the transmission
+void RuuviLogModule::SendReport()
+{
+	RawDataReport packet;
+	CheckedMemset(&packet, 0, sizeof(packet));
+	FillRawDataHeader(packet.header, receiver.partner, receiver.requestHandle, RawDataActionType::REPORT);
+	for (u32 i = 0; i < sizeof(packet.missings) / sizeof(packet.missings[0]); i++)
+	{
+		if (receiver.nextChunkId + i <= receiver.numChunks) packet.missings[i] = receiver.nextChunkId + i;
+	}
+
+	GS->cm.SendMeshMessage((u8*)&packet, sizeof(RawDataReport), DeliveryPriority::LOW);
+}
+
+void RuuviLogModule::StopReceiving()
+{
+	receiver.active = false;
+	GS->timerWheel.Stop(this, (u8)RuuviLogModuleTimers::RECEIVER_TIMEOUT);
+}
+
+void RuuviLogModule::TimerWheelEventHandler(u8 timerId)
+{
+	if (timerId == (u8)RuuviLogModuleTimers::STREAM)
+	{
+		StreamChunks();
+	}
+	else if (timerId == (u8)RuuviLogModuleTimers::SENDER_TIMEOUT)
+	{
+		if (sender.retries >= MAX_SENDER_RETRIES)
+		{
+			logt("RUUVILOG", "Transfer to %u timed out", (u32)sender.partner);
+			AbortSending(RawDataErrorType::UNEXPECTED_END_OF_TRANSMISSION);
+			return;
+		}
+		sender.retries++;
+
+		//The last chunk makes the receiver report the missing chunks again
+		if (sender.state == SenderState::WAITING_FOR_START_RECEIVED) SendStart();
+		else if (sender.state == SenderState::WAITING_FOR_REPORT) SendChunk(sender.numChunks);
+	}
+	else if (timerId == (u8)RuuviLogModuleTimers::RECEIVER_TIMEOUT)
+	{
+		logt("RUUVILOG", "Transfer from %u timed out at chunk %u", (u32)receiver.partner, receiver.nextChunkId);
+		GS->node.SendRawError(receiver.partner, moduleId, RawDataErrorType::UNEXPECTED_END_OF_TRANSMISSION, RawDataErrorDestination::SENDER, receiver.requestHandle);
+		StopReceiving();
+	}
 }
 
 #ifdef TERMINAL_ENABLED
 TerminalCommandHandlerReturnType RuuviLogModule::TerminalCommandHandler(const char* commandArgs[], u8 commandArgsSize)
 {
 	//React on commands, return true if handled, false otherwise
-	if(commandArgsSize >= 3 && TERMARGS(2, moduleName))
+	if(commandArgsSize >= 4 && TERMARGS(2, moduleName))
 	{
 		if(TERMARGS(0, "action"))
 		{
-			if(!TERMARGS(2, moduleName)) return TerminalCommandHandlerReturnType::UNKNOWN;
+			NodeId destinationNode = Utility::TerminalArgumentToNodeId(commandArgs[1]);
 
-			if(commandArgsSize >= 4 && TERMARGS(3, "argument_a"))
+			//action [nodeId] ruuvilog query [fromTimestamp] [toTimestamp] {requestHandle}
+			if(commandArgsSize >= 6 && TERMARGS(3, "query"))
 			{
+				bool didError = false;
+				RuuviLogModuleQueryMessage data;
+				data.fromTimestamp = Utility::StringToU32(commandArgs[4], &didError);
+				data.toTimestamp = Utility::StringToU32(commandArgs[5], &didError);
+				const u8 requestHandle = commandArgsSize >= 7 ? Utility::StringToU8(commandArgs[6], &didError) : 0;
+				if (didError) return TerminalCommandHandlerReturnType::WRONG_ARGUMENT;
 
-			return TerminalCommandHandlerReturnType::SUCCESS;
+				//The window is remembered to filter the samples of the transmission that answers the query
+				receiver.fromTimestamp = data.fromTimestamp;
+				receiver.toTimestamp = data.toTimestamp;
+
+				SendModuleActionMessage(
+					MessageType::MODULE_TRIGGER_ACTION,
+					destinationNode,
+					(u8)RuuviLogModuleTriggerActionMessages::QUERY,
+					requestHandle,
+					(u8*)&data,
+					SIZEOF_RUUVI_LOG_MODULE_QUERY_MESSAGE,
+					false
+				);
+
+				return TerminalCommandHandlerReturnType::SUCCESS;
 			}
-			else if(commandArgsSize >= 4 && TERMARGS(3, "argument_b"))
+			//action [nodeId] ruuvilog sample [temperature] [humidity] [pressure] [batteryMv] {requestHandle}
+			else if(commandArgsSize >= 8 && TERMARGS(3, "sample"))
 			{
+				bool didError = false;
+				RuuviLogModuleSampleMessage data;
+				data.temperature = Utility::StringToI16(commandArgs[4], &didError);
+				data.humidity = Utility::StringToU16(commandArgs[5], &didError);
+				data.pressure = Utility::StringToU32(commandArgs[6], &didError);
+				data.batteryMv = Utility::StringToU16(commandArgs[7], &didError);
+				const u8 requestHandle = commandArgsSize >= 9 ? Utility::StringToU8(commandArgs[8], &didError) : 0;
+				if (didError) return TerminalCommandHandlerReturnType::WRONG_ARGUMENT;
+
+				SendModuleActionMessage(
+					MessageType::MODULE_TRIGGER_ACTION,
+					destinationNode,
+					(u8)RuuviLogModuleTriggerActionMessages::SAMPLE,
+					requestHandle,
+					(u8*)&data,
+					SIZEOF_RUUVI_LOG_MODULE_SAMPLE_MESSAGE,
+					false
+				);
 
-			return TerminalCommandHandlerReturnType::SUCCESS;
+				return TerminalCommandHandlerReturnType::SUCCESS;
 			}
+			//action [nodeId] ruuvilog flush {requestHandle}
+			//action [nodeId] ruuvilog info {requestHandle}
+			else if(TERMARGS(3, "flush") || TERMARGS(3, "info"))
+			{
+				bool didError = false;
+				const u8 requestHandle = commandArgsSize >= 5 ? Utility::StringToU8(commandArgs[4], &didError) : 0;
+				if (didError) return TerminalCommandHandlerReturnType::WRONG_ARGUMENT;
 
-			return TerminalCommandHandlerReturnType::UNKNOWN;
+				SendModuleActionMessage(
+					MessageType::MODULE_TRIGGER_ACTION,
+					destinationNode,
+					TERMARGS(3, "flush") ? (u8)RuuviLogModuleTriggerActionMessages::FLUSH : (u8)RuuviLogModuleTriggerActionMessages::GET_INFO,
+					requestHandle,
+					nullptr,
+					0,
+					false
+				);
 
+				return TerminalCommandHandlerReturnType::SUCCESS;
+			}
+
+			return TerminalCommandHandlerReturnType::UNKNOWN;
 		}
 	}
 
@@ -121,8 +1136,66 @@ void RuuviLogModule::MeshMessageReceivedHandler(BaseConnection* connection, Base
 
 		//Check if our module is meant and we should trigger an action
 		if(packet->moduleId == moduleId){
-			if(packet->actionType == RuuviLogModuleTriggerActionMessages::MESSAGE_0){
+			if(packet->actionType == (u8)RuuviLogModuleTriggerActionMessages::QUERY && sendData->dataLength >= SIZEOF_CONN_PACKET_MODULE + SIZEOF_RUUVI_LOG_MODULE_QUERY_MESSAGE)
+			{
+				RuuviLogModuleQueryMessage query;
+				CheckedMemcpy(&query, packet->data, SIZEOF_RUUVI_LOG_MODULE_QUERY_MESSAGE);
+				HandleQuery(packet->header.sender, packet->requestHandle, query);
+			}
+			else if(packet->actionType == (u8)RuuviLogModuleTriggerActionMessages::SAMPLE && sendData->dataLength >= SIZEOF_CONN_PACKET_MODULE + SIZEOF_RUUVI_LOG_MODULE_SAMPLE_MESSAGE)
+			{
+				RuuviLogModuleSampleMessage data;
+				CheckedMemcpy(&data, packet->data, SIZEOF_RUUVI_LOG_MODULE_SAMPLE_MESSAGE);
+
+				RuuviLogSample sample;
+				sample.timestamp = GS->timeManager.GetTime();
+				sample.temperature = data.temperature;
+				sample.humidity = data.humidity;
+				sample.pressure = data.pressure;
+				sample.batteryMv = data.batteryMv;
+
+				RuuviLogModuleCommandResponseMessage response;
+				response.result = LogSample(sample) ? RuuviLogCommandResult::SUCCESS : RuuviLogCommandResult::FAILED;
+
+				SendModuleActionMessage(
+					MessageType::MODULE_ACTION_RESPONSE,
+					packet->header.sender,
+					(u8)RuuviLogModuleActionResponseMessages::SAMPLE_RESPONSE,
+					packet->requestHandle,
+					(u8*)&response,
+					SIZEOF_RUUVI_LOG_MODULE_COMMAND_RESPONSE_MESSAGE,
+					false
+				);
+			}
+			else if(packet->actionType == (u8)RuuviLogModuleTriggerActionMessages::FLUSH)
+			{
+				RuuviLogModuleCommandResponseMessage response;
+				response.result = FlushPendingBlock() ? RuuviLogCommandResult::SUCCESS : RuuviLogCommandResult::FAILED;
+
+				SendModuleActionMessage(
+					MessageType::MODULE_ACTION_RESPONSE,
+					packet->header.sender,
+					(u8)RuuviLogModuleActionResponseMessages::FLUSH_RESPONSE,
+					packet->requestHandle,
+					(u8*)&response,
+					SIZEOF_RUUVI_LOG_MODULE_COMMAND_RESPONSE_MESSAGE,
+					false
+				);
+			}
+			else if(packet->actionType == (u8)RuuviLogModuleTriggerActionMessages::GET_INFO)
+			{
+				RuuviLogModuleInfoMessage info;
+				FillInfo(info);
 
+				SendModuleActionMessage(
+					MessageType::MODULE_ACTION_RESPONSE,
+					packet->header.sender,
+					(u8)RuuviLogModuleActionResponseMessages::INFO,
+					packet->requestHandle,
+					(u8*)&info,
+					SIZEOF_RUUVI_LOG_MODULE_INFO_MESSAGE,
+					false
+				);
 			}
 		}
 	}
@@ -134,10 +1207,91 @@ void RuuviLogModule::MeshMessageReceivedHandler(BaseConnection* connection, Base
 		//Check if our module is meant and we should trigger an action
 		if(packet->moduleId == moduleId)
 		{
-			if(packet->actionType == RuuviLogModuleActionResponseMessages::MESSAGE_0_RESPONSE)
+			if(packet->actionType == (u8)RuuviLogModuleActionResponseMessages::QUERY_RESPONSE && sendData->dataLength >= SIZEOF_CONN_PACKET_MODULE + SIZEOF_RUUVI_LOG_MODULE_QUERY_RESPONSE_MESSAGE)
 			{
+				RuuviLogModuleQueryResponseMessage response;
+				CheckedMemcpy(&response, packet->data, SIZEOF_RUUVI_LOG_MODULE_QUERY_RESPONSE_MESSAGE);
 
+				logjson("RUUVILOG",
+					"{"
+						"\"nodeId\":%u,"
+						"\"type\":\"ruuvi_log_query_response\","
+						"\"module\":%u,"
+						"\"result\":%u,"
+						"\"numSamples\":%u,"
+						"\"numChunks\":%u,"
+						"\"requestHandle\":%u"
+					"}" SEP,
+					packet->header.sender,
+					(u32)moduleId,
+					(u32)response.result,
+					response.numSamples,
+					response.numChunks,
+					packet->requestHandle
+				);
 			}
+			else if((packet->actionType == (u8)RuuviLogModuleActionResponseMessages::SAMPLE_RESPONSE || packet->actionType == (u8)RuuviLogModuleActionResponseMessages::FLUSH_RESPONSE)
+				&& sendData->dataLength >= SIZEOF_CONN_PACKET_MODULE + SIZEOF_RUUVI_LOG_MODULE_COMMAND_RESPONSE_MESSAGE)
+			{
+				RuuviLogModuleCommandResponseMessage response;
+				CheckedMemcpy(&response, packet->data, SIZEOF_RUUVI_LOG_MODULE_COMMAND_RESPONSE_MESSAGE);
+
+				logjson("RUUVILOG",
+					"{"
+						"\"nodeId\":%u,"
+						"\"type\":\"%s\","
+						"\"module\":%u,"
+						"\"result\":%u,"
+						"\"requestHandle\":%u"
+					"}" SEP,
+					packet->header.sender,
+					packet->actionType == (u8)RuuviLogModuleActionResponseMessages::SAMPLE_RESPONSE ? "ruuvi_log_sample_response" : "ruuvi_log_flush_response",
+					(u32)moduleId,
+					(u32)response.result,
+					packet->requestHandle
+				);
+			}
+			else if(packet->actionType == (u8)RuuviLogModuleActionResponseMessages::INFO && sendData->dataLength >= SIZEOF_CONN_PACKET_MODULE + SIZEOF_RUUVI_LOG_MODULE_INFO_MESSAGE)
+			{
+				RuuviLogModuleInfoMessage info;
+				CheckedMemcpy(&info, packet->data, SIZEOF_RUUVI_LOG_MODULE_INFO_MESSAGE);
+
+				logjson("RUUVILOG",
+					"{"
+						"\"nodeId\":%u,"
+						"\"type\":\"ruuvi_log_info\","
+						"\"module\":%u,"
+						"\"numPages\":%u,"
+						"\"numBlocks\":%u,"
+						"\"numSamples\":%u,"
+						"\"pendingSamples\":%u,"
+						"\"minTimestamp\":%u,"
+						"\"maxTimestamp\":%u,"
+						"\"dropped\":%u,"
+						"\"requestHandle\":%u"
+					"}" SEP,
+					packet->header.sender,
+					(u32)moduleId,
+					(u32)info.numPages,
+					info.numBlocks,
+					info.numSamples,
+					(u32)info.pendingSamples,
+					info.minTimestamp,
+					info.maxTimestamp,
+					info.droppedSamples,
+					packet->requestHandle
+				);
+			}
+		}
+	}
+
+	if(packetHeader->messageType == MessageType::MODULE_RAW_DATA){
+		RawDataHeader const * packet = (RawDataHeader const *)packetHeader;
+
+		//Check if our module is meant
+		if(packet->moduleId == moduleId)
+		{
+			HandleRawData(packet, sendData->dataLength);
 		}
 	}
 }
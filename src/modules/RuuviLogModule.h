@@ -27,50 +27,294 @@
 // **
 // ****************************************************************************/
 ////////////////////////////////////////////////////////////////////////////////
-
 #pragma once
 
 #include <Module.h>
+#include <Node.h>
+#include <FlashStorage.h>
+
+//A single environmental measurement as it is passed to and read from the log
+struct RuuviLogSample
+{
+	u32 timestamp; //Seconds as reported by the TimeManager
+	i16 temperature; //0.01 degree celsius
+	u16 humidity; //0.01 percent relative humidity
+	u32 pressure; //Pascal
+	u16 batteryMv;
+};
+
+#pragma pack(push)
+#pragma pack(1)
+//Written at the start of every log page once it is taken into use
+struct RuuviLogPageHeader
+{
+	u32 magic;
+	u32 sequenceNumber; //Increases with every page that is taken into use, 0 is invalid
+};
+STATIC_ASSERT_SIZE(RuuviLogPageHeader, 8);
+
+//Precedes the delta encoded samples of a block, the first sample of a block is encoded against an all zero sample
+struct RuuviLogBlockHeader
+{
+	u16 payloadLength; //0xFFFF if the flash behind the last block is still erased
+	u8 numSamples;
+	u8 reserved;
+	u32 minTimestamp;
+	u32 maxTimestamp;
+	u32 crc; //Crc32 over the header up to this field, continued over the payload
+};
+STATIC_ASSERT_SIZE(RuuviLogBlockHeader, 16);
+#pragma pack(pop)
 
 /*
- * This is a template for a FruityMesh module.
- * A comment should be here to provide a least a short description of its purpose.
+ * The RuuviLogModule keeps a ring log of environmental samples in a few flash pages
+ * below the record storage. The module disables itself if these pages are needed by
+ * the application or a DFU. Samples are delta and varint encoded into blocks that are
+ * committed to flash once full. Gateways can query a time window of the log, which is
+ * then streamed to them with the raw data chunk transfer.
  */
-class RuuviLogModule: public Module
+class RuuviLogModule: public Module, public FlashStorageEventListener
 {
-	private:
-
-		//Module configuration that is saved persistently (size must be multiple of 4)
-		struct RuuviLogModuleConfiguration : ModuleConfiguration{
-			//Insert more persistent config values here
+	public:
+		enum class RuuviLogModuleTriggerActionMessages : u8
+		{
+			QUERY = 0,
+			SAMPLE = 1,
+			FLUSH = 2,
+			GET_INFO = 3,
 		};
 
-		RuuviLogModuleConfiguration configuration;
+		enum class RuuviLogModuleActionResponseMessages : u8
+		{
+			QUERY_RESPONSE = 0,
+			SAMPLE_RESPONSE = 1,
+			FLUSH_RESPONSE = 2,
+			INFO = 3,
+		};
 
-		enum RuuviLogModuleTriggerActionMessages{
-			MESSAGE_0 = 0
+		enum class RuuviLogQueryResult : u8
+		{
+			SUCCESS = 0,
+			NO_DATA = 1,
+			BUSY = 2,
 		};
 
-		enum RuuviLogModuleActionResponseMessages{
-			MESSAGE_0_RESPONSE = 0
+		enum class RuuviLogCommandResult : u8
+		{
+			SUCCESS = 0,
+			FAILED = 1,
 		};
 
-		/*
 		//####### Module messages (these need to be packed)
 		#pragma pack(push)
 		#pragma pack(1)
 
-			#define SIZEOF_TEMPLATE_MODULE_***_MESSAGE 10
+			static constexpr int SIZEOF_RUUVI_LOG_MODULE_QUERY_MESSAGE = 8;
+			typedef struct
+			{
+				u32 fromTimestamp;
+				u32 toTimestamp;
+
+			}RuuviLogModuleQueryMessage;
+			STATIC_ASSERT_SIZE(RuuviLogModuleQueryMessage, SIZEOF_RUUVI_LOG_MODULE_QUERY_MESSAGE);
+
+			static constexpr int SIZEOF_RUUVI_LOG_MODULE_QUERY_RESPONSE_MESSAGE = 9;
+			typedef struct
+			{
+				RuuviLogQueryResult result;
+				u32 numSamples;
+				u32 numChunks;
+
+			}RuuviLogModuleQueryResponseMessage;
+			STATIC_ASSERT_SIZE(RuuviLogModuleQueryResponseMessage, SIZEOF_RUUVI_LOG_MODULE_QUERY_RESPONSE_MESSAGE);
+
+			//The timestamp of the sample is taken by the node that logs it
+			static constexpr int SIZEOF_RUUVI_LOG_MODULE_SAMPLE_MESSAGE = 10;
+			typedef struct
+			{
+				i16 temperature;
+				u16 humidity;
+				u32 pressure;
+				u16 batteryMv;
+
+			}RuuviLogModuleSampleMessage;
+			STATIC_ASSERT_SIZE(RuuviLogModuleSampleMessage, SIZEOF_RUUVI_LOG_MODULE_SAMPLE_MESSAGE);
+
+			//Answers the sample and the flush command
+			static constexpr int SIZEOF_RUUVI_LOG_MODULE_COMMAND_RESPONSE_MESSAGE = 1;
+			typedef struct
+			{
+				RuuviLogCommandResult result;
+
+			}RuuviLogModuleCommandResponseMessage;
+			STATIC_ASSERT_SIZE(RuuviLogModuleCommandResponseMessage, SIZEOF_RUUVI_LOG_MODULE_COMMAND_RESPONSE_MESSAGE);
+
+			static constexpr int SIZEOF_RUUVI_LOG_MODULE_INFO_MESSAGE = 22;
 			typedef struct
 			{
-				//Insert values here
+				u8 numPages;
+				u32 numBlocks;
+				u32 numSamples;
+				u8 pendingSamples;
+				u32 minTimestamp;
+				u32 maxTimestamp;
+				u32 droppedSamples;
 
-			}RuuviLogModule***Message;
+			}RuuviLogModuleInfoMessage;
+			STATIC_ASSERT_SIZE(RuuviLogModuleInfoMessage, SIZEOF_RUUVI_LOG_MODULE_INFO_MESSAGE);
 
 		#pragma pack(pop)
 		//####### Module messages end
-		*/
 
+		static constexpr u32 PAGE_MAGIC = 0x474C5652; //"RVLG"
+		static constexpr u32 MAX_PAGE_SIZE = 4096;
+		static constexpr u32 BLOCK_SIZE = 128;
+		static constexpr u32 MAX_BLOCK_PAYLOAD = BLOCK_SIZE - sizeof(RuuviLogBlockHeader);
+		//Every field is stored as a zigzag varint, 5 bytes for 32 bit deltas and 3 bytes for 16 bit deltas
+		static constexpr u32 MAX_ENCODED_SAMPLE_SIZE = 5 + 3 + 3 + 5 + 3;
+
+		//Chunks are never made smaller than this, even if the connections have a small payload size
+		static constexpr u32 MIN_CHUNK_PAYLOAD = 24;
+		//Number of packets that may be queued in the ConnectionManager before the stream waits
+		static constexpr u16 MAX_PENDING_PACKETS_WHILE_STREAMING = 4;
+		static constexpr u32 SENDER_TIMEOUT_DS = SEC_TO_DS(10);
+		static constexpr u32 RECEIVER_TIMEOUT_DS = SEC_TO_DS(15);
+		static constexpr u8 MAX_SENDER_RETRIES = 3;
+
+	private:
+
+		//Module configuration that is saved persistently (size must be multiple of 4)
+		struct RuuviLogModuleConfiguration : ModuleConfiguration{
+			//Insert more persistent config values here
+		};
+
+		RuuviLogModuleConfiguration configuration;
+
+		enum class RuuviLogModuleTimers : u8
+		{
+			STREAM = 0,
+			SENDER_TIMEOUT = 1,
+			RECEIVER_TIMEOUT = 2,
+		};
+
+		enum class RuuviLogFlashUserTypes : u32
+		{
+			ERASE = 0,
+			PAGE_HEADER = 1,
+			BLOCK = 2,
+		};
+
+		enum class SenderState : u8
+		{
+			IDLE = 0,
+			WAITING_FOR_START_RECEIVED = 1,
+			SENDING = 2,
+			WAITING_FOR_REPORT = 3,
+		};
+
+TESTER_PUBLIC:
+		//Position while iterating over the committed blocks from the oldest to the newest page
+		struct BlockPosition
+		{
+			u8 page;
+			u8 pagesLeft;
+			u16 offset;
+		};
+
+		//RAM state of the ring, a sequence number of 0 marks a page without valid data
+		u32 pageSequenceNumbers[RUUVI_LOG_NUM_PAGES];
+		u16 pageEnds[RUUVI_LOG_NUM_PAGES]; //Offset behind the last valid block of a page
+		bool pageErased[RUUVI_LOG_NUM_PAGES];
+		u8 headPage = RUUVI_LOG_NUM_PAGES - 1;
+		bool headPageClosed = true; //No more blocks are appended to the head page, e.g. after a torn write
+		u32 nextSequenceNumber = 1;
+		bool logLoaded = false;
+		u32 droppedSamples = 0;
+
+		//Block that collects samples until it is committed, holds the header followed by the payload
+		u32 pendingBlock[BLOCK_SIZE / sizeof(u32)];
+		RuuviLogSample lastPendingSample;
+
+		struct
+		{
+			SenderState state;
+			NodeId partner;
+			u8 requestHandle;
+			u8 retries;
+			u32 fromTimestamp;
+			u32 toTimestamp;
+			u32 numChunks;
+			u32 nextChunkId;
+			u32 rewindChunkId; //Lowest missing chunk of the last report, the stream was rewound to it
+			u16 chunkPayload;
+			u32 firstSequenceNumber; //Sequence number of the oldest page that is part of the stream
+			u8 endPage;
+			u16 endOffset;
+			bool includesSnapshot;
+			u32 snapshot[BLOCK_SIZE / sizeof(u32)]; //Copy of the pending block at the start of the transfer
+
+			//Cursor that is moved over the stream while reading the chunks
+			BlockPosition cursorPosition;
+			bool cursorAtSnapshot;
+			const u8* cursorBlock;
+			u32 cursorStreamOffset;
+		} sender;
+
+		struct
+		{
+			bool active;
+			NodeId partner;
+			u8 requestHandle;
+			u32 fromTimestamp;
+			u32 toTimestamp;
+			u32 numChunks;
+			u32 nextChunkId;
+			u32 reportedChunkId; //Expected chunk id for which a report was already sent because of a gap
+			bool parseError;
+			u32 numBlocks;
+			u32 numSamples;
+			u32 minTimestamp;
+			u32 maxTimestamp;
+			u16 blockFill;
+			u32 block[BLOCK_SIZE / sizeof(u32)];
+		} receiver;
+
+		u32 GetPageAddress(u8 page) const;
+		bool IsLogRegionFree() const;
+		static bool IsErased(u32 address, u32 length);
+		static u32 GetStoredBlockSize(u16 payloadLength);
+		static u32 CalculateBlockCrc(const RuuviLogBlockHeader* header);
+		u16 ScanPage(u8 page) const;
+		void LoadLog();
+
+		static u32 EncodeSample(const RuuviLogSample& sample, const RuuviLogSample& reference, u8* out);
+		static bool DecodeSample(const u8*& read, const u8* end, RuuviLogSample& inOutSample);
+		RuuviLogBlockHeader* GetPendingHeader();
+		void ResetPendingBlock();
+		bool PrepareHeadPage(u32 storedSize);
+
+		BlockPosition GetFirstBlockPosition() const;
+		const RuuviLogBlockHeader* NextBlock(BlockPosition& position, u8 endPage, u16 endOffset) const;
+		static u32 DecodeBlock(const RuuviLogBlockHeader* header, u32 fromTimestamp, u32 toTimestamp, RuuviLogSample* out, u32 maxSamples, u32* inOutMinTimestamp, u32* inOutMaxTimestamp);
+
+		void FillRawDataHeader(RawDataHeader& header, NodeId receiverId, u8 requestHandle, RawDataActionType actionType) const;
+		void HandleQuery(NodeId requester, u8 requestHandle, const RuuviLogModuleQueryMessage& query);
+		void FillInfo(RuuviLogModuleInfoMessage& info) const;
+		const u8* NextTransferBlock();
+		void ResetTransferCursor();
+		u32 ReadTransferStream(u32 offset, u8* out, u32 length);
+		u16 GetChunkPayloadSize(NodeId receiverId) const;
+		void SendStart();
+		void SendChunk(u32 chunkId);
+		void StreamChunks();
+		void StopSending();
+		void AbortSending(RawDataErrorType type);
+
+		void HandleRawData(RawDataHeader const* packet, u16 dataLength);
+		void ParseReceivedBytes(const u8* data, u32 length);
+		void ProcessReceivedBlock();
+		void SendReport();
+		void StopReceiving();
 
 	public:
 		RuuviLogModule();
@@ -79,11 +323,22 @@ class RuuviLogModule: public Module
 
 		void ResetToDefaultConfiguration() override;
 
-		void TimerEventHandler(u16 passedTimeDs) override;
+		void TimerWheelEventHandler(u8 timerId) override final;
 
 		void MeshMessageReceivedHandler(BaseConnection* connection, BaseConnectionSendData* sendData, connPacketHeader const * packetHeader) override;
 
+		void FlashStorageItemExecuted(FlashStorageTaskItem* task, FlashStorageError errorCode) override;
+
 		#ifdef TERMINAL_ENABLED
 		TerminalCommandHandlerReturnType TerminalCommandHandler(const char* commandArgs[], u8 commandArgsSize) override;
 		#endif
+
+		//Appends a sample to the log, this is the hook for the sensor driver
+		bool LogSample(const RuuviLogSample& sample);
+
+		//Commits the samples that are still held in RAM to flash
+		bool FlushPendingBlock();
+
+		//Reads the logged samples within the given window (inclusive) from the oldest to the newest
+		u32 ReadSamples(u32 fromTimestamp, u32 toTimestamp, RuuviLogSample* out, u32 maxSamples) const;
 };
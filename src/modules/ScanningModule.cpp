@@ -61,6 +61,13 @@ ScanningModule::ScanningModule() :
 	configurationPointer = &configuration;
 	configurationLength = sizeof(ScanningModuleConfiguration);
 
+	//All reports are sent from timers of the timer wheel
+	needsTimerEventHandler = false;
+
+	//Only asset packets are tracked
+	GS->scanController.SubscribeToAdvertisements(this, BleGapAdType::TYPE_SERVICE_DATA, MESH_SERVICE_DATA_SERVICE_UUID16, ServiceDataMessageType::STANDARD_ASSET);
+	GS->scanController.SubscribeToAdvertisements(this, BleGapAdType::TYPE_SERVICE_DATA, MESH_SERVICE_DATA_SERVICE_UUID16, ServiceDataMessageType::INS_ASSET);
+
 	//Initialize scanFilters as empty
 	for (int i = 0; i < SCAN_FILTER_NUMBER; i++)
 	{
@@ -107,7 +114,16 @@ void ScanningModule::ConfigurationLoadedHandler(ModuleConfiguration* migratableC
 		GS->scanController.UpdateJobPointer(&p_scanJob, ScanState::HIGH, ScanJobState::ACTIVE);
 	}
 #endif
+
 	//Start the Module...
+	if (configuration.moduleActive) {
+		GS->timerWheel.StartAligned(this, (u8)ScanningModuleTimers::GROUPED_REPORTING, groupedReportingIntervalDs, 0);
+		GS->timerWheel.StartAligned(this, (u8)ScanningModuleTimers::ASSET_REPORTING, assetReportingIntervalDs, 0);
+	}
+	else {
+		GS->timerWheel.Stop(this, (u8)ScanningModuleTimers::GROUPED_REPORTING);
+		GS->timerWheel.Stop(this, (u8)ScanningModuleTimers::ASSET_REPORTING);
+	}
 }
 
 #ifdef TERMINAL_ENABLED
@@ -118,9 +134,9 @@ TerminalCommandHandlerReturnType ScanningModule::TerminalCommandHandler(const ch
 }
 #endif
 
-void ScanningModule::TimerEventHandler(u16 passedTimeDs)
+void ScanningModule::TimerWheelEventHandler(u8 timerId)
 {
-	if(SHOULD_IV_TRIGGER(GS->appTimerDs, passedTimeDs, groupedReportingIntervalDs))
+	if(timerId == (u8)ScanningModuleTimers::GROUPED_REPORTING)
 	{
 
 		//Send grouped packets
@@ -134,7 +150,7 @@ void ScanningModule::TimerEventHandler(u16 passedTimeDs)
 		totalRSSI = 0;
 	}
 
-	if(SHOULD_IV_TRIGGER(GS->appTimerDs, passedTimeDs, assetReportingIntervalDs)){
+	if(timerId == (u8)ScanningModuleTimers::ASSET_REPORTING){
 		//Send asset tracking packets
 		SendTrackedAssets();
 		SendTrackedAssetsIns();
@@ -253,91 +269,65 @@ void ScanningModule::HandleAssetInsPackets(const FruityHal::GapAdvertisementRepo
 }
 
 /**
- * Finds a free slot in our buffer of asset packets and adds the packet
+ * Adds the packet to the table of tracked assets, replacing the weakest asset if the table is full
  */
 bool ScanningModule::addTrackedAsset(const advPacketAssetServiceData* packet, i8 rssi){
-	ScannedAssetTrackingStorage* slot = nullptr;
-
-	//Look for an old entry of this asset or a free space
-	//Because we fill this buffer from the beginning, we can use the first slot that is empty
-	for(int i = 0; i<ASSET_PACKET_BUFFER_SIZE; i++){
-		if(assetPackets[i].serialNumberIndex == packet->serialNumberIndex || assetPackets[i].serialNumberIndex == 0){
-			slot = &assetPackets[i];
-			break;
-		}
-	}
-
-	//If a slot was found, add the packet
-	if(slot != nullptr){
-		u16 slotNum = ((u32)slot - (u32)assetPackets.data()) / sizeof(ScannedAssetTrackingStorage);
-		logt("SCANMOD", "Tracked packet %u in slot %d", packet->serialNumberIndex, slotNum);
-
-		//Clean up first, if we overwrite another assetId
-		if(slot->serialNumberIndex != packet->serialNumberIndex){
-			slot->serialNumberIndex = packet->serialNumberIndex;
-			slot->nodeId = packet->nodeId;
-			slot->rssiContainer.count = 0;
-			slot->rssiContainer.rssi37 = slot->rssiContainer.rssi38 = slot->rssiContainer.rssi39 = UINT8_MAX;
-			slot->rssiContainer.channelCount[0] = slot->rssiContainer.channelCount[1] = slot->rssiContainer.channelCount[2] = 0;
-		}
-		slot->pressure = packet->pressure;
-		slot->speed = packet->speed;
+	ScannedAssetTrackingStorage* slot = assetPackets.GetOrInsert(packet->serialNumberIndex, (u8)rssi);
 
-		slot->hasFreeInConnection = packet->hasFreeInConnection;
-		slot->interestedInConnection = packet->interestedInConnection;
-		slot->hasSameNetworkId = packet->networkId == GS->node.configuration.networkId;
+	//The table is full with assets that were received stronger
+	if(slot == nullptr) return false;
 
-		RssiRunningAverageCalculationInPlace(slot->rssiContainer, packet->advertisingChannel, rssi);
+	logt("SCANMOD", "Tracked packet %u, %u assets tracked", packet->serialNumberIndex, assetPackets.GetNumEntries());
 
-		return true;
+	//New entries are cleared by the table
+	if(slot->rssiContainer.count == 0){
+		slot->nodeId = packet->nodeId;
+		slot->rssiContainer.rssi37 = slot->rssiContainer.rssi38 = slot->rssiContainer.rssi39 = UINT8_MAX;
+		slot->rssiContainer.channelCount[0] = slot->rssiContainer.channelCount[1] = slot->rssiContainer.channelCount[2] = 0;
 	}
-	return false;
+	slot->pressure = packet->pressure;
+	slot->speed = packet->speed;
+
+	slot->hasFreeInConnection = packet->hasFreeInConnection;
+	slot->interestedInConnection = packet->interestedInConnection;
+	slot->hasSameNetworkId = packet->networkId == GS->node.configuration.networkId;
+
+	RssiRunningAverageCalculationInPlace(slot->rssiContainer, packet->advertisingChannel, rssi);
+
+	return true;
 }
 bool ScanningModule::addTrackedAssetIns(const advPacketAssetInsServiceData * packet, i8 rssi)
 {
-	ScannedAssetInsTrackingStorage* slot = nullptr;
-
-	//Look for an old entry of this asset or a free space
-	//Because we fill this buffer from the beginning, we can use the first slot that is empty
-	for (int i = 0; i < ASSET_INS_PACKET_BUFFER_SIZE; i++) {
-		if (assetInsPackets[i].assetNodeId == packet->assetNodeId || assetInsPackets[i].assetNodeId == 0) {
-			slot = &assetInsPackets[i];
-			break;
-		}
-	}
+	ScannedAssetInsTrackingStorage* slot = assetInsPackets.GetOrInsert(packet->assetNodeId, (u8)rssi);
 
-	//If a slot was found, add the packet
-	if (slot != nullptr) {
-		u16 slotNum = ((u32)slot - (u32)assetInsPackets.data()) / sizeof(ScannedAssetInsTrackingStorage);
-		logt("SCANMOD", "Tracked packet %u in slot %d", packet->assetNodeId, slotNum);
-
-		//Clean up first, if we overwrite another assetId
-		if (slot->assetNodeId != packet->assetNodeId) {
-			slot->assetNodeId = packet->assetNodeId;
-			slot->rssiContainer.count = 0;
-			slot->rssiContainer.rssi37 = slot->rssiContainer.rssi38 = slot->rssiContainer.rssi39 = UINT8_MAX;
-			slot->rssiContainer.channelCount[0] = slot->rssiContainer.channelCount[1] = slot->rssiContainer.channelCount[2] = 0;
-		}
-		slot->batteryPower = packet->batteryPower;
-		slot->absolutePositionX = packet->absolutePositionX;
-		slot->absolutePositionY = packet->absolutePositionY;
-		slot->pressure = packet->pressure;
-		slot->moving = packet->moving;
-
-		slot->hasFreeInConnection = packet->hasFreeInConnection;
-		slot->interestedInConnection = packet->interestedInConnection;
-		slot->hasSameNetworkId = packet->networkId == GS->node.configuration.networkId;
+	//The table is full with assets that were received stronger
+	if (slot == nullptr) return false;
 
-		RssiRunningAverageCalculationInPlace(slot->rssiContainer, 0, rssi);
+	logt("SCANMOD", "Tracked packet %u, %u assets tracked", packet->assetNodeId, assetInsPackets.GetNumEntries());
 
-		return true;
+	//New entries are cleared by the table
+	if (slot->rssiContainer.count == 0) {
+		slot->rssiContainer.rssi37 = slot->rssiContainer.rssi38 = slot->rssiContainer.rssi39 = UINT8_MAX;
+		slot->rssiContainer.channelCount[0] = slot->rssiContainer.channelCount[1] = slot->rssiContainer.channelCount[2] = 0;
 	}
-	return false;
+	slot->batteryPower = packet->batteryPower;
+	slot->absolutePositionX = packet->absolutePositionX;
+	slot->absolutePositionY = packet->absolutePositionY;
+	slot->pressure = packet->pressure;
+	slot->moving = packet->moving;
+
+	slot->hasFreeInConnection = packet->hasFreeInConnection;
+	slot->interestedInConnection = packet->interestedInConnection;
+	slot->hasSameNetworkId = packet->networkId == GS->node.configuration.networkId;
+
+	RssiRunningAverageCalculationInPlace(slot->rssiContainer, 0, rssi);
+
+	return true;
 }
 #endif
 
 /**
- * Sends out all tracked assets from our buffer and resets the buffer
+ * Sends out all tracked assets from our buffer, the strongest first, and resets the buffer
  */
 
 //FIXME: rssi threshold must be used somewhere, apply when receiving packet?
@@ -346,110 +336,106 @@ bool ScanningModule::addTrackedAssetIns(const advPacketAssetInsServiceData * pac
 void ScanningModule::SendTrackedAssets()
 {
 #if IS_INACTIVE(GW_SAVE_SPACE)
-	//Find out how many assets were tracked
-	u8 count = 0;
-	for(int i=0; i<ASSET_PACKET_BUFFER_SIZE; i++){
-		if(assetPackets[i].serialNumberIndex == 0) break;
-		count++;
-	}
-
-	if(count == 0) return;
-
-	//jstodo add test for tracked assets
-	u16 messageLength = SIZEOF_CONN_PACKET_HEADER + SIZEOF_SCAN_MODULE_TRACKED_ASSET_V2 * count;
+	std::array<u16, ASSET_PACKET_BUFFER_SIZE> indices;
+	const u32 count = assetPackets.GetIndicesByRssi(indices);
+
+	//The assets are split into as many messages as needed
+	for(u32 first = 0; first < count; first += MAX_TRACKED_ASSETS_PER_V2_MESSAGE){
+		const u32 messageCount = (count - first < MAX_TRACKED_ASSETS_PER_V2_MESSAGE) ? count - first : MAX_TRACKED_ASSETS_PER_V2_MESSAGE;
+		u16 messageLength = SIZEOF_CONN_PACKET_HEADER + SIZEOF_SCAN_MODULE_TRACKED_ASSET_V2 * messageCount;
+
+		//Allocate a buffer big enough and fill the packet
+		DYNAMIC_ARRAY(buffer, messageLength);
+		CheckedMemset(buffer, 0, messageLength);
+		ScanModuleTrackedAssetsV2Message* message = (ScanModuleTrackedAssetsV2Message*) buffer;
+
+		message->header.messageType = MessageType::ASSET_V2;
+		message->header.sender = GS->node.configuration.nodeId;
+		message->header.receiver = NODE_ID_SHORTEST_SINK;
+
+		for(u32 i=0; i<messageCount; i++){
+			const ScannedAssetTrackingStorage& asset = assetPackets[indices[first + i]];
+			if (asset.nodeId != 0)
+			{
+				message->trackedAssets[i].assetId = asset.nodeId;
+			}
+			else
+			{
+				message->trackedAssets[i].assetId = asset.serialNumberIndex;
+			}
+			message->trackedAssets[i].rssi37 = asset.rssiContainer.rssi37;
+			message->trackedAssets[i].rssi38 = asset.rssiContainer.rssi38;
+			message->trackedAssets[i].rssi39 = asset.rssiContainer.rssi39;
 
-	//Allocate a buffer big enough and fill the packet
-	DYNAMIC_ARRAY(buffer, messageLength);
-	CheckedMemset(buffer, 0, messageLength);
-	ScanModuleTrackedAssetsV2Message* message = (ScanModuleTrackedAssetsV2Message*) buffer;
+			message->trackedAssets[i].speed = ConvertServiceDataToMeshMessageSpeed(asset.speed);
 
-	message->header.messageType = MessageType::ASSET_V2;
-	message->header.sender = GS->node.configuration.nodeId;
-	message->header.receiver = NODE_ID_SHORTEST_SINK;
+			message->trackedAssets[i].hasFreeInConnection = asset.hasFreeInConnection;
+			message->trackedAssets[i].interestedInConnection = asset.interestedInConnection;
+			message->trackedAssets[i].hasSameNetworkId = asset.hasSameNetworkId;
 
-	for(int i=0; i<count; i++){
-		if (assetPackets[i].nodeId != 0)
-		{
-			message->trackedAssets[i].assetId = assetPackets[i].nodeId;
+			message->trackedAssets[i].pressure = ConvertServiceDataToMeshMessagePressure(asset.pressure);
 		}
-		else
-		{
-			message->trackedAssets[i].assetId = assetPackets[i].serialNumberIndex;
-		}
-		message->trackedAssets[i].rssi37 = assetPackets[i].rssiContainer.rssi37;
-		message->trackedAssets[i].rssi38 = assetPackets[i].rssiContainer.rssi38;
-		message->trackedAssets[i].rssi39 = assetPackets[i].rssiContainer.rssi39;
-
-		message->trackedAssets[i].speed = ConvertServiceDataToMeshMessageSpeed(assetPackets[i].speed);
 
-		message->trackedAssets[i].hasFreeInConnection = assetPackets[i].hasFreeInConnection;
-		message->trackedAssets[i].interestedInConnection = assetPackets[i].interestedInConnection;
-		message->trackedAssets[i].hasSameNetworkId = assetPackets[i].hasSameNetworkId;
-
-		message->trackedAssets[i].pressure = ConvertServiceDataToMeshMessagePressure(assetPackets[i].pressure);
+		//Send the packet as a non-module message to save some bytes in the header
+		GS->cm.SendMeshMessage(
+				buffer,
+				(u8)messageLength,
+				DeliveryPriority::LOW
+				);
 	}
 
-	//Send the packet as a non-module message to save some bytes in the header
-	GS->cm.SendMeshMessage(
-			buffer,
-			(u8)messageLength,
-			DeliveryPriority::LOW
-			);
-
 	//Clear the buffer
-	assetPackets = {};
+	assetPackets.Clear();
 #endif
 }
 
 void ScanningModule::SendTrackedAssetsIns()
 {
 #if IS_INACTIVE(GW_SAVE_SPACE)
-	//Find out how many assets were tracked
-	u8 count = 0;
-	for (int i = 0; i < ASSET_INS_PACKET_BUFFER_SIZE; i++) {
-		if (assetInsPackets[i].assetNodeId == 0) break;
-		count++;
-	}
-
-	if (count == 0) return;
-
-	//jstodo add test for tracked assets
-	u16 messageLength = sizeof(TrackedAssetInsMessage) * count;
-
-	//Allocate a buffer big enough and fill the packet
-	DYNAMIC_ARRAY(buffer, messageLength);
-	CheckedMemset(buffer, 0, messageLength);
-	TrackedAssetInsMessage* trackedAssets = (TrackedAssetInsMessage*)buffer;
-
-	for (int i = 0; i < count; i++) {
-		trackedAssets[i].assetNodeId = assetInsPackets[i].assetNodeId;
-		trackedAssets[i].rssi37 = assetInsPackets[i].rssiContainer.rssi37;
-		trackedAssets[i].rssi38 = assetInsPackets[i].rssiContainer.rssi38;
-		trackedAssets[i].rssi39 = assetInsPackets[i].rssiContainer.rssi39;
-		trackedAssets[i].batteryPower = assetInsPackets[i].batteryPower;
-		trackedAssets[i].absolutePositionX = assetInsPackets[i].absolutePositionX;
-		trackedAssets[i].absolutePositionY = assetInsPackets[i].absolutePositionY;
-
-		trackedAssets[i].moving = assetInsPackets[i].moving;
-		trackedAssets[i].pressure = ConvertServiceDataToMeshMessagePressure(assetInsPackets[i].pressure);
+	std::array<u16, ASSET_INS_PACKET_BUFFER_SIZE> indices;
+	const u32 count = assetInsPackets.GetIndicesByRssi(indices);
+
+	//The assets are split into as many messages as needed
+	for (u32 first = 0; first < count; first += MAX_TRACKED_ASSETS_PER_INS_MESSAGE) {
+		const u32 messageCount = (count - first < MAX_TRACKED_ASSETS_PER_INS_MESSAGE) ? count - first : MAX_TRACKED_ASSETS_PER_INS_MESSAGE;
+		u16 messageLength = sizeof(TrackedAssetInsMessage) * messageCount;
+
+		//Allocate a buffer big enough and fill the packet
+		DYNAMIC_ARRAY(buffer, messageLength);
+		CheckedMemset(buffer, 0, messageLength);
+		TrackedAssetInsMessage* trackedAssets = (TrackedAssetInsMessage*)buffer;
+
+		for (u32 i = 0; i < messageCount; i++) {
+			const ScannedAssetInsTrackingStorage& asset = assetInsPackets[indices[first + i]];
+			trackedAssets[i].assetNodeId = asset.assetNodeId;
+			trackedAssets[i].rssi37 = asset.rssiContainer.rssi37;
+			trackedAssets[i].rssi38 = asset.rssiContainer.rssi38;
+			trackedAssets[i].rssi39 = asset.rssiContainer.rssi39;
+			trackedAssets[i].batteryPower = asset.batteryPower;
+			trackedAssets[i].absolutePositionX = asset.absolutePositionX;
+			trackedAssets[i].absolutePositionY = asset.absolutePositionY;
+
+			trackedAssets[i].moving = asset.moving;
+			trackedAssets[i].pressure = ConvertServiceDataToMeshMessagePressure(asset.pressure);
+
+			trackedAssets[i].hasFreeInConnection = asset.hasFreeInConnection;
+			trackedAssets[i].interestedInConnection = asset.interestedInConnection;
+			trackedAssets[i].hasSameNetworkId = asset.hasSameNetworkId;
+		}
 
-		trackedAssets[i].hasFreeInConnection = assetInsPackets[i].hasFreeInConnection;
-		trackedAssets[i].interestedInConnection = assetInsPackets[i].interestedInConnection;
-		trackedAssets[i].hasSameNetworkId = assetInsPackets[i].hasSameNetworkId;
+		SendModuleActionMessage(
+			MessageType::ASSET_GENERIC,
+			NODE_ID_SHORTEST_SINK,
+			(u8)ScanModuleMessages::ASSET_INS_TRACKING_PACKET,
+			0,
+			buffer,
+			messageLength,
+			false
+		);
 	}
 
-	SendModuleActionMessage(
-		MessageType::ASSET_GENERIC,
-		NODE_ID_SHORTEST_SINK,
-		(u8)ScanModuleMessages::ASSET_INS_TRACKING_PACKET,
-		0,
-		buffer,
-		messageLength,
-		false
-	);
-
 	//Clear the buffer
-	assetInsPackets = {};
+	assetInsPackets.Clear();
 #endif
 }
 
@@ -39,12 +39,11 @@
 #endif //GITHUB_RELEASE
 #endif
 #include <ScanController.h>
+#include <AssetTrackingTable.h>
 
 constexpr int SCAN_FILTER_NUMBER = 2;//Number of filters that can be set
 constexpr int NUM_ADDRESSES_TRACKED = 50;
 
-constexpr int ASSET_PACKET_BUFFER_SIZE = 30;
-constexpr int ASSET_INS_PACKET_BUFFER_SIZE = 30;
 constexpr int ASSET_PACKET_RSSI_SEND_THRESHOLD = -88;
 
 constexpr int SCAN_BUFFERS_SIZE = 10; //Max number of packets that are buffered
@@ -86,6 +85,12 @@ class ScanningModule : public Module
 {
 private:
 	static constexpr u16 groupedReportingIntervalDs = 0;
+
+	enum class ScanningModuleTimers : u8
+	{
+		GROUPED_REPORTING = 0,
+		ASSET_REPORTING = 1,
+	};
 	/*
 	 * Filters coud be:
 	 * 	- group all filtered packets by address and sum their RSSI and count
@@ -101,6 +106,12 @@ private:
 		u8 rssi39;
 		u8 count;
 		u16 channelCount[3];
+
+		u8 GetBestRssi() const
+		{
+			u8 rssi = rssi37 < rssi38 ? rssi37 : rssi38;
+			return rssi < rssi39 ? rssi : rssi39;
+		}
 	};
 
 	//Storage for advertising packets
@@ -115,9 +126,13 @@ private:
 		u8 interestedInConnection : 1;
 		u8 hasSameNetworkId : 1;
 		u8 reservedBits : 5;
+
+		u32 GetKey() const { return serialNumberIndex; }
+		void SetKey(u32 key) { serialNumberIndex = key; }
+		u8 GetRssi() const { return rssiContainer.GetBestRssi(); }
 	};
 
-	std::array<ScannedAssetTrackingStorage, ASSET_PACKET_BUFFER_SIZE> assetPackets{};
+	AssetTrackingTable<ScannedAssetTrackingStorage, ASSET_PACKET_BUFFER_SIZE> assetPackets;
 
 	typedef struct
 	{
@@ -172,6 +187,7 @@ private:
 		u8 pressure;
 	} trackedAssetV2;
 	STATIC_ASSERT_SIZE(trackedAssetV2, 8);
+	static constexpr int MAX_TRACKED_ASSETS_PER_V2_MESSAGE = (MAX_MESH_PACKET_SIZE - SIZEOF_CONN_PACKET_HEADER) / SIZEOF_SCAN_MODULE_TRACKED_ASSET_V2;
 
 	typedef struct
 	{
@@ -196,6 +212,7 @@ private:
 		u8 reservedBits : 4;
 	};
 	STATIC_ASSERT_SIZE(TrackedAssetInsMessage, 12);
+	static constexpr int MAX_TRACKED_ASSETS_PER_INS_MESSAGE = (MAX_MESH_PACKET_SIZE - SIZEOF_CONN_PACKET_MODULE) / sizeof(TrackedAssetInsMessage);
 
 	//Storage for INS advertising packets
 	struct ScannedAssetInsTrackingStorage
@@ -211,9 +228,13 @@ private:
 		u8 interestedInConnection : 1;
 		u8 hasSameNetworkId : 1;
 		u8 reservedBits : 5;
+
+		u32 GetKey() const { return assetNodeId; }
+		void SetKey(u32 key) { assetNodeId = (NodeId)key; }
+		u8 GetRssi() const { return rssiContainer.GetBestRssi(); }
 	};
 
-	std::array<ScannedAssetInsTrackingStorage, ASSET_INS_PACKET_BUFFER_SIZE> assetInsPackets{};
+	AssetTrackingTable<ScannedAssetInsTrackingStorage, ASSET_INS_PACKET_BUFFER_SIZE> assetInsPackets;
 
 	//####### End of Module specitic messages
 #pragma pack(pop)
@@ -270,7 +291,7 @@ public:
 
 	void ResetToDefaultConfiguration() override final;
 
-	void TimerEventHandler(u16 passedTimeDs) override final;
+	void TimerWheelEventHandler(u8 timerId) override final;
 
 	virtual void GapAdvertisementReportEventHandler(const FruityHal::GapAdvertisementReportEvent& advertisementReportEvent) override final;
 
@@ -55,6 +55,9 @@ StatusReporterModule::StatusReporterModule()
 	configurationPointer = &configuration;
 	configurationLength = sizeof(StatusReporterModuleConfiguration);
 
+	//The nearby nodes are measured using their JOIN_ME packets
+	GS->scanController.SubscribeToAdvertisements(this, BleGapAdType::TYPE_MANUFACTURER_SPECIFIC_DATA, MESH_COMPANY_IDENTIFIER, ServiceDataMessageType::JOIN_ME_V0);
+
 	//Set defaults
 	ResetToDefaultConfiguration();
 }
@@ -79,37 +82,71 @@ void StatusReporterModule::ResetToDefaultConfiguration()
 void StatusReporterModule::ConfigurationLoadedHandler(ModuleConfiguration* migratableConfig, u16 migratableConfigLength)
 {
 	//Start the Module...
+	const u8 timerIds[] = {
+		(u8)StatusReporterModuleTimers::DEVICE_INFO_REPORTING,
+		(u8)StatusReporterModuleTimers::STATUS_REPORTING,
+		(u8)StatusReporterModuleTimers::CONNECTION_REPORTING,
+		(u8)StatusReporterModuleTimers::NEARBY_REPORTING,
+		(u8)StatusReporterModuleTimers::BATTERY_MEASUREMENT
+	};
+	if (!configuration.moduleActive) {
+		for (u32 i = 0; i < sizeof(timerIds); i++) {
+			GS->timerWheel.Stop(this, timerIds[i]);
+		}
+		return;
+	}
 
+	StartReportingTimers();
+	GS->timerWheel.StartAligned(this, (u8)StatusReporterModuleTimers::BATTERY_MEASUREMENT, batteryMeasurementIntervalDs, 0);
 }
 
-void StatusReporterModule::TimerEventHandler(u16 passedTimeDs)
+void StatusReporterModule::StartReportingTimers()
+{
+	//The reports are sent with the random offset of the node so that not all nodes report at the same time
+	GS->timerWheel.StartAligned(this, (u8)StatusReporterModuleTimers::DEVICE_INFO_REPORTING, configuration.deviceInfoReportingIntervalDs, GS->appTimerRandomOffsetDs);
+	GS->timerWheel.StartAligned(this, (u8)StatusReporterModuleTimers::STATUS_REPORTING, configuration.statusReportingIntervalDs, GS->appTimerRandomOffsetDs);
+	GS->timerWheel.StartAligned(this, (u8)StatusReporterModuleTimers::CONNECTION_REPORTING, configuration.connectionReportingIntervalDs, GS->appTimerRandomOffsetDs);
+	GS->timerWheel.StartAligned(this, (u8)StatusReporterModuleTimers::NEARBY_REPORTING, configuration.nearbyReportingIntervalDs, GS->appTimerRandomOffsetDs);
+}
+
+void StatusReporterModule::AppTimerRandomOffsetChangedHandler()
 {
+	if (!configuration.moduleActive) return;
+
+	StartReportingTimers();
+}
+
+void StatusReporterModule::TimerWheelEventHandler(u8 timerId)
+{
+	if (timerId == (u8)StatusReporterModuleTimers::BATTERY_MEASUREMENT) {
+		BatteryVoltageADC();
+		return;
+	}
+
 	//Peridoic Message sending does not make sense for Assets as they are not connected most of the time.
 	//So instead, the asset fully relies on manual querying these messages. Other than "not making sense"
 	//this can lead to issues on the Gateway if it receives a messages through a MA-Connection that has a
 	//virtual partnerId as the gateway gets confused by the unknown nodeId.
-	if (GET_DEVICE_TYPE() != DeviceType::ASSET)
-	{
-		//Device Info
-		if (SHOULD_IV_TRIGGER(GS->appTimerDs + GS->appTimerRandomOffsetDs, passedTimeDs, configuration.deviceInfoReportingIntervalDs)) {
-			SendDeviceInfoV2(NODE_ID_BROADCAST, 0, MessageType::MODULE_ACTION_RESPONSE);
-		}
-		//Status
-		if (SHOULD_IV_TRIGGER(GS->appTimerDs + GS->appTimerRandomOffsetDs, passedTimeDs, configuration.statusReportingIntervalDs)) {
-			SendStatus(NODE_ID_BROADCAST, 0, MessageType::MODULE_ACTION_RESPONSE);
-		}
-		//Connections
-		if (SHOULD_IV_TRIGGER(GS->appTimerDs + GS->appTimerRandomOffsetDs, passedTimeDs, configuration.connectionReportingIntervalDs)) {
-			SendAllConnections(NODE_ID_BROADCAST, 0, MessageType::MODULE_GENERAL);
-		}
-		//Nearby Nodes
-		if (SHOULD_IV_TRIGGER(GS->appTimerDs + GS->appTimerRandomOffsetDs, passedTimeDs, configuration.nearbyReportingIntervalDs)) {
-			SendNearbyNodes(NODE_ID_BROADCAST, 0, MessageType::MODULE_ACTION_RESPONSE);
-		}
+	if (GET_DEVICE_TYPE() == DeviceType::ASSET) return;
+
+	if (timerId == (u8)StatusReporterModuleTimers::DEVICE_INFO_REPORTING) {
+		SendDeviceInfoV2(NODE_ID_BROADCAST, 0, MessageType::MODULE_ACTION_RESPONSE);
+	}
+	else if (timerId == (u8)StatusReporterModuleTimers::STATUS_REPORTING) {
+		SendStatus(NODE_ID_BROADCAST, 0, MessageType::MODULE_ACTION_RESPONSE);
+	}
+	else if (timerId == (u8)StatusReporterModuleTimers::CONNECTION_REPORTING) {
+		SendAllConnections(NODE_ID_BROADCAST, 0, MessageType::MODULE_GENERAL);
+	}
+	else if (timerId == (u8)StatusReporterModuleTimers::NEARBY_REPORTING) {
+		SendNearbyNodes(NODE_ID_BROADCAST, 0, MessageType::MODULE_ACTION_RESPONSE);
 	}
-	//BatteryMeasurement (measure short after reset and then priodically)
-	if( (GS->appTimerDs < SEC_TO_DS(40) && Boardconfig->batteryAdcInputPin != -1 )
-		|| SHOULD_IV_TRIGGER(GS->appTimerDs, passedTimeDs, batteryMeasurementIntervalDs)){
+}
+
+void StatusReporterModule::TimerEventHandler(u16 passedTimeDs)
+{
+	//BatteryMeasurement (measure short after reset, periodic measurements are done by a timer)
+	if(GS->appTimerDs < SEC_TO_DS(40) && Boardconfig->batteryAdcInputPin != -1){
 		BatteryVoltageADC();
 	}
 
@@ -176,6 +213,7 @@ void StatusReporterModule::SendStatus(NodeId toNode, u8 requestHandle, MessageTy
 	data.inConnectionPartner = !inConnection.Exists() ? 0 : inConnection.GetPartnerId();
 	data.inConnectionRSSI = !inConnection.Exists() ? 0 : inConnection.GetAverageRSSI();
 	data.initializedByGateway = GS->node.initializedByGateway;
+	data.packetPoolHighWaterMark = GS->packetPool.GetHighWaterMark();
 
 	SendModuleActionMessage(
 		messageType,
@@ -440,6 +478,20 @@ TerminalCommandHandlerReturnType StatusReporterModule::TerminalCommandHandler(co
 
 				return TerminalCommandHandlerReturnType::SUCCESS;
 			}
+			else if(TERMARGS(3, "reset_pool_hwm"))
+			{
+				SendModuleActionMessage(
+					MessageType::MODULE_TRIGGER_ACTION,
+					destinationNode,
+					(u8)StatusModuleTriggerActionMessages::RESET_POOL_HIGH_WATER_MARK,
+					0,
+					nullptr,
+					0,
+					false
+				);
+
+				return TerminalCommandHandlerReturnType::SUCCESS;
+			}
 			else if(TERMARGS(3,"get_device_info"))
 			{
 				SendModuleActionMessage(
@@ -652,6 +704,21 @@ void StatusReporterModule::MeshMessageReceivedHandler(BaseConnection* connection
 			{
 				SendRebootReason(packet->header.sender, packet->requestHandle);
 			}
+			//Start a new measurement period for the packet pool high water mark
+			else if(actionType == StatusModuleTriggerActionMessages::RESET_POOL_HIGH_WATER_MARK)
+			{
+				GS->packetPool.ResetHighWaterMark();
+
+				SendModuleActionMessage(
+					MessageType::MODULE_ACTION_RESPONSE,
+					packet->header.sender,
+					(u8)StatusModuleActionResponseMessages::RESET_POOL_HIGH_WATER_MARK_RESULT,
+					packet->requestHandle,
+					nullptr,
+					0,
+					false
+				);
+			}
 		}
 	}
 
@@ -699,7 +766,13 @@ void StatusReporterModule::MeshMessageReceivedHandler(BaseConnection* connection
 				logjson_partial("STATUSMOD", "\"batteryInfo\":%u,\"clusterSize\":%u,", data->batteryInfo, data->clusterSize);
 				logjson_partial("STATUSMOD", "\"connectionLossCounter\":%u,\"freeIn\":%u,", data->connectionLossCounter, data->freeIn);
 				logjson_partial("STATUSMOD", "\"freeOut\":%u,\"inConnectionPartner\":%u,", data->freeOut, data->inConnectionPartner);
-				logjson_partial("STATUSMOD", "\"inConnectionRSSI\":%d, \"initialized\":%u", data->inConnectionRSSI, data->initializedByGateway);
+				logjson_partial("STATUSMOD", "\"inConnectionRSSI\":%d, ", data->inConnectionRSSI);
+				//Older firmwares do not report the packet pool
+				if (sendData->dataLength >= SIZEOF_CONN_PACKET_MODULE + SIZEOF_STATUS_REPORTER_MODULE_STATUS_MESSAGE)
+				{
+					logjson_partial("STATUSMOD", "\"poolHighWaterMark\":%u,", data->packetPoolHighWaterMark);
+				}
+				logjson_partial("STATUSMOD", "\"initialized\":%u", data->initializedByGateway);
 				logjson("STATUSMOD", "}" SEP);
 			}
 			else if(actionType == StatusModuleActionResponseMessages::NEARBY_NODES)
@@ -728,6 +801,10 @@ void StatusReporterModule::MeshMessageReceivedHandler(BaseConnection* connection
 			{
 				logjson("STATUSMOD", "{\"type\":\"set_init_result\",\"nodeId\":%u,\"module\":%u}" SEP, packet->header.sender, (u32)moduleId);
 			}
+			else if(actionType == StatusModuleActionResponseMessages::RESET_POOL_HIGH_WATER_MARK_RESULT)
+			{
+				logjson("STATUSMOD", "{\"type\":\"reset_pool_hwm_result\",\"nodeId\":%u,\"module\":%u}" SEP, packet->header.sender, (u32)moduleId);
+			}
 			else if(actionType == StatusModuleActionResponseMessages::ERROR_LOG_ENTRY)
 			{
 				StatusReporterModuleErrorLogEntryMessage const * data = (StatusReporterModuleErrorLogEntryMessage const *) (packet->data);
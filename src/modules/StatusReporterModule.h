@@ -107,6 +107,7 @@ public:
 			SET_KEEP_ALIVE = 9,
 			GET_DEVICE_INFO_V2 = 10,
 			SET_LIVEREPORTING = 11,
+			RESET_POOL_HIGH_WATER_MARK = 12,
 		};
 
 		enum class StatusModuleActionResponseMessages : u8
@@ -121,6 +122,7 @@ public:
 			//DISCONNECT_REASON = 7, removed as of 21.05.2019
 			REBOOT_REASON = 8,
 			DEVICE_INFO_V2 = 10,
+			RESET_POOL_HIGH_WATER_MARK_RESULT = 12,
 		};
 
 		enum class StatusModuleGeneralMessages : u8
@@ -163,7 +165,7 @@ private:
 			STATIC_ASSERT_SIZE(StatusReporterModuleDeviceInfoV2Message, 37);
 
 			//This message delivers often changing information and info about the incoming connection
-			static constexpr int SIZEOF_STATUS_REPORTER_MODULE_STATUS_MESSAGE = 9;
+			static constexpr int SIZEOF_STATUS_REPORTER_MODULE_STATUS_MESSAGE = 11;
 			typedef struct
 			{
 				ClusterSize clusterSize;
@@ -174,9 +176,10 @@ private:
 				u8 batteryInfo;
 				u8 connectionLossCounter; //Connection losses since reboot
 				u8 initializedByGateway : 1; //Set to 0 if node has been resetted and does not know its configuration
+				u16 packetPoolHighWaterMark; //Highest number of used packet pool blocks since boot or the last reset
 
 			} StatusReporterModuleStatusMessage;
-			STATIC_ASSERT_SIZE(StatusReporterModuleStatusMessage, 9);
+			STATIC_ASSERT_SIZE(StatusReporterModuleStatusMessage, 11);
 
 			//Used for sending error logs through the mesh
 			static constexpr int SIZEOF_STATUS_REPORTER_MODULE_ERROR_LOG_ENTRY_MESSAGE = 12;
@@ -226,6 +229,15 @@ private:
 
 		void convertADCtoVoltage();
 
+		enum class StatusReporterModuleTimers : u8
+		{
+			DEVICE_INFO_REPORTING = 0,
+			STATUS_REPORTING = 1,
+			CONNECTION_REPORTING = 2,
+			NEARBY_REPORTING = 3,
+			BATTERY_MEASUREMENT = 4,
+		};
+
 		bool periodicTimeSendWasActivePreviousTimerEventHandler = false;
 		u32 periodicTimeSendStartTimestampDs = 0;
 		constexpr static u32 PERIODIC_TIME_SEND_AUTOMATIC_DEACTIVATION = SEC_TO_DS(/*10 minutes*/ 10 * 60);
@@ -235,6 +247,8 @@ private:
 		decltype(componentMessageHeader::requestHandle) periodicTimeSendRequestHandle = 0;
 		bool IsPeriodicTimeSendActive();
 
+		void StartReportingTimers();
+
 	public:
 
 		static constexpr int SIZEOF_STATUS_REPORTER_MODULE_CONNECTIONS_MESSAGE = 12;
@@ -250,6 +264,11 @@ private:
 
 		void TimerEventHandler(u16 passedTimeDs) override final;
 
+		void TimerWheelEventHandler(u8 timerId) override final;
+
+		//Aligns the reporting timers again once the node got another nodeId and therefore another random offset
+		void AppTimerRandomOffsetChangedHandler();
+
 		#ifdef TERMINAL_ENABLED
 		TerminalCommandHandlerReturnType TerminalCommandHandler(const char* commandArgs[], u8 commandArgsSize) override final;
 		#endif
@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include "types.h"
+
+template<typename T, u32 N>
+
+/**
+ * Stores the assets that were scanned since the last report in an open addressing table keyed by their
+ * serialNumberIndex or nodeId. The entry type must provide GetKey and SetKey where a key of 0 marks an empty
+ * entry, and GetRssi which returns the positive rssi of the entry, so a lower value is a stronger asset.
+ * Once the table is full, a new asset replaces the weakest entry if it was received stronger.
+ */
+class AssetTrackingTable
+{
+private:
+	static constexpr u32 INVALID_INDEX = 0xFFFFFFFF;
+
+	std::array<T, N> entries{};
+	u32 numEntries = 0;
+
+	static u32 GetHomeIndex(u32 key)
+	{
+		//Fibonacci hashing spreads keys that only differ in their upper bits over the table as well
+		return ((u32)(key * 2654435761U) >> 16) % N;
+	}
+
+	//Returns the index of the key or, if it is not stored, of the first empty entry of its probe sequence
+	u32 Find(u32 key) const
+	{
+		u32 index = GetHomeIndex(key);
+		for (u32 i = 0; i < N; i++)
+		{
+			const u32 entryKey = entries[index].GetKey();
+			if (entryKey == key || entryKey == 0) return index;
+			index = (index + 1) % N;
+		}
+		return INVALID_INDEX;
+	}
+
+	//Removes an entry and moves the following entries of the probe sequence back so that no empty entry interrupts it
+	void RemoveAt(u32 index)
+	{
+		entries[index] = {};
+		numEntries--;
+
+		u32 hole = index;
+		u32 next = (hole + 1) % N;
+		while (entries[next].GetKey() != 0)
+		{
+			//An entry may only be moved to the hole if the hole is not before its home index
+			const u32 homeDistance = (GetHomeIndex(entries[next].GetKey()) + N - hole) % N;
+			const u32 nextDistance = (next + N - hole) % N;
+			if (homeDistance == 0 || homeDistance > nextDistance)
+			{
+				entries[hole] = entries[next];
+				entries[next] = {};
+				hole = next;
+			}
+			next = (next + 1) % N;
+		}
+	}
+
+public:
+	static constexpr u32 length = N;
+
+	//Returns the entry of the key, a cleared entry with the key set if it was not stored yet,
+	//or nullptr if the table is full and no entry is weaker than the given rssi
+	T* GetOrInsert(u32 key, u8 rssi)
+	{
+		if (key == 0) return nullptr;
+
+		u32 index = Find(key);
+		if (index != INVALID_INDEX && entries[index].GetKey() == key) return &entries[index];
+
+		if (numEntries == N)
+		{
+			u32 weakestIndex = 0;
+			for (u32 i = 1; i < N; i++)
+			{
+				if (entries[i].GetRssi() > entries[weakestIndex].GetRssi()) weakestIndex = i;
+			}
+			if (entries[weakestIndex].GetRssi() <= rssi) return nullptr;
+
+			RemoveAt(weakestIndex);
+			index = Find(key);
+		}
+
+		entries[index] = {};
+		entries[index].SetKey(key);
+		numEntries++;
+		return &entries[index];
+	}
+
+	const T* Get(u32 key) const
+	{
+		if (key == 0) return nullptr;
+		const u32 index = Find(key);
+		if (index == INVALID_INDEX || entries[index].GetKey() != key) return nullptr;
+		return &entries[index];
+	}
+
+	//Writes the indices of all entries ordered from the strongest to the weakest and returns their number
+	u32 GetIndicesByRssi(std::array<u16, N>& indices) const
+	{
+		u32 count = 0;
+		for (u32 i = 0; i < N; i++)
+		{
+			if (entries[i].GetKey() == 0) continue;
+
+			//Insertion sort, the table is small and only sorted once per report
+			u32 k = count;
+			while (k > 0 && entries[indices[k - 1]].GetRssi() > entries[i].GetRssi())
+			{
+				indices[k] = indices[k - 1];
+				k--;
+			}
+			indices[k] = (u16)i;
+			count++;
+		}
+		return count;
+	}
+
+	const T& operator[](u32 index) const
+	{
+		return entries[index];
+	}
+
+	u32 GetNumEntries() const
+	{
+		return numEntries;
+	}
+
+	void Clear()
+	{
+		entries = {};
+		numEntries = 0;
+	}
+};
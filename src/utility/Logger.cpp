@@ -243,6 +243,7 @@ void Logger::enableTag(const char* tag)
 
 	if (!found && emptySpot >= 0) {
 		strcpy(&activeLogTags[emptySpot * MAX_LOG_TAG_LENGTH], tagUpper);
+		UpdateActiveLogTagMask();
 	}
 	else if (!found && emptySpot < 0)
 	{
@@ -282,6 +283,7 @@ void Logger::disableTag(const char* tag)
 	for (u32 i = 0; i < MAX_ACTIVATE_LOG_TAG_NUM; i++) {
 		if (strcmp(&activeLogTags[i * MAX_LOG_TAG_LENGTH], tagUpper) == 0) {
 			activeLogTags[i * MAX_LOG_TAG_LENGTH] = '\0';
+			UpdateActiveLogTagMask();
 			return;
 		}
 	}
@@ -318,6 +320,7 @@ void Logger::toggleTag(const char* tag)
 	//If we haven't found it, we enable it by using the previously found empty spot
 	if (!found && emptySpot >= 0) {
 		strcpy(&activeLogTags[emptySpot * MAX_LOG_TAG_LENGTH], tagUpper);
+		UpdateActiveLogTagMask();
 		logt("WARNING", "Tag enabled");
 	}
 	else if (!found && emptySpot < 0) {
@@ -326,12 +329,24 @@ void Logger::toggleTag(const char* tag)
 	}
 	else if (found)
 	{
+		UpdateActiveLogTagMask();
 		logt("WARNING", "Tag disabled");
 	}
 
 #endif
 }
 
+void Logger::UpdateActiveLogTagMask()
+{
+	//ERROR and WARNING are always enabled
+	activeLogTagMask = GetTagMask("ERROR") | GetTagMask("WARNING");
+	for (u32 i = 0; i < MAX_ACTIVATE_LOG_TAG_NUM; i++) {
+		if (activeLogTags[i * MAX_LOG_TAG_LENGTH] != '\0') {
+			activeLogTagMask |= GetTagMask(&activeLogTags[i * MAX_LOG_TAG_LENGTH]);
+		}
+	}
+}
+
 u32 Logger::getAmountOfEnabledTags()
 {
 #if IS_ACTIVE(LOGGING) && defined(TERMINAL_ENABLED)
@@ -548,6 +563,12 @@ const char* Logger::getErrorLogCustomError(CustomErrorTypes type)
 		return "WARN_CONNECTION_SUSTAIN_FAILED";
 	case CustomErrorTypes::FATAL_SENSOR_PINS_NOT_DEFINED_IN_BOARD_ID:
 		return "FATAL_SENSOR_PINS_NOT_DEFINED_IN_BOARD_ID";
+	case CustomErrorTypes::FATAL_FAILED_TO_START_TIMER:
+		return "FATAL_FAILED_TO_START_TIMER";
+	case CustomErrorTypes::FATAL_FAILED_TO_SUBSCRIBE_ADVERTISEMENT:
+		return "FATAL_FAILED_TO_SUBSCRIBE_ADVERTISEMENT";
+	case CustomErrorTypes::FATAL_RUUVI_LOG_PAGES_NOT_AVAILABLE:
+		return "FATAL_RUUVI_LOG_PAGES_NOT_AVAILABLE";
 	default:
 		SIMEXCEPTION(ErrorCodeUnknownException); //Could be an error or should be added to the list
 		return "UNKNOWN_ERROR";
@@ -1068,6 +1089,7 @@ u32 Logger::parseBase64StringToBuffer(const char * base64String, const u32 base6
 void Logger::disableAll()
 {
 	activeLogTags = {};
+	UpdateActiveLogTagMask();
 	logEverything = false;
 }
 
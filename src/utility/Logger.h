@@ -127,6 +127,10 @@ enum class CustomErrorTypes : u8 {
 	WARN_GAP_SEC_DISCONNECT_FAILED = 67,
 	FATAL_FAILED_TO_REGISTER_APPLICATION_INTERRUPT_HANDLER = 68,
 	FATAL_FAILED_TO_REGISTER_MAIN_CONTEXT_HANDLER = 69,
+	//INFO_PACKET_POOL_HIGH_WATER_MARK = 70, removed as of 16.10.2026, reported in the status instead
+	FATAL_FAILED_TO_START_TIMER = 71,
+	FATAL_FAILED_TO_SUBSCRIBE_ADVERTISEMENT = 72,
+	FATAL_RUUVI_LOG_PAGES_NOT_AVAILABLE = 73,
 };
 
 #ifdef _MSC_VER
@@ -144,10 +148,17 @@ enum class CustomErrorTypes : u8 {
  */
 class Logger
 {
+#ifdef SIM_ENABLED
+	friend class CherrySim;
+#endif
 private:
 
 	std::array<char, MAX_ACTIVATE_LOG_TAG_NUM * MAX_LOG_TAG_LENGTH> activeLogTags{};
 
+	//Each active tag sets the bit given by GetTagMask so that most disabled tags are rejected without comparing strings
+	u32 activeLogTagMask = GetTagMask("ERROR") | GetTagMask("WARNING");
+	void UpdateActiveLogTagMask();
+
 	u32 currentJsonCrc = 0;
 
 #ifdef SIM_ENABLED
@@ -212,6 +223,18 @@ public:
 	//These functions are used to enable/disable a debug tag, it will then be printed to the output
 	void enableTag(const char* tag);
 	bool IsTagEnabled(const char* tag) const;
+	//Checked before a tag message is formatted, the mask is usually computed at compile time by the logt macro
+	bool IsTagActive(u32 tagMask, const char* tag) const
+	{
+		return logEverything || ((activeLogTagMask & tagMask) != 0 && IsTagEnabled(tag));
+	}
+	//Hashes the tag (case insensitive) to one of 32 bits
+	static constexpr u32 GetTagMask(const char* tag, u32 hash = 2166136261UL)
+	{
+		return *tag == '\0'
+			? 1UL << (hash % 32)
+			: GetTagMask(tag + 1, (hash ^ (u8)((*tag >= 'a' && *tag <= 'z') ? *tag - 'a' + 'A' : *tag)) * 16777619UL);
+	}
 	void disableTag(const char* tag);
 	void toggleTag(const char* tag);
 
@@ -272,20 +295,24 @@ private:
 #endif
 
 #if IS_ACTIVE(LOGGING)
+//The arguments of logt are only evaluated and formatted if the tag is active
+#define LOGT_ACTIVE(tag) Logger::getInstance().IsTagActive(Logger::GetTagMask(tag), tag)
 #define logs(message, ...) Logger::getInstance().log_f(true, false, true, false, __FILE_S__, __LINE__, message, ##__VA_ARGS__)
-#define logt(tag, message, ...) Logger::getInstance().logTag_f(Logger::LogType::LOG_LINE, __FILE_S__, __LINE__, tag, message, ##__VA_ARGS__)
-#define TO_BASE64(data, dataSize) DYNAMIC_ARRAY(data##Hex, (dataSize)*3+1); Logger::convertBufferToBase64String(data, (dataSize), (char*)data##Hex, (dataSize)*3+1)
-#define TO_BASE64_2(data, dataSize) Logger::convertBufferToBase64String(data, (dataSize), (char*)data##Hex, (dataSize)*3+1)
-#define TO_HEX(data, dataSize) DYNAMIC_ARRAY(data##Hex, (dataSize)*3+1); Logger::convertBufferToHexString(data, (dataSize), (char*)data##Hex, (dataSize)*3+1)
-#define TO_HEX_2(data, dataSize) Logger::convertBufferToHexString(data, (dataSize), (char*)data##Hex, (dataSize)*3+1)
+#define logt(tag, message, ...) do{ if (LOGT_ACTIVE(tag)) Logger::getInstance().logTag_f(Logger::LogType::LOG_LINE, __FILE_S__, __LINE__, tag, message, ##__VA_ARGS__); }while(0)
+//Encode the data as data##Hex for logging it with the given tag, nothing is encoded if the tag is not active
+#define TO_BASE64(tag, data, dataSize) const bool data##HexActive = LOGT_ACTIVE(tag); DYNAMIC_ARRAY(data##Hex, data##HexActive ? (dataSize)*3+1 : 1); if (data##HexActive) Logger::convertBufferToBase64String(data, (dataSize), (char*)data##Hex, (dataSize)*3+1)
+#define TO_BASE64_2(data, dataSize) if (data##HexActive) Logger::convertBufferToBase64String(data, (dataSize), (char*)data##Hex, (dataSize)*3+1)
+#define TO_HEX(tag, data, dataSize) const bool data##HexActive = LOGT_ACTIVE(tag); DYNAMIC_ARRAY(data##Hex, data##HexActive ? (dataSize)*3+1 : 1); if (data##HexActive) Logger::convertBufferToHexString(data, (dataSize), (char*)data##Hex, (dataSize)*3+1)
+#define TO_HEX_2(data, dataSize) if (data##HexActive) Logger::convertBufferToHexString(data, (dataSize), (char*)data##Hex, (dataSize)*3+1)
 
 #else //ACTIVATE_LOGGING
 
-#define logs(message, ...)          do{}while(0)
-#define logt(tag, message, ...)     do{}while(0)
-#define TO_BASE64(data, dataSize)   do{}while(0)
-#define TO_BASE64_2(data, dataSize) do{}while(0)
-#define TO_HEX(data, dataSize)      do{}while(0)
-#define TO_HEX_2(data, dataSize)    do{}while(0)
+#define LOGT_ACTIVE(tag)                 false
+#define logs(message, ...)               do{}while(0)
+#define logt(tag, message, ...)          do{}while(0)
+#define TO_BASE64(tag, data, dataSize)   do{}while(0)
+#define TO_BASE64_2(data, dataSize)      do{}while(0)
+#define TO_HEX(tag, data, dataSize)      do{}while(0)
+#define TO_HEX_2(data, dataSize)         do{}while(0)
 
 #endif //ACTIVATE_LOGGING
@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include <PacketPool.h>
+#include <GlobalState.h>
+#include <Logger.h>
+
+PacketPool::PacketPool()
+{
+	for (u16 i = 0; i < NUM_BLOCKS; i++)
+	{
+		nextBlock[i] = (i + 1 < NUM_BLOCKS) ? (u16)(i + 1) : NO_BLOCK;
+	}
+	freeHead = NUM_BLOCKS > 0 ? 0 : NO_BLOCK;
+	numFreeBlocks = NUM_BLOCKS;
+}
+
+void PacketPool::Register(Account& account, u16 minBlocks, u16 maxBlocks)
+{
+	account.numBlocks = 0;
+	account.maxBlocks = maxBlocks;
+
+	//We can only reserve blocks that are not yet reserved by other queues
+	u16 reservable = numFreeBlocks - numReservedBlocks;
+	account.minBlocks = minBlocks < reservable ? minBlocks : reservable;
+	if (account.minBlocks < minBlocks)
+	{
+		logt("PQ", "Pool can only reserve %u of %u blocks", account.minBlocks, minBlocks);
+	}
+	numReservedBlocks += account.minBlocks;
+}
+
+void PacketPool::Unregister(Account& account)
+{
+	if (account.numBlocks < account.minBlocks)
+	{
+		numReservedBlocks -= account.minBlocks - account.numBlocks;
+	}
+	account.minBlocks = 0;
+	account.maxBlocks = 0;
+}
+
+u16 PacketPool::Allocate(Account& account)
+{
+	if (account.numBlocks >= account.maxBlocks || freeHead == NO_BLOCK) return NO_BLOCK;
+
+	if (account.numBlocks < account.minBlocks)
+	{
+		//Use up one of our reserved blocks
+		numReservedBlocks--;
+	}
+	else if (numFreeBlocks <= numReservedBlocks)
+	{
+		//All remaining blocks are reserved for other queues
+		return NO_BLOCK;
+	}
+
+	u16 block = freeHead;
+	freeHead = nextBlock[block];
+	nextBlock[block] = NO_BLOCK;
+	numFreeBlocks--;
+	account.numBlocks++;
+
+	if (GetNumUsedBlocks() > highWaterMark) highWaterMark = GetNumUsedBlocks();
+
+	return block;
+}
+
+void PacketPool::Free(Account& account, u16 block)
+{
+	if (block >= NUM_BLOCKS || account.numBlocks == 0)
+	{
+		SIMEXCEPTION(IllegalArgumentException); //LCOV_EXCL_LINE assertion
+		return;                                 //LCOV_EXCL_LINE assertion
+	}
+
+	nextBlock[block] = freeHead;
+	freeHead = block;
+	numFreeBlocks++;
+	account.numBlocks--;
+
+	//The block goes back into the reservation of the queue
+	if (account.numBlocks < account.minBlocks)
+	{
+		numReservedBlocks++;
+	}
+}
+
+u8* PacketPool::GetBlock(u16 block)
+{
+	return (u8*)blocks[block];
+}
+
+const u8* PacketPool::GetBlock(u16 block) const
+{
+	return (const u8*)blocks[block];
+}
+
+u16 PacketPool::GetNextBlock(u16 block) const
+{
+	return nextBlock[block];
+}
+
+void PacketPool::SetNextBlock(u16 block, u16 next)
+{
+	nextBlock[block] = next;
+}
+
+u16 PacketPool::GetNumUsedBlocks() const
+{
+	return NUM_BLOCKS - numFreeBlocks;
+}
+
+u16 PacketPool::GetNumFreeBlocks() const
+{
+	return numFreeBlocks;
+}
+
+u16 PacketPool::GetHighWaterMark() const
+{
+	return highWaterMark;
+}
+
+void PacketPool::ResetHighWaterMark()
+{
+	highWaterMark = GetNumUsedBlocks();
+}
+
+/* EOF */
@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <types.h>
+#include <Config.h>
+
+/*
+ * The packet pool is a node wide pool of fixed size blocks that the packet send queues
+ * of all connections draw from on demand. This allows a single connection (e.g. on the
+ * path to the sink) to absorb a burst of packets while the other connections are idle,
+ * using the same amount of RAM as fixed size buffers for each connection.
+ *
+ * Each queue registers with a minimum number of blocks that is reserved for it and
+ * a maximum number of blocks that it can use, so that one congested connection can not
+ * starve the others.
+ */
+class PacketPool
+{
+public:
+	static constexpr u16 BLOCK_SIZE = PACKET_POOL_BLOCK_SIZE;
+	static constexpr u16 NUM_BLOCKS = PACKET_POOL_NUM_BLOCKS;
+	static constexpr u16 NO_BLOCK = 0xFFFF;
+
+	static_assert(BLOCK_SIZE % 4 == 0, "Blocks must keep the data 4 byte aligned");
+	static_assert(NUM_BLOCKS < NO_BLOCK, "Too many blocks");
+
+	//The bookkeeping of a single queue, owned by the queue
+	struct Account
+	{
+		u16 numBlocks;
+		u16 minBlocks;
+		u16 maxBlocks;
+	};
+
+private:
+	u32 blocks[NUM_BLOCKS][BLOCK_SIZE / sizeof(u32)];
+	//Links the free blocks as well as the blocks of each queue
+	u16 nextBlock[NUM_BLOCKS];
+	u16 freeHead = NO_BLOCK;
+	u16 numFreeBlocks = 0;
+	//Number of free blocks that are reserved for queues that are below their minimum
+	u16 numReservedBlocks = 0;
+	u16 highWaterMark = 0;
+
+public:
+	PacketPool();
+
+	//Registers a queue, the minimum is reserved as long as there are enough unreserved blocks
+	void Register(Account& account, u16 minBlocks, u16 maxBlocks);
+	//Releases the reservation of a queue, all its blocks must have been freed before
+	void Unregister(Account& account);
+
+	//Returns the index of a new block or NO_BLOCK if the pool or the account is exhausted
+	u16 Allocate(Account& account);
+	void Free(Account& account, u16 block);
+
+	u8* GetBlock(u16 block);
+	const u8* GetBlock(u16 block) const;
+	u16 GetNextBlock(u16 block) const;
+	void SetNextBlock(u16 block, u16 next);
+
+	u16 GetNumUsedBlocks() const;
+	u16 GetNumFreeBlocks() const;
+	//The highest number of blocks that were used at the same time since the last reset
+	u16 GetHighWaterMark() const;
+	void ResetHighWaterMark();
+};
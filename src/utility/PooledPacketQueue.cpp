@@ -0,0 +1,284 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include <PooledPacketQueue.h>
+#include "GlobalState.h"
+#include <Logger.h>
+#include "Utility.h"
+
+//Each element consists of a 4 byte length field followed by the data padded to 4 bytes
+//A length of 0 marks the end of the elements in a block that is not completely filled
+
+PooledPacketQueue::PooledPacketQueue(PacketPool& pool, u16 minBlocks, u16 maxBlocks)
+	: pool(pool)
+{
+	pool.Register(account, minBlocks, maxBlocks);
+}
+
+PooledPacketQueue::~PooledPacketQueue()
+{
+	Clean();
+	pool.Unregister(account);
+}
+
+u16 PooledPacketQueue::GetElementSize(u16 dataLength)
+{
+	//Padding makes sure that we only save 4-byte aligned data
+	return dataLength + 4 + (4 - dataLength % 4) % 4;
+}
+
+//Moves the given position to the element following the one at the position
+void PooledPacketQueue::AdvancePosition(u16& block, u16& offset) const
+{
+	offset += GetElementSize(((const u16*)(pool.GetBlock(block) + offset))[0]);
+
+	if (offset >= PacketPool::BLOCK_SIZE || ((const u16*)(pool.GetBlock(block) + offset))[0] == 0) {
+		block = pool.GetNextBlock(block);
+		offset = 0;
+	}
+}
+
+void PooledPacketQueue::GetElementPosition(u16 pos, u16& block, u16& offset) const
+{
+	block = headBlock;
+	offset = readOffset;
+	for (u16 i = 0; i < pos; i++) {
+		AdvancePosition(block, offset);
+	}
+}
+
+void PooledPacketQueue::FreeBlocksAfter(u16 block)
+{
+	u16 next = pool.GetNextBlock(block);
+	pool.SetNextBlock(block, PacketPool::NO_BLOCK);
+	while (next != PacketPool::NO_BLOCK) {
+		u16 current = next;
+		next = pool.GetNextBlock(current);
+		pool.Free(account, current);
+	}
+}
+
+bool PooledPacketQueue::Put(u8* data, u16 dataLength)
+{
+	u8* dest = Reserve(dataLength);
+
+	if(dest != nullptr){
+		CheckedMemcpy(dest, data, dataLength);
+		return true;
+	} else {
+		return false;
+	}
+}
+
+u8* PooledPacketQueue::Reserve(u16 dataLength)
+{
+	if (dataLength == 0) return nullptr;
+
+	u16 elementSize = GetElementSize(dataLength);
+
+	if(elementSize > PacketPool::BLOCK_SIZE){
+		logt("ERROR", "Too big");																	//LCOV_EXCL_LINE assertion
+		GS->logger.logCustomError(CustomErrorTypes::FATAL_PACKETQUEUE_PACKET_TOO_BIG, dataLength);	//LCOV_EXCL_LINE assertion
+		SIMEXCEPTION(IllegalArgumentException);														//LCOV_EXCL_LINE assertion
+		return nullptr;																				//LCOV_EXCL_LINE assertion
+	}
+
+	//Take a new block from the pool if the element does not fit in the last one
+	if (tailBlock == PacketPool::NO_BLOCK || writeOffset + elementSize > PacketPool::BLOCK_SIZE)
+	{
+		u16 block = pool.Allocate(account);
+		if (block == PacketPool::NO_BLOCK) {
+			logt("PQ", "No space for %u bytes", dataLength);
+			return nullptr;
+		}
+
+		if (tailBlock == PacketPool::NO_BLOCK) {
+			headBlock = block;
+			readOffset = 0;
+		} else {
+			pool.SetNextBlock(tailBlock, block);
+		}
+		tailBlock = block;
+		writeOffset = 0;
+	}
+
+	u8* writePointer = pool.GetBlock(tailBlock) + writeOffset;
+	((u16*)writePointer)[0] = dataLength;
+	u8* dataPointer = writePointer + 4; //jump over length field
+
+	writeOffset += elementSize;
+
+	//Set length to 0 for next datafield
+	if (writeOffset < PacketPool::BLOCK_SIZE) {
+		((u16*)(pool.GetBlock(tailBlock) + writeOffset))[0] = 0;
+	}
+
+	_numElements++;
+
+	logt("PQ", "Reserve %u bytes, now %u elements", dataLength, _numElements);
+
+	CheckedMemset(dataPointer, 0, dataLength);
+
+	return dataPointer;
+}
+
+SizedData PooledPacketQueue::PeekNext() const
+{
+	return PeekNext(0);
+}
+
+SizedData PooledPacketQueue::PeekNext(u16 pos) const
+{
+	SizedData data;
+	//If queue has been fully read, return empty data
+	if (pos >= _numElements){
+		data.length = 0;
+		data.data = nullptr;
+		return data;
+	}
+
+	u16 block;
+	u16 offset;
+	GetElementPosition(pos, block, offset);
+
+	u8* elementPointer = (u8*)pool.GetBlock(block) + offset;
+	data.length = ((u16*)elementPointer)[0];
+	data.data = elementPointer + 4; // 4 byte added for length field
+
+	return data;
+}
+
+void PooledPacketQueue::DiscardNext()
+{
+	if (_numElements == 0) return;
+
+	_numElements--;
+
+	if (_numElements == 0) {
+		Clean();
+		return;
+	}
+
+	u16 block = headBlock;
+	AdvancePosition(headBlock, readOffset);
+
+	//Give the block back to the pool once all its elements were read
+	if (block != headBlock) {
+		pool.Free(account, block);
+	}
+
+	logt("PQ", "DiscardNext, now %u elements", _numElements);
+}
+
+SizedData PooledPacketQueue::PeekLast()
+{
+	SizedData data = { nullptr, 0 };
+
+	//Return 0 length data in case we have no elements
+	if (_numElements == 0){
+		return data;
+	}
+
+	return PeekNext(_numElements - 1);
+}
+
+void PooledPacketQueue::DiscardLast()
+{
+	if (_numElements == 0) {
+		return;
+	}
+
+	_numElements--;
+
+	if (_numElements == 0) {
+		Clean();
+		return;
+	}
+
+	//Place the write position after the element that is now the last one and free the block
+	//that contained the discarded element if it is empty now
+	u16 block;
+	u16 offset;
+	GetElementPosition(_numElements - 1, block, offset);
+
+	writeOffset = offset + GetElementSize(((u16*)(pool.GetBlock(block) + offset))[0]);
+	if (writeOffset < PacketPool::BLOCK_SIZE) {
+		((u16*)(pool.GetBlock(block) + writeOffset))[0] = 0;
+	}
+	FreeBlocksAfter(block);
+	tailBlock = block;
+
+	logt("PQ", "DiscardLast, now %u elements", _numElements);
+}
+
+void PooledPacketQueue::Clean(void)
+{
+	_numElements = 0;
+
+	if (headBlock != PacketPool::NO_BLOCK) {
+		FreeBlocksAfter(headBlock);
+		pool.Free(account, headBlock);
+	}
+
+	headBlock = PacketPool::NO_BLOCK;
+	tailBlock = PacketPool::NO_BLOCK;
+	readOffset = 0;
+	writeOffset = 0;
+
+	logt("PQ", "Clean");
+}
+
+//Allows us to print the contents of the packet queue
+void PooledPacketQueue::Print() const
+{
+	logt("PQ", "Printing Queue: ");
+	u16 block = headBlock;
+	u16 offset = readOffset;
+	for(u32 i=0; i<_numElements; i++){
+		SizedData data;
+		data.length = ((const u16*)(pool.GetBlock(block) + offset))[0];
+		data.data = (u8*)pool.GetBlock(block) + offset + 4; // 4 byte added for length field
+
+		trace("%u: ", i);
+		for(u32 j=0; j<data.length; j++){
+			trace("%02x:", data.data[j]);
+		}
+		trace(EOL);
+
+		AdvancePosition(block, offset);
+	}
+}
+
+u16 PooledPacketQueue::GetNumBlocks() const
+{
+	return account.numBlocks;
+}
+
+/* EOF */
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <types.h>
+#include <PacketPool.h>
+
+/*
+ * A packet queue with the same interface as the PacketQueue that stores its elements
+ * in blocks of the PacketPool instead of a fixed buffer. Blocks are taken from the pool
+ * once the last block is full and are given back as soon as all elements of a block
+ * were discarded. An element never spans more than one block.
+ */
+class PooledPacketQueue
+{
+private:
+	PacketPool& pool;
+	PacketPool::Account account;
+
+	u16 headBlock = PacketPool::NO_BLOCK;
+	u16 tailBlock = PacketPool::NO_BLOCK;
+	u16 readOffset = 0; //Offset of the next element in the head block
+	u16 writeOffset = 0; //Offset after the last element in the tail block
+
+	static u16 GetElementSize(u16 dataLength);
+	void GetElementPosition(u16 pos, u16& block, u16& offset) const;
+	void AdvancePosition(u16& block, u16& offset) const;
+	void FreeBlocksAfter(u16 block);
+
+public:
+	PooledPacketQueue(PacketPool& pool, u16 minBlocks, u16 maxBlocks);
+	~PooledPacketQueue();
+	PooledPacketQueue(const PooledPacketQueue&) = delete;
+	PooledPacketQueue& operator=(const PooledPacketQueue&) = delete;
+
+	u8* Reserve(u16 dataLength);
+	bool Put(u8* data, u16 dataLength);
+	SizedData PeekNext() const;
+	SizedData PeekNext(u16 pos) const;
+	void DiscardNext();
+	SizedData PeekLast();
+	void DiscardLast();
+	void Clean(void);
+
+	void Print() const;
+
+	//Number of pool blocks that are currently used by this queue
+	u16 GetNumBlocks() const;
+
+	u8 packetSendPosition = 0; //Is used to note the position in messages that consist of multiple parts
+	u8 packetSentRemaining = 0; //Is used to check how many have not yet been sent of the ones that have been queued
+	u8 packetFailedToQueueCounter = 0; //Used to store the number of time the packet failed to send
+
+	u16 _numElements = 0;
+
+	u16 numUnsentElements = 0; //Used for marking some packets as already sent (queued in the softdevice)
+};
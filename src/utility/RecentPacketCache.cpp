@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "RecentPacketCache.h"
+
+bool RecentPacketCache::IsDuplicate(NodeId sender, MessageType messageType, u32 payloadHash, u32 connectionId, u32 nowDs)
+{
+	for (u32 i = 0; i < NUM_ENTRIES; i++)
+	{
+		Entry& entry = entries[i];
+		if (!entry.valid || entry.payloadHash != payloadHash || entry.sender != sender || entry.messageType != messageType) continue;
+
+		if (entry.connectionId != connectionId && nowDs - entry.timestampDs <= ENTRY_TIMEOUT_DS)
+		{
+			hits++;
+			return true;
+		}
+
+		//The sender repeated the packet or the entry is outdated, both is treated as a new packet
+		entry.connectionId = connectionId;
+		entry.timestampDs = nowDs;
+		misses++;
+		return false;
+	}
+
+	Entry& entry = entries[nextEntry];
+	entry.payloadHash = payloadHash;
+	entry.connectionId = connectionId;
+	entry.timestampDs = nowDs;
+	entry.sender = sender;
+	entry.messageType = messageType;
+	entry.valid = true;
+	nextEntry = (nextEntry + 1) % NUM_ENTRIES;
+	misses++;
+	return false;
+}
+
+void RecentPacketCache::Clear()
+{
+	for (u32 i = 0; i < NUM_ENTRIES; i++)
+	{
+		entries[i].valid = false;
+	}
+	nextEntry = 0;
+}
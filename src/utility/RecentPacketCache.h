@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "types.h"
+
+/*
+* Remembers the mesh packets that were routed recently together with the connection
+* that they were received on. Within a cluster, all packets of a sender reach us over
+* the same connection. If the same packet arrives over a different connection shortly
+* after, it was flooded back to us (e.g. while clusters re-form) and does not have to be
+* forwarded again. The cache has a fixed size and replaces the oldest entry if it is full.
+* Once nodes left the cluster, a sender can legitimately reach us over another connection,
+* so the cache must be cleared whenever that happens.
+*/
+class RecentPacketCache
+{
+public:
+	static constexpr u32 NUM_ENTRIES = 16;
+	static constexpr u32 ENTRY_TIMEOUT_DS = SEC_TO_DS(2);
+
+private:
+	struct Entry
+	{
+		u32 payloadHash;
+		u32 connectionId;
+		u32 timestampDs;
+		NodeId sender;
+		MessageType messageType;
+		bool valid;
+	};
+
+	Entry entries[NUM_ENTRIES] = {};
+	u8 nextEntry = 0;
+
+public:
+	u16 hits = 0;
+	u16 misses = 0;
+
+	//Returns true if the same packet was received over a different connection within the timeout,
+	//otherwise the packet is remembered for the given connection
+	bool IsDuplicate(NodeId sender, MessageType messageType, u32 payloadHash, u32 connectionId, u32 nowDs);
+	void Clear();
+};
@@ -77,6 +77,7 @@
 RecordStorage::RecordStorage()
 	: opQueue(opBuffer, RECORD_STORAGE_QUEUE_SIZE)
 {
+	ResetRecordIndex();
 }
 
 void RecordStorage::Init()
@@ -175,6 +176,9 @@ void RecordStorage::SaveRecordInternal(SaveRecordOperation& op)
 {
 	//If any of the previous operations failed, call the callback with an error code
 	if (op.op.flashStorageErrorCode != FlashStorageError::SUCCESS) {
+		//We do not know what was written, so the index must be read from flash again
+		savedRecord = nullptr;
+		recordIndexValid = false;
 		return RecordOperationFinished(op.op, RecordStorageResultCode::BUSY);
 	}
 
@@ -244,6 +248,7 @@ void RecordStorage::SaveRecordInternal(SaveRecordOperation& op)
 			//The crc is calculated over the record header and data, excluding the first two byte (crc and flags)
 			newRecord->crc = Utility::CalculateCrc8(((u8*)newRecord) + 2, newRecord->recordLength - 2);
 			op.stage = RecordStorageSaveStage::CALLBACKS_AND_FINISH;
+			savedRecord = (RecordStorageRecord*)freeSpace;
 			GS->flashStorage.CacheAndWriteData((u32*)newRecord, (u32*)freeSpace, recordLength, this, (u32)FlashUserTypes::DEFAULT);
 			return;
 
@@ -264,6 +269,9 @@ void RecordStorage::SaveRecordInternal(SaveRecordOperation& op)
 	
 	if (op.stage == RecordStorageSaveStage::CALLBACKS_AND_FINISH)
 	{
+		if (savedRecord != nullptr && recordIndexValid) AddToRecordIndex(savedRecord);
+		savedRecord = nullptr;
+
 		return RecordOperationFinished(op.op, RecordStorageResultCode::SUCCESS);
 	}
 }
@@ -273,6 +281,7 @@ void RecordStorage::DeactivateRecordInternal(DeactivateRecordOperation& op)
 {
 	//If any of the previous operations failed, call the callback with an error code
 	if (op.op.flashStorageErrorCode != FlashStorageError::SUCCESS) {
+		recordIndexValid = false;
 		return RecordOperationFinished(op.op, RecordStorageResultCode::BUSY);
 	}
 
@@ -315,6 +324,7 @@ RecordStorageResultCode RecordStorage::LockDownAndClearAllSettings(ModuleId resp
 		opQueue.DiscardNext();
 	}
 	opQueue.Clean();
+	savedRecord = nullptr;
 	lockDownCallback = callback;
 	lockDownUserType = userType;
 	lockDownModuleId = responsibleModuleForShutDown;
@@ -322,6 +332,7 @@ RecordStorageResultCode RecordStorage::LockDownAndClearAllSettings(ModuleId resp
 	if (flashRetVal == FlashStorageError::SUCCESS)
 	{
 		recordStorageLockDown = true;
+		ResetRecordIndex();
 		return RecordStorageResultCode::SUCCESS;
 	}
 	else
@@ -342,6 +353,7 @@ void RecordStorage::RepairPages()
 {
 	if (repairStage == RepairStage::NO_REPAIR) {
 		repairStage = RepairStage::ERASE_CORRUPT_PAGES;
+		ResetRecordIndex();
 	}
 
 	//If there are items in the flashStorage queue, we wait until we get called after the queue is empty
@@ -433,12 +445,8 @@ void RecordStorage::RepairPages()
 			RecordStoragePageState pageState = GetPageState(page);
 
 			if (pageState == RecordStoragePageState::ACTIVE) {
-				RecordStorageRecord* record = (RecordStorageRecord*)page.data;
-
-				//Iterate through all records to find the last valid one (record will then point to free space)
-				while (IsRecordValid(page, record)) {
-					record = (RecordStorageRecord*)((u8*)record + record->recordLength);
-				}
+				//Find the last valid record (record will then point to free space)
+				RecordStorageRecord* record = GetFirstFreeRecord(page);
 
 				//Now, we must check that the rest of the page is clean
 				u32* pageData = (u32*)&page;
@@ -461,6 +469,9 @@ void RecordStorage::RepairPages()
 	{
 		repairStage = RepairStage::NO_REPAIR;
 
+		//Pages were erased and activated, the index is built again once a record is requested
+		ResetRecordIndex();
+
 		//If this repair process was initiated from a lock down.
 		if (recordStorageLockDown)
 		{
@@ -598,6 +609,11 @@ void RecordStorage::DefragmentPage(RecordStoragePage& pageToDefragment, bool for
 	{
 		defragmentationStage = DefragmentationStage::NO_DEFRAGMENTATION;
 
+		//The records of the erased page now live on the former swap page
+		const u32 pageIndex = GetPageIndex(defragmentPage);
+		if (pageIndex < RECORD_STORAGE_MAX_VALIDATED_PAGES) validatedPageEnd[pageIndex] = SIZEOF_RECORD_STORAGE_PAGE_HEADER;
+		recordIndexValid = false;
+
 		//Call the listener manually because we did not queue another task
 		ProcessQueue(true);
 	}
@@ -693,6 +709,37 @@ SizedData RecordStorage::GetRecordData(u16 recordId) const
 //Will return the latest version of a record if its structure is valid
 //Will also return a record if it has been deactivated
 RecordStorageRecord* RecordStorage::GetRecord(u16 recordId) const
+{
+	//While pages are repaired or erased, the flash can change at any time and must be searched
+	if (repairStage != RepairStage::NO_REPAIR
+		|| defragmentationStage == DefragmentationStage::FINALIZE
+		|| recordStorageLockDown)
+	{
+		return FindRecord(recordId);
+	}
+
+	if (!recordIndexValid) BuildRecordIndex();
+
+	//A record that is being saved can be used as soon as it was written completely
+	if (savedRecord != nullptr
+		&& savedRecord->recordId == recordId
+		&& IsRecordValid(getPage(GetPageIndex(savedRecord)), savedRecord))
+	{
+		AddToRecordIndex(savedRecord);
+	}
+
+	for (u32 i = 0; i < recordIndexSize; i++)
+	{
+		if (recordIndex[i].recordId == recordId)
+		{
+			return (RecordStorageRecord*)(startPage + recordIndex[i].recordOffset * sizeof(u32));
+		}
+	}
+
+	return recordIndexComplete ? nullptr : FindRecord(recordId);
+}
+
+RecordStorageRecord* RecordStorage::FindRecord(u16 recordId) const
 {
 	RecordStorageRecord* result = nullptr;
 
@@ -728,6 +775,90 @@ RecordStorageRecord* RecordStorage::GetRecord(u16 recordId) const
 	return result;
 }
 
+void RecordStorage::BuildRecordIndex() const
+{
+	recordIndexSize = 0;
+	recordIndexComplete = true;
+
+	for (u32 i = 0; i < RECORD_STORAGE_NUM_PAGES; i++)
+	{
+		RecordStoragePage& page = getPage(i);
+		if (GetPageState(page) != RecordStoragePageState::ACTIVE) continue;
+
+		RecordStorageRecord* record = (RecordStorageRecord*)page.data;
+		while (IsRecordValid(page, record))
+		{
+			AddToRecordIndex(record);
+			record = (RecordStorageRecord*)((u8*)record + record->recordLength);
+		}
+	}
+
+	recordIndexValid = true;
+}
+
+void RecordStorage::AddToRecordIndex(const RecordStorageRecord* record) const
+{
+	const u16 recordOffset = (u16)(((u32)record - (u32)startPage) / sizeof(u32));
+
+	for (u32 i = 0; i < recordIndexSize; i++)
+	{
+		if (recordIndex[i].recordId != record->recordId) continue;
+
+		//Same rule as when searching the flash: the first record with the biggest versionCounter wins
+		const RecordStorageRecord* indexedRecord = (const RecordStorageRecord*)(startPage + recordIndex[i].recordOffset * sizeof(u32));
+		if (record->versionCounter > indexedRecord->versionCounter) {
+			recordIndex[i].recordOffset = recordOffset;
+		}
+		return;
+	}
+
+	if (recordIndexSize < RECORD_STORAGE_INDEX_SIZE)
+	{
+		recordIndex[recordIndexSize].recordId = record->recordId;
+		recordIndex[recordIndexSize].recordOffset = recordOffset;
+		recordIndexSize++;
+	}
+	else
+	{
+		recordIndexComplete = false;
+	}
+}
+
+void RecordStorage::ResetRecordIndex()
+{
+	recordIndexSize = 0;
+	recordIndexValid = false;
+	recordIndexComplete = false;
+	for (u32 i = 0; i < RECORD_STORAGE_MAX_VALIDATED_PAGES; i++)
+	{
+		validatedPageEnd[i] = SIZEOF_RECORD_STORAGE_PAGE_HEADER;
+	}
+}
+
+u32 RecordStorage::GetPageIndex(const void* address) const
+{
+	return ((u32)address - (u32)startPage) / FruityHal::GetCodePageSize();
+}
+
+RecordStorageRecord* RecordStorage::GetFirstFreeRecord(const RecordStoragePage& page) const
+{
+	//All records before the validated end are valid, so we can skip them
+	u32 pageIndex = GetPageIndex(&page);
+	RecordStorageRecord* record = (RecordStorageRecord*)page.data;
+	if (pageIndex < RECORD_STORAGE_MAX_VALIDATED_PAGES)
+	{
+		record = (RecordStorageRecord*)((u8*)&page + validatedPageEnd[pageIndex]);
+	}
+
+	//Iterate through all remaining valid records
+	while (IsRecordValid(page, record))
+	{
+		record = (RecordStorageRecord*)((u8*)record + record->recordLength);
+	}
+
+	return record;
+}
+
 //Returns a pointer to the free space, otherwise returns nullptr
 u8* RecordStorage::GetFreeRecordSpace(u16 dataLength) const
 {
@@ -738,14 +869,7 @@ u8* RecordStorage::GetFreeRecordSpace(u16 dataLength) const
 		RecordStoragePage& page = getPage(i);
 		if(GetPageState(page) != RecordStoragePageState::ACTIVE) continue;
 
-		//Get first record
-		RecordStorageRecord* record = (RecordStorageRecord*)page.data;
-
-		//Iterate through all valid records
-		while(IsRecordValid(page, record))
-		{
-			record = (RecordStorageRecord*)((u8*)record + record->recordLength);
-		}
+		RecordStorageRecord* record = GetFirstFreeRecord(page);
 
 		//Check if we have enough space left till the end of the page
 		if(((u32)record - (u32)&page + dataLength) <= FruityHal::GetCodePageSize()){
@@ -760,12 +884,7 @@ u16 RecordStorage::GetFreeSpaceOnPage(const RecordStoragePage& page) const
 {
 	if (GetPageState(page) != RecordStoragePageState::ACTIVE) return 0;
 
-	//Get first record
-	const RecordStorageRecord* record = (const RecordStorageRecord*)page.data;
-	//Iterate through all valid records until it jumps to the first invalid record
-	while (IsRecordValid(page, record)) {
-		record = (const RecordStorageRecord*)((const u8*)record + record->recordLength);
-	}
+	const RecordStorageRecord* record = GetFirstFreeRecord(page);
 
 	return (FruityHal::GetCodePageSize() - ((u32)record - (u32)&page));
 }
@@ -817,6 +936,14 @@ bool RecordStorage::IsRecordValid(const RecordStoragePage& page, RecordStorageRe
 		return false;
 	}
 
+	//Records are only appended to a page and the crc does not cover the deactivation flag,
+	//so the crc of the records before the validated end does not have to be checked again
+	const u32 pageIndex = GetPageIndex(&page);
+	const u32 recordOffset = (u32)record - (u32)&page;
+	if (pageIndex < RECORD_STORAGE_MAX_VALIDATED_PAGES && recordOffset < validatedPageEnd[pageIndex]) {
+		return true;
+	}
+
 	//Check if CRC is valid
 	if(Utility::CalculateCrc8(((const u8*)record) + sizeof(u16), record->recordLength - 2) != record->crc){
 		logt("ERROR", "crc %u not matching %u", record->crc, Utility::CalculateCrc8(((const u8*)record) + sizeof(u16), record->recordLength - 2));
@@ -825,6 +952,10 @@ bool RecordStorage::IsRecordValid(const RecordStoragePage& page, RecordStorageRe
 		return false;
 	}
 
+	if (pageIndex < RECORD_STORAGE_MAX_VALIDATED_PAGES && recordOffset == validatedPageEnd[pageIndex]) {
+		validatedPageEnd[pageIndex] = recordOffset + record->recordLength;
+	}
+
 	return true;
 }
 
@@ -174,6 +174,11 @@ class RecordStorageEventListener;
 
 constexpr int RECORD_STORAGE_QUEUE_SIZE = 256;
 
+//Number of recordIds whose newest record is remembered in RAM, other records are searched in flash
+constexpr int RECORD_STORAGE_INDEX_SIZE = 32;
+//Number of pages for which validated records are remembered, records on other pages have their crc checked on every access
+constexpr int RECORD_STORAGE_MAX_VALIDATED_PAGES = 8;
+
 /**
  * The RecordStorage is able to manage multiple records in the flash. It is possible to create new
  * records, update records and delete records. It uses the FlashStorage class for storage operations.
@@ -205,6 +210,24 @@ class RecordStorage : public FlashStorageEventListener
 
 		bool processQueueInProgress = false;
 
+		//The record index stores the newest record of each recordId as an offset in words from the startPage
+		//It is rebuilt from flash after pages were repaired or erased and updated whenever a record was saved
+		struct RecordIndexEntry
+		{
+			u16 recordId;
+			u16 recordOffset;
+		};
+		mutable RecordIndexEntry recordIndex[RECORD_STORAGE_INDEX_SIZE] = {};
+		mutable u8 recordIndexSize = 0;
+		mutable bool recordIndexValid = false;
+		//False if there were more recordIds than fit in the index
+		mutable bool recordIndexComplete = false;
+		//Where the last save operation wrote its record
+		RecordStorageRecord* savedRecord = nullptr;
+
+		//Offset of the first record on each page whose crc was not checked yet, all records before are valid
+		mutable u16 validatedPageEnd[RECORD_STORAGE_MAX_VALIDATED_PAGES] = {};
+
 		//Stores a record
 		void SaveRecordInternal(SaveRecordOperation& op);
 		//Removes a record
@@ -225,8 +248,19 @@ class RecordStorage : public FlashStorageEventListener
 		u16 GetFreeSpaceWhenDefragmented(const RecordStoragePage& page) const;
 
 		//Helpers
-		//Checks if a record is valid
+		//Checks if a record is valid, the crc of each record is only checked once
 		bool IsRecordValid(const RecordStoragePage& page, RecordStorageRecord const* record) const;
+		//Returns the first record after all valid records of the page
+		RecordStorageRecord* GetFirstFreeRecord(const RecordStoragePage& page) const;
+		//Searches all pages for the latest version of a record
+		RecordStorageRecord* FindRecord(u16 recordId) const;
+		void BuildRecordIndex() const;
+		//Stores the record in the index if it is newer than the indexed one
+		void AddToRecordIndex(const RecordStorageRecord* record) const;
+		//Forgets all knowledge about the flash contents, must be called if the pages were modified or erased
+		void ResetRecordIndex();
+		//Returns the index of the page that contains the address
+		u32 GetPageIndex(const void* address) const;
 		//Looks through all pages and returns the page with the most space after defragmentation
 		RecordStoragePage * FindPageToDefragment() const;
 		RecordStoragePage& getPage(u32 index) const;
@@ -806,6 +806,12 @@ bool Terminal::GetNextTerminalQueueEntry(TerminalCommandQueueEntry & out)
 	}
 }
 
+bool Terminal::HasQueuedTerminalCommands()
+{
+	std::unique_lock<std::mutex> guard(terminalMutex);
+	return terminalCommandQueue.size() > 0;
+}
+
 void Terminal::StdioCheckAndProcessLine()
 {
 	if (cherrySimInstance->simConfig.terminalId != cherrySimInstance->currentNode->id && cherrySimInstance->simConfig.terminalId != 0) return;
@@ -835,6 +841,7 @@ void Terminal::StdioCheckAndProcessLine()
 				+ "[!]COMMAND EXECUTION END[!]" EOL;
 			
 			StdioPutString(executionReplayLine.c_str());
+			cherrySimInstance->TraceReplayCommand(message);
 		}
 
 		const char *simPos = strstr(message.c_str(), "sim ");
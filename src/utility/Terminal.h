@@ -93,6 +93,10 @@ public:
 class Terminal
 {
 		friend class DebugModule;
+#ifdef SIM_ENABLED
+		friend class CherrySim;
+		friend class CherrySimTester;
+#endif
 
 private:
 	const char* commandArgsPtr[MAX_NUM_TERM_ARGS];
@@ -190,6 +194,7 @@ private:
 public:
 	void PutIntoTerminalCommandQueue(std::string &message, bool skipCrc);
 	bool GetNextTerminalQueueEntry(TerminalCommandQueueEntry &out);
+	bool HasQueuedTerminalCommands();
 	void StdioPutString(const char* message);
 
 #endif
@@ -0,0 +1,205 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "TimerWheel.h"
+#include "GlobalState.h"
+
+TimerWheel::TimerWheel()
+{
+	CheckedMemset(lists, INVALID_INDEX, sizeof(lists));
+}
+
+TimerWheel::Timer* TimerWheel::Find(const TimerWheelEventListener* listener, u8 timerId)
+{
+	for (u32 i = 0; i < NUM_TIMERS; i++)
+	{
+		if (timers[i].listener == listener && timers[i].timerId == timerId) return &timers[i];
+	}
+	return nullptr;
+}
+
+bool TimerWheel::Start(TimerWheelEventListener* listener, u8 timerId, u32 delayDs, u32 periodDs)
+{
+	Timer* timer = Find(listener, timerId);
+	if (timer != nullptr)
+	{
+		Remove((u8)(timer - timers));
+	}
+	else
+	{
+		for (u32 i = 0; i < NUM_TIMERS && timer == nullptr; i++)
+		{
+			if (timers[i].listener == nullptr) timer = &timers[i];
+		}
+		if (timer == nullptr)
+		{
+			logt("ERROR", "No free timer in the timer wheel");
+			SIMEXCEPTION(BufferTooSmallException);
+			GS->logger.logCustomError(CustomErrorTypes::FATAL_FAILED_TO_START_TIMER, timerId);
+			return false;
+		}
+		numActiveTimers++;
+	}
+
+	timer->listener = listener;
+	timer->timerId = timerId;
+	//A timer can only be due in the future, otherwise it would never be reached
+	timer->deadlineDs = currentDs + (delayDs != 0 ? delayDs : 1);
+	timer->periodDs = periodDs;
+	Insert((u8)(timer - timers));
+
+	return true;
+}
+
+bool TimerWheel::StartAligned(TimerWheelEventListener* listener, u8 timerId, u32 intervalDs, u32 offsetDs)
+{
+	if (intervalDs == 0) {
+		Stop(listener, timerId);
+		return true;
+	}
+	return Start(listener, timerId, intervalDs - ((currentDs + offsetDs) % intervalDs), intervalDs);
+}
+
+void TimerWheel::Stop(const TimerWheelEventListener* listener, u8 timerId)
+{
+	Timer* timer = Find(listener, timerId);
+	if (timer == nullptr || listener == nullptr) return;
+
+	Remove((u8)(timer - timers));
+	timer->listener = nullptr;
+	numActiveTimers--;
+}
+
+bool TimerWheel::IsRunning(const TimerWheelEventListener* listener, u8 timerId)
+{
+	return listener != nullptr && Find(listener, timerId) != nullptr;
+}
+
+void TimerWheel::Insert(u8 index)
+{
+	Timer& timer = timers[index];
+
+	const u32 block = timer.deadlineDs / NUM_SLOTS;
+	const u32 currentBlock = currentDs / NUM_SLOTS;
+	if (block == currentBlock) timer.list = timer.deadlineDs % NUM_SLOTS;
+	else if (block - currentBlock < NUM_SLOTS) timer.list = NUM_SLOTS + block % NUM_SLOTS;
+	else timer.list = OVERFLOW_LIST;
+
+	//Lists are sorted by index so that timers that are due at the same time are called in a fixed order
+	u8 prev = INVALID_INDEX;
+	u8 next = lists[timer.list];
+	while (next != INVALID_INDEX && next < index)
+	{
+		prev = next;
+		next = timers[next].next;
+	}
+
+	timer.prev = prev;
+	timer.next = next;
+	if (prev != INVALID_INDEX) timers[prev].next = index;
+	else lists[timer.list] = index;
+	if (next != INVALID_INDEX) timers[next].prev = index;
+}
+
+void TimerWheel::Remove(u8 index)
+{
+	Timer& timer = timers[index];
+
+	if (timer.prev != INVALID_INDEX) timers[timer.prev].next = timer.next;
+	else lists[timer.list] = timer.next;
+	if (timer.next != INVALID_INDEX) timers[timer.next].prev = timer.prev;
+
+	timer.prev = INVALID_INDEX;
+	timer.next = INVALID_INDEX;
+}
+
+//Moves all timers of a list to the list that matches their deadline from the current time on
+void TimerWheel::Cascade(u8 list)
+{
+	u8 index = lists[list];
+	lists[list] = INVALID_INDEX;
+	while (index != INVALID_INDEX)
+	{
+		const u8 next = timers[index].next;
+		Insert(index);
+		index = next;
+	}
+}
+
+void TimerWheel::Advance(u32 nowDs)
+{
+	//Without timers, no list has to be cascaded
+	if (numActiveTimers == 0)
+	{
+		currentDs = nowDs;
+		return;
+	}
+
+	while (currentDs != nowDs)
+	{
+		currentDs++;
+
+		if (currentDs % NUM_SLOTS == 0)
+		{
+			const u32 currentBlock = currentDs / NUM_SLOTS;
+			if (currentBlock % NUM_SLOTS == 0) Cascade(OVERFLOW_LIST);
+			Cascade(NUM_SLOTS + currentBlock % NUM_SLOTS);
+		}
+
+		const u8 slot = currentDs % NUM_SLOTS;
+		while (lists[slot] != INVALID_INDEX)
+		{
+			const u8 index = lists[slot];
+			Timer& timer = timers[index];
+			TimerWheelEventListener* listener = timer.listener;
+			const u8 timerId = timer.timerId;
+
+			//The timer is rescheduled or freed before its listener is called, so that the listener may restart or stop it
+			Remove(index);
+			if (timer.periodDs != 0)
+			{
+				timer.deadlineDs += timer.periodDs;
+				Insert(index);
+			}
+			else
+			{
+				timer.listener = nullptr;
+				numActiveTimers--;
+			}
+
+			listener->TimerWheelEventHandler(timerId);
+		}
+	}
+}
+
+u32 TimerWheel::GetNumActiveTimers() const
+{
+	return numActiveTimers;
+}
@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "types.h"
+
+/*
+ * Listeners of the TimerWheel are called once one of their timers is due.
+ */
+class TimerWheelEventListener
+{
+	public:
+		TimerWheelEventListener(){};
+
+	virtual ~TimerWheelEventListener(){};
+
+	//The timerId is the one that was given when the timer was started
+	virtual void TimerWheelEventHandler(u8 timerId) = 0;
+};
+
+/*
+ * The TimerWheel calls its listeners once their one-shot or periodic deadlines are reached, so that
+ * they do not have to check their intervals on every timer tick. Deadlines are given in deciseconds of the
+ * app timer. It is a hierarchical timer wheel with two levels: timers that are due within the current
+ * block of NUM_SLOTS ds are kept in a slot per ds, timers that are due within the next NUM_SLOTS blocks
+ * are kept in a slot per block and are moved to the first level once their block is reached. Timers that
+ * are due even later are kept in an overflow list that is checked once per revolution of the second level.
+ * All timers are stored in a fixed size array, a timer is identified by its listener and timerId.
+ */
+class TimerWheel
+{
+public:
+	static constexpr u32 NUM_TIMERS = 16;
+	static constexpr u32 NUM_SLOTS = 32;
+
+private:
+	static constexpr u8 INVALID_INDEX = 0xFF;
+	static constexpr u8 OVERFLOW_LIST = 2 * NUM_SLOTS;
+	static constexpr u8 NUM_LISTS = 2 * NUM_SLOTS + 1;
+
+	struct Timer
+	{
+		TimerWheelEventListener* listener; //nullptr if the timer is not used
+		u32 deadlineDs;
+		u32 periodDs; //0 for one-shot timers
+		u8 timerId;
+		u8 list;
+		u8 prev;
+		u8 next;
+	};
+
+	Timer timers[NUM_TIMERS] = {};
+	//Heads of the first level slots, followed by the second level slots and the overflow list
+	u8 lists[NUM_LISTS];
+	u32 currentDs = 0;
+	u8 numActiveTimers = 0;
+
+	Timer* Find(const TimerWheelEventListener* listener, u8 timerId);
+	void Insert(u8 index);
+	void Remove(u8 index);
+	void Cascade(u8 list);
+
+public:
+	TimerWheel();
+
+	//Starts a timer that calls the listener after delayDs and then every periodDs, or only once if periodDs is 0
+	//A running timer with the same listener and timerId is restarted. Returns false if all timers are in use
+	bool Start(TimerWheelEventListener* listener, u8 timerId, u32 delayDs, u32 periodDs);
+
+	//Starts a periodic timer that is due whenever the app timer plus offsetDs crosses a multiple of intervalDs,
+	//which is the same time at which SHOULD_IV_TRIGGER(appTimerDs + offsetDs, passedTimeDs, intervalDs) is true
+	bool StartAligned(TimerWheelEventListener* listener, u8 timerId, u32 intervalDs, u32 offsetDs);
+
+	//Stops the timer, does nothing if it is not running
+	void Stop(const TimerWheelEventListener* listener, u8 timerId);
+	bool IsRunning(const TimerWheelEventListener* listener, u8 timerId);
+
+	//Advances the wheel to the current app timer and calls the listeners of all timers that became due
+	void Advance(u32 nowDs);
+
+	u32 GetNumActiveTimers() const;
+};
@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "UnicastRouteTable.h"
+
+void UnicastRouteTable::Learn(NodeId nodeId, u32 connectionId, u32 nowDs)
+{
+	Entry* oldestEntry = &entries[0];
+	for (u32 i = 0; i < NUM_ENTRIES; i++)
+	{
+		Entry& entry = entries[i];
+		if (entry.connectionId != 0 && entry.nodeId == nodeId)
+		{
+			entry.connectionId = connectionId;
+			entry.timestampDs = nowDs;
+			return;
+		}
+		//Unused entries are always preferred, otherwise the least recently updated one is replaced
+		if (oldestEntry->connectionId != 0 && (entry.connectionId == 0 || nowDs - entry.timestampDs > nowDs - oldestEntry->timestampDs))
+		{
+			oldestEntry = &entry;
+		}
+	}
+
+	oldestEntry->nodeId = nodeId;
+	oldestEntry->connectionId = connectionId;
+	oldestEntry->timestampDs = nowDs;
+}
+
+u32 UnicastRouteTable::GetConnectionId(NodeId nodeId, u32 nowDs)
+{
+	for (u32 i = 0; i < NUM_ENTRIES; i++)
+	{
+		Entry& entry = entries[i];
+		if (entry.connectionId == 0 || entry.nodeId != nodeId) continue;
+
+		if (nowDs - entry.timestampDs > ENTRY_TIMEOUT_DS)
+		{
+			//The node was not heard of for a while, it might have left the cluster
+			entry.connectionId = 0;
+			break;
+		}
+
+		hits++;
+		return entry.connectionId;
+	}
+
+	misses++;
+	return 0;
+}
+
+void UnicastRouteTable::RemoveConnection(u32 connectionId)
+{
+	for (u32 i = 0; i < NUM_ENTRIES; i++)
+	{
+		if (entries[i].connectionId == connectionId) entries[i].connectionId = 0;
+	}
+}
+
+void UnicastRouteTable::Clear()
+{
+	for (u32 i = 0; i < NUM_ENTRIES; i++)
+	{
+		entries[i].connectionId = 0;
+	}
+}
@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2020 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "types.h"
+
+/*
+* Learns which mesh connection leads to a node, similar to a learning switch. Within a cluster,
+* all packets of a sender reach us over the connection that is the next hop towards that sender,
+* so unicast packets to that node can be sent over this connection only instead of flooding them
+* through the whole cluster. The table has a fixed size and replaces the oldest entry if it is full.
+*/
+class UnicastRouteTable
+{
+public:
+	static constexpr u32 NUM_ENTRIES = 32;
+	static constexpr u32 ENTRY_TIMEOUT_DS = SEC_TO_DS(60);
+
+private:
+	struct Entry
+	{
+		u32 connectionId;
+		u32 timestampDs;
+		NodeId nodeId;
+	};
+
+	Entry entries[NUM_ENTRIES] = {};
+
+public:
+	u16 hits = 0;
+	u16 misses = 0;
+
+	//Remembers that the node is reachable over the connection with the given uniqueConnectionId
+	void Learn(NodeId nodeId, u32 connectionId, u32 nowDs);
+
+	//Returns the uniqueConnectionId of the learned route to the node or 0 if no route is known
+	u32 GetConnectionId(NodeId nodeId, u32 nowDs);
+
+	//Forgets all routes over the given connection
+	void RemoveConnection(u32 connectionId);
+
+	//Forgets all routes, must be called if the cluster topology changed in a way that routes could become invalid
+	void Clear();
+};
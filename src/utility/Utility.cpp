@@ -380,16 +380,72 @@ uint16_t Utility::CalculateCrc16(const uint8_t * p_data, const uint32_t size, co
 	return crc;
 }
 
+namespace {
+	constexpr u32 CRC32_POLYNOMIAL = 0xEDB88320;
+
+	//Shifts the given number of bits through the crc32, one bit at a time
+	constexpr u32 Crc32ShiftBits(u32 crc, u32 numBits)
+	{
+		return numBits == 0 ? crc : Crc32ShiftBits((crc >> 1) ^ ((crc & 1) ? CRC32_POLYNOMIAL : 0), numBits - 1);
+	}
+
+#ifdef SIM_ENABLED
+	//The simulator uses slice-by-8 which processes 8 bytes per iteration using 8 KB of tables
+	struct Crc32SliceTables
+	{
+		u32 slice[8][256];
+	};
+
+	constexpr Crc32SliceTables GenerateCrc32SliceTables()
+	{
+		Crc32SliceTables tables = {};
+		for (u32 i = 0; i < 256; i++) {
+			tables.slice[0][i] = Crc32ShiftBits(i, 8);
+		}
+		for (u32 i = 0; i < 256; i++) {
+			for (u32 s = 1; s < 8; s++) {
+				tables.slice[s][i] = (tables.slice[s - 1][i] >> 8) ^ tables.slice[0][tables.slice[s - 1][i] & 0xFF];
+			}
+		}
+		return tables;
+	}
+
+	constexpr Crc32SliceTables crc32SliceTables = GenerateCrc32SliceTables();
+#else
+	//The firmware uses a table of 16 entries to save flash and processes a nibble per lookup
+	constexpr u32 crc32NibbleTable[16] = {
+		Crc32ShiftBits( 0, 4), Crc32ShiftBits( 1, 4), Crc32ShiftBits( 2, 4), Crc32ShiftBits( 3, 4),
+		Crc32ShiftBits( 4, 4), Crc32ShiftBits( 5, 4), Crc32ShiftBits( 6, 4), Crc32ShiftBits( 7, 4),
+		Crc32ShiftBits( 8, 4), Crc32ShiftBits( 9, 4), Crc32ShiftBits(10, 4), Crc32ShiftBits(11, 4),
+		Crc32ShiftBits(12, 4), Crc32ShiftBits(13, 4), Crc32ShiftBits(14, 4), Crc32ShiftBits(15, 4),
+	};
+#endif
+}
+
 u32 Utility::CalculateCrc32(const u8* message, const u32 messageLength, u32 previousCrc) {
 	u32 crc = ~previousCrc;
-	for(u32 i = 0; i < messageLength; i++) {
-		u32 byte = message[i];
-		crc = crc ^ byte;
-		for (u32 j = 0; j < 8; j++) {
-			u32 mask = -(crc & 1);
-			crc = (crc >> 1) ^ (0xEDB88320 & mask);
-		}
+	u32 remaining = messageLength;
+#ifdef SIM_ENABLED
+	const auto& table = crc32SliceTables.slice;
+	//Bytes are assembled manually so that the message does not have to be aligned
+	while (remaining >= 8) {
+		const u32 low = crc ^ ((u32)message[0] | ((u32)message[1] << 8) | ((u32)message[2] << 16) | ((u32)message[3] << 24));
+		const u32 high = (u32)message[4] | ((u32)message[5] << 8) | ((u32)message[6] << 16) | ((u32)message[7] << 24);
+		crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24]
+			^ table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+		message += 8;
+		remaining -= 8;
+	}
+	for (u32 i = 0; i < remaining; i++) {
+		crc = (crc >> 8) ^ table[0][(crc ^ message[i]) & 0xFF];
+	}
+#else
+	for (u32 i = 0; i < remaining; i++) {
+		crc = crc ^ message[i];
+		crc = (crc >> 4) ^ crc32NibbleTable[crc & 0x0F];
+		crc = (crc >> 4) ^ crc32NibbleTable[crc & 0x0F];
 	}
+#endif
 	return ~crc;
 }
 
@@ -406,6 +462,21 @@ void Utility::Aes128BlockEncrypt(const Aes128Block* messageBlock, const Aes128Bl
 	FruityHal::EcbEncryptBlock((const u8*)key->data, (const u8*)messageBlock->data, (u8*)encryptedMessage->data);
 }
 
+void Utility::Aes128PrepareKey(const Aes128Block* key, Aes128KeyContext* keyContext)
+{
+	FruityHal::EcbPrepareKey((const u8*)key->data, keyContext);
+}
+
+void Utility::Aes128BlockEncrypt(const Aes128Block* messageBlock, const Aes128KeyContext& keyContext, Aes128Block* encryptedMessage)
+{
+	FruityHal::EcbEncryptBlocks(keyContext, (const u8*)messageBlock->data, (u8*)encryptedMessage->data, 1);
+}
+
+void Utility::Aes128BlocksEncrypt(const Aes128Block* messageBlocks, const Aes128KeyContext& keyContext, Aes128Block* encryptedMessages, u32 numBlocks)
+{
+	FruityHal::EcbEncryptBlocks(keyContext, (const u8*)messageBlocks->data, (u8*)encryptedMessages->data, numBlocks);
+}
+
 void Utility::XorBytes(const u8* src1, const u8* src2, const u8 numBytes, u8* out) {
 	for(u8 i = 0; i < numBytes; i++) {
 		out[i] = src1[i] ^ src2[i];
@@ -39,6 +39,8 @@ typedef struct Aes128Block {
 	uint8_t data[16];
 }Aes128Block;
 
+typedef FruityHal::EcbKeyContext Aes128KeyContext;
+
 class Module;
 class RecordStorageEventListener;
 
@@ -90,6 +92,11 @@ namespace Utility
 
 	//Encryption Functionality
 	void Aes128BlockEncrypt(const Aes128Block* messageBlock, const Aes128Block* key, Aes128Block* encryptedMessage);
+	//Prepares a key once so that it can be used for many encryptions, e.g. for a session key
+	void Aes128PrepareKey(const Aes128Block* key, Aes128KeyContext* keyContext);
+	void Aes128BlockEncrypt(const Aes128Block* messageBlock, const Aes128KeyContext& keyContext, Aes128Block* encryptedMessage);
+	//Encrypts multiple independent blocks with the same key, e.g. to generate multiple keystream blocks at once
+	void Aes128BlocksEncrypt(const Aes128Block* messageBlocks, const Aes128KeyContext& keyContext, Aes128Block* encryptedMessages, u32 numBlocks);
 	void XorWords(const u32* src1, const u32* src2, const u8 numWords, u32* out);
 	void XorBytes(const u8* src1, const u8* src2, const u8 numBytes, u8* out);
 